@@ -13,6 +13,7 @@ function c4_show_info()
     echo "PROJ_PFX_TARGET=$PROJ_PFX_TARGET"
     echo "PROJ_PFX_CMAKE=$PROJ_PFX_CMAKE"
     echo "CMAKE_FLAGS=$CMAKE_FLAGS"
+    echo "CXXFLAGS_=$CXXFLAGS_"
     echo "NUM_JOBS_BUILD=$NUM_JOBS_BUILD"
     echo "GITHUB_WORKSPACE=$GITHUB_WORKSPACE"
     pwd
@@ -280,7 +281,7 @@ function c4_cfg_test()
             cmake -S $PROJ_DIR -B $build_dir -DCMAKE_INSTALL_PREFIX="$install_dir" \
                   -DCMAKE_BUILD_TYPE=$BT $CMFLAGS \
                   -DCMAKE_C_COMPILER=$CC_ -DCMAKE_CXX_COMPILER=$CXX_ \
-                  -DCMAKE_C_FLAGS="-std=c99 -m$bits" -DCMAKE_CXX_FLAGS="-m$bits"
+                  -DCMAKE_C_FLAGS="-std=c99 -m$bits" -DCMAKE_CXX_FLAGS="-m$bits $CXXFLAGS_"
             cmake --build $build_dir --target help | sed 1d | sort
             ;;
         arm*|"")
@@ -0,0 +1,237 @@
+#include <ryml.hpp>
+#include <ryml_std.hpp>
+#include <c4/fs/fs.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <benchmark/benchmark.h>
+
+namespace bm = benchmark;
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** a directory with many small configuration files, which are created
+ * before running the benchmarks and removed afterwards */
+struct ConfigDir
+{
+    std::string dir;
+    std::vector<std::string> names;
+    std::vector<const char*> paths;
+    size_t num_bytes = 0;
+
+    void create(const char *dir_, size_t num_files)
+    {
+        dir = dir_;
+        #if defined(_WIN32)
+        _mkdir(dir.c_str());
+        #else
+        mkdir(dir.c_str(), 0755);
+        #endif
+        std::string src;
+        for(size_t i = 0; i < num_files; ++i)
+        {
+            src.clear();
+            src += "service: svc" + std::to_string(i) + "\n";
+            src += "replicas: " + std::to_string(i % 7 + 1) + "\n";
+            src += "image: registry.example.com/svc:" + std::to_string(i % 13) + ".0\n";
+            src += "ports: [80, 443]\n";
+            src += "env:\n";
+            for(size_t j = 0; j < 8; ++j)
+                src += "  - {name: VAR" + std::to_string(j) + ", value: \"value " + std::to_string(i * j) + "\"}\n";
+            src += "labels:\n  tier: backend\n  team: platform\n";
+            names.push_back(dir + "/config" + std::to_string(i) + ".yml");
+            c4::fs::file_put_contents(names.back().c_str(), src.data(), src.size());
+            num_bytes += src.size();
+        }
+        for(std::string const& name : names)
+            paths.push_back(name.c_str());
+    }
+
+    void remove_all()
+    {
+        for(std::string const& name : names)
+            ::remove(name.c_str());
+        #if defined(_WIN32)
+        _rmdir(dir.c_str());
+        #else
+        rmdir(dir.c_str());
+        #endif
+    }
+};
+
+ConfigDir s_config_dir;
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+void report(bm::State& st)
+{
+    const size_t num_files = s_config_dir.paths.size();
+    st.SetItemsProcessed(st.iterations() * num_files);
+    st.SetBytesProcessed(st.iterations() * s_config_dir.num_bytes);
+    st.counters["files_per_sec"] = bm::Counter(static_cast<double>(st.iterations() * num_files), bm::Counter::kIsRate);
+}
+
+/** the baseline: read each file into a buffer, and parse a copy of it */
+void ryml_read_parse(bm::State& st)
+{
+    std::vector<char> buf;
+    size_t num_nodes = 0;
+    for(auto _ : st)
+    {
+        for(const char *path : s_config_dir.paths)
+        {
+            c4::fs::file_get_contents(path, &buf);
+            ryml::Tree t = ryml::parse(c4::to_csubstr(path), c4::csubstr(buf.data(), buf.size()));
+            num_nodes += t.size();
+        }
+    }
+    bm::DoNotOptimize(num_nodes);
+    report(st);
+}
+
+/** read each file into a reused tree, and parse it there, sequentially */
+void ryml_context_load(bm::State& st)
+{
+    ryml::ParseContext ctx;
+    size_t num_nodes = 0;
+    for(auto _ : st)
+    {
+        for(const char *path : s_config_dir.paths)
+            num_nodes += ctx.load(path).size();
+    }
+    bm::DoNotOptimize(num_nodes);
+    report(st);
+}
+
+/** load the files with a pool of workers; the argument is the number
+ * of threads */
+void ryml_load_files(bm::State& st)
+{
+    const size_t num_threads = static_cast<size_t>(st.range(0));
+    std::vector<size_t> num_nodes(s_config_dir.paths.size());
+    for(auto _ : st)
+    {
+        ryml::load_files(s_config_dir.paths.data(), s_config_dir.paths.size(), [&](size_t i, ryml::Tree &t){
+            num_nodes[i] = t.size();
+        }, num_threads);
+    }
+    bm::DoNotOptimize(num_nodes.data());
+    report(st);
+}
+
+/** a queue of tiny messages, parsed from memory */
+struct Messages
+{
+    std::vector<std::string> srcs;
+    size_t num_bytes = 0;
+
+    Messages(size_t num_messages)
+    {
+        for(size_t i = 0; i < num_messages; ++i)
+        {
+            std::string src;
+            src += "id: " + std::to_string(i) + "\n";
+            src += "method: update\n";
+            src += "params: {key: \"k" + std::to_string(i % 97) + "\", value: " + std::to_string(i * 7) + "}\n";
+            src += "tags: [a, b, c]\n";
+            srcs.push_back(src);
+            num_bytes += src.size();
+        }
+    }
+};
+
+Messages const& messages()
+{
+    static const Messages m(10000);
+    return m;
+}
+
+void report_messages(bm::State& st)
+{
+    st.SetItemsProcessed(st.iterations() * messages().srcs.size());
+    st.SetBytesProcessed(st.iterations() * messages().num_bytes);
+}
+
+/** the baseline: a tree for each message */
+void ryml_messages_tree(bm::State& st)
+{
+    size_t num_nodes = 0;
+    for(auto _ : st)
+    {
+        for(std::string const& src : messages().srcs)
+        {
+            ryml::Tree t = ryml::parse(c4::to_csubstr(src));
+            num_nodes += t.size();
+        }
+    }
+    bm::DoNotOptimize(num_nodes);
+    report_messages(st);
+}
+
+/** the messages parsed one after the other into a reused tree */
+void ryml_messages_context(bm::State& st)
+{
+    ryml::ParseContext ctx;
+    size_t num_nodes = 0;
+    for(auto _ : st)
+    {
+        for(std::string const& src : messages().srcs)
+            num_nodes += ctx.parse(c4::to_csubstr(src)).size();
+    }
+    bm::DoNotOptimize(num_nodes);
+    report_messages(st);
+}
+
+/** all the messages parsed into a batch, which is cleared and reused */
+void ryml_messages_batch(bm::State& st)
+{
+    ryml::TreeBatch batch;
+    size_t num_nodes = 0;
+    for(auto _ : st)
+    {
+        batch.clear();
+        for(std::string const& src : messages().srcs)
+            batch.parse(c4::to_csubstr(src));
+        num_nodes += batch.tree().size();
+    }
+    bm::DoNotOptimize(num_nodes);
+    report_messages(st);
+}
+
+BENCHMARK(ryml_read_parse)->UseRealTime();
+BENCHMARK(ryml_context_load)->UseRealTime();
+BENCHMARK(ryml_load_files)->UseRealTime()->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->Arg(32);
+BENCHMARK(ryml_messages_tree);
+BENCHMARK(ryml_messages_context);
+BENCHMARK(ryml_messages_batch);
+
+
+//-----------------------------------------------------------------------------
+
+/** usage: ryml-bm-load [benchmark options] [<num_files> [<dir>]] */
+int main(int argc, char **argv)
+{
+    bm::Initialize(&argc, argv);
+    size_t num_files = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 30000;
+    const char *dir = argc > 2 ? argv[2] : "ryml-bm-load-files";
+    s_config_dir.create(dir, num_files);
+    bm::RunSpecifiedBenchmarks();
+    s_config_dir.remove_all();
+    return 0;
+}
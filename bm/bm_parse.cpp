@@ -1,11 +1,19 @@
 #include <ryml.hpp>
 #include <ryml_std.hpp>
+#include <c4/yml/detail/simd.hpp>
 #include <c4/fs/fs.hpp>
 #include "../test/libyaml.hpp"
 
 #include <vector>
 #include <iostream>
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include <benchmark/benchmark.h>
 
 #if defined(_MSC_VER)
@@ -339,6 +347,478 @@ void ryml_rw_reuse(bm::State& st)
     st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
 }
 
+/** as ryml_rw_reuse, reporting the memory taken by the nodes: the
+ * size of each node, and the nodes with tags or anchors, whose
+ * properties are kept apart in a table of the tree */
+void ryml_rw_reuse_memory(bm::State& st)
+{
+    size_t sz = 0, num_props = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        s_bm_case->ryml_parser.parse(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+        num_props = s_bm_case->ryml_tree._props_size();
+    }
+    const size_t node_bytes = sz * sizeof(ryml::NodeData) + num_props * sizeof(ryml::NodeProps);
+    st.counters["node_size"] = static_cast<double>(sizeof(ryml::NodeData));
+    st.counters["nodes_with_props"] = static_cast<double>(num_props);
+    st.counters["bytes_per_node"] = sz ? static_cast<double>(node_bytes) / static_cast<double>(sz) : 0.;
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+#ifndef RYML_NO_PARSE_FEATURES
+/** as ryml_rw_reuse, but with a parser accepting only plain data: no
+ * anchors, tags or complex keys. The cases using them are skipped. */
+void ryml_rw_reuse_nofeatures(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    ryml::Parser parser;
+    parser.set_features(0);
+    if( ! parser.validate(c4::to_csubstr(s_bm_case->src)))
+    {
+        st.SkipWithError("the source uses anchors, tags or complex keys");
+        return;
+    }
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        parser.parse(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+#endif
+
+/** as ryml_rw_reuse, always building the structural index before
+ * parsing (index_min_size=0) or never building it (the parser scans
+ * the buffer directly). Comparing these two on each case gives the
+ * source size from which the index pays off, which is the default of
+ * Parser::set_index_min_size(). */
+template<size_t index_min_size>
+void ryml_rw_reuse_index_(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    ryml::Parser parser;
+    parser.set_index_min_size(index_min_size);
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        parser.parse(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+void ryml_rw_reuse_index(bm::State& st) { ryml_rw_reuse_index_<0>(st); }
+void ryml_rw_reuse_noindex(bm::State& st) { ryml_rw_reuse_index_<~size_t(0)>(st); }
+
+/** the stage 1 alone: build the structural index of the source */
+void ryml_index_build(bm::State& st)
+{
+    c4::csubstr src = c4::to_csubstr(s_bm_case->src);
+    ryml::StructuralIndex index;
+    for(auto _ : st)
+    {
+        index.build(src);
+        bm::DoNotOptimize(index.size());
+    }
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+/** a hardware event counter of the calling thread. It is available
+ * only on linux, and only when allowed by the kernel (see
+ * /proc/sys/kernel/perf_event_paranoid) */
+struct PerfCounter
+{
+    int fd = -1;
+    explicit PerfCounter(uint64_t config)
+    {
+        #if defined(__linux__)
+        perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if(fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        #else
+        (void)config;
+        #endif
+    }
+    ~PerfCounter()
+    {
+        #if defined(__linux__)
+        if(fd >= 0)
+            close(fd);
+        #endif
+    }
+    bool available() const { return fd >= 0; }
+    #if defined(__linux__)
+    void resume() { ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
+    void pause() { ioctl(fd, PERF_EVENT_IOC_DISABLE, 0); }
+    uint64_t value() const { uint64_t v = 0; return read(fd, &v, sizeof(v)) == sizeof(v) ? v : 0; }
+    #else
+    void resume() {}
+    void pause() {}
+    uint64_t value() const { return 0; }
+    #endif
+};
+
+/** as ryml_rw_reuse, reporting the branches and the mispredicted
+ * branches per byte of source, as counted by the cpu. These are the
+ * numbers to look at when changing the dispatch of the parser. */
+void ryml_rw_reuse_branches(bm::State& st)
+{
+    #if defined(__linux__)
+    PerfCounter branches(PERF_COUNT_HW_BRANCH_INSTRUCTIONS);
+    PerfCounter misses(PERF_COUNT_HW_BRANCH_MISSES);
+    #else
+    PerfCounter branches(0), misses(0);
+    #endif
+    if( ! branches.available() || ! misses.available())
+    {
+        st.SkipWithError("the cpu counters are not available");
+        return;
+    }
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        branches.resume();
+        misses.resume();
+        s_bm_case->ryml_parser.parse(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        misses.pause();
+        branches.pause();
+        sz = s_bm_case->ryml_tree.size();
+    }
+    const double num_bytes = static_cast<double>(st.iterations()) * static_cast<double>(s_bm_case->src.size());
+    st.counters["branches_per_byte"] = static_cast<double>(branches.value()) / num_bytes;
+    st.counters["branch_misses_per_byte"] = static_cast<double>(misses.value()) / num_bytes;
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+/** count the allocations and the frees, to report the reallocations
+ * of the tree */
+struct CountingResource : public ryml::MemoryResource
+{
+    ryml::MemoryResource *r = ryml::get_memory_resource();
+    size_t num_allocs = 0;
+    size_t num_frees = 0;
+    void* allocate(size_t len, void* hint) override { ++num_allocs; return r->allocate(len, hint); }
+    void free(void *mem, size_t len) override { ++num_frees; r->free(mem, len); }
+};
+
+/** parse into a new tree, which is reserved from
+ * estimate_tree_capacity(). Reports the allocations made by the tree,
+ * and its reallocations, ie the buffers of nodes or arena which were
+ * outgrown and freed during the parse. */
+void ryml_ro_estimate(bm::State& st)
+{
+    CountingResource res;
+    c4::csubstr src = c4::to_csubstr(s_bm_case->src);
+    ryml::Parser parser;
+    size_t sz = 0, allocs = 0, reallocs = 0;
+    for(auto _ : st)
+    {
+        ryml::Tree tree{ryml::Allocator(&res)};
+        res.num_allocs = 0;
+        res.num_frees = 0;
+        parser.parse(s_bm_case->filename, src, &tree);
+        allocs = res.num_allocs;
+        reallocs = res.num_frees; // the tree frees nothing else before it is destroyed
+        sz = tree.size();
+    }
+    st.counters["nodes"] = static_cast<double>(sz);
+    st.counters["estimate"] = static_cast<double>(ryml::estimate_tree_capacity(src).nodes);
+    st.counters["tree_allocs"] = static_cast<double>(allocs);
+    st.counters["tree_reallocs"] = static_cast<double>(reallocs);
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_ro_context(bm::State& st)
+{
+    size_t sz = 0;
+    c4::csubstr src = c4::to_csubstr(s_bm_case->src);
+    ryml::ParseContext &ctx = ryml::ParseContext::this_thread();
+    for(auto _ : st)
+    {
+        ryml::Tree const& tree = ctx.parse(s_bm_case->filename, src);
+        sz = tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_rw_context(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    ryml::ParseContext &ctx = ryml::ParseContext::this_thread();
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace);
+        ryml::Tree const& tree = ctx.parse(s_bm_case->filename, src);
+        sz = tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+/** parse the file from a private mapping, instead of reading it
+ * into a buffer which is then copied to the arena */
+void ryml_file(bm::State& st)
+{
+    size_t sz = 0;
+    std::string path(s_bm_case->filename.str, s_bm_case->filename.len);
+    for(auto _ : st)
+    {
+        ryml::Tree tree = ryml::parse_file(path.c_str());
+        sz = tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * (s_bm_case->src.size() - 1)); // without the terminating null
+}
+
+/** as ryml_file, with the file read into a buffer, as before parse_file() */
+void ryml_file_read(bm::State& st)
+{
+    size_t sz = 0;
+    std::string path(s_bm_case->filename.str, s_bm_case->filename.len);
+    std::vector<char> buf;
+    for(auto _ : st)
+    {
+        c4::fs::file_get_contents(path.c_str(), &buf);
+        ryml::Tree tree = ryml::parse(s_bm_case->filename, c4::csubstr(buf.data(), buf.size()));
+        sz = tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * (s_bm_case->src.size() - 1));
+}
+
+/** counts the events; the handler methods are inlined into the
+ * dispatcher instantiated by the parser */
+struct CountingHandler
+{
+    size_t num_containers = 0;
+    size_t num_scalars = 0;
+    void begin_doc() {}
+    void end_doc() {}
+    void begin_map() { ++num_containers; }
+    void end_map() {}
+    void begin_seq() { ++num_containers; }
+    void end_seq() {}
+    void key(c4::csubstr) { ++num_scalars; }
+    void val(c4::csubstr) { ++num_scalars; }
+};
+
+/** as ryml_rw_reuse, sending the events to a handler instead of
+ * building the tree */
+void ryml_rw_reuse_events(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    ryml::Parser parser;
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace);
+        CountingHandler handler;
+        parser.parse_events(s_bm_case->filename, src, &handler);
+        sz = handler.num_containers + handler.num_scalars;
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_validate(bm::State& st)
+{
+    c4::csubstr src = c4::to_csubstr(s_bm_case->src);
+    ryml::Parser parser;
+    bool ok = true;
+    for(auto _ : st)
+    {
+        ok = parser.validate(s_bm_case->filename, src).ok;
+    }
+    if( ! ok)
+        st.SkipWithError("invalid source");
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+
+void ryml_rw_reuse_parallel(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        ryml::parse_stream_parallel(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_rw_reuse_parallel_entries(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        ryml::parse_parallel(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+
+/** the lazy parse skips the nested containers: it pays off when only a
+ * part of the document is accessed */
+void ryml_rw_reuse_lazy(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    ryml::Parser parser;
+    parser.set_lazy(true);
+    for(auto _ : st)
+    {
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        parser.parse(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+
+/** the dedicated JSON parser, to compare with the json libraries */
+void ryml_ro_json(bm::State& st)
+{
+    size_t sz = 0;
+    c4::csubstr src = c4::to_csubstr(s_bm_case->src);
+    for(auto _ : st)
+    {
+        ONLY_FOR_JSON;
+        ryml::Tree tree = ryml::parse_json(s_bm_case->filename, src);
+        sz = tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_rw_json(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    for(auto _ : st)
+    {
+        ONLY_FOR_JSON;
+        s_bm_case->prepare(st, kResetInPlace);
+        ryml::Tree tree = ryml::parse_json(s_bm_case->filename, src);
+        sz = tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_ro_reuse_json(bm::State& st)
+{
+    size_t sz = 0;
+    c4::csubstr src = c4::to_csubstr(s_bm_case->src);
+    for(auto _ : st)
+    {
+        ONLY_FOR_JSON;
+        s_bm_case->prepare(st, kClearTree|kClearTreeArena);
+        s_bm_case->ryml_parser.parse_json(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_rw_reuse_json(bm::State& st)
+{
+    size_t sz = 0;
+    c4::substr src = c4::to_substr(s_bm_case->in_place);
+    for(auto _ : st)
+    {
+        ONLY_FOR_JSON;
+        s_bm_case->prepare(st, kResetInPlace|kClearTree|kClearTreeArena);
+        s_bm_case->ryml_parser.parse_json(s_bm_case->filename, src, &s_bm_case->ryml_tree);
+        sz = s_bm_case->ryml_tree.size();
+    }
+    st.SetItemsProcessed(st.iterations() * sz);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+//-----------------------------------------------------------------------------
+
+/** run the kernel over the whole source, restarting after each match */
+template<size_t (*find_fn)(c4::csubstr)>
+void ryml_kernel_find(bm::State& st)
+{
+    c4::csubstr src = c4::to_csubstr(s_bm_case->src);
+    size_t count = 0;
+    for(auto _ : st)
+    {
+        count = 0;
+        c4::csubstr rem = src;
+        while(!rem.empty())
+        {
+            size_t pos = find_fn(rem);
+            if(pos == c4::csubstr::npos)
+                break;
+            ++count;
+            rem = rem.sub(pos + 1);
+        }
+        bm::DoNotOptimize(count);
+    }
+    st.SetItemsProcessed(st.iterations() * count);
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+/** count the indentation of every line in the source */
+template<size_t (*count_fn)(c4::csubstr)>
+void ryml_kernel_indentation(bm::State& st)
+{
+    std::vector<c4::csubstr> lines;
+    for(c4::csubstr line : c4::to_csubstr(s_bm_case->src).split('\n'))
+        lines.push_back(line);
+    size_t total = 0;
+    for(auto _ : st)
+    {
+        total = 0;
+        for(c4::csubstr line : lines)
+            total += count_fn(line);
+        bm::DoNotOptimize(total);
+    }
+    st.SetItemsProcessed(st.iterations() * lines.size());
+    st.SetBytesProcessed(st.iterations() * s_bm_case->src.size());
+}
+
+void ryml_kernel_newline_scalar(bm::State& st) { ryml_kernel_find<&c4::yml::detail::find_newline_scalar>(st); }
+void ryml_kernel_newline_simd(bm::State& st) { ryml_kernel_find<&c4::yml::detail::find_newline>(st); }
+void ryml_kernel_structural_scalar(bm::State& st) { ryml_kernel_find<&c4::yml::detail::find_structural_scalar>(st); }
+void ryml_kernel_structural_simd(bm::State& st) { ryml_kernel_find<&c4::yml::detail::find_structural>(st); }
+void ryml_kernel_indentation_scalar(bm::State& st) { ryml_kernel_indentation<&c4::yml::detail::count_leading_spaces_scalar>(st); }
+void ryml_kernel_indentation_simd(bm::State& st) { ryml_kernel_indentation<&c4::yml::detail::count_leading_spaces>(st); }
+
+
+//-----------------------------------------------------------------------------
+
 BENCHMARK(rapidjson_ro);
 BENCHMARK(rapidjson_rw);
 BENCHMARK(sajson_rw);
@@ -352,6 +832,34 @@ BENCHMARK(ryml_ro);
 BENCHMARK(ryml_rw);
 BENCHMARK(ryml_ro_reuse);
 BENCHMARK(ryml_rw_reuse);
+#ifndef RYML_NO_PARSE_FEATURES
+BENCHMARK(ryml_rw_reuse_nofeatures);
+#endif
+BENCHMARK(ryml_rw_reuse_memory);
+BENCHMARK(ryml_rw_reuse_branches);
+BENCHMARK(ryml_rw_reuse_index);
+BENCHMARK(ryml_rw_reuse_noindex);
+BENCHMARK(ryml_index_build);
+BENCHMARK(ryml_ro_estimate);
+BENCHMARK(ryml_ro_context);
+BENCHMARK(ryml_rw_context);
+BENCHMARK(ryml_rw_reuse_events);
+BENCHMARK(ryml_validate);
+BENCHMARK(ryml_file_read);
+BENCHMARK(ryml_file);
+BENCHMARK(ryml_rw_reuse_parallel);
+BENCHMARK(ryml_rw_reuse_parallel_entries);
+BENCHMARK(ryml_rw_reuse_lazy);
+BENCHMARK(ryml_ro_json);
+BENCHMARK(ryml_rw_json);
+BENCHMARK(ryml_ro_reuse_json);
+BENCHMARK(ryml_rw_reuse_json);
+BENCHMARK(ryml_kernel_newline_scalar);
+BENCHMARK(ryml_kernel_newline_simd);
+BENCHMARK(ryml_kernel_structural_scalar);
+BENCHMARK(ryml_kernel_structural_simd);
+BENCHMARK(ryml_kernel_indentation_scalar);
+BENCHMARK(ryml_kernel_indentation_simd);
 
 #if defined(_MSC_VER)
 #   pragma warning(pop)
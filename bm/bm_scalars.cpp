@@ -0,0 +1,128 @@
+#include <ryml.hpp>
+#include <ryml_std.hpp>
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+namespace bm = benchmark;
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** a double-quoted scalar of about sz bytes, built by repeating the
+ * given line; the scalar is folded when the line ends with a newline */
+std::string make_dquoted(size_t sz, const char *line)
+{
+    std::string src = "\"";
+    while(src.size() < sz)
+        src += line;
+    src += "\"\n";
+    return src;
+}
+
+/** a block map with a single key whose value is a scalar of about sz
+ * bytes, built by repeating the given (indented) line after the given
+ * header. Use an empty header for a multi-line plain scalar. */
+std::string make_keyval(size_t sz, const char *header, const char *line)
+{
+    std::string src = "key: ";
+    src += header;
+    src += "\n";
+    while(src.size() < sz)
+        src += line;
+    src += "other: value\n";
+    return src;
+}
+
+/** parse the source in-situ, restoring it before each iteration.
+ * The scalar is the value of the root or of its first child. */
+void parse_scalar(bm::State& st, std::string const& src)
+{
+    std::string buf = src;
+    ryml::Parser parser;
+    ryml::Tree tree;
+    size_t len = 0;
+    for(auto _ : st)
+    {
+        st.PauseTiming();
+        buf = src;
+        tree.clear();
+        tree.clear_arena();
+        st.ResumeTiming();
+        parser.parse({}, ryml::to_substr(buf), &tree);
+        size_t node = tree.root_id();
+        if( ! tree.has_val(node))
+            node = tree.first_child(node);
+        len = tree.val(node).len;
+    }
+    bm::DoNotOptimize(len);
+    st.SetBytesProcessed(st.iterations() * static_cast<int64_t>(src.size()));
+}
+
+void ryml_dquot_plain(bm::State& st)
+{
+    parse_scalar(st, make_dquoted(static_cast<size_t>(st.range(0)), "the quick brown fox jumps over the lazy dog. "));
+}
+
+void ryml_dquot_escapes(bm::State& st)
+{
+    parse_scalar(st, make_dquoted(static_cast<size_t>(st.range(0)), "{\\\"key\\\": \\\"val\\\\ue\\\", \\\"n\\\": [1, 2]}\\n"));
+}
+
+void ryml_dquot_unicode(bm::State& st)
+{
+    parse_scalar(st, make_dquoted(static_cast<size_t>(st.range(0)), "caf\\u00e9 na\\u00efve \\U0001F600 \\x41\\t"));
+}
+
+void ryml_dquot_folded(bm::State& st)
+{
+    parse_scalar(st, make_dquoted(static_cast<size_t>(st.range(0)), "MIIBIjANBgkqhkiG9w0BAQEFAAOCAQ8AMIIBCgKCAQEA\n  "));
+}
+
+void ryml_plain_multiline(bm::State& st)
+{
+    parse_scalar(st, make_keyval(static_cast<size_t>(st.range(0)), "", "  the quick brown fox jumps over the lazy dog\n\n"));
+}
+
+void ryml_block_literal(bm::State& st)
+{
+    parse_scalar(st, make_keyval(static_cast<size_t>(st.range(0)), "|", "  for f in *.yml ; do\n    echo \"$f\"\n  done\n\n"));
+}
+
+/** the same lines as a multi-line plain scalar and as a block literal,
+ * to compare the scan of both */
+void ryml_same_lines_plain(bm::State& st)
+{
+    parse_scalar(st, make_keyval(static_cast<size_t>(st.range(0)), "", "  the quick brown fox jumps over the lazy dog\n"));
+}
+
+void ryml_same_lines_literal(bm::State& st)
+{
+    parse_scalar(st, make_keyval(static_cast<size_t>(st.range(0)), "|", "  the quick brown fox jumps over the lazy dog\n"));
+}
+
+void ryml_block_literal_keep(bm::State& st)
+{
+    parse_scalar(st, make_keyval(static_cast<size_t>(st.range(0)), "|+", "  MIIBIjANBgkqhkiG9w0BAQEFAAOCAQ8AMIIBCgKCAQEA\r\n"));
+}
+
+void ryml_block_folded(bm::State& st)
+{
+    parse_scalar(st, make_keyval(static_cast<size_t>(st.range(0)), ">-", "  the quick brown fox\n  jumps over the lazy dog\n\n"));
+}
+
+BENCHMARK(ryml_dquot_plain)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_dquot_escapes)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_dquot_unicode)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_dquot_folded)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_plain_multiline)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_block_literal)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_same_lines_plain)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_same_lines_literal)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_block_literal_keep)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(ryml_block_folded)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,267 @@
+#include <ryml.hpp>
+#include <ryml_std.hpp>
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace bm = benchmark;
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** a large tree built in memory: a sequence of records, each a map
+ * with some scalars and a small sequence */
+struct BigTree
+{
+    ryml::Tree tree;
+    size_t num_bytes = 0; // the size of the emitted tree
+
+    void create(size_t num_nodes)
+    {
+        const size_t nodes_per_record = 9;
+        const size_t num_records = num_nodes / nodes_per_record + 1;
+        tree.reserve(num_records * nodes_per_record + 1);
+        tree.reserve_arena(num_records * 8);
+        ryml::NodeRef root = tree.rootref();
+        root |= ryml::SEQ;
+        for(size_t i = 0; i < num_records; ++i)
+        {
+            ryml::NodeRef rec = root.append_child();
+            rec |= ryml::MAP;
+            rec["id"] << i;
+            rec["name"] = "record";
+            rec["enabled"] = (i & 1) ? "true" : "false";
+            rec["weight"] << (i % 100);
+            ryml::NodeRef tags = rec["tags"];
+            tags |= ryml::SEQ;
+            tags.append_child() = "a";
+            tags.append_child() = "b";
+            tags.append_child() = "c";
+        }
+        std::string buf;
+        num_bytes = ryml::emitrs(tree, &buf).len;
+    }
+};
+
+BigTree s_big_tree;
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** emit the whole tree to a reused buffer */
+void ryml_tree_emit(bm::State& st)
+{
+    std::string buf;
+    size_t len = 0;
+    for(auto _ : st)
+        len += ryml::emitrs(s_big_tree.tree, &buf).len;
+    bm::DoNotOptimize(len);
+    st.SetItemsProcessed(st.iterations() * s_big_tree.tree.size());
+    st.SetBytesProcessed(st.iterations() * s_big_tree.num_bytes);
+}
+
+/** walk the tree with NodeRef::visit(), looking only at the node types */
+void ryml_tree_visit(bm::State& st)
+{
+    size_t num_containers = 0;
+    for(auto _ : st)
+    {
+        s_big_tree.tree.rootref().visit([&](ryml::NodeRef const* n, size_t){
+            num_containers += n->is_container();
+            return false;
+        });
+    }
+    bm::DoNotOptimize(num_containers);
+    st.SetItemsProcessed(st.iterations() * s_big_tree.tree.size());
+}
+
+/** walk the tree through the links, looking at the values of the leaves */
+void ryml_tree_walk(bm::State& st)
+{
+    ryml::Tree const& t = s_big_tree.tree;
+    size_t len = 0;
+    for(auto _ : st)
+    {
+        for(ryml::id_type rec = t.first_child(t.root_id()); rec != ryml::NONE; rec = t.next_sibling(rec))
+            for(ryml::id_type ch = t.first_child(rec); ch != ryml::NONE; ch = t.next_sibling(ch))
+                if(t.has_val(ch))
+                    len += t.val(ch).len;
+    }
+    bm::DoNotOptimize(len);
+    st.SetItemsProcessed(st.iterations() * t.size());
+}
+
+/** query the type of every node, in the order of the node buffer */
+void ryml_tree_types(bm::State& st)
+{
+    ryml::Tree const& t = s_big_tree.tree;
+    size_t num_maps = 0;
+    for(auto _ : st)
+    {
+        for(ryml::id_type i = 0; i < t.size(); ++i)
+            num_maps += t.is_map(i);
+    }
+    bm::DoNotOptimize(num_maps);
+    st.SetItemsProcessed(st.iterations() * t.size());
+}
+
+/** a map with many keys, as a catalog of services */
+struct BigMap
+{
+    ryml::Tree tree;
+    std::vector<std::string> keys;
+
+    BigMap(size_t num_keys)
+    {
+        std::string src;
+        for(size_t i = 0; i < num_keys; ++i)
+        {
+            keys.push_back("service-" + std::to_string(i * 7919 % num_keys));
+            src += keys.back() + ": {replicas: " + std::to_string(i % 5 + 1) + "}\n";
+        }
+        tree = ryml::parse(c4::to_csubstr(src));
+    }
+};
+
+BigMap const& big_map()
+{
+    static const BigMap m(80000);
+    return m;
+}
+
+void report_lookups(bm::State& st)
+{
+    st.SetItemsProcessed(st.iterations() * big_map().keys.size());
+}
+
+/** look up every key of the big map, walking its children */
+void ryml_map_find_linear(bm::State& st)
+{
+    ryml::Tree const& t = big_map().tree;
+    size_t num_found = 0;
+    for(auto _ : st)
+    {
+        for(std::string const& k : big_map().keys)
+            num_found += t.find_child(t.root_id(), c4::to_csubstr(k)) != ryml::NONE;
+    }
+    bm::DoNotOptimize(num_found);
+    report_lookups(st);
+}
+
+/** look up every key of the big map, using its index */
+void ryml_map_find_index(bm::State& st)
+{
+    ryml::Tree t = big_map().tree;
+    t.build_index(t.root_id());
+    size_t num_found = 0;
+    for(auto _ : st)
+    {
+        for(std::string const& k : big_map().keys)
+            num_found += t.find_child(t.root_id(), c4::to_csubstr(k)) != ryml::NONE;
+    }
+    bm::DoNotOptimize(num_found);
+    report_lookups(st);
+}
+
+/** merge the big map into a copy of itself */
+void ryml_map_merge(bm::State& st)
+{
+    ryml::Tree const& src = big_map().tree;
+    size_t num_nodes = 0;
+    for(auto _ : st)
+    {
+        ryml::Tree dst = src;
+        dst.merge_with(&src);
+        num_nodes += dst.size();
+    }
+    bm::DoNotOptimize(num_nodes);
+    report_lookups(st);
+}
+
+/** a long sequence of scalars */
+ryml::Tree const& big_seq()
+{
+    static const ryml::Tree t = []{
+        std::string src;
+        for(size_t i = 0; i < 20000; ++i)
+            src += "- " + std::to_string(i) + "\n";
+        return ryml::parse(c4::to_csubstr(src));
+    }();
+    return t;
+}
+
+/** access each element of the sequence by index, walking the siblings */
+void ryml_seq_child_walk(bm::State& st)
+{
+    ryml::Tree const& t = big_seq();
+    const size_t num = t.num_children(t.root_id());
+    size_t len = 0;
+    for(auto _ : st)
+    {
+        for(size_t i = 0; i < num; ++i)
+            len += t.val(t.child(t.root_id(), i)).len;
+    }
+    bm::DoNotOptimize(len);
+    st.SetItemsProcessed(st.iterations() * num);
+}
+
+/** access each element of the sequence by index, using the array of children */
+void ryml_seq_child_ids(bm::State& st)
+{
+    ryml::Tree t = big_seq();
+    t.build_child_ids(t.root_id());
+    const size_t num = t.num_children(t.root_id());
+    size_t len = 0;
+    for(auto _ : st)
+    {
+        for(size_t i = 0; i < num; ++i)
+            len += t.val(t.child(t.root_id(), i)).len;
+    }
+    bm::DoNotOptimize(len);
+    st.SetItemsProcessed(st.iterations() * num);
+}
+
+/** count the children of every node */
+void ryml_tree_num_children(bm::State& st)
+{
+    ryml::Tree const& t = s_big_tree.tree;
+    size_t num = 0;
+    for(auto _ : st)
+    {
+        for(ryml::id_type i = 0; i < t.size(); ++i)
+            num += t.num_children(i);
+    }
+    bm::DoNotOptimize(num);
+    st.SetItemsProcessed(st.iterations() * t.size());
+}
+
+BENCHMARK(ryml_tree_emit);
+BENCHMARK(ryml_tree_visit);
+BENCHMARK(ryml_tree_walk);
+BENCHMARK(ryml_tree_types);
+BENCHMARK(ryml_map_find_linear);
+BENCHMARK(ryml_map_find_index);
+BENCHMARK(ryml_map_merge);
+BENCHMARK(ryml_seq_child_walk);
+BENCHMARK(ryml_seq_child_ids);
+BENCHMARK(ryml_tree_num_children);
+
+
+//-----------------------------------------------------------------------------
+
+/** usage: ryml-bm-tree [benchmark options] [<num_nodes>] */
+int main(int argc, char **argv)
+{
+    bm::Initialize(&argc, argv);
+    size_t num_nodes = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 10000000;
+    s_big_tree.create(num_nodes);
+    bm::RunSpecifiedBenchmarks();
+    return 0;
+}
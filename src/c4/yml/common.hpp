@@ -2,6 +2,8 @@
 #define _C4_YML_COMMON_HPP_
 
 #include <cstddef>
+#include <cstdint>
+#include <type_traits>
 #include <c4/substr.hpp>
 #include <c4/yml/export.hpp>
 
@@ -9,6 +11,15 @@
 #define RYML_INLINE inline
 
 
+/** the integral type of the node ids. Define it to a narrower type
+ * (eg uint32_t) to halve the size of the links between the nodes,
+ * when the trees have less nodes than it can count. This must be
+ * defined in the same way for the library and for its users. */
+#ifndef RYML_ID_TYPE
+#   define RYML_ID_TYPE size_t
+#endif
+
+
 #ifndef RYML_USE_ASSERT
 #   define RYML_USE_ASSERT C4_USE_ASSERT
 #endif
@@ -50,11 +61,18 @@
 namespace c4 {
 namespace yml {
 
+/** the type of the node ids. @see RYML_ID_TYPE */
+using id_type = RYML_ID_TYPE;
+static_assert(std::is_integral<id_type>::value && std::is_unsigned<id_type>::value, "RYML_ID_TYPE must be an unsigned integral type");
+
 enum : size_t {
     /** a null position */
-    npos = size_t(-1),
+    npos = size_t(-1)
+};
+
+enum : id_type {
     /** an index to none */
-    NONE = size_t(-1)
+    NONE = id_type(-1)
 };
 
 
@@ -17,7 +17,7 @@ namespace c4 {
 namespace yml {
 
 
-void check_invariants(Tree const& t, size_t node=NONE);
+void check_invariants(Tree const& t, id_type node=NONE);
 void check_free_list(Tree const& t);
 void check_arena(Tree const& t);
 
@@ -26,7 +26,7 @@ void check_arena(Tree const& t);
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
-inline void check_invariants(Tree const& t, size_t node)
+inline void check_invariants(Tree const& t, id_type node)
 {
     if(node == NONE)
     {
@@ -101,7 +101,7 @@ inline void check_invariants(Tree const& t, size_t node)
     }
 
     size_t count = 0;
-    for(size_t i = n.m_first_child; i != NONE; i = t.next_sibling(i))
+    for(id_type i = n.m_first_child; i != NONE; i = t.next_sibling(i))
     {
 #ifdef RYML_DBG
         printf("check(%zu):               descend to child[%zu]=%zu\n", node, count, i);
@@ -131,7 +131,7 @@ inline void check_invariants(Tree const& t, size_t node)
         check_arena(t);
     }
 
-    for(size_t i = t.first_child(node); i != NONE; i = t.next_sibling(i))
+    for(id_type i = t.first_child(node); i != NONE; i = t.next_sibling(i))
     {
         check_invariants(t, i);
     }
@@ -160,7 +160,7 @@ inline void check_free_list(Tree const& t)
     //C4_CHECK(tail.m_next_sibling == NONE);
 
     size_t count = 0;
-    for(size_t i = t.m_free_head, prev = NONE; i != NONE; i = t._p(i)->m_next_sibling)
+    for(id_type i = t.m_free_head, prev = NONE; i != NONE; i = t._p(i)->m_next_sibling)
     {
         auto const& elm = *t._p(i);
         if(&elm != &head)
@@ -0,0 +1,102 @@
+#ifndef _C4_YML_DETAIL_DOC_SPLITTER_HPP_
+#define _C4_YML_DETAIL_DOC_SPLITTER_HPP_
+
+#ifndef _C4_YML_COMMON_HPP_
+#include "../common.hpp"
+#endif
+
+namespace c4 {
+namespace yml {
+namespace detail {
+
+/** Finds the documents of a YAML stream from its lines, without
+ * parsing them. The documents are delimited by the markers
+ * <tt>---</tt> and <tt>...</tt> at the beginning of a line, which
+ * YAML forbids inside document contents (including block and quoted
+ * scalars). A <tt>---</tt> line starts a new document, and a
+ * <tt>...</tt> line ends the current one. Directives and comments
+ * alone do not make a document, so they go with the document that
+ * follows them. */
+struct doc_splitter
+{
+    size_t doc_start;       //!< the start of the current (incomplete) document
+    bool   doc_has_content; //!< whether the current document has anything besides directives and comments
+
+    doc_splitter() : doc_start(0), doc_has_content(false) {}
+
+    void reset(size_t pos=0)
+    {
+        doc_start = pos;
+        doc_has_content = false;
+    }
+
+    /** scan a line
+     * @param line the line contents, without the newline
+     * @param first the position of the line start
+     * @param next the position of the next line start
+     * @param doc receives the range of the completed document, if any
+     * @return true if the line completed a document */
+    bool scan_line(csubstr line, size_t first, size_t next, size_t (*doc)[2])
+    {
+        if(line.ends_with('\r'))
+            line = line.first(line.len - 1);
+        if(_is_marker(line, "---"))
+        {
+            bool completed = doc_has_content;
+            if(completed)
+            {
+                (*doc)[0] = doc_start;
+                (*doc)[1] = first;
+                doc_start = first;
+            }
+            doc_has_content = true;
+            return completed;
+        }
+        else if(_is_marker(line, "..."))
+        {
+            // the marker line belongs to the doc it ends
+            bool completed = doc_has_content;
+            if(completed)
+            {
+                (*doc)[0] = doc_start;
+                (*doc)[1] = next;
+            }
+            reset(next);
+            return completed;
+        }
+        else if( ! doc_has_content)
+        {
+            csubstr trimmed = line.triml(" \t");
+            if( ! trimmed.empty() && trimmed[0] != '#' && line[0] != '%')
+                doc_has_content = true;
+        }
+        return false;
+    }
+
+    /** signal the end of the stream
+     * @param end the stream size
+     * @param doc receives the range of the last document, if any
+     * @return true if there was a last document */
+    bool finish(size_t end, size_t (*doc)[2])
+    {
+        bool completed = doc_has_content;
+        if(completed)
+        {
+            (*doc)[0] = doc_start;
+            (*doc)[1] = end;
+        }
+        reset(end);
+        return completed;
+    }
+
+    static bool _is_marker(csubstr line, const char (&marker)[4])
+    {
+        return line.begins_with(marker) && (line.len == 3 || line[3] == ' ' || line[3] == '\t');
+    }
+};
+
+} // namespace detail
+} // namespace yml
+} // namespace c4
+
+#endif /* _C4_YML_DETAIL_DOC_SPLITTER_HPP_ */
@@ -9,9 +9,9 @@ namespace c4 {
 namespace yml {
 
 
-inline size_t print_node(Tree const& p, size_t node, int level, size_t count, bool print_children)
+inline size_t print_node(Tree const& p, id_type node, int level, size_t count, bool print_children)
 {
-    printf("[%zd]%*s[%zd] %p", count, (2*level), "", node, (void*)p.get(node));
+    printf("[%zd]%*s[%zd] %p", count, (2*level), "", (size_t)node, (void*)p.get(node));
     if(p.is_root(node))
     {
         printf(" [ROOT]");
@@ -76,7 +76,7 @@ inline size_t print_node(Tree const& p, size_t node, int level, size_t count, bo
         printf(" %zd children:\n", p.num_children(node));
         if(print_children)
         {
-            for(size_t i = p.first_child(node); i != NONE; i = p.next_sibling(i))
+            for(id_type i = p.first_child(node); i != NONE; i = p.next_sibling(i))
             {
                 count = print_node(p, i, level+1, count, print_children);
             }
@@ -105,7 +105,7 @@ inline void print_node(NodeRef const& p, int level=0)
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
-inline size_t print_tree(Tree const& p, size_t node=NONE)
+inline size_t print_tree(Tree const& p, id_type node=NONE)
 {
     if(node == NONE)
     {
@@ -0,0 +1,509 @@
+#ifndef _C4_YML_DETAIL_SIMD_HPP_
+#define _C4_YML_DETAIL_SIMD_HPP_
+
+#ifndef _C4_YML_COMMON_HPP_
+#include "../common.hpp"
+#endif
+
+#include <stdint.h>
+
+/** @file simd.hpp Vectorized scanning kernels used in the parser's hot
+ * loops. Every kernel has a scalar version, which is always compiled and
+ * is also used to process the tail of the buffer.
+ *
+ * The instruction set is selected at compile time from the compiler's
+ * target flags: AVX2 (eg -mavx2), SSE2 (always available on x86_64) or
+ * NEON (always available on aarch64). Define RYML_NO_SIMD to force the
+ * scalar versions. */
+
+#if !defined(RYML_NO_SIMD)
+#   if defined(__AVX2__)
+#       define RYML_SIMD_AVX2
+#   endif
+#   if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#       define RYML_SIMD_SSE2
+#   elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#       define RYML_SIMD_NEON
+#   endif
+#endif
+
+#if defined(RYML_SIMD_AVX2)
+#   include <immintrin.h>
+#elif defined(RYML_SIMD_SSE2)
+#   include <emmintrin.h>
+#elif defined(RYML_SIMD_NEON)
+#   include <arm_neon.h>
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#   include <intrin.h>
+#endif
+
+
+namespace c4 {
+namespace yml {
+namespace detail {
+
+C4_ALWAYS_INLINE unsigned _simd_ctz32(uint32_t mask)
+{
+    RYML_ASSERT(mask != 0);
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long pos;
+    _BitScanForward(&pos, mask);
+    return static_cast<unsigned>(pos);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+C4_ALWAYS_INLINE unsigned _simd_ctz64(uint64_t mask)
+{
+    RYML_ASSERT(mask != 0);
+#if defined(_MSC_VER) && !defined(__clang__)
+    uint32_t lo = static_cast<uint32_t>(mask);
+    return lo ? _simd_ctz32(lo) : 32u + _simd_ctz32(static_cast<uint32_t>(mask >> 32));
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+C4_ALWAYS_INLINE unsigned _simd_popcount64(uint64_t mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    mask = mask - ((mask >> 1) & 0x5555555555555555ull);
+    mask = (mask & 0x3333333333333333ull) + ((mask >> 2) & 0x3333333333333333ull);
+    mask = (mask + (mask >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<unsigned>((mask * 0x0101010101010101ull) >> 56);
+#else
+    return static_cast<unsigned>(__builtin_popcountll(mask));
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** @name character matchers
+ * Each matcher flags the bytes it is looking for, either one at a time
+ * (scalar) or a full register at a time (the flagged lanes are set to 0xff).
+ * @{ */
+
+/** matches the newline characters \n and \r */
+struct match_newline
+{
+    C4_ALWAYS_INLINE static bool scalar(char c) { return c == '\n' || c == '\r'; }
+#if defined(RYML_SIMD_AVX2)
+    C4_ALWAYS_INLINE static __m256i avx2(__m256i v)
+    {
+        return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+    }
+#endif
+#if defined(RYML_SIMD_SSE2)
+    C4_ALWAYS_INLINE static __m128i sse2(__m128i v)
+    {
+        return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    }
+#elif defined(RYML_SIMD_NEON)
+    C4_ALWAYS_INLINE static uint8x16_t neon(uint8x16_t v)
+    {
+        return vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')),
+                        vceqq_u8(v, vdupq_n_u8('\r')));
+    }
+#endif
+};
+
+/** matches any character other than a space: used to count indentation */
+struct match_not_space
+{
+    C4_ALWAYS_INLINE static bool scalar(char c) { return c != ' '; }
+#if defined(RYML_SIMD_AVX2)
+    C4_ALWAYS_INLINE static __m256i avx2(__m256i v)
+    {
+        return _mm256_xor_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                _mm256_set1_epi8(-1));
+    }
+#endif
+#if defined(RYML_SIMD_SSE2)
+    C4_ALWAYS_INLINE static __m128i sse2(__m128i v)
+    {
+        return _mm_xor_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                             _mm_set1_epi8(-1));
+    }
+#elif defined(RYML_SIMD_NEON)
+    C4_ALWAYS_INLINE static uint8x16_t neon(uint8x16_t v)
+    {
+        return vmvnq_u8(vceqq_u8(v, vdupq_n_u8(' ')));
+    }
+#endif
+};
+
+/** matches the YAML structural characters: <tt>: - # ' " [ ] { } ,</tt> */
+struct match_structural
+{
+    C4_ALWAYS_INLINE static bool scalar(char c)
+    {
+        switch(c)
+        {
+        case ':': case '-': case '#': case '\'': case '"':
+        case '[': case ']': case '{': case '}': case ',':
+            return true;
+        default:
+            return false;
+        }
+    }
+#if defined(RYML_SIMD_AVX2)
+    C4_ALWAYS_INLINE static __m256i avx2(__m256i v)
+    {
+        #define _c4cmp(c) _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))
+        __m256i a = _mm256_or_si256(_mm256_or_si256(_c4cmp(':'), _c4cmp('-')), _mm256_or_si256(_c4cmp('#'), _c4cmp('\'')));
+        __m256i b = _mm256_or_si256(_mm256_or_si256(_c4cmp('"'), _c4cmp(',')), _mm256_or_si256(_c4cmp('['), _c4cmp(']')));
+        __m256i c = _mm256_or_si256(_c4cmp('{'), _c4cmp('}'));
+        #undef _c4cmp
+        return _mm256_or_si256(_mm256_or_si256(a, b), c);
+    }
+#endif
+#if defined(RYML_SIMD_SSE2)
+    C4_ALWAYS_INLINE static __m128i sse2(__m128i v)
+    {
+        #define _c4cmp(c) _mm_cmpeq_epi8(v, _mm_set1_epi8(c))
+        __m128i a = _mm_or_si128(_mm_or_si128(_c4cmp(':'), _c4cmp('-')), _mm_or_si128(_c4cmp('#'), _c4cmp('\'')));
+        __m128i b = _mm_or_si128(_mm_or_si128(_c4cmp('"'), _c4cmp(',')), _mm_or_si128(_c4cmp('['), _c4cmp(']')));
+        __m128i c = _mm_or_si128(_c4cmp('{'), _c4cmp('}'));
+        #undef _c4cmp
+        return _mm_or_si128(_mm_or_si128(a, b), c);
+    }
+#elif defined(RYML_SIMD_NEON)
+    C4_ALWAYS_INLINE static uint8x16_t neon(uint8x16_t v)
+    {
+        #define _c4cmp(c) vceqq_u8(v, vdupq_n_u8(static_cast<uint8_t>(c)))
+        uint8x16_t a = vorrq_u8(vorrq_u8(_c4cmp(':'), _c4cmp('-')), vorrq_u8(_c4cmp('#'), _c4cmp('\'')));
+        uint8x16_t b = vorrq_u8(vorrq_u8(_c4cmp('"'), _c4cmp(',')), vorrq_u8(_c4cmp('['), _c4cmp(']')));
+        uint8x16_t c = vorrq_u8(_c4cmp('{'), _c4cmp('}'));
+        #undef _c4cmp
+        return vorrq_u8(vorrq_u8(a, b), c);
+    }
+#endif
+};
+
+/** matches the characters which need decoding in double-quoted
+ * scalars: the escape character \\ and the newline characters */
+struct match_dquot_special
+{
+    C4_ALWAYS_INLINE static bool scalar(char c) { return c == '\\' || c == '\n' || c == '\r'; }
+#if defined(RYML_SIMD_AVX2)
+    C4_ALWAYS_INLINE static __m256i avx2(__m256i v)
+    {
+        return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')),
+                               _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    }
+#endif
+#if defined(RYML_SIMD_SSE2)
+    C4_ALWAYS_INLINE static __m128i sse2(__m128i v)
+    {
+        return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+                            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    }
+#elif defined(RYML_SIMD_NEON)
+    C4_ALWAYS_INLINE static uint8x16_t neon(uint8x16_t v)
+    {
+        return vorrq_u8(vceqq_u8(v, vdupq_n_u8('\\')),
+                        vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')),
+                                 vceqq_u8(v, vdupq_n_u8('\r'))));
+    }
+#endif
+};
+
+/** matches any of the given characters */
+template<char C, char... Cs>
+struct match_any
+{
+    C4_ALWAYS_INLINE static bool scalar(char c) { return c == C || match_any<Cs...>::scalar(c); }
+#if defined(RYML_SIMD_AVX2)
+    C4_ALWAYS_INLINE static __m256i avx2(__m256i v)
+    {
+        return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(C)), match_any<Cs...>::avx2(v));
+    }
+#endif
+#if defined(RYML_SIMD_SSE2)
+    C4_ALWAYS_INLINE static __m128i sse2(__m128i v)
+    {
+        return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(C)), match_any<Cs...>::sse2(v));
+    }
+#elif defined(RYML_SIMD_NEON)
+    C4_ALWAYS_INLINE static uint8x16_t neon(uint8x16_t v)
+    {
+        return vorrq_u8(vceqq_u8(v, vdupq_n_u8(static_cast<uint8_t>(C))), match_any<Cs...>::neon(v));
+    }
+#endif
+};
+
+/** @overload match_any */
+template<char C>
+struct match_any<C>
+{
+    C4_ALWAYS_INLINE static bool scalar(char c) { return c == C; }
+#if defined(RYML_SIMD_AVX2)
+    C4_ALWAYS_INLINE static __m256i avx2(__m256i v) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(C)); }
+#endif
+#if defined(RYML_SIMD_SSE2)
+    C4_ALWAYS_INLINE static __m128i sse2(__m128i v) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(C)); }
+#elif defined(RYML_SIMD_NEON)
+    C4_ALWAYS_INLINE static uint8x16_t neon(uint8x16_t v) { return vceqq_u8(v, vdupq_n_u8(static_cast<uint8_t>(C))); }
+#endif
+};
+
+/** @} */
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** @name generic kernels
+ * @{ */
+
+/** find the first character in [b,e[ flagged by the matcher, one
+ * byte at a time. Returns e if no such character exists. */
+template<class Match>
+C4_ALWAYS_INLINE const char* scalar_find(const char *b, const char *e)
+{
+    for( ; b < e; ++b)
+    {
+        if(Match::scalar(*b))
+            return b;
+    }
+    return e;
+}
+
+/** find the first character in [b,e[ flagged by the matcher, using
+ * the widest registers available. Returns e if no such character
+ * exists. */
+template<class Match>
+inline const char* simd_find(const char *b, const char *e)
+{
+#if defined(RYML_SIMD_AVX2)
+    for( ; e - b >= 32; b += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(Match::avx2(v)));
+        if(mask)
+            return b + _simd_ctz32(mask);
+    }
+#endif
+#if defined(RYML_SIMD_SSE2)
+    for( ; e - b >= 16; b += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(Match::sse2(v)));
+        if(mask)
+            return b + _simd_ctz32(mask);
+    }
+#elif defined(RYML_SIMD_NEON)
+    for( ; e - b >= 16; b += 16)
+    {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<uint8_t const*>(b));
+        // there's no movemask in NEON: narrow each 16 bit lane to 8
+        // bits, leaving 4 bits per byte in a 64 bit mask
+        uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(Match::neon(v)), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+        if(mask)
+            return b + (_simd_ctz64(mask) >> 2);
+    }
+#endif
+    return scalar_find<Match>(b, e);
+}
+
+/** get a bitmask flagging the characters in [b,e[ which are matched,
+ * one byte at a time. Bit i corresponds to b[i]; e-b must not exceed 64. */
+template<class Match>
+C4_ALWAYS_INLINE uint64_t scalar_mask(const char *b, const char *e)
+{
+    RYML_ASSERT(e - b <= 64);
+    uint64_t mask = 0;
+    for(uint64_t bit = 1; b < e; ++b, bit <<= 1)
+    {
+        if(Match::scalar(*b))
+            mask |= bit;
+    }
+    return mask;
+}
+
+/** get a bitmask flagging the matched characters in the 64 bytes
+ * starting at b. Bit i corresponds to b[i]. */
+template<class Match>
+C4_ALWAYS_INLINE uint64_t simd_mask64(const char *b)
+{
+#if defined(RYML_SIMD_AVX2)
+    uint64_t lo = static_cast<uint32_t>(_mm256_movemask_epi8(Match::avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(b)))));
+    uint64_t hi = static_cast<uint32_t>(_mm256_movemask_epi8(Match::avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + 32)))));
+    return lo | (hi << 32);
+#elif defined(RYML_SIMD_SSE2)
+    uint64_t mask = 0;
+    for(unsigned i = 0; i < 4; ++i)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + 16 * i));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(Match::sse2(v)))) << (16 * i);
+    }
+    return mask;
+#elif defined(RYML_SIMD_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+    // weigh each flagged lane by its bit, then add the lanes pairwise
+    // until each 8-byte half is reduced to a single byte
+    static const uint8_t weights_[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t weights = vld1q_u8(weights_);
+    uint8x16_t m0 = vandq_u8(Match::neon(vld1q_u8(reinterpret_cast<uint8_t const*>(b     ))), weights);
+    uint8x16_t m1 = vandq_u8(Match::neon(vld1q_u8(reinterpret_cast<uint8_t const*>(b + 16))), weights);
+    uint8x16_t m2 = vandq_u8(Match::neon(vld1q_u8(reinterpret_cast<uint8_t const*>(b + 32))), weights);
+    uint8x16_t m3 = vandq_u8(Match::neon(vld1q_u8(reinterpret_cast<uint8_t const*>(b + 48))), weights);
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(m0, m1), vpaddq_u8(m2, m3));
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+#else
+    return scalar_mask<Match>(b, b + 64);
+#endif
+}
+
+/** @} */
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** @name parser kernels
+ * @{ */
+
+/** get the position of the first newline character (\n or \r) in s,
+ * or npos if there is none */
+inline size_t find_newline(csubstr s)
+{
+    const char *pos = simd_find<match_newline>(s.begin(), s.end());
+    return pos != s.end() ? static_cast<size_t>(pos - s.begin()) : npos;
+}
+/** @overload find_newline */
+inline size_t find_newline_scalar(csubstr s)
+{
+    const char *pos = scalar_find<match_newline>(s.begin(), s.end());
+    return pos != s.end() ? static_cast<size_t>(pos - s.begin()) : npos;
+}
+
+/** get the number of spaces at the beginning of s. This is equal to
+ * s.len if s has only spaces. */
+inline size_t count_leading_spaces(csubstr s)
+{
+    return static_cast<size_t>(simd_find<match_not_space>(s.begin(), s.end()) - s.begin());
+}
+/** @overload count_leading_spaces */
+inline size_t count_leading_spaces_scalar(csubstr s)
+{
+    return static_cast<size_t>(scalar_find<match_not_space>(s.begin(), s.end()) - s.begin());
+}
+
+/** get the position of the first structural character in s, or npos
+ * if there is none. @see match_structural */
+inline size_t find_structural(csubstr s)
+{
+    const char *pos = simd_find<match_structural>(s.begin(), s.end());
+    return pos != s.end() ? static_cast<size_t>(pos - s.begin()) : npos;
+}
+/** @overload find_structural */
+inline size_t find_structural_scalar(csubstr s)
+{
+    const char *pos = scalar_find<match_structural>(s.begin(), s.end());
+    return pos != s.end() ? static_cast<size_t>(pos - s.begin()) : npos;
+}
+
+/** get the position of the first backslash or newline character in
+ * s, or npos if there is none. @see match_dquot_special */
+inline size_t find_dquot_special(csubstr s)
+{
+    const char *pos = simd_find<match_dquot_special>(s.begin(), s.end());
+    return pos != s.end() ? static_cast<size_t>(pos - s.begin()) : npos;
+}
+/** @overload find_dquot_special */
+inline size_t find_dquot_special_scalar(csubstr s)
+{
+    const char *pos = scalar_find<match_dquot_special>(s.begin(), s.end());
+    return pos != s.end() ? static_cast<size_t>(pos - s.begin()) : npos;
+}
+
+/** the counts of the characters which announce the nodes of a tree,
+ * used to estimate its size before parsing. @see count_tree_tokens */
+struct tree_token_counts
+{
+    size_t separators;   //!< the number of <tt>, : ?</tt>
+    size_t openers;      //!< the number of <tt>[ {</tt>
+    size_t dashes;       //!< the number of <tt>-</tt> followed by a blank, a newline or the end
+    size_t wide_escapes; //!< the number of <tt>\L</tt> and <tt>\P</tt>, which grow when decoded
+};
+
+template<bool Simd, class Match>
+C4_ALWAYS_INLINE uint64_t _token_mask64(const char *b)
+{
+    return Simd ? simd_mask64<Match>(b) : scalar_mask<Match>(b, b + 64);
+}
+
+template<bool Simd>
+inline tree_token_counts _count_tree_tokens(csubstr s)
+{
+    using match_separator = match_any<',', ':', '?'>;
+    using match_opener = match_any<'[', '{'>;
+    using match_dash = match_any<'-'>;
+    using match_blank = match_any<' ', '\t', '\n', '\r'>;
+    using match_backslash = match_any<'\\'>;
+    using match_wide = match_any<'L', 'P'>;
+    tree_token_counts counts = {0, 0, 0, 0};
+    // the pairs of characters may straddle two blocks: carry the
+    // first character of the pair to the next block
+    uint64_t dash_carry = 0, backslash_carry = 0;
+    auto add = [&](uint64_t sep, uint64_t open, uint64_t dash, uint64_t blank, uint64_t backslash, uint64_t wide) {
+        counts.separators += _simd_popcount64(sep);
+        counts.openers += _simd_popcount64(open);
+        counts.dashes += _simd_popcount64(dash & (blank >> 1)) + static_cast<size_t>(dash_carry & blank & 1u);
+        counts.wide_escapes += _simd_popcount64(backslash & (wide >> 1)) + static_cast<size_t>(backslash_carry & wide & 1u);
+        dash_carry = dash >> 63;
+        backslash_carry = backslash >> 63;
+    };
+    const char *b = s.begin();
+    const char *e = s.end();
+    for( ; e - b >= 64; b += 64)
+    {
+        add(_token_mask64<Simd, match_separator>(b),
+            _token_mask64<Simd, match_opener>(b),
+            _token_mask64<Simd, match_dash>(b),
+            _token_mask64<Simd, match_blank>(b),
+            _token_mask64<Simd, match_backslash>(b),
+            _token_mask64<Simd, match_wide>(b));
+    }
+    // the tail, where the end of the buffer counts as a blank
+    add(scalar_mask<match_separator>(b, e),
+        scalar_mask<match_opener>(b, e),
+        scalar_mask<match_dash>(b, e),
+        scalar_mask<match_blank>(b, e) | (uint64_t(1) << (e - b)),
+        scalar_mask<match_backslash>(b, e),
+        scalar_mask<match_wide>(b, e));
+    return counts;
+}
+
+/** count the characters which announce the nodes of a tree, in a
+ * single pass over s */
+inline tree_token_counts count_tree_tokens(csubstr s)
+{
+    return _count_tree_tokens<true>(s);
+}
+/** @overload count_tree_tokens */
+inline tree_token_counts count_tree_tokens_scalar(csubstr s)
+{
+    return _count_tree_tokens<false>(s);
+}
+
+/** @} */
+
+} // namespace detail
+} // namespace yml
+} // namespace c4
+
+#endif /* _C4_YML_DETAIL_SIMD_HPP_ */
@@ -10,7 +10,7 @@ namespace c4 {
 namespace yml {
 
 template<class Writer>
-substr Emitter<Writer>::emit(EmitType_e type, Tree const& t, size_t id, bool error_on_excess)
+substr Emitter<Writer>::emit(EmitType_e type, Tree const& t, id_type id, bool error_on_excess)
 {
     if(type == YAML)
     {
@@ -31,7 +31,7 @@ substr Emitter<Writer>::emit(EmitType_e type, Tree const& t, size_t id, bool err
 /** @todo this function is too complex. break it down into manageable
  * pieces */
 template<class Writer>
-void Emitter<Writer>::_do_visit(Tree const& t, size_t id, size_t ilevel, size_t do_indent)
+void Emitter<Writer>::_do_visit(Tree const& t, id_type id, size_t ilevel, size_t do_indent)
 {
     RepC ind = indent_to(do_indent * ilevel);
     RYML_ASSERT(t.is_root(id) || (t.parent_is_map(id) || t.parent_is_seq(id)));
@@ -192,14 +192,16 @@ void Emitter<Writer>::_do_visit(Tree const& t, size_t id, size_t ilevel, size_t
         next_level = ilevel; // do not indent at top level
     }
 
-    for(size_t ich = t.first_child(id); ich != NONE; ich = t.next_sibling(ich))
+    if(C4_UNLIKELY(t.is_lazy(id)))
+        c4::yml::error("cannot emit a lazy node: expand it first with Tree::expand_lazy_all()");
+    for(id_type ich = t.first_child(id); ich != NONE; ich = t.next_sibling(ich))
     {
         _do_visit(t, ich, next_level, do_indent);
         do_indent = true;
     }
 }
 template<class Writer>
-void Emitter<Writer>::_do_visit_json(Tree const& t, size_t id)
+void Emitter<Writer>::_do_visit_json(Tree const& t, id_type id)
 {
     if(C4_UNLIKELY(t.is_stream(id)))
     {
@@ -232,7 +234,9 @@ void Emitter<Writer>::_do_visit_json(Tree const& t, size_t id)
             this->Writer::_do_write('{');
         }
     } // container
-    for(size_t ich = t.first_child(id); ich != NONE; ich = t.next_sibling(ich))
+    if(C4_UNLIKELY(t.is_lazy(id)))
+        c4::yml::error("cannot emit a lazy node: expand it first with Tree::expand_lazy_all()");
+    for(id_type ich = t.first_child(id); ich != NONE; ich = t.next_sibling(ich))
     {
         if(ich != t.first_child(id))
             this->Writer::_do_write(',');
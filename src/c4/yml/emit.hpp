@@ -33,9 +33,9 @@ typedef enum {
 struct as_json
 {
     Tree const* tree;
-    size_t node;
+    id_type node;
     as_json(Tree const& t) : tree(&t), node(t.root_id()) {}
-    as_json(Tree const& t, size_t id) : tree(&t), node(id) {}
+    as_json(Tree const& t, id_type id) : tree(&t), node(id) {}
     as_json(NodeRef const& n) : tree(n.tree()), node(n.id()) {}
 };
 
@@ -60,7 +60,7 @@ public:
      *
      * When writing to a file, the returned substr will be null, but its
      * length will be set to the number of bytes written. */
-    substr emit(EmitType_e type, Tree const& t, size_t id, bool error_on_excess);
+    substr emit(EmitType_e type, Tree const& t, id_type id, bool error_on_excess);
     /** @overload */
     substr emit(EmitType_e type, Tree const& t, bool error_on_excess=true) { return emit(type, t, t.root_id(), error_on_excess); }
     /** @overload */
@@ -68,8 +68,8 @@ public:
 
 private:
 
-    void _do_visit(Tree const& t, size_t id, size_t ilevel=0, size_t do_indent=1);
-    void _do_visit_json(Tree const& t, size_t id);
+    void _do_visit(Tree const& t, id_type id, size_t ilevel=0, size_t do_indent=1);
+    void _do_visit_json(Tree const& t, id_type id);
 
 private:
 
@@ -92,11 +92,11 @@ private:
         _valsc_json = ~(KEY)  |  (VAL),
     };
 
-    C4_ALWAYS_INLINE void _writek(Tree const& t, size_t id, size_t level) { _write(t.keysc(id), t._p(id)->m_type.type & ~(VAL|VALREF|VALANCH|VALQUO), level); }
-    C4_ALWAYS_INLINE void _writev(Tree const& t, size_t id, size_t level) { _write(t.valsc(id), t._p(id)->m_type.type & ~(KEY|KEYREF|KEYANCH|KEYQUO), level); }
+    C4_ALWAYS_INLINE void _writek(Tree const& t, id_type id, size_t level) { _write(t.keysc(id), t._p(id)->m_type.type & ~(VAL|VALREF|VALANCH|VALQUO), level); }
+    C4_ALWAYS_INLINE void _writev(Tree const& t, id_type id, size_t level) { _write(t.valsc(id), t._p(id)->m_type.type & ~(KEY|KEYREF|KEYANCH|KEYQUO), level); }
 
-    C4_ALWAYS_INLINE void _writek_json(Tree const& t, size_t id) { _write_json(t.keysc(id), t._p(id)->m_type.type & ~(VAL)); }
-    C4_ALWAYS_INLINE void _writev_json(Tree const& t, size_t id) { _write_json(t.valsc(id), t._p(id)->m_type.type & ~(KEY)); }
+    C4_ALWAYS_INLINE void _writek_json(Tree const& t, id_type id) { _write_json(t.keysc(id), t._p(id)->m_type.type & ~(VAL)); }
+    C4_ALWAYS_INLINE void _writev_json(Tree const& t, id_type id) { _write_json(t.valsc(id), t._p(id)->m_type.type & ~(KEY)); }
 };
 
 
@@ -106,7 +106,7 @@ private:
 
 /** emit YAML to the given file. A null file defaults to stdout.
  * Return the number of bytes written. */
-inline size_t emit(Tree const& t, size_t id, FILE *f)
+inline size_t emit(Tree const& t, id_type id, FILE *f)
 {
     EmitterFile em(f);
     size_t len = em.emit(YAML, t, id, /*error_on_excess*/true).len;
@@ -114,7 +114,7 @@ inline size_t emit(Tree const& t, size_t id, FILE *f)
 }
 /** emit JSON to the given file. A null file defaults to stdout.
  * Return the number of bytes written. */
-inline size_t emit_json(Tree const& t, size_t id, FILE *f)
+inline size_t emit_json(Tree const& t, id_type id, FILE *f)
 {
     EmitterFile em(f);
     size_t len = em.emit(JSON, t, id, /*error_on_excess*/true).len;
@@ -188,7 +188,7 @@ inline OStream& operator<< (OStream& s, as_json const& js)
 /** emit YAML to the given buffer. Return a substr trimmed to the emitted YAML.
  * @param error_on_excess Raise an error if the space in the buffer is insufficient.
  * @overload */
-inline substr emit(Tree const& t, size_t id, substr buf, bool error_on_excess=true)
+inline substr emit(Tree const& t, id_type id, substr buf, bool error_on_excess=true)
 {
     EmitterBuf em(buf);
     substr result = em.emit(YAML, t, id, error_on_excess);
@@ -197,7 +197,7 @@ inline substr emit(Tree const& t, size_t id, substr buf, bool error_on_excess=tr
 /** emit JSON to the given buffer. Return a substr trimmed to the emitted JSON.
  * @param error_on_excess Raise an error if the space in the buffer is insufficient.
  * @overload */
-inline substr emit_json(Tree const& t, size_t id, substr buf, bool error_on_excess=true)
+inline substr emit_json(Tree const& t, id_type id, substr buf, bool error_on_excess=true)
 {
     EmitterBuf em(buf);
     substr result = em.emit(JSON, t, id, error_on_excess);
@@ -242,7 +242,7 @@ inline substr emit_json(NodeRef const& r, substr buf, bool error_on_excess=true)
 /** emit+resize: YAML to the given std::string/std::vector-like container,
  * resizing it as needed to fit the emitted YAML. */
 template<class CharOwningContainer>
-substr emitrs(Tree const& t, size_t id, CharOwningContainer * cont)
+substr emitrs(Tree const& t, id_type id, CharOwningContainer * cont)
 {
     substr buf = to_substr(*cont);
     substr ret = emit(t, id, buf, /*error_on_excess*/false);
@@ -257,7 +257,7 @@ substr emitrs(Tree const& t, size_t id, CharOwningContainer * cont)
 /** emit+resize: JSON to the given std::string/std::vector-like container,
  * resizing it as needed to fit the emitted JSON. */
 template<class CharOwningContainer>
-substr emitrs_json(Tree const& t, size_t id, CharOwningContainer * cont)
+substr emitrs_json(Tree const& t, id_type id, CharOwningContainer * cont)
 {
     substr buf = to_substr(*cont);
     substr ret = emit_json(t, id, buf, /*error_on_excess*/false);
@@ -273,7 +273,7 @@ substr emitrs_json(Tree const& t, size_t id, CharOwningContainer * cont)
 /** emit+resize: YAML to the given std::string/std::vector-like container,
  * resizing it as needed to fit the emitted YAML. */
 template<class CharOwningContainer>
-CharOwningContainer emitrs(Tree const& t, size_t id)
+CharOwningContainer emitrs(Tree const& t, id_type id)
 {
     CharOwningContainer c;
     emitrs(t, id, &c);
@@ -282,7 +282,7 @@ CharOwningContainer emitrs(Tree const& t, size_t id)
 /** emit+resize: JSON to the given std::string/std::vector-like container,
  * resizing it as needed to fit the emitted JSON. */
 template<class CharOwningContainer>
-CharOwningContainer emitrs_json(Tree const& t, size_t id)
+CharOwningContainer emitrs_json(Tree const& t, id_type id)
 {
     CharOwningContainer c;
     emitrs_json(t, id, &c);
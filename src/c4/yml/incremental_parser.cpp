@@ -0,0 +1,147 @@
+#include "c4/yml/incremental_parser.hpp"
+
+#include <string.h>
+
+namespace c4 {
+namespace yml {
+
+//-----------------------------------------------------------------------------
+IncrementalParser::IncrementalParser(Allocator const& a)
+    : m_buf(nullptr)
+    , m_size(0)
+    , m_cap(0)
+    , m_scanned(0)
+    , m_finished(false)
+    , m_splitter()
+    , m_docs(a)
+    , m_next_doc(0)
+    , m_filename()
+    , m_parser(a)
+    , m_alloc(a)
+{
+}
+
+IncrementalParser::~IncrementalParser()
+{
+    if(m_buf)
+        m_alloc.free(m_buf, m_cap);
+    m_buf = nullptr;
+}
+
+void IncrementalParser::reset()
+{
+    m_size = 0;
+    m_scanned = 0;
+    m_finished = false;
+    m_splitter.reset();
+    m_docs.clear();
+    m_next_doc = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+void IncrementalParser::feed(csubstr chunk)
+{
+    RYML_CHECK( ! m_finished);
+    if(chunk.empty())
+        return;
+    _compact();
+    if(m_size + chunk.len > m_cap)
+        _reserve(m_size + chunk.len);
+    memcpy(m_buf + m_size, chunk.str, chunk.len);
+    m_size += chunk.len;
+    _scan_lines();
+}
+
+void IncrementalParser::finish()
+{
+    if(m_finished)
+        return;
+    size_t doc[2];
+    if(m_scanned < m_size)
+    {
+        // the last line has no newline
+        if(m_splitter.scan_line(csubstr(m_buf + m_scanned, m_size - m_scanned), m_scanned, m_size, &doc))
+            m_docs.push({doc[0], doc[1]});
+        m_scanned = m_size;
+    }
+    if(m_splitter.finish(m_size, &doc))
+        m_docs.push({doc[0], doc[1]});
+    m_finished = true;
+}
+
+bool IncrementalParser::next_doc(Tree *t)
+{
+    RYML_ASSERT(t != nullptr);
+    if(m_next_doc >= m_docs.size())
+        return false;
+    DocRange r = m_docs[m_next_doc++];
+    if(m_next_doc == m_docs.size())
+    {
+        m_docs.clear();
+        m_next_doc = 0;
+    }
+    t->clear();
+    t->clear_arena();
+    m_parser.parse(m_filename, csubstr(m_buf + r.first, r.last - r.first), t);
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+/** discard the text which was already handed out, so that the
+ * memory is bounded by the text still needed */
+void IncrementalParser::_compact()
+{
+    size_t first = _first_pos();
+    if(first == 0)
+        return;
+    RYML_ASSERT(first <= m_scanned && m_scanned <= m_size);
+    memmove(m_buf, m_buf + first, m_size - first);
+    m_size -= first;
+    m_scanned -= first;
+    m_splitter.doc_start -= first;
+    for(size_t i = m_next_doc; i < m_docs.size(); ++i)
+    {
+        m_docs[i].first -= first;
+        m_docs[i].last -= first;
+    }
+}
+
+void IncrementalParser::_reserve(size_t cap)
+{
+    if(cap <= m_cap)
+        return;
+    if(cap < 2 * m_cap)
+        cap = 2 * m_cap;
+    if(cap < 256)
+        cap = 256;
+    char *buf = (char*) m_alloc.allocate(cap, m_buf);
+    if(m_buf)
+    {
+        memcpy(buf, m_buf, m_size);
+        m_alloc.free(m_buf, m_cap);
+    }
+    m_buf = buf;
+    m_cap = cap;
+}
+
+
+//-----------------------------------------------------------------------------
+void IncrementalParser::_scan_lines()
+{
+    size_t doc[2];
+    while(m_scanned < m_size)
+    {
+        const char *nl = (const char*) memchr(m_buf + m_scanned, '\n', m_size - m_scanned);
+        if( ! nl)
+            break; // the line is not complete; wait for more
+        size_t pos = static_cast<size_t>(nl - m_buf);
+        if(m_splitter.scan_line(csubstr(m_buf + m_scanned, pos - m_scanned), m_scanned, pos + 1, &doc))
+            m_docs.push({doc[0], doc[1]});
+        m_scanned = pos + 1;
+    }
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,141 @@
+#ifndef _C4_YML_INCREMENTAL_PARSER_HPP_
+#define _C4_YML_INCREMENTAL_PARSER_HPP_
+
+#ifndef _C4_YML_PARSE_HPP_
+#include "c4/yml/parse.hpp"
+#endif
+
+#ifndef _C4_YML_DETAIL_DOC_SPLITTER_HPP_
+#include "c4/yml/detail/doc_splitter.hpp"
+#endif
+
+#if defined(_MSC_VER)
+#   pragma warning(push)
+#   pragma warning(disable: 4251/*needs to have dll-interface to be used by clients of struct*/)
+#endif
+
+namespace c4 {
+namespace yml {
+
+
+/** A resumable parser for YAML streams received in chunks, eg from
+ * a pipe or a socket. The chunks are fed with feed(), and each
+ * document becomes available through next_doc() as soon as its end is
+ * known; finish() signals the end of the stream.
+ *
+ * @code
+ * IncrementalParser ip;
+ * Tree t;
+ * while(read_chunk(&chunk))
+ * {
+ *     ip.feed(chunk);
+ *     while(ip.next_doc(&t))
+ *         process(t);
+ * }
+ * ip.finish();
+ * while(ip.next_doc(&t))
+ *     process(t);
+ * @endcode
+ *
+ * Documents are delimited by the markers <tt>---</tt> and <tt>...</tt>
+ * at the beginning of a line, which YAML forbids inside document
+ * contents (including block and quoted scalars); so a document is
+ * complete when the next marker line is received, and partial lines
+ * and unfinished scalars are simply held until then. Directives are
+ * given to the document that follows them.
+ *
+ * Only the text of the documents not yet obtained with next_doc() is
+ * kept, and the memory used for it is reused; so when the documents
+ * are consumed as they become available, the memory used is bounded by
+ * the size of the largest document, and not by the size of the stream.
+ *
+ * @note documents are handed out as a whole. To get nodes as soon as
+ * they are parsed, use Parser::parse_events() on each document.
+ */
+class RYML_EXPORT IncrementalParser
+{
+public:
+
+    IncrementalParser(Allocator const& a={});
+    ~IncrementalParser();
+
+    IncrementalParser(IncrementalParser const&) = delete;
+    IncrementalParser(IncrementalParser &&) = delete;
+    IncrementalParser& operator= (IncrementalParser const&) = delete;
+    IncrementalParser& operator= (IncrementalParser &&) = delete;
+
+public:
+
+    /** set the filename used in error messages */
+    void set_filename(csubstr filename) { m_filename = filename; }
+
+    /** append a chunk of the stream. The chunk can end anywhere, even
+     * in the middle of a line. The chunk is copied, so its memory can
+     * be reused after this call. */
+    void feed(csubstr chunk);
+
+    /** signal the end of the stream: the remaining text becomes the
+     * last document. */
+    void finish();
+
+    /** forget all the state and pending text, to start a new stream.
+     * The memory is kept. */
+    void reset();
+
+    /** get the next complete document, parsing it into the given
+     * tree, which is first cleared. The tree is given its own copy of
+     * the document text, so it remains valid after further calls to
+     * feed().
+     * @return true if a document was parsed, false if no complete
+     * document is available. */
+    bool next_doc(Tree *t);
+
+    /** the number of complete documents not yet obtained with next_doc() */
+    size_t num_pending_docs() const { return m_docs.size() - m_next_doc; }
+
+    /** true after finish() was called */
+    bool finished() const { return m_finished; }
+
+    /** the size of the text currently held: the pending documents
+     * and the current incomplete one */
+    size_t buffered_size() const { return m_size - _first_pos(); }
+
+private:
+
+    struct DocRange
+    {
+        size_t first;
+        size_t last;
+    };
+
+    size_t _first_pos() const { return m_next_doc < m_docs.size() ? m_docs[m_next_doc].first : m_splitter.doc_start; }
+    void _compact();
+    void _reserve(size_t cap);
+    void _scan_lines();
+
+private:
+
+    char *  m_buf;       //!< the text received and not yet consumed
+    size_t  m_size;
+    size_t  m_cap;
+    size_t  m_scanned;   //!< the text before this position is made of complete lines already scanned
+    bool    m_finished;
+    detail::doc_splitter m_splitter;
+
+    detail::stack<DocRange> m_docs; //!< the complete documents
+    size_t  m_next_doc;
+
+    csubstr   m_filename;
+    Parser    m_parser;
+    Allocator m_alloc;
+
+};
+
+} // namespace yml
+} // namespace c4
+
+#if defined(_MSC_VER)
+#   pragma warning(pop)
+#endif
+
+#endif /* _C4_YML_INCREMENTAL_PARSER_HPP_ */
@@ -53,7 +53,7 @@ class RYML_EXPORT NodeRef
 private:
 
     Tree *C4_RESTRICT m_tree;
-    size_t m_id;
+    id_type m_id;
 
     /** This member is used to enable lazy operator[] writing. When a child
      * with a key or index is not found, m_id is set to the id of the parent
@@ -72,9 +72,9 @@ public:
     NodeRef() : m_tree(nullptr), m_id(NONE), m_seed() { _clear_seed(); }
     NodeRef(Tree &t) : m_tree(&t), m_id(t .root_id()), m_seed() { _clear_seed(); }
     NodeRef(Tree *t) : m_tree(t ), m_id(t->root_id()), m_seed() { _clear_seed(); }
-    NodeRef(Tree *t, size_t id) : m_tree(t), m_id(id), m_seed() { _clear_seed(); }
-    NodeRef(Tree *t, size_t id, size_t seed_pos) : m_tree(t), m_id(id), m_seed() { m_seed.str = nullptr; m_seed.len = seed_pos; }
-    NodeRef(Tree *t, size_t id, csubstr  seed_key) : m_tree(t), m_id(id), m_seed(seed_key) {}
+    NodeRef(Tree *t, id_type id) : m_tree(t), m_id(id), m_seed() { _clear_seed(); }
+    NodeRef(Tree *t, id_type id, size_t seed_pos) : m_tree(t), m_id(id), m_seed() { m_seed.str = nullptr; m_seed.len = seed_pos; }
+    NodeRef(Tree *t, id_type id, csubstr  seed_key) : m_tree(t), m_id(id), m_seed(seed_key) {}
     NodeRef(std::nullptr_t) : m_tree(nullptr), m_id(NONE), m_seed() {}
 
     NodeRef(NodeRef const&) = default;
@@ -88,7 +88,7 @@ public:
     inline Tree      * tree()       { return m_tree; }
     inline Tree const* tree() const { return m_tree; }
 
-    inline size_t id() const { return m_id; }
+    inline id_type id() const { return m_id; }
 
     inline NodeData      * get()       { return m_tree->get(m_id); }
     inline NodeData const* get() const { return m_tree->get(m_id); }
@@ -121,12 +121,12 @@ public:
     inline csubstr    const& key    () const { _C4RV(); return m_tree->key(m_id); }
     inline csubstr    const& key_tag() const { _C4RV(); return m_tree->key_tag(m_id); }
     inline csubstr    const& key_ref() const { _C4RV(); return m_tree->key_ref(m_id); }
-    inline NodeScalar const& keysc  () const { _C4RV(); return m_tree->keysc(m_id); }
+    inline NodeScalar        keysc  () const { _C4RV(); return m_tree->keysc(m_id); }
 
     inline csubstr    const& val    () const { _C4RV(); return m_tree->val(m_id); }
     inline csubstr    const& val_tag() const { _C4RV(); return m_tree->val_tag(m_id); }
     inline csubstr    const& val_ref() const { _C4RV(); return m_tree->val_ref(m_id); }
-    inline NodeScalar const& valsc  () const { _C4RV(); return m_tree->valsc(m_id); }
+    inline NodeScalar        valsc  () const { _C4RV(); return m_tree->valsc(m_id); }
 
     inline csubstr const& key_anchor() const { _C4RV(); return m_tree->key_anchor(m_id); }
     inline csubstr const& val_anchor() const { _C4RV(); return m_tree->val_anchor(m_id); }
@@ -167,7 +167,7 @@ public:
     inline bool has_parent() const { _C4RV(); return m_tree->has_parent(m_id); }
 
     inline bool has_child(NodeRef const& ch) const { _C4RV(); return m_tree->has_child(m_id, ch.m_id); }
-    inline bool has_child(csubstr name) const { _C4RV();  return m_tree->has_child(m_id, name); }
+    inline bool has_child(csubstr name) const { _C4RV();  return m_tree->find_child(m_id, name) != NONE; }
     inline bool has_children() const { _C4RV(); return m_tree->has_children(m_id); }
 
     inline bool has_sibling(NodeRef const& n) const { _C4RV(); return m_tree->has_sibling(m_id, n.m_id); }
@@ -297,7 +297,7 @@ public:
     {
         RYML_ASSERT( ! is_seed());
         RYML_ASSERT(valid());
-        size_t ch = m_tree->find_child(m_id, k);
+        id_type ch = m_tree->find_child(m_id, k);
         NodeRef r = ch != NONE ? NodeRef(m_tree, ch) : NodeRef(m_tree, m_id, k);
         return r;
     }
@@ -307,7 +307,7 @@ public:
     {
         RYML_ASSERT( ! is_seed());
         RYML_ASSERT(valid());
-        size_t ch = m_tree->child(m_id, pos);
+        id_type ch = m_tree->child(m_id, pos);
         NodeRef r = ch != NONE ? NodeRef(m_tree, ch) : NodeRef(m_tree, m_id, pos);
         return r;
     }
@@ -319,7 +319,7 @@ public:
     {
         RYML_ASSERT( ! is_seed());
         RYML_ASSERT(valid());
-        size_t ch = m_tree->find_child(m_id, k);
+        id_type ch = m_tree->find_child(m_id, k);
         RYML_ASSERT(ch != NONE);
         NodeRef const r(m_tree, ch);
         return r;
@@ -330,7 +330,7 @@ public:
     {
         RYML_ASSERT( ! is_seed());
         RYML_ASSERT(valid());
-        size_t ch = m_tree->child(m_id, pos);
+        id_type ch = m_tree->child(m_id, pos);
         RYML_ASSERT(ch != NONE);
         NodeRef const r(m_tree, ch);
         return r;
@@ -413,7 +413,7 @@ public:
         // operator<< for writing a substr to a stream)
         _apply_seed();
         write(this, s);
-        RYML_ASSERT(get()->val() == s);
+        RYML_ASSERT(m_tree->val(m_id) == s);
         return *this;
     }
 
@@ -675,7 +675,7 @@ public:
     {
         _C4RV();
         RYML_ASSERT(pos >= 0 && pos < num_children());
-        size_t child = m_tree->child(m_id, pos);
+        id_type child = m_tree->child(m_id, pos);
         RYML_ASSERT(child != NONE);
         m_tree->remove(child);
     }
@@ -684,7 +684,7 @@ public:
     inline void remove_child(csubstr key)
     {
         _C4RV();
-        size_t child = m_tree->find_child(m_id, key);
+        id_type child = m_tree->find_child(m_id, key);
         RYML_ASSERT(child != NONE);
         m_tree->remove(child);
     }
@@ -722,13 +722,13 @@ public:
         RYML_ASSERT(parent.m_tree == after.m_tree);
         if(parent.m_tree == m_tree)
         {
-            size_t dup = m_tree->duplicate(m_id, parent.m_id, after.m_id);
+            id_type dup = m_tree->duplicate(m_id, parent.m_id, after.m_id);
             NodeRef r(m_tree, dup);
             return r;
         }
         else
         {
-            size_t dup = parent.m_tree->duplicate(m_tree, m_id, parent.m_id, after.m_id);
+            id_type dup = parent.m_tree->duplicate(m_tree, m_id, parent.m_id, after.m_id);
             NodeRef r(parent.m_tree, dup);
             return r;
         }
@@ -754,11 +754,11 @@ private:
     struct child_iterator
     {
         Tree * m_tree;
-        size_t m_child_id;
+        id_type m_child_id;
 
         using value_type = NodeRef;
 
-        child_iterator(Tree * t, size_t id) : m_tree(t), m_child_id(id) {}
+        child_iterator(Tree * t, id_type id) : m_tree(t), m_child_id(id) {}
 
         child_iterator& operator++ () { RYML_ASSERT(m_child_id != NONE); m_child_id = m_tree->next_sibling(m_child_id); return *this; }
         child_iterator& operator-- () { RYML_ASSERT(m_child_id != NONE); m_child_id = m_tree->prev_sibling(m_child_id); return *this; }
@@ -814,8 +814,8 @@ public:
     #   endif
     #endif
 
-          children_view siblings()       { if(is_root()) { return       children_view(end(), end()); } else { size_t p = get()->m_parent; return       children_view(iterator(m_tree, m_tree->get(p)->m_first_child), iterator(m_tree, NONE)); } }
-    const_children_view siblings() const { if(is_root()) { return const_children_view(end(), end()); } else { size_t p = get()->m_parent; return const_children_view(const_iterator(m_tree, m_tree->get(p)->m_first_child), const_iterator(m_tree, NONE)); } }
+          children_view siblings()       { if(is_root()) { return       children_view(end(), end()); } else { id_type p = get()->m_parent; return       children_view(iterator(m_tree, m_tree->get(p)->m_first_child), iterator(m_tree, NONE)); } }
+    const_children_view siblings() const { if(is_root()) { return const_children_view(end(), end()); } else { id_type p = get()->m_parent; return const_children_view(const_iterator(m_tree, m_tree->get(p)->m_first_child), const_iterator(m_tree, NONE)); } }
 
     #if defined(__clang__)
     #   pragma clang diagnostic pop
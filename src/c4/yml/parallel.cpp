@@ -0,0 +1,507 @@
+#include "c4/yml/parallel.hpp"
+#include "c4/yml/parse_context.hpp"
+#include "c4/yml/detail/doc_splitter.hpp"
+
+#include <string.h>
+
+#ifdef RYML_WITH_THREADS
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+#endif
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#   define RYML_PARALLEL_EXCEPTIONS
+#endif
+
+namespace c4 {
+namespace yml {
+
+#ifdef RYML_WITH_THREADS
+
+namespace {
+
+struct SrcRange
+{
+    size_t first;
+    size_t last;
+};
+
+size_t _num_threads(size_t num_threads, size_t num_ranges)
+{
+    if(num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    return num_threads < num_ranges ? num_threads : num_ranges;
+}
+
+/** parse each range of the source into its own tree, using a pool of
+ * workers. The ranges are parsed in-situ, so they must not overlap,
+ * and must be sorted. The error locations are relative to the whole
+ * source. When a worker fails, the error is rethrown in the calling
+ * thread. */
+void _parse_ranges(csubstr filename, substr src, std::vector<SrcRange> const& ranges, std::vector<Tree> *trees, size_t num_threads, bool as_stream)
+{
+    trees->resize(ranges.size());
+    // the number of lines before each range. This is counted before
+    // parsing because the error callback must not return.
+    std::vector<size_t> lines(ranges.size());
+    for(size_t i = 0, prev = 0, num_lines = 0; i < ranges.size(); ++i)
+    {
+        RYML_ASSERT(ranges[i].first >= prev);
+        num_lines += src.range(prev, ranges[i].first).count('\n');
+        lines[i] = num_lines;
+        prev = ranges[i].first;
+    }
+    std::atomic<size_t> next_range(0);
+    #ifdef RYML_PARALLEL_EXCEPTIONS
+    std::vector<std::exception_ptr> errors(num_threads);
+    #endif
+    auto work = [&](size_t worker) {
+        C4_UNUSED(worker);
+        #ifdef RYML_PARALLEL_EXCEPTIONS
+        try
+        {
+        #endif
+            Parser np;
+            for(size_t i = next_range++; i < ranges.size(); i = next_range++)
+            {
+                Tree &t = (*trees)[i];
+                np.set_buffer_origin(ranges[i].first, lines[i]);
+                np.parse(filename, src.range(ranges[i].first, ranges[i].last), &t);
+                // docs without an explicit --- do not get a STREAM root
+                if(as_stream)
+                    t.set_root_as_stream();
+            }
+        #ifdef RYML_PARALLEL_EXCEPTIONS
+        }
+        catch(...)
+        {
+            errors[worker] = std::current_exception();
+            next_range = ranges.size(); // stop the other workers
+        }
+        #endif
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads - 1);
+    for(size_t i = 1; i < num_threads; ++i)
+        workers.emplace_back(work, i);
+    work(0);
+    for(std::thread &w : workers)
+        w.join();
+    #ifdef RYML_PARALLEL_EXCEPTIONS
+    for(std::exception_ptr const& e : errors)
+        if(e)
+            std::rethrow_exception(e);
+    #endif
+}
+
+csubstr _moved(csubstr s, csubstr from, substr to)
+{
+    if(s.str == nullptr || ! from.is_super(s))
+        return s;
+    return to.sub(static_cast<size_t>(s.str - from.str), s.len);
+}
+
+/** point the scalars of the branch which are in the range from at the
+ * same position in the range to */
+void _move_scalars(Tree *t, id_type node, csubstr from, substr to)
+{
+    if(t->has_key(node))
+        t->set_key(node, _moved(t->key(node), from, to));
+    if(t->has_val(node))
+        t->set_val(node, _moved(t->val(node), from, to));
+    for(id_type ch = t->first_child(node); ch != NONE; ch = t->next_sibling(ch))
+        _move_scalars(t, ch, from, to);
+}
+
+/** copy the children of the roots of the trees, in order, as
+ * children of the root of t */
+void _splice(Tree *t, std::vector<Tree> &trees)
+{
+    size_t num_nodes = t->size() + 1;
+    for(Tree const& pt : trees)
+        num_nodes += pt.size();
+    t->reserve(num_nodes);
+    id_type root = t->root_id();
+    id_type last = NONE;
+    for(Tree &pt : trees)
+    {
+        const id_type prev = last;
+        last = t->duplicate_children(&pt, pt.root_id(), root, last);
+        // the scalars which did not fit in the source were decoded
+        // into the arena of pt, which is about to be destroyed: copy
+        // them to the arena of t. Growing the arena of t relocates the
+        // scalars in it, but not those pointing at the arena of pt.
+        if(pt.arena_size() == 0 || last == prev)
+            continue;
+        csubstr from = pt.arena();
+        substr to = t->copy_to_arena(from);
+        id_type ch = prev == NONE ? t->first_child(root) : t->next_sibling(prev);
+        for( ; ch != NONE; ch = t->next_sibling(ch))
+        {
+            _move_scalars(t, ch, from, to);
+            if(ch == last)
+                break;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+/** the pre-scan for the stream: find its documents */
+void _find_docs(csubstr src, std::vector<SrcRange> *docs)
+{
+    detail::doc_splitter splitter;
+    size_t doc[2];
+    size_t pos = 0;
+    while(pos < src.len)
+    {
+        const char *nl = (const char*) memchr(src.str + pos, '\n', src.len - pos);
+        size_t last = nl ? static_cast<size_t>(nl - src.str) : src.len;
+        size_t next = nl ? last + 1 : src.len;
+        if(splitter.scan_line(src.range(pos, last), pos, next, &doc))
+            docs->push_back({doc[0], doc[1]});
+        pos = next;
+    }
+    if(splitter.finish(src.len, &doc))
+        docs->push_back({doc[0], doc[1]});
+}
+
+
+//-----------------------------------------------------------------------------
+
+/** whether the character ends an anchor or a tag */
+inline bool _is_property_end(char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == '[' || c == ']' || c == '{' || c == '}';
+}
+
+/** Tracks the flow and quoted contexts of the lines of a block
+ * collection, without parsing them, so that it is possible to know
+ * whether a line is inside a flow collection or a quoted scalar
+ * started in a previous line. The contents of block scalars are
+ * skipped. */
+struct ContextScanner
+{
+    size_t flow_level;   //!< the depth of flow collections
+    char   quote;        //!< the open quote, or 0
+    bool   block_header; //!< the previous line started a block scalar
+    size_t block_indref; //!< the indentation of the line with the block scalar header
+    size_t block_indentation; //!< the indentation of the block scalar contents, or npos when not in a block scalar
+
+    ContextScanner() : flow_level(0), quote(0), block_header(false), block_indref(0), block_indentation(npos) {}
+
+    bool in_context() const { return flow_level > 0 || quote != 0; }
+
+    /** scan a line, updating the context
+     * @return true if the line has a block map key indicator, ie a
+     * colon followed by a blank outside of any flow or quoted context */
+    bool scan_line(csubstr line)
+    {
+        bool has_key = false;
+        if(line.ends_with('\r'))
+            line = line.first(line.len - 1);
+        size_t indentation = line.first_not_of(' ');
+        if(indentation == npos)
+            return false; // blank lines do not change the context
+        if(block_header)
+        {
+            // the first non-blank line sets the indentation of the
+            // block scalar contents
+            block_header = false;
+            if(indentation > block_indref)
+                block_indentation = indentation;
+        }
+        if(block_indentation != npos)
+        {
+            if(indentation >= block_indentation)
+                return false; // the line is block scalar contents
+            block_indentation = npos;
+        }
+        bool at_start = true; // whether a scalar or collection can start here
+        for(size_t i = indentation; i < line.len; ++i)
+        {
+            const char c = line.str[i];
+            if(quote == '"')
+            {
+                if(c == '\\')
+                    ++i;
+                else if(c == '"')
+                    quote = 0;
+                continue;
+            }
+            else if(quote == '\'')
+            {
+                if(c == '\'')
+                {
+                    if(i+1 < line.len && line.str[i+1] == '\'')
+                        ++i;
+                    else
+                        quote = 0;
+                }
+                continue;
+            }
+            const bool next_is_blank = (i+1 == line.len || line.str[i+1] == ' ' || line.str[i+1] == '\t');
+            switch(c)
+            {
+            case ' ':
+            case '\t':
+                break;
+            case '#':
+                if(i == 0 || line.str[i-1] == ' ' || line.str[i-1] == '\t')
+                    return has_key; // the rest of the line is a comment
+                at_start = false;
+                break;
+            case ':':
+                if(next_is_blank && flow_level == 0)
+                    has_key = true;
+                at_start = next_is_blank || flow_level > 0;
+                break;
+            case '-':
+            case '?':
+                at_start = at_start && next_is_blank;
+                break;
+            case ',':
+                at_start = flow_level > 0;
+                break;
+            case '[':
+            case '{':
+                if(at_start || flow_level > 0)
+                    ++flow_level;
+                at_start = flow_level > 0;
+                break;
+            case ']':
+            case '}':
+                if(flow_level > 0)
+                    --flow_level;
+                at_start = false;
+                break;
+            case '&':
+            case '!':
+                if(at_start)
+                {
+                    // an anchor or a tag: the node starts after it,
+                    // so skip the token and stay at the start
+                    while(i+1 < line.len && ! _is_property_end(line.str[i+1]))
+                        ++i;
+                    break;
+                }
+                at_start = false;
+                break;
+            case '\'':
+            case '"':
+                if(at_start)
+                    quote = c;
+                at_start = false;
+                break;
+            case '|':
+            case '>':
+                if(at_start && flow_level == 0)
+                {
+                    block_header = true;
+                    block_indref = indentation;
+                    return has_key; // the rest of the header does not matter
+                }
+                at_start = false;
+                break;
+            default:
+                at_start = false;
+                break;
+            }
+        }
+        return has_key;
+    }
+};
+
+/** the pre-scan for a document with a top-level block collection:
+ * split it into chunks starting at the column-0 lines which begin a
+ * new entry of the collection.
+ * @return false if the document cannot be split, because it is not a
+ * top-level block collection, or because a column-0 line is inside a
+ * flow or quoted context. */
+bool _find_entry_chunks(csubstr src, size_t num_chunks, size_t min_chunk_size, std::vector<SrcRange> *chunks)
+{
+    ContextScanner ctx;
+    char kind = 0; // 'm' for maps and 's' for seqs
+    size_t chunk_size = src.len / num_chunks;
+    if(chunk_size < min_chunk_size)
+        chunk_size = min_chunk_size;
+    size_t chunk_start = 0;
+    size_t pos = 0;
+    while(pos < src.len)
+    {
+        const char *nl = (const char*) memchr(src.str + pos, '\n', src.len - pos);
+        size_t last = nl ? static_cast<size_t>(nl - src.str) : src.len;
+        size_t next = nl ? last + 1 : src.len;
+        csubstr line = src.range(pos, last);
+        const bool was_in_context = ctx.in_context();
+        const bool has_key = ctx.scan_line(line);
+        if( ! line.empty() && line[0] != ' ' && line[0] != '\t' && line[0] != '#' && line[0] != '\r')
+        {
+            bool is_seq_entry = line.begins_with("- ") || line == "-" || line == "-\r";
+            if(detail::doc_splitter::_is_marker(line, "---")
+               || detail::doc_splitter::_is_marker(line, "...")
+               || line.begins_with_any("%?:[{|>*&!"))
+                return false;
+            if( ! kind)
+                kind = is_seq_entry ? 's' : 'm';
+            else if(kind == 's' && ! is_seq_entry)
+                return false;
+            // in a top-level map, the entries of a seq value can be
+            // at column 0, and they are not map entries
+            if(kind == 's' || ! is_seq_entry)
+            {
+                if(was_in_context)
+                    return false; // the split would not be safe
+                if(kind == 'm' && ! has_key)
+                    return false; // not a map entry: maybe a multiline scalar
+                if(pos >= chunk_start + chunk_size)
+                {
+                    chunks->push_back({chunk_start, pos});
+                    chunk_start = pos;
+                }
+            }
+        }
+        pos = next;
+    }
+    if(ctx.in_context())
+        return false;
+    chunks->push_back({chunk_start, src.len});
+    return kind != 0;
+}
+
+} // namespace
+
+#endif // RYML_WITH_THREADS
+
+
+//-----------------------------------------------------------------------------
+
+void parse_stream_parallel(csubstr filename, substr src, Tree *t, size_t num_threads)
+{
+    RYML_ASSERT(t != nullptr);
+#ifdef RYML_WITH_THREADS
+    if(num_threads != 1)
+    {
+        std::vector<SrcRange> docs;
+        _find_docs(src, &docs);
+        num_threads = _num_threads(num_threads, docs.size());
+        if(num_threads > 1)
+        {
+            // each document is parsed in-situ from its own part of
+            // the buffer, so the workers do not interfere
+            std::vector<Tree> trees;
+            _parse_ranges(filename, src, docs, &trees, num_threads, /*as_stream*/true);
+            id_type root = t->root_id();
+            RYML_CHECK( ! t->has_children(root));
+            t->to_stream(root);
+            _splice(t, trees);
+            return;
+        }
+    }
+#else
+    C4_UNUSED(num_threads);
+#endif
+    Parser np;
+    np.parse(filename, src, t);
+}
+
+
+//-----------------------------------------------------------------------------
+
+void parse_parallel(csubstr filename, substr src, Tree *t, size_t num_threads, size_t min_chunk_size)
+{
+    RYML_ASSERT(t != nullptr);
+#ifdef RYML_WITH_THREADS
+    if(num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    if(num_threads > 1)
+    {
+        // use more chunks than threads, to balance the load
+        std::vector<SrcRange> chunks;
+        if( ! _find_entry_chunks(src, 4 * num_threads, min_chunk_size, &chunks))
+        {
+            // not a top-level block collection: maybe a stream
+            parse_stream_parallel(filename, src, t, num_threads);
+            return;
+        }
+        num_threads = _num_threads(num_threads, chunks.size());
+        if(num_threads > 1)
+        {
+            std::vector<Tree> trees;
+            _parse_ranges(filename, src, chunks, &trees, num_threads, /*as_stream*/false);
+            id_type root = t->root_id();
+            RYML_CHECK( ! t->has_children(root));
+            t->_copy_props_wo_key(root, &trees[0], trees[0].root_id());
+            _splice(t, trees);
+            return;
+        }
+    }
+#else
+    C4_UNUSED(num_threads);
+    C4_UNUSED(min_chunk_size);
+#endif
+    Parser np;
+    np.parse(filename, src, t);
+}
+
+
+//-----------------------------------------------------------------------------
+
+void load_files(const char *const* paths, size_t num_paths, pfn_file_loaded fn, void *user_data, size_t num_threads)
+{
+    RYML_ASSERT(fn != nullptr);
+#ifdef RYML_WITH_THREADS
+    num_threads = _num_threads(num_threads, num_paths);
+    if(num_threads > 1)
+    {
+        std::atomic<size_t> next_file(0);
+        #ifdef RYML_PARALLEL_EXCEPTIONS
+        std::vector<std::exception_ptr> errors(num_threads);
+        #endif
+        auto work = [&](size_t worker) {
+            C4_UNUSED(worker);
+            #ifdef RYML_PARALLEL_EXCEPTIONS
+            try
+            {
+            #endif
+                ParseContext ctx;
+                for(size_t i = next_file++; i < num_paths; i = next_file++)
+                    if(ctx.try_load(paths[i]))
+                        fn(user_data, i, &ctx.tree());
+            #ifdef RYML_PARALLEL_EXCEPTIONS
+            }
+            catch(...)
+            {
+                errors[worker] = std::current_exception();
+                next_file = num_paths; // stop the other workers
+            }
+            #endif
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(num_threads - 1);
+        for(size_t i = 1; i < num_threads; ++i)
+            workers.emplace_back(work, i);
+        work(0);
+        for(std::thread &w : workers)
+            w.join();
+        #ifdef RYML_PARALLEL_EXCEPTIONS
+        for(std::exception_ptr const& e : errors)
+            if(e)
+                std::rethrow_exception(e);
+        #endif
+        return;
+    }
+#else
+    C4_UNUSED(num_threads);
+#endif
+    ParseContext ctx;
+    for(size_t i = 0; i < num_paths; ++i)
+        if(ctx.try_load(paths[i]))
+            fn(user_data, i, &ctx.tree());
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,161 @@
+#ifndef _C4_YML_PARALLEL_HPP_
+#define _C4_YML_PARALLEL_HPP_
+
+#ifndef _C4_YML_PARSE_HPP_
+#include "c4/yml/parse.hpp"
+#endif
+
+#include <memory>
+#include <type_traits>
+
+namespace c4 {
+namespace yml {
+
+/** @name parse_stream_parallel
+ *
+ * Parse a multi-document stream using several threads. The stream is
+ * first split at the document markers (see detail::doc_splitter), then
+ * each document is parsed by a worker into a private tree, and the
+ * documents are finally copied in order under the STREAM root of the
+ * given tree. The resulting tree has the same structure and contents
+ * as the one obtained with a sequential parse, and the error locations
+ * are relative to the whole stream. Note that the error callback (see
+ * set_callbacks()) may then be called from a worker thread; when it
+ * throws, the exception is rethrown in the calling thread after the
+ * workers are joined.
+ *
+ * The tree is expected to be empty.
+ *
+ * @param num_threads the number of threads to use, including the
+ * calling thread. Use 0 for the number of hardware threads. When ryml
+ * is built without RYML_WITH_THREADS, or when the stream has a single
+ * document, the stream is parsed sequentially.
+ * @{ */
+
+/** parse in-situ a modifiable YAML stream */
+RYML_EXPORT void parse_stream_parallel(csubstr filename, substr src, Tree *t, size_t num_threads=0);
+/** parse a read-only YAML stream, copying it first to the tree's source arena */
+inline void parse_stream_parallel(csubstr filename, csubstr src, Tree *t, size_t num_threads=0) { parse_stream_parallel(filename, detail::copy_to_arena_with_slack(t, src), t, num_threads); }
+/** parse in-situ a modifiable YAML stream */
+inline void parse_stream_parallel(substr src, Tree *t, size_t num_threads=0) { parse_stream_parallel({}, src, t, num_threads); }
+/** parse a read-only YAML stream, copying it first to the tree's source arena */
+inline void parse_stream_parallel(csubstr src, Tree *t, size_t num_threads=0) { parse_stream_parallel({}, src, t, num_threads); }
+
+/** @} */
+
+
+//-----------------------------------------------------------------------------
+
+/** @name parse_parallel
+ *
+ * Parse a document with a large top-level block map or block seq
+ * using several threads. A quick pre-scan splits the source at the
+ * column-0 lines which begin a new map key or a new seq entry (<tt>- </tt>),
+ * keeping track of the flow collections and quoted scalars spanning
+ * several lines. The chunks are parsed concurrently by independent
+ * parsers, and their entries are finally copied in order into the root
+ * of the given tree. The resulting tree has the same structure and
+ * contents as the one obtained with a sequential parse, and the error
+ * locations are relative to the whole source. As with
+ * parse_stream_parallel(), the error callback may be called from a
+ * worker thread.
+ *
+ * The split is speculative: when the pre-scan finds that a chunk
+ * boundary would be inside a flow collection or a quoted scalar, or
+ * that the document is not a top-level block collection, the source
+ * is instead parsed with parse_stream_parallel() (which in turn parses
+ * sequentially a single document). Block scalars cannot contain
+ * column-0 lines, so they never straddle a boundary.
+ *
+ * The tree is expected to be empty.
+ *
+ * @param num_threads the number of threads to use, including the
+ * calling thread. Use 0 for the number of hardware threads.
+ * @param min_chunk_size the minimum size of each chunk. Splitting
+ * smaller chunks does not pay off.
+ * @{ */
+
+enum : size_t {
+    /** the default minimum size of the chunks in parse_parallel() */
+    parallel_min_chunk_size = size_t(1) << 16
+};
+
+/** parse in-situ a modifiable YAML source */
+RYML_EXPORT void parse_parallel(csubstr filename, substr src, Tree *t, size_t num_threads=0, size_t min_chunk_size=parallel_min_chunk_size);
+/** parse a read-only YAML source, copying it first to the tree's source arena */
+inline void parse_parallel(csubstr filename, csubstr src, Tree *t, size_t num_threads=0, size_t min_chunk_size=parallel_min_chunk_size) { parse_parallel(filename, detail::copy_to_arena_with_slack(t, src), t, num_threads, min_chunk_size); }
+/** parse in-situ a modifiable YAML source */
+inline void parse_parallel(substr src, Tree *t, size_t num_threads=0, size_t min_chunk_size=parallel_min_chunk_size) { parse_parallel({}, src, t, num_threads, min_chunk_size); }
+/** parse a read-only YAML source, copying it first to the tree's source arena */
+inline void parse_parallel(csubstr src, Tree *t, size_t num_threads=0, size_t min_chunk_size=parallel_min_chunk_size) { parse_parallel({}, src, t, num_threads, min_chunk_size); }
+
+/** @} */
+
+
+
+//-----------------------------------------------------------------------------
+
+/** @name load_files
+ *
+ * Load and parse many files, eg the contents of a configuration
+ * directory, using a pool of workers. Each worker has its own
+ * ParseContext: it takes the next file, reads it with a single pread()
+ * into the arena of the context's tree, parses it there in-situ, and
+ * hands the tree to the callback, before taking the next file. While
+ * a worker waits for a read, the others are parsing, so the reads
+ * overlap with the parsing.
+ *
+ * The callback is called from the workers, concurrently, and in no
+ * particular order: it receives the index of the file in paths, and
+ * the tree of the worker, which is reused for the next file of the
+ * worker. To keep the tree, move it out of the callback (the worker
+ * then starts over with a new tree). When a callback throws, or the
+ * error callback throws, the workers stop and the exception is
+ * rethrown in the calling thread. When a file cannot be opened or
+ * read and the error callback returns, the file is skipped: the
+ * callback is not called for it.
+ *
+ * @code
+ * std::vector<Tree> configs(paths.size());
+ * load_files(paths.data(), paths.size(), [&](size_t i, Tree &t){
+ *     configs[i] = std::move(t);
+ * });
+ * @endcode
+ *
+ * @param num_threads the number of threads to use, including the
+ * calling thread. Use 0 for the number of hardware threads; as the
+ * workers block on the reads, more threads than cores can pay off
+ * with slow storage. When ryml is built without RYML_WITH_THREADS, the
+ * files are loaded sequentially.
+ * @{ */
+
+using pfn_file_loaded = void (*)(void *user_data, size_t index, Tree *tree);
+
+/** load the files, calling fn(user_data, index, tree) for each one */
+RYML_EXPORT void load_files(const char *const* paths, size_t num_paths, pfn_file_loaded fn, void *user_data, size_t num_threads=0);
+
+namespace detail {
+/** call the functor passed as user_data to load_files() */
+template<class Fn>
+void _file_loaded(void *user_data, size_t index, Tree *tree)
+{
+    (*static_cast<Fn*>(user_data))(index, *tree);
+}
+} // namespace detail
+
+/** load the files, calling fn(index, tree) for each one */
+template<class Fn>
+void load_files(const char *const* paths, size_t num_paths, Fn &&fn, size_t num_threads=0)
+{
+    using fn_type = typename std::remove_reference<Fn>::type;
+    using fn_ptr = typename std::remove_const<fn_type>::type*;
+    fn_ptr fnp = const_cast<fn_ptr>(std::addressof(fn));
+    load_files(paths, num_paths, &detail::_file_loaded<fn_type>, static_cast<void*>(fnp), num_threads);
+}
+
+/** @} */
+
+} // namespace yml
+} // namespace c4
+
+#endif /* _C4_YML_PARALLEL_HPP_ */
@@ -4,12 +4,19 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "c4/yml/detail/parser_dbg.hpp"
 #ifdef RYML_DBG
 #include "c4/yml/detail/print.hpp"
 #endif
 
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#   define RYML_VALIDATE_EXCEPTIONS
+#else
+#   include <setjmp.h>
+#endif
+
 
 #if defined(_MSC_VER)
 #   pragma warning(push)
@@ -68,6 +75,39 @@ static bool _is_doc_sep(csubstr s)
 }
 
 
+//-----------------------------------------------------------------------------
+TreeCapacity estimate_tree_capacity(csubstr src)
+{
+    detail::tree_token_counts counts = detail::count_tree_tokens(src);
+    TreeCapacity cap;
+    // the root and the stream root, plus one node for each token
+    // announcing a node, and one more for the first child of each
+    // flow collection
+    cap.nodes = 2 + counts.separators + 2 * counts.openers + counts.dashes;
+    // \L and \P are longer than their escapes: a double-quoted scalar
+    // which does not fit in its source after decoding is decoded into
+    // the arena, reserving half its size to grow
+    cap.arena = counts.wide_escapes ? src.len + src.len / 2 + counts.wide_escapes : 0;
+    return cap;
+}
+
+
+//-----------------------------------------------------------------------------
+struct Parser::_ValidateStatus
+{
+    Location location; //!< where the error was found
+    size_t   msg_len;  //!< the length of its message in m_validate_msg
+#ifndef RYML_VALIDATE_EXCEPTIONS
+    jmp_buf  stop;     //!< where _err() jumps back to validate(). The frames of the parser hold only trivially destructible objects, so they can be skipped
+#endif
+};
+
+#ifdef RYML_VALIDATE_EXCEPTIONS
+namespace {
+/** thrown by _err() when validating, and caught by validate() */
+struct _ValidateStop {};
+} // anonymous namespace
+#endif
 //-----------------------------------------------------------------------------
 Parser::Parser(Allocator const& a)
     : m_file()
@@ -76,6 +116,26 @@ Parser::Parser(Allocator const& a)
     , m_tree()
     , m_stack(a)
     , m_state()
+    , m_index(a)
+    , m_index_threads(1)
+    , m_index_min_size(index_min_size_default)
+    , m_indexed(false)
+    , m_origin_offset(0)
+    , m_origin_line(0)
+    , m_lazy(false)
+    , m_detect_json(false)
+#ifndef RYML_NO_PARSE_FEATURES
+    , m_features(PARSE_ALL_FEATURES)
+#endif
+    , m_json_open(a)
+    , m_reserved()
+    , m_evt_mode(false)
+    , m_evt_fn(nullptr)
+    , m_evt_handler(nullptr)
+    , m_evt_open(a)
+    , m_evt_tree(a)
+    , m_validate(nullptr)
+    , m_validate_msg()
     , m_key_tag_indentation(0)
     , m_key_tag2_indentation(0)
     , m_key_tag()
@@ -137,7 +197,70 @@ bool Parser::_finished_line() const
 }
 
 //-----------------------------------------------------------------------------
-void Parser::parse(csubstr file, substr buf, Tree *t, size_t node_id)
+void Parser::parse(csubstr file, substr buf, Tree *t, id_type node_id)
+{
+    if(m_detect_json && file.ends_with(".json"))
+    {
+        parse_json(file, buf, t, node_id);
+        return;
+    }
+    if(buf.str != m_reserved.str || buf.len != m_reserved.len)
+        buf = _reserve(t, buf);
+    m_reserved = {};
+    m_evt_mode = false;
+    m_evt_fn = nullptr;
+    m_evt_handler = nullptr;
+    _parse(file, buf, t, node_id);
+}
+
+namespace detail {
+substr copy_to_arena_with_slack(Tree *t, csubstr src, bool reserve_nodes)
+{
+    RYML_ASSERT(t != nullptr);
+    TreeCapacity cap = estimate_tree_capacity(src);
+    if(reserve_nodes)
+        t->reserve(t->size() + cap.nodes);
+    t->reserve_arena(t->arena_size() + src.len + cap.arena);
+    return t->copy_to_arena(src);
+}
+} // namespace detail
+
+/** copy a read-only source to the tree's arena, reserving first the
+ * tree for it, so that the arena is not relocated during the parse.
+ * The parse of the copy does not reserve again. */
+substr Parser::_copy_to_arena(Tree *t, csubstr src, bool reserve_nodes)
+{
+    // lazy parses create only a fraction of the nodes
+    substr copy = detail::copy_to_arena_with_slack(t, src, reserve_nodes && ! m_lazy);
+    m_reserved = copy;
+    return copy;
+}
+
+/** reserve the tree for parsing the given source, returning the
+ * source, which is moved with the arena when it is in the arena */
+substr Parser::_reserve(Tree *t, substr buf)
+{
+    RYML_ASSERT(t != nullptr);
+    TreeCapacity cap = estimate_tree_capacity(buf);
+    // lazy parses create only a fraction of the nodes
+    if( ! m_lazy)
+        t->reserve(t->size() + cap.nodes);
+    // the arena cannot grow while a source in it is parsed, so make
+    // room now for decoding the scalars. Growing the arena relocates
+    // it, and with it the source when it is in the arena.
+    if(cap.arena > t->arena_slack())
+    {
+        const bool in_arena = t->in_arena(buf);
+        const size_t offset = in_arena ? static_cast<size_t>(buf.str - t->arena().str) : 0;
+        t->reserve_arena(t->arena_size() + cap.arena);
+        if(in_arena)
+            buf = t->arena().sub(offset, buf.len);
+    }
+    m_reserved = buf;
+    return buf;
+}
+
+void Parser::_parse(csubstr file, substr buf, Tree *t, id_type node_id)
 {
     m_file = file;
     m_buf = buf;
@@ -145,6 +268,14 @@ void Parser::parse(csubstr file, substr buf, Tree *t, size_t node_id)
     m_tree = t;
 
     _reset();
+    // the index pays off only when its build is amortized over
+    // enough lines: small buffers are scanned directly, and so are
+    // the validated buffers, as validate() does not allocate for them
+    m_indexed = m_buf.len >= m_index_min_size && ! m_validate;
+    if(m_indexed)
+        m_index.build(m_buf, m_index_threads);
+    else
+        m_index.clear();
 
     while( ! _finished_file())
     {
@@ -160,50 +291,581 @@ void Parser::parse(csubstr file, substr buf, Tree *t, size_t node_id)
 }
 
 //-----------------------------------------------------------------------------
-void Parser::_handle_finished_file()
+static void _expand_all(Tree *t, id_type node)
 {
-    _end_stream();
+    for(id_type ch = t->first_child(node); ch != NONE; ch = t->next_sibling(ch))
+        _expand_all(t, ch);
+}
+
+namespace {
+enum : uint8_t {
+    _prune_remove = 0, //!< neither a target nor on the way to one
+    _prune_on_path = 1, //!< an ancestor of a target
+    _prune_target = 2,
+};
+/** restore the lazy mode of the parser when the parse ends, also when
+ * it ends with an error */
+struct _LazyModeGuard
+{
+    Parser *parser;
+    bool was_lazy;
+    _LazyModeGuard(Parser *p) : parser(p), was_lazy(p->lazy()) { p->set_lazy(true); }
+    ~_LazyModeGuard() { parser->set_lazy(was_lazy); }
+};
+} // anonymous namespace
+
+/** remove the descendants of node which are neither targets nor on the
+ * way to a target, as given by the marks of each node. In seqs, the
+ * entries before the last one kept are instead blanked to null, so
+ * that the indices remain valid. The removed nodes are not expanded. */
+static void _prune_to_targets(Tree *t, id_type node, uint8_t const* marks)
+{
+    id_type last_kept = NONE;
+    if(t->is_seq(node))
+    {
+        for(id_type ch = t->last_child(node); ch != NONE && last_kept == NONE; ch = t->prev_sibling(ch))
+            if(marks[ch] != _prune_remove)
+                last_kept = ch;
+    }
+    bool blank = last_kept != NONE;
+    for(id_type ch = t->first_child(node), next; ch != NONE; ch = next)
+    {
+        next = t->next_sibling(ch);
+        if(marks[ch] == _prune_on_path)
+        {
+            _prune_to_targets(t, ch, marks);
+        }
+        else if(marks[ch] == _prune_remove)
+        {
+            if(blank)
+            {
+                t->remove_children(ch);
+                t->to_val(ch, csubstr{});
+            }
+            else
+            {
+                t->remove(ch);
+            }
+        }
+        if(ch == last_kept)
+            blank = false;
+    }
 }
 
+void Parser::parse(csubstr file, substr buf, Tree *t, csubstr const* paths, size_t num_paths)
+{
+    RYML_ASSERT(t != nullptr);
+    RYML_ASSERT(paths != nullptr || num_paths == 0);
+    {
+        _LazyModeGuard guard(this);
+        parse(file, buf, t, t->root_id());
+    }
+    // the lookup expands only the containers on the way to the targets
+    detail::stack<id_type> targets(t->allocator());
+    for(size_t i = 0; i < num_paths; ++i)
+    {
+        Tree::lookup_result r = t->lookup_path(paths[i]);
+        if( ! r)
+            continue;
+        _expand_all(t, r.target);
+        if(r.target == t->root_id())
+            return;
+        targets.push(r.target);
+    }
+    // mark the targets and their ancestors once, so that pruning is
+    // linear in the number of nodes
+    detail::stack<uint8_t> marks(t->allocator());
+    marks.resize(t->capacity());
+    memset(marks.m_stack, _prune_remove, marks.size());
+    for(id_type target : targets)
+    {
+        marks.m_stack[target] = _prune_target;
+        for(id_type n = t->parent(target); n != NONE && marks.m_stack[n] == _prune_remove; n = t->parent(n))
+            marks.m_stack[n] = _prune_on_path;
+    }
+    _prune_to_targets(t, t->root_id(), marks.m_stack);
+}
+
+
 //-----------------------------------------------------------------------------
-void Parser::_handle_line()
+void Parser::parse_json(csubstr file, substr buf, Tree *t, id_type node_id)
 {
-    _c4dbgq("\n-----------");
-    _c4dbgt("handling line=%zu, offset=%zuB", m_state->pos.line, m_state->pos.offset);
+    RYML_ASSERT(t != nullptr);
+    if(buf.str != m_reserved.str || buf.len != m_reserved.len)
+        buf = _reserve(t, buf);
+    m_reserved = {};
+    m_evt_mode = false;
+    m_evt_fn = nullptr;
+    m_evt_handler = nullptr;
+    m_file = file;
+    m_buf = buf;
+    m_root_id = node_id;
+    m_tree = t;
+    _reset();
+    m_json_open.clear();
 
-    RYML_ASSERT( ! m_state->line_contents.rem.empty());
+    size_t pos = _json_skip_ws(0);
+    if(pos == m_buf.len)
+        return;
+
+    // the root: mimic the YAML parser, which keeps the existing
+    // type and key of the node and makes root scalars a DOCVAL
+    char c = m_buf.str[pos];
+    const bool has_key = m_tree->has_key(node_id);
+    const csubstr root_key = has_key ? m_tree->key(node_id) : csubstr{};
+    const type_bits key_quoted = m_tree->is_key_quoted(node_id) ? KEYQUO : NOTYPE;
+    if(c == '{' || c == '[')
+    {
+        type_bits as_doc = m_tree->is_doc(node_id) ? DOC : NOTYPE;
+        if(c == '{')
+        {
+            if(m_tree->is_map(node_id))
+                m_tree->_add_flags(node_id, as_doc);
+            else if(has_key)
+                m_tree->to_map(node_id, root_key, key_quoted|as_doc);
+            else
+                m_tree->to_map(node_id, as_doc);
+        }
+        else
+        {
+            if(m_tree->is_seq(node_id))
+                m_tree->_add_flags(node_id, as_doc);
+            else if(has_key)
+                m_tree->to_seq(node_id, root_key, key_quoted|as_doc);
+            else
+                m_tree->to_seq(node_id, as_doc);
+        }
+        m_json_open.push(node_id);
+        ++pos;
+    }
+    else
+    {
+        const type_bits quoted = c == '"' ? VALQUO : NOTYPE;
+        csubstr s = c == '"' ? _json_scan_string(&pos) : _json_scan_plain(&pos);
+        if(has_key)
+            m_tree->to_keyval(node_id, root_key, s, key_quoted|quoted);
+        else
+            m_tree->to_val(node_id, s, DOC|quoted);
+    }
 
-    if(has_any(RSEQ))
+    enum { _VAL_OR_END, _VAL, _SEP_OR_END } expect = _VAL_OR_END;
+    while( ! m_json_open.empty())
     {
-        if(has_any(EXPL))
+        pos = _json_skip_ws(pos);
+        if(pos == m_buf.len)
+        {
+            _json_set_pos(pos);
+            _c4err("unexpected end of input: unclosed %s", m_tree->is_map(m_json_open.top()) ? "map" : "seq");
+            return;
+        }
+        const id_type parent = m_json_open.top();
+        const bool in_map = m_tree->is_map(parent);
+        const char close = in_map ? '}' : ']';
+        c = m_buf.str[pos];
+        if(expect == _SEP_OR_END)
         {
-            if(_handle_seq_expl())
+            if(c == ',')
+            {
+                expect = _VAL;
+            }
+            else if(c == close)
+            {
+                m_json_open.pop();
+            }
+            else
+            {
+                _json_set_pos(pos);
+                _c4err("expected ',' or '%c'", close);
                 return;
+            }
+            ++pos;
+            continue;
         }
-        else
+        if(c == close)
         {
-            if(_handle_seq_impl())
+            if(expect == _VAL)
+            {
+                _json_set_pos(pos);
+                _c4err("trailing comma");
                 return;
+            }
+            m_json_open.pop();
+            expect = _SEP_OR_END;
+            ++pos;
+            continue;
         }
-    }
-    else if(has_any(RMAP))
-    {
-        if(has_any(EXPL))
+        csubstr key;
+        if(in_map)
         {
-            if(_handle_map_expl())
+            if(c != '"')
+            {
+                _json_set_pos(pos);
+                _c4err("expected a quoted key");
+                return;
+            }
+            key = _json_scan_string(&pos);
+            pos = _json_skip_ws(pos);
+            if(pos == m_buf.len || m_buf.str[pos] != ':')
+            {
+                _json_set_pos(pos);
+                _c4err("expected ':'");
                 return;
+            }
+            pos = _json_skip_ws(pos + 1);
+            if(pos == m_buf.len)
+            {
+                _json_set_pos(pos);
+                _c4err("unexpected end of input: missing value");
+                return;
+            }
+            c = m_buf.str[pos];
+        }
+        const id_type id = m_tree->append_child(parent);
+        if(c == '{')
+        {
+            if(in_map)
+                m_tree->to_map(id, key, KEYQUO);
+            else
+                m_tree->to_map(id);
+            m_json_open.push(id);
+            expect = _VAL_OR_END;
+            ++pos;
+        }
+        else if(c == '[')
+        {
+            // the YAML parser does not flag the key of a seq as quoted
+            if(in_map)
+                m_tree->to_seq(id, key);
+            else
+                m_tree->to_seq(id);
+            m_json_open.push(id);
+            expect = _VAL_OR_END;
+            ++pos;
         }
         else
         {
-            if(_handle_map_impl())
-                return;
+            type_bits quoted = NOTYPE;
+            csubstr val;
+            if(c == '"')
+            {
+                val = _json_scan_string(&pos);
+                quoted = VALQUO;
+            }
+            else
+            {
+                val = _json_scan_plain(&pos);
+            }
+            if(in_map)
+                m_tree->to_keyval(id, key, val, KEYQUO|quoted);
+            else
+                m_tree->to_val(id, val, quoted);
+            expect = _SEP_OR_END;
         }
     }
-    else if(has_any(RUNK))
+
+    // accept a terminating null character, as in zero-terminated buffers
+    pos = _json_skip_ws(pos);
+    if(pos < m_buf.len && m_buf.str[pos] != '\0')
     {
-        if(_handle_unk())
-            return;
+        _json_set_pos(pos);
+        _c4err("unexpected characters after the JSON value");
+    }
+}
+
+size_t Parser::_json_skip_ws(size_t pos) const
+{
+    for( ; pos < m_buf.len; ++pos)
+    {
+        const char c = m_buf.str[pos];
+        if(c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            break;
+    }
+    return pos;
+}
+
+/** scan the string starting at the quote in *pos, and leave *pos after
+ * its closing quote. Strings with escapes are filtered in-situ. */
+csubstr Parser::_json_scan_string(size_t *pos)
+{
+    RYML_ASSERT(*pos < m_buf.len && m_buf.str[*pos] == '"');
+    const size_t first = *pos + 1;
+    size_t last = first;
+    while(true)
+    {
+        const char *q = last < m_buf.len ? (const char*) memchr(m_buf.str + last, '"', m_buf.len - last) : nullptr;
+        if( ! q)
+        {
+            _json_set_pos(*pos);
+            _c4err("unterminated string");
+            *pos = m_buf.len;
+            return {};
+        }
+        last = static_cast<size_t>(q - m_buf.str);
+        // the quote is escaped if it follows an odd number of backslashes
+        size_t num_backslashes = 0;
+        while(last - num_backslashes > first && m_buf.str[last - num_backslashes - 1] == '\\')
+            ++num_backslashes;
+        if((num_backslashes & 1) == 0)
+            break;
+        ++last;
+    }
+    *pos = last + 1;
+    substr s = m_buf.range(first, last);
+    if(memchr(s.str, '\\', s.len) != nullptr)
+        return _filter_dquot_scalar(s);
+    return s;
+}
+
+/** scan a number or a literal (true, false, null), leaving *pos after it */
+csubstr Parser::_json_scan_plain(size_t *pos)
+{
+    const size_t first = *pos;
+    size_t last = first;
+    for( ; last < m_buf.len; ++last)
+    {
+        const char c = m_buf.str[last];
+        if(c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\0')
+            break;
+    }
+    if(last == first)
+    {
+        _json_set_pos(first);
+        _c4err("expected a value");
+    }
+    *pos = last;
+    return m_buf.range(first, last);
+}
+
+/** set the position of the state to the given offset, so that the
+ * error messages show the offending line. This is only used for
+ * errors, so the line is found by counting the newlines. */
+void Parser::_json_set_pos(size_t pos)
+{
+    if(pos > m_buf.len)
+        pos = m_buf.len;
+    size_t line = 1;
+    size_t line_start = 0;
+    for(size_t i = 0; i < pos; ++i)
+    {
+        if(m_buf.str[i] == '\n')
+        {
+            ++line;
+            line_start = i + 1;
+        }
+    }
+    const char *nl = line_start < m_buf.len ? (const char*) memchr(m_buf.str + line_start, '\n', m_buf.len - line_start) : nullptr;
+    const size_t line_end = nl ? static_cast<size_t>(nl - m_buf.str) : m_buf.len;
+    csubstr stripped = m_buf.range(line_start, line_end).trimr('\r');
+    m_state->line_contents.reset(m_buf.range(line_start, nl ? line_end + 1 : line_end), stripped);
+    m_state->line_contents.rem = stripped.sub(pos - line_start < stripped.len ? pos - line_start : stripped.len);
+    m_state->pos.offset = pos;
+    m_state->pos.line = line;
+    m_state->pos.col = pos - line_start + 1;
+}
+
+//-----------------------------------------------------------------------------
+void Parser::_parse_events(csubstr file, substr buf, pfn_evt fn, void *handler)
+{
+    m_evt_mode = true;
+    m_evt_fn = fn;
+    m_evt_handler = handler;
+    m_evt_open.clear();
+    m_evt_tree.clear();
+    _parse(file, buf, &m_evt_tree, m_evt_tree.root_id());
+    _evt_flush_root();
+    m_evt_mode = false;
+    m_evt_fn = nullptr;
+    m_evt_handler = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+ValidationResult Parser::validate(csubstr filename, csubstr src)
+{
+    ValidationResult result = {true, {}, {}};
+    _ValidateStatus status = {};
+    // leave the parser usable also when an error callback throws
+    struct _Restore
+    {
+        Parser *p;
+        ~_Restore() { p->m_validate = nullptr; p->m_evt_mode = false; }
+    } restore = {this};
+    m_validate = &status;
+    m_reserved = {};
+    m_evt_mode = true;
+    m_evt_fn = nullptr;
+    m_evt_handler = nullptr;
+    m_evt_open.clear();
+    m_evt_tree.clear();
+    // the scalars are not filtered when validating, so the source is
+    // never written
+    substr buf(const_cast<char*>(src.str), src.len);
+    // the scratch state left by an error is reset on the next parse
+#ifdef RYML_VALIDATE_EXCEPTIONS
+    try
+    {
+        _parse(filename, buf, &m_evt_tree, m_evt_tree.root_id());
+        _evt_flush_root();
+    }
+    catch(_ValidateStop const&)
+    {
+        result.ok = false;
+    }
+#else
+    if(setjmp(status.stop) == 0)
+    {
+        _parse(filename, buf, &m_evt_tree, m_evt_tree.root_id());
+        _evt_flush_root();
+    }
+    else
+    {
+        result.ok = false;
+    }
+#endif
+    if( ! result.ok)
+    {
+        result.location = status.location;
+        result.message = csubstr(m_validate_msg, status.msg_len);
+    }
+    return result;
+}
+
+/** record the error found while validating, and unwind the parser back
+ * to validate() */
+void Parser::_validate_failed(const char *msg, size_t len) const
+{
+    RYML_ASSERT(m_validate != nullptr);
+    if(len > sizeof(m_validate_msg))
+        len = sizeof(m_validate_msg);
+    memcpy(const_cast<char*>(m_validate_msg), msg, len);
+    m_validate->location = _err_location();
+    m_validate->msg_len = len;
+#ifdef RYML_VALIDATE_EXCEPTIONS
+    throw _ValidateStop{};
+#else
+    longjmp(m_validate->stop, 1);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+/** send the events of the nodes still held by the scratch tree, and
+ * release them */
+void Parser::_evt_flush_root()
+{
+    RYML_ASSERT(m_evt_mode);
+    id_type root = m_tree->root_id();
+    if(_evt_is_open(root) || m_tree->type(root) != NOTYPE)
+        _evt_close(root);
+    RYML_ASSERT(m_evt_open.empty());
+    m_tree->remove_children(root);
+    m_tree->_clear(root);
+}
+
+/** in event mode, the previous last child of parent is complete once
+ * a new child is appended to parent: send its events and release it */
+void Parser::_evt_flush_prev_child(id_type parent)
+{
+    RYML_ASSERT(m_evt_mode);
+    id_type prev = m_tree->last_child(parent);
+    if(prev == NONE)
+        return;
+    _evt_open_path(parent);
+    _evt_close(prev);
+    m_tree->remove(prev);
+}
+
+bool Parser::_evt_is_open(id_type node) const
+{
+    for(id_type id : m_evt_open)
+        if(id == node)
+            return true;
+    return false;
+}
+
+/** send the begin events of node and of all its ancestors which were
+ * not yet sent */
+void Parser::_evt_open_path(id_type node)
+{
+    if(_evt_is_open(node))
+        return;
+    id_type parent = m_tree->parent(node);
+    if(parent != NONE)
+        _evt_open_path(parent);
+    RYML_ASSERT(m_evt_open.empty() || m_evt_open.top() == parent);
+    _evt_send(node, _EVT_BEGIN);
+    m_evt_open.push(node);
+}
+
+/** send the remaining events of node: if its begin events were already
+ * sent then only its remaining children and its end events are sent */
+void Parser::_evt_close(id_type node)
+{
+    if( ! _evt_is_open(node))
+    {
+        _evt_send(node, _EVT_WHOLE);
+        return;
     }
+    for(id_type ch = m_tree->first_child(node); ch != NONE; ch = m_tree->next_sibling(ch))
+        _evt_close(ch);
+    RYML_ASSERT(m_evt_open.top() == node);
+    _evt_send(node, _EVT_END);
+    m_evt_open.pop();
+}
+
+//-----------------------------------------------------------------------------
+id_type Parser::_append_child(id_type parent)
+{
+    if(m_evt_mode)
+        _evt_flush_prev_child(parent);
+    return m_tree->append_child(parent);
+}
+
+//-----------------------------------------------------------------------------
+void Parser::_handle_finished_file()
+{
+    _end_stream();
+}
+
+//-----------------------------------------------------------------------------
+/* The line handler is selected by the flags RUNK, RMAP, RSEQ and
+ * EXPL, which are contiguous: they index a table instead of going
+ * through the top-level cascade of tests. Only this top-level
+ * selection is table-driven: the handlers still test the tokens of
+ * the line in sequence. RSEQ has precedence over RMAP, which has
+ * precedence over RUNK; without any of them, only _handle_top() is
+ * used. */
+const Parser::pfn_handle_line Parser::s_handle_line[16] = {
+    // implicit
+    nullptr,                   // (none)
+    &Parser::_handle_unk,      // RUNK
+    &Parser::_handle_map_impl, // RMAP
+    &Parser::_handle_map_impl, // RMAP|RUNK
+    &Parser::_handle_seq_impl, // RSEQ
+    &Parser::_handle_seq_impl, // RSEQ|RUNK
+    &Parser::_handle_seq_impl, // RSEQ|RMAP
+    &Parser::_handle_seq_impl, // RSEQ|RMAP|RUNK
+    // explicit
+    nullptr,                   // EXPL
+    &Parser::_handle_unk,      // EXPL|RUNK
+    &Parser::_handle_map_expl, // EXPL|RMAP
+    &Parser::_handle_map_expl, // EXPL|RMAP|RUNK
+    &Parser::_handle_seq_expl, // EXPL|RSEQ
+    &Parser::_handle_seq_expl, // EXPL|RSEQ|RUNK
+    &Parser::_handle_seq_expl, // EXPL|RSEQ|RMAP
+    &Parser::_handle_seq_expl, // EXPL|RSEQ|RMAP|RUNK
+};
+
+void Parser::_handle_line()
+{
+    _c4dbgq("\n-----------");
+    _c4dbgt("handling line=%zu, offset=%zuB", m_state->pos.line, m_state->pos.offset);
+
+    RYML_ASSERT( ! m_state->line_contents.rem.empty());
+
+    static_assert(RUNK == (1 << 1) && RMAP == (1 << 2) && RSEQ == (1 << 3) && EXPL == (1 << 4),
+                  "the line handler table needs these flags to be contiguous");
+    const pfn_handle_line handler = s_handle_line[(m_state->flags >> 1) & 0xf];
+    if(handler && (this->*handler)())
+        return;
 
     if(_handle_top())
         return;
@@ -306,6 +968,7 @@ bool Parser::_handle_unk()
     else if(rem.begins_with("? "))
     {
         _c4dbgpf("it's a map (as_child=%d) + this key is complex", start_as_child);
+        _require_feature(PARSE_COMPLEX_KEYS, "complex keys");
         _push_level();
         _start_map(start_as_child);
         addrem_flags(RKEY|CPLX, RVAL);
@@ -605,6 +1268,7 @@ bool Parser::_handle_seq_expl()
         else if(rem.begins_with("? "))
         {
             _c4dbgpf("found '? ' -- there's an implicit map in the seq node[%zu]", m_state->node_id);
+            _require_feature(PARSE_COMPLEX_KEYS, "complex keys");
             _start_seqimap();
             _line_progressed(2);
             RYML_ASSERT(has_any(SSCL) && m_state->scalar == "");
@@ -756,6 +1420,9 @@ bool Parser::_handle_seq_impl()
         if(_handle_indentation())
             return true;
 
+        if(m_lazy && ! m_evt_mode && _handle_lazy_entry())
+            return true;
+
         csubstr s;
         bool is_quoted;
         if(_scan_scalar(&s, &is_quoted)) // this also progresses the line
@@ -846,6 +1513,7 @@ bool Parser::_handle_seq_impl()
         else if(rem.begins_with("? "))
         {
             _c4dbgp("val is a child map + this key is complex");
+            _require_feature(PARSE_COMPLEX_KEYS, "complex keys");
             addrem_flags(RNXT, RVAL); // before _push_level!
             _push_level();
             _start_map();
@@ -1027,6 +1695,7 @@ bool Parser::_handle_map_expl()
         else if(rem.begins_with('?'))
         {
             _c4dbgp("complex key");
+            _require_feature(PARSE_COMPLEX_KEYS, "complex keys");
             add_flags(CPLX);
             _line_progressed(1);
             return true;
@@ -1215,6 +1884,11 @@ bool Parser::_handle_map_impl()
         addrem_flags(RKEY, RNXT);
     }
 
+    if(m_lazy && ! m_evt_mode && has_all(RVAL|SSCL) && _handle_lazy_val())
+    {
+        return true;
+    }
+
     if(_handle_indentation())
     {
         //rem = m_state->line_contents.rem;
@@ -1266,6 +1940,7 @@ bool Parser::_handle_map_impl()
         else if(rem.begins_with("? "))
         {
             _c4dbgp("it's a complex key");
+            _require_feature(PARSE_COMPLEX_KEYS, "complex keys");
             add_flags(CPLX);
             _line_progressed(2);
             if(has_all(SSCL))
@@ -1545,6 +2220,7 @@ bool Parser::_handle_key_anchors_and_refs()
     if(rem.begins_with('&'))
     {
         _c4dbgp("found a key anchor!!!");
+        _require_feature(PARSE_ANCHORS, "anchors");
         csubstr anchor = rem.left_of(rem.first_of(' '));
         _line_progressed(anchor.len);
         anchor = anchor.sub(1); // skip the first character
@@ -1569,6 +2245,7 @@ bool Parser::_handle_val_anchors_and_refs()
     const csubstr rem = m_state->line_contents.rem;
     if(rem.begins_with('&'))
     {
+        _require_feature(PARSE_ANCHORS, "anchors");
         csubstr anchor = rem.left_of(rem.first_of(' '));
         _line_progressed(anchor.len);
         anchor = anchor.sub(1); // skip the first character
@@ -1682,6 +2359,10 @@ bool Parser::_handle_types()
     csubstr rem = m_state->line_contents.rem.triml(' ');
     csubstr t;
 
+    if( ! rem.begins_with('!'))
+        return false;
+    _require_feature(PARSE_TAGS, "tags");
+
     if(rem.begins_with("!!"))
     {
         _c4dbgp("begins with '!!'");
@@ -1975,16 +2656,8 @@ bool Parser::_scan_scalar(csubstr *C4_RESTRICT scalar, bool *C4_RESTRICT quoted)
     {
         if( ! _is_scalar_next__rmap(s))
             return false;
-        size_t colon_space = s.find(": ");
-        if(colon_space == npos)
-        {
-            colon_space = s.find(":");
-            RYML_ASSERT(s.len > 0);
-            if(colon_space != s.len-1)
-            {
-                colon_space = npos;
-            }
-        }
+        RYML_ASSERT(s.len > 0);
+        size_t colon_space = _find_colon_space(s);
 
         if(has_all(RKEY))
         {
@@ -2188,6 +2861,7 @@ substr Parser::_scan_plain_scalar_expl(csubstr currscalar, csubstr peeked_line)
         if(peeked_line.empty())
         {
             _c4err("expected token or continuation");
+            break;
         }
         pos = peeked_line.first_of(chars);
         first = false;
@@ -2200,66 +2874,143 @@ substr Parser::_scan_plain_scalar_expl(csubstr currscalar, csubstr peeked_line)
 
 //-----------------------------------------------------------------------------
 
+/** find the extent of a multi-line plain scalar in block context,
+ * walking each continuation line exactly once directly on the buffer,
+ * instead of peeking and advancing the parser line by line. The
+ * parser is moved only when the end of the scalar is found, and it is
+ * left where the line-by-line scan would have left it: at the
+ * beginning of the line which terminates the scalar (or at the last
+ * blank line before it), or at the end of the file.
+ *
+ * @param peeked_line the first continuation line, which must be the
+ * current line of the parser */
 substr Parser::_scan_plain_scalar_impl(csubstr currscalar, csubstr peeked_line, size_t indentation)
 {
     RYML_ASSERT(m_buf.is_super(currscalar));
-    // NOTE. there's a problem with _scan_to_next_nonempty_line(), as it counts newlines twice
-    // size_t offs = m_state->pos.offset;   // so we workaround by directly counting from the end of the given scalar
     RYML_ASSERT(currscalar.end() >= m_buf.begin());
-    size_t offs = static_cast<size_t>(currscalar.end() - m_buf.begin());
     RYML_ASSERT(peeked_line.begins_with(' ', indentation));
+    RYML_ASSERT(peeked_line.str == m_buf.str + m_state->pos.offset);
+    C4_UNUSED(peeked_line);
+    const size_t offs = static_cast<size_t>(currscalar.end() - m_buf.begin());
+    size_t pos = m_state->pos.offset; // the beginning of the current line
+    size_t num_lines = 0; // the lines from the parser's line to the current line
+    size_t err = npos; // the column of an invalid token
+    const char *errmsg = nullptr;
+    bool finished_file = false;
     while(true)
     {
-        _c4dbgpf("rscalar[IMPL]: continuing... ref_indentation=%zu", indentation);
-        if(peeked_line.begins_with("...") || peeked_line.begins_with("---"))
-        {
-            _c4dbgpf("rscalar[IMPL]: document termination next -- bail now '%.*s'", _c4prsp(peeked_line.trimr("\r\n")));
+        size_t eol = _find_newline(pos);
+        if(eol == npos)
+            eol = m_buf.len;
+        size_t next = eol;
+        if(next < m_buf.len && m_buf.str[next] == '\r')
+            ++next;
+        if(next < m_buf.len && m_buf.str[next] == '\n')
+            ++next;
+        csubstr line = m_buf.range(pos, eol);
+        _c4dbgpf("rscalar[IMPL]: continuing... ref_indentation=%zu line='%.*s'", indentation, _c4prsp(line));
+        if(line.begins_with("...") || line.begins_with("---"))
+        {
+            _c4dbgp("rscalar[IMPL]: document termination next -- bail now");
             break;
         }
-        else if(( ! peeked_line.begins_with(' ', indentation))) // is the line deindented?
+        else if( ! line.begins_with(' ', indentation)) // is the line deindented?
         {
-            if(!peeked_line.trim(" \r\n\t").empty()) // is the line not blank?
+            if(line.first_not_of(" \t") != npos)
             {
-                _c4dbgpf("rscalar[IMPL]: deindented line, not blank -- bail now '%.*s'", _c4prsp(peeked_line.trimr("\r\n")));
+                _c4dbgp("rscalar[IMPL]: deindented line, not blank -- bail now");
                 break;
             }
-            _c4dbgpf("rscalar[IMPL]: line is blank and has less indentation: ref=%zu line=%zu: '%.*s'", indentation, peeked_line.first_not_of(' ') == csubstr::npos ? 0 : peeked_line.first_not_of(' '), _c4prsp(peeked_line.trimr("\r\n")));
-            _c4dbgpf("rscalar[IMPL]: ... searching for a line starting at indentation %zu", indentation);
-            csubstr next_peeked = _scan_to_next_nonempty_line(indentation);
-            if(next_peeked.empty())
+            // skip the following blank lines and comments, looking
+            // for a line starting at the indentation
+            _c4dbgpf("rscalar[IMPL]: blank line, searching for a line starting at indentation %zu", indentation);
+            bool found = false;
+            while( ! found)
+            {
+                if(next >= m_buf.len)
+                {
+                    finished_file = true;
+                    break;
+                }
+                eol = _find_newline(next);
+                if(eol == npos)
+                    eol = m_buf.len;
+                csubstr peeked = m_buf.range(next, eol);
+                const size_t ind = detail::count_leading_spaces(peeked);
+                if(peeked.sub(ind).begins_with('#'))
+                    ;
+                else if(peeked.begins_with(' ', indentation))
+                    found = true;
+                else if( ! peeked.sub(ind).trimr('\t').empty())
+                    break; // deindented, not blank: the parser stays on the current line
+                pos = next;
+                ++num_lines;
+                next = eol;
+                if(next < m_buf.len && m_buf.str[next] == '\r')
+                    ++next;
+                if(next < m_buf.len && m_buf.str[next] == '\n')
+                    ++next;
+            }
+            if( ! found)
             {
                 _c4dbgp("rscalar[IMPL]: ... finished.");
                 break;
             }
             _c4dbgp("rscalar[IMPL]: ... continuing.");
-            peeked_line = next_peeked;
+            line = m_buf.range(pos, eol);
         }
 
-        _c4dbgpf("rscalar[IMPL]: line contents: '%.*s'", _c4prsp(peeked_line.right_of(indentation, true).trimr("\r\n")));
-        if(peeked_line.find(": ") != npos)
-        {
-            _line_progressed(peeked_line.find(": "));
-            _c4err("': ' is not a valid token in plain flow (unquoted) scalars");
-        }
-        else if(peeked_line.ends_with(':'))
-        {
-            _line_progressed(peeked_line.find(':'));
-            _c4err("lines cannot end with ':' in plain flow (unquoted) scalars");
-        }
-        else if(peeked_line.find(" #") != npos)
+        // look for the tokens which cannot be in the line, in a single pass
+        for(size_t i = 0; i < line.len; ++i)
         {
-            _line_progressed(peeked_line.find(" #"));
-            _c4err("' #' is not a valid token in plain flow (unquoted) scalars");
+            const char c = line.str[i];
+            if(c == ':' && (i+1 == line.len || line.str[i+1] == ' '))
+            {
+                err = i;
+                errmsg = i+1 == line.len ?
+                    "lines cannot end with ':' in plain flow (unquoted) scalars" :
+                    "': ' is not a valid token in plain flow (unquoted) scalars";
+                break;
+            }
+            else if(c == ' ' && i+1 < line.len && line.str[i+1] == '#' && err == npos)
+            {
+                err = i; // keep looking for a colon, which is reported first
+                errmsg = "' #' is not a valid token in plain flow (unquoted) scalars";
+            }
         }
+        if(err != npos)
+            break;
 
-        _c4dbgpf("rscalar[IMPL]: append another line: (len=%zu)'%.*s'", peeked_line.len, _c4prsp(peeked_line.trimr("\r\n")));
-        if(!_advance_to_peeked())
+        _c4dbgpf("rscalar[IMPL]: append another line: (len=%zu)'%.*s'", line.len, _c4prsp(line));
+        if(next >= m_buf.len)
         {
             _c4dbgp("rscalar[IMPL]: file finishes after the scalar");
+            finished_file = true;
             break;
         }
-        peeked_line = m_state->line_contents.rem;
+        pos = next;
+        ++num_lines;
+    }
+
+    // now move the parser to the line where the scan stopped
+    if(num_lines)
+    {
+        _line_progressed(m_state->line_contents.rem.len);
+        m_state->pos.offset = pos;
+        m_state->pos.line += num_lines;
+        m_state->pos.col = 1;
+        _scan_line();
+    }
+    if(finished_file)
+    {
+        _advance_to_peeked();
+    }
+    else if(err != npos)
+    {
+        _line_progressed(err);
+        _c4err("%s", errmsg);
     }
+
     RYML_ASSERT(m_state->pos.offset >= offs);
     substr full(m_buf.str + (currscalar.str - m_buf.str),
                 currscalar.len + (m_state->pos.offset - offs));
@@ -2343,7 +3094,8 @@ csubstr Parser::_scan_to_next_nonempty_line(size_t indentation)
         _c4dbgpf("rscalar: ... curr offset: %zu indentation=%zu", m_state->pos.offset, indentation);
         next_peeked = _peek_next_line(m_state->pos.offset);
         _c4dbgpf("rscalar: ... next peeked line='%.*s'", _c4prsp(next_peeked.trimr("\r\n")));
-        if(next_peeked.triml(' ').begins_with('#'))
+        const size_t next_indentation = detail::count_leading_spaces(next_peeked);
+        if(next_peeked.sub(next_indentation).begins_with('#'))
         {
             ; // nothing to do
         }
@@ -2355,7 +3107,7 @@ csubstr Parser::_scan_to_next_nonempty_line(size_t indentation)
         }
         else   // check for de-indentation
         {
-            csubstr trimmed = next_peeked.triml(' ').trimr("\t\r\n");
+            csubstr trimmed = next_peeked.sub(next_indentation).trimr("\t\r\n");
             _c4dbgpf("rscalar: ... deindented! trimmed='%.*s'", _c4prsp(trimmed));
             if(!trimmed.empty())
             {
@@ -2395,27 +3147,6 @@ C4_ALWAYS_INLINE size_t _extend_from_combined_newline(char nl, char following)
     return (nl == '\n' && following == '\r') || (nl == '\r' && following == '\n');
 }
 
-//! look for the next newline chars, and jump to the right of those
-csubstr from_next_line(csubstr rem)
-{
-    size_t nlpos = rem.first_of("\r\n");
-    if(nlpos == csubstr::npos)
-    {
-        return {};
-    }
-    const char nl = rem[nlpos];
-    rem = rem.right_of(nlpos);
-    if(rem.empty())
-    {
-        return {};
-    }
-    if(_extend_from_combined_newline(nl, rem.front()))
-    {
-        rem = rem.sub(1);
-    }
-    return rem;
-}
-
 csubstr Parser::_peek_next_line(size_t pos) const
 {
     csubstr rem{}; // declare here because of the goto
@@ -2427,19 +3158,36 @@ csubstr Parser::_peek_next_line(size_t pos) const
     }
 
     // look for the next newline chars, and jump to the right of those
-    rem = from_next_line(m_buf.sub(pos));
-    if(rem.empty())
+    nlpos = _find_newline(pos);
+    if(nlpos == npos)
+    {
+        goto next_is_empty;
+    }
+    pos = nlpos + 1;
+    if(pos < m_buf.len && _extend_from_combined_newline(m_buf.str[nlpos], m_buf.str[pos]))
+    {
+        ++pos;
+    }
+    if(pos >= m_buf.len)
     {
         goto next_is_empty;
     }
 
     // now get everything up to and including the following newline chars
-    nlpos = rem.first_of("\r\n");
-    if((nlpos != csubstr::npos) && (nlpos + 1 < rem.len))
+    nlpos = _find_newline(pos);
+    if(nlpos == npos)
+    {
+        nlpos = m_buf.len;
+    }
+    else
     {
-        nlpos += _extend_from_combined_newline(rem[nlpos], rem[nlpos+1]);
+        ++nlpos;
+        if(nlpos < m_buf.len && _extend_from_combined_newline(m_buf.str[nlpos-1], m_buf.str[nlpos]))
+        {
+            ++nlpos;
+        }
     }
-    rem = rem.left_of(nlpos, /*include_pos*/true);
+    rem = m_buf.range(pos, nlpos);
 
     _c4dbgpf("peek next line @ %zu: (len=%zu)'%.*s'", pos, rem.len, _c4prsp(rem.trimr("\r\n")));
     return rem;
@@ -2448,19 +3196,385 @@ next_is_empty:
     return {};
 }
 
+/** find the first ": " in s; if there is none, accept only a colon
+ * which is both the first and the last in s. The structural index is
+ * used to jump over the characters which cannot be a colon. */
+size_t Parser::_find_colon_space(csubstr s) const
+{
+    RYML_ASSERT(m_buf.is_super(s));
+    const size_t offs = static_cast<size_t>(s.str - m_buf.str);
+    size_t first_colon = npos;
+    size_t i = offs;
+    while(true)
+    {
+        size_t pos = _find_structural(i, offs + s.len);
+        if(pos == npos)
+            break;
+        if(m_buf.str[pos] == ':')
+        {
+            if(pos + 1 < offs + s.len && m_buf.str[pos + 1] == ' ')
+                return pos - offs;
+            if(first_colon == npos)
+                first_colon = pos - offs;
+        }
+        i = pos + 1;
+    }
+    return (first_colon + 1 == s.len) ? first_colon : npos;
+}
+
+//-----------------------------------------------------------------------------
+/** parse the source of a lazy node into it: this is the expand
+ * function given to Tree::set_lazy() */
+void Parser::_expand_lazy(Tree *t, id_type node, substr src)
+{
+    // the source of a lazy block map which is a seq entry starts with
+    // the dash (see _handle_lazy_entry()): blank it to parse the entry
+    // as an indented map. The dash is not part of any scalar.
+    if(t->is_map(node))
+    {
+        const size_t dash = src.first_not_of(' ');
+        if(dash != npos && src.str[dash] == '-')
+            src.str[dash] = ' ';
+    }
+    // the node already has its final type, so parsing into it keeps
+    // its key, and its own nested containers are again left lazy
+    Parser np(t->m_alloc);
+    np.set_lazy(true);
+    np.parse({}, src, t, node);
+}
+
+//-----------------------------------------------------------------------------
+/** in lazy mode, skip the block or flow collection which is the val of
+ * the stored key, and append it to the current map as a LAZY node. The
+ * collection is only recognized when the parser would start it in the
+ * same way when expanding the node; otherwise, it is left to the
+ * regular parse. */
+bool Parser::_handle_lazy_val()
+{
+    RYML_ASSERT(has_all(RMAP|RVAL|SSCL));
+    if(has_any(CPLX|RSET|RSEQIMAP)
+       || m_key_anchor.not_empty() || m_key_tag.not_empty() || m_key_tag2.not_empty()
+       || m_val_anchor.not_empty() || m_val_tag.not_empty())
+        return false;
+
+    csubstr rem = m_state->line_contents.rem;
+    const size_t first = m_state->pos.offset;
+    size_t last, next, num_lines;
+    bool is_seq;
+    if(_at_line_begin())
+    {
+        if( ! _lazy_block_range(&last, &num_lines, &is_seq))
+            return false;
+        next = last;
+    }
+    else if(rem.begins_with('[') || rem.begins_with('{'))
+    {
+        is_seq = rem.begins_with('[');
+        if( ! _lazy_flow_range(first, &last, &next, &num_lines))
+            return false;
+    }
+    else
+    {
+        return false;
+    }
+    _c4dbgpf("lazy %s: skipping %zu lines", is_seq ? "seq" : "map", num_lines);
+
+    const type_bits key_quoted = has_all(SSCL_QUO) ? KEYQUO : NOTYPE;
+    csubstr key = _consume_scalar();
+    id_type node_id = _append_child(m_state->node_id);
+    if(is_seq)
+        m_tree->to_seq(node_id, key, key_quoted);
+    else
+        m_tree->to_map(node_id, key, key_quoted);
+    m_tree->set_lazy(node_id, m_buf.range(first, last), &Parser::_expand_lazy);
+    _write_key_anchor(node_id);
+    addrem_flags(RKEY, RVAL);
+
+    // resume at the line following the collection
+    _line_progressed(m_state->line_contents.rem.len);
+    m_state->pos.offset = next;
+    m_state->pos.line += num_lines;
+    m_state->pos.col = 1;
+    _scan_line();
+    return true;
+}
+
+/** in lazy mode, skip the block map or the flow collection which is
+ * the current entry of a block seq, and append it to the seq as a LAZY
+ * node. A block map is recognized only when it starts with a plain key
+ * in the line of its dash, eg <tt>- name: x</tt>; its source then
+ * begins at the start of that line, so that all its lines keep their
+ * indentation, and the dash is blanked when expanding. */
+bool Parser::_handle_lazy_entry()
+{
+    RYML_ASSERT(has_all(RSEQ|RVAL) && has_none(EXPL));
+    if(m_key_anchor.not_empty() || m_key_tag.not_empty() || m_key_tag2.not_empty()
+       || m_val_anchor.not_empty() || m_val_tag.not_empty())
+        return false;
+
+    LineContents const& lc = m_state->line_contents;
+    csubstr rem = lc.rem;
+    // the entry must begin in the line of its dash, after only spaces
+    csubstr prefix = lc.full.first(static_cast<size_t>(rem.str - lc.full.str));
+    if(prefix.trim(' ') != '-')
+        return false;
+    const size_t dash_col = prefix.first_of('-');
+    size_t first, last, next, num_lines;
+    bool is_seq = false;
+    if(rem.begins_with('[') || rem.begins_with('{'))
+    {
+        is_seq = rem.begins_with('[');
+        first = m_state->pos.offset;
+        if( ! _lazy_flow_range(first, &last, &next, &num_lines))
+            return false;
+    }
+    else
+    {
+        if(rem.begins_with_any(" [{'\"|>&!*?%:-#\t"))
+            return false; // not a plain key
+        const size_t colon = _find_colon_space(rem);
+        if(colon == npos || rem.find(" #") < colon)
+            return false; // not a key, or the colon is in a comment
+        first = static_cast<size_t>(lc.full.str - m_buf.str);
+        _lazy_entry_range(first, dash_col, &last, &num_lines);
+        next = last;
+    }
+    _c4dbgpf("lazy entry %s: skipping %zu lines", is_seq ? "seq" : "map", num_lines);
+
+    id_type node_id = _append_child(m_state->node_id);
+    if(is_seq)
+        m_tree->to_seq(node_id);
+    else
+        m_tree->to_map(node_id);
+    m_tree->set_lazy(node_id, m_buf.range(first, last), &Parser::_expand_lazy);
+    addrem_flags(RNXT, RVAL);
+
+    // resume at the line following the entry
+    _line_progressed(m_state->line_contents.rem.len);
+    m_state->pos.offset = next;
+    m_state->pos.line += num_lines;
+    m_state->pos.col = 1;
+    _scan_line();
+    return true;
+}
+
+/** find the extent of the seq entry whose dash line starts at first:
+ * that line, and the following lines indented more than the dash.
+ * Blank and comment lines are included only when followed by a line of
+ * the entry.
+ * @param last receives the position after the last line of the entry
+ * @param num_lines receives the number of lines up to last */
+void Parser::_lazy_entry_range(size_t first, size_t dash_col, size_t *last, size_t *num_lines) const
+{
+    size_t pos = first;
+    size_t lines = 0;
+    *last = npos;
+    while(pos < m_buf.len)
+    {
+        size_t eol = _find_newline(pos);
+        if(eol == npos)
+            eol = m_buf.len;
+        size_t next = eol;
+        if(next < m_buf.len && m_buf.str[next] == '\r')
+            ++next;
+        if(next < m_buf.len && m_buf.str[next] == '\n')
+            ++next;
+        csubstr line = m_buf.range(pos, eol);
+        size_t ind = line.first_not_of(' ');
+        if(ind != npos && line.str[ind] != '#')
+        {
+            if(*last != npos && ind <= dash_col)
+                break;
+            *last = next;
+            *num_lines = lines + 1;
+        }
+        ++lines;
+        pos = next;
+    }
+    RYML_ASSERT(*last != npos); // the dash line is always in the entry
+}
+
+/** find the extent of the block collection starting at the current
+ * line: the lines indented more than the current map, or the seq
+ * entries at the same indentation. Blank and comment lines are skipped.
+ * @param last receives the position after the last line of the collection
+ * @param num_lines receives the number of lines up to last */
+bool Parser::_lazy_block_range(size_t *last, size_t *num_lines, bool *is_seq) const
+{
+    const size_t indref = m_state->indref;
+    bool same_level = false;
+    size_t pos = m_state->pos.offset;
+    size_t lines = 0;
+    *last = npos;
+    while(pos < m_buf.len)
+    {
+        size_t eol = _find_newline(pos);
+        if(eol == npos)
+            eol = m_buf.len;
+        size_t next = eol;
+        if(next < m_buf.len && m_buf.str[next] == '\r')
+            ++next;
+        if(next < m_buf.len && m_buf.str[next] == '\n')
+            ++next;
+        csubstr line = m_buf.range(pos, eol);
+        size_t ind = line.first_not_of(' ');
+        if(ind != npos && line.str[ind] != '#')
+        {
+            csubstr s = line.sub(ind);
+            const bool is_entry = s.begins_with("- ") || s == '-';
+            if(*last == npos)
+            {
+                // the first line decides the type of the collection
+                if(ind == indref && is_entry)
+                    same_level = true;
+                else if(ind <= indref)
+                    return false; // the val is null
+                if(is_entry)
+                    *is_seq = true;
+                else if(s.begins_with_any("[{'\"|>&!*?%:-\t") || _find_colon_space(s) == npos)
+                    return false; // not a plain key
+                else
+                    *is_seq = false;
+            }
+            else if(ind < indref || (ind == indref && ! (same_level && is_entry)))
+            {
+                break;
+            }
+            *last = next;
+            *num_lines = lines + 1;
+        }
+        else if(*last == npos)
+        {
+            return false; // let the parser skip the blank and comment lines
+        }
+        ++lines;
+        pos = next;
+    }
+    return *last != npos;
+}
+
+/** find the extent of the flow collection opened at first, by
+ * balancing its brackets. Quoted scalars and comments are skipped.
+ * @param last receives the position after the closing bracket
+ * @param next receives the position of the following line
+ * @param num_lines receives the number of line endings up to next */
+bool Parser::_lazy_flow_range(size_t first, size_t *last, size_t *next, size_t *num_lines) const
+{
+    RYML_ASSERT(m_buf.str[first] == '[' || m_buf.str[first] == '{');
+    size_t level = 0;
+    size_t pos = first;
+    *last = npos;
+    while(*last == npos)
+    {
+        pos = _find_structural(pos, m_buf.len);
+        if(pos == npos)
+            return false; // unbalanced: let the parser report the error
+        switch(m_buf.str[pos])
+        {
+        case '[':
+        case '{':
+            ++level;
+            break;
+        case ']':
+        case '}':
+            if(level == 0)
+                return false;
+            if(--level == 0)
+                *last = pos + 1;
+            break;
+        case '#':
+            if(m_buf.str[pos - 1] == ' ' || m_buf.str[pos - 1] == '\t' || m_buf.str[pos - 1] == '\n' || m_buf.str[pos - 1] == '\r')
+            {
+                pos = _find_newline(pos);
+                if(pos == npos)
+                    return false;
+            }
+            break;
+        case '\'':
+        case '"':
+        {
+            // a quote opens a scalar only after an indicator or at
+            // the beginning of a line (eg, not in it's)
+            size_t prev = pos - 1;
+            while(m_buf.str[prev] == ' ' || m_buf.str[prev] == '\t')
+                --prev; // the opening bracket stops this
+            if(csubstr("[{,:\r\n").first_of(m_buf.str[prev]) != npos)
+            {
+                pos = _lazy_skip_quoted(pos);
+                if(pos == npos)
+                    return false;
+                continue;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        ++pos;
+    }
+    // the rest of the line must be blank or a comment
+    size_t eol = _find_newline(*last);
+    if(eol == npos)
+        eol = m_buf.len;
+    csubstr rest = m_buf.range(*last, eol).triml(" \t");
+    if( ! rest.empty() && ! rest.begins_with('#'))
+        return false;
+    *next = eol;
+    if(*next < m_buf.len && m_buf.str[*next] == '\r')
+        ++*next;
+    if(*next < m_buf.len && m_buf.str[*next] == '\n')
+        ++*next;
+    size_t lines = 0;
+    for(size_t nl = _find_newline(first); nl != npos && nl < *next; nl = _find_newline(nl + 1))
+    {
+        if(m_buf.str[nl] == '\r' && nl + 1 < m_buf.len && m_buf.str[nl + 1] == '\n')
+            ++nl;
+        ++lines;
+    }
+    *num_lines = lines;
+    return true;
+}
+
+/** @return the position after the closing quote of the quoted scalar
+ * starting at pos, or npos if it is not closed */
+size_t Parser::_lazy_skip_quoted(size_t pos) const
+{
+    const char q = m_buf.str[pos];
+    for(size_t i = pos + 1; i < m_buf.len; ++i)
+    {
+        const char *found = (const char*) memchr(m_buf.str + i, q, m_buf.len - i);
+        if( ! found)
+            return npos;
+        i = static_cast<size_t>(found - m_buf.str);
+        if(q == '"')
+        {
+            size_t num_backslashes = 0;
+            for(size_t j = i; j > pos + 1 && m_buf.str[j - 1] == '\\'; --j)
+                ++num_backslashes;
+            if((num_backslashes & 1) == 0)
+                return i + 1;
+        }
+        else if(i + 1 < m_buf.len && m_buf.str[i + 1] == '\'')
+        {
+            ++i; // an escaped quote
+        }
+        else
+        {
+            return i + 1;
+        }
+    }
+    return npos;
+}
+
 //-----------------------------------------------------------------------------
 void Parser::_scan_line()
 {
     if(m_state->pos.offset >= m_buf.len) return;
 
     char const* b = &m_buf[m_state->pos.offset];
-    char const* e = b;
-
     // get the line stripped of newline chars
-    while(e < m_buf.end() && (*e != '\n' && *e != '\r'))
-    {
-        ++e;
-    }
+    size_t nlpos = _find_newline(m_state->pos.offset);
+    char const* e = nlpos != npos ? m_buf.str + nlpos : m_buf.end();
     RYML_ASSERT(e >= b);
     csubstr stripped = m_buf.sub(m_state->pos.offset, static_cast<size_t>(e - b));
 
@@ -2473,6 +3587,32 @@ void Parser::_scan_line()
     m_state->line_contents.reset(full, stripped);
 }
 
+//-----------------------------------------------------------------------------
+/** get the position of the first newline character (\n or \r) at or
+ * after pos, or npos if there is none */
+size_t Parser::_find_newline(size_t pos) const
+{
+    if(m_indexed)
+        return m_index.find_newline(pos);
+    if(pos >= m_buf.len)
+        return npos;
+    const size_t nl = detail::find_newline(m_buf.sub(pos));
+    return nl != npos ? pos + nl : npos;
+}
+
+/** get the position of the first structural character in [pos,end[,
+ * or npos if there is none */
+size_t Parser::_find_structural(size_t pos, size_t end) const
+{
+    RYML_ASSERT(end <= m_buf.len);
+    if(m_indexed)
+        return m_index.find_structural(pos, end);
+    if(pos >= end)
+        return npos;
+    const size_t st = detail::find_structural(m_buf.range(pos, end));
+    return st != npos ? pos + st : npos;
+}
+
 //-----------------------------------------------------------------------------
 void Parser::_line_progressed(size_t ahead)
 {
@@ -2508,7 +3648,7 @@ void Parser::_save_indentation(size_t behind)
 }
 
 //-----------------------------------------------------------------------------
-void Parser::_write_key_anchor(size_t node_id)
+void Parser::_write_key_anchor(id_type node_id)
 {
     RYML_ASSERT(m_tree->has_key(node_id));
     if( ! m_key_anchor.empty())
@@ -2525,6 +3665,7 @@ void Parser::_write_key_anchor(size_t node_id)
         if(r.begins_with('*'))
         {
             _c4dbgpf("node=%zd: set key reference: '%.*s'", node_id, _c4prsp(r));
+            _require_feature(PARSE_ANCHORS, "references");
             m_tree->set_key_ref(node_id, r.sub(1));
         }
         else if(r == "<<")
@@ -2533,7 +3674,7 @@ void Parser::_write_key_anchor(size_t node_id)
             if(m_tree->is_seq(node_id))
             {
                 _c4dbgpf("node=%zd: inheriting from seq of %zd", node_id, m_tree->num_children(node_id));
-                for(size_t i = m_tree->first_child(node_id); i != NONE; i = m_tree->next_sibling(i))
+                for(id_type i = m_tree->first_child(node_id); i != NONE; i = m_tree->next_sibling(i))
                 {
                     if( ! (m_tree->val(i).begins_with('*')))
                         _c4err("malformed reference: '%.*s'", _c4prsp(m_tree->val(i)));
@@ -2549,7 +3690,7 @@ void Parser::_write_key_anchor(size_t node_id)
 }
 
 //-----------------------------------------------------------------------------
-void Parser::_write_val_anchor(size_t node_id)
+void Parser::_write_val_anchor(id_type node_id)
 {
     if( ! m_val_anchor.empty())
     {
@@ -2561,6 +3702,7 @@ void Parser::_write_val_anchor(size_t node_id)
     if(!m_tree->is_val_quoted(node_id) && r.begins_with('*'))
     {
         _c4dbgpf("node=%zd: set val reference: '%.*s'", node_id, _c4prsp(r));
+        _require_feature(PARSE_ANCHORS, "references");
         m_tree->set_val_ref(node_id, r.sub(1));
     }
 }
@@ -2584,7 +3726,7 @@ void Parser::_push_level(bool explicit_flow_chars)
     m_stack.push(*m_state);
     m_state = &m_stack.top();
     set_flags(st);
-    m_state->node_id = (size_t)NONE;
+    m_state->node_id = NONE;
     m_state->indref = (size_t)NONE;
     ++m_state->level;
     _c4dbgpf("pushing level: now, currlevel=%zd", m_state->level);
@@ -2634,7 +3776,7 @@ void Parser::_start_doc(bool as_child)
 {
     _c4dbgpf("start_doc (as child=%d)", as_child);
     RYML_ASSERT(node(m_stack.bottom()) == node(m_root_id));
-    size_t parent_id = m_stack.size() < 2 ? m_root_id : m_stack.top(1).node_id;
+    id_type parent_id = m_stack.size() < 2 ? m_root_id : m_stack.top(1).node_id;
     RYML_ASSERT(parent_id != NONE);
     RYML_ASSERT(m_tree->is_root(parent_id));
     RYML_ASSERT(node(m_state) == nullptr || node(m_state) == node(m_root_id));
@@ -2643,10 +3785,15 @@ void Parser::_start_doc(bool as_child)
         _c4dbgpf("start_doc: parent=%zu", parent_id);
         if( ! m_tree->is_stream(parent_id))
         {
+            if(m_evt_mode)
+            {
+                _c4dbgp("start_doc: flushing the implicit document");
+                _evt_flush_root();
+            }
             _c4dbgp("start_doc: rearranging with root as STREAM");
             m_tree->set_root_as_stream();
         }
-        m_state->node_id = m_tree->append_child(parent_id);
+        m_state->node_id = _append_child(parent_id);
         m_tree->to_doc(m_state->node_id);
     }
     else
@@ -2710,7 +3857,7 @@ void Parser::_end_stream()
 
     if(added)
     {
-        size_t added_id = m_tree->id(added);
+        id_type added_id = m_tree->id(added);
         if(m_tree->is_seq(m_state->node_id) || m_tree->is_doc(m_state->node_id))
         {
             if(!m_key_anchor.empty())
@@ -2783,17 +3930,17 @@ void Parser::_start_map(bool as_child)
     _c4dbgpf("start_map (as child=%d)", as_child);
     addrem_flags(RMAP|RVAL, RKEY|RUNK);
     RYML_ASSERT(node(m_stack.bottom()) == node(m_root_id));
-    size_t parent_id = m_stack.size() < 2 ? m_root_id : m_stack.top(1).node_id;
+    id_type parent_id = m_stack.size() < 2 ? m_root_id : m_stack.top(1).node_id;
     RYML_ASSERT(parent_id != NONE);
     RYML_ASSERT(node(m_state) == nullptr || node(m_state) == node(m_root_id));
     if(as_child)
     {
-        m_state->node_id = m_tree->append_child(parent_id);
+        m_state->node_id = _append_child(parent_id);
         if(has_all(SSCL))
         {
             csubstr key = _consume_scalar();
             m_tree->to_map(m_state->node_id, key, has_all(SSCL_QUO) ? KEYQUO : NOTYPE);
-            _c4dbgpf("start_map: id=%zd key='%.*s'", m_state->node_id, _c4prsp(node(m_state)->key()));
+            _c4dbgpf("start_map: id=%zd key='%.*s'", m_state->node_id, _c4prsp(m_tree->key(m_state->node_id)));
             _write_key_anchor(m_state->node_id);
             if( ! m_key_tag.empty())
             {
@@ -2885,18 +4032,18 @@ void Parser::_start_seq(bool as_child)
     }
     addrem_flags(RSEQ|RVAL, RUNK);
     RYML_ASSERT(node(m_stack.bottom()) == node(m_root_id));
-    size_t parent_id = m_stack.size() < 2 ? m_root_id : m_stack.top(1).node_id;
+    id_type parent_id = m_stack.size() < 2 ? m_root_id : m_stack.top(1).node_id;
     RYML_ASSERT(parent_id != NONE);
     RYML_ASSERT(node(m_state) == nullptr || node(m_state) == node(m_root_id));
     if(as_child)
     {
-        m_state->node_id = m_tree->append_child(parent_id);
+        m_state->node_id = _append_child(parent_id);
         if(has_all(SSCL))
         {
             RYML_ASSERT(node(parent_id)->is_map());
             csubstr name = _consume_scalar();
             m_tree->to_seq(m_state->node_id, name);
-            _c4dbgpf("start_seq: id=%zd name='%.*s'", m_state->node_id, _c4prsp(node(m_state)->key()));
+            _c4dbgpf("start_seq: id=%zd name='%.*s'", m_state->node_id, _c4prsp(m_tree->key(m_state->node_id)));
             _write_key_anchor(m_state->node_id);
             if( ! m_key_tag.empty())
             {
@@ -2956,10 +4103,11 @@ void Parser::_start_seqimap()
         auto prev = m_tree->last_child(m_state->node_id);
         _c4dbgpf("has children and last child=%zu has val. saving the scalars, val='%.*s', val='%.*s'", prev, _c4prsp(m_tree->val(prev)), _c4prsp(m_tree->valsc(prev).scalar));
         NodeScalar tmp = m_tree->valsc(prev);
+        bool quoted = m_tree->is_val_quoted(prev);
         m_tree->remove(prev);
         _push_level();
         _start_map();
-        _store_scalar(tmp.scalar, m_tree->is_val_quoted(prev));
+        _store_scalar(tmp.scalar, quoted);
         m_key_anchor = tmp.anchor;
         m_key_tag = tmp.tag;
     }
@@ -2987,10 +4135,10 @@ NodeData* Parser::_append_val(csubstr val, bool quoted)
     RYML_ASSERT(node(m_state)->is_seq());
     type_bits additional_flags = quoted ? VALQUO : NOTYPE;
     _c4dbgpf("append val: '%.*s' to parent id=%zd (level=%zd)%s", _c4prsp(val), m_state->node_id, m_state->level, quoted ? " VALQUO!" : "");
-    size_t nid = m_tree->append_child(m_state->node_id);
+    id_type nid = _append_child(m_state->node_id);
     m_tree->to_val(nid, val, additional_flags);
 
-    _c4dbgpf("append val: id=%zd key='%.*s' val='%.*s'", nid, _c4prsp(m_tree->get(nid)->m_key.scalar), _c4prsp(m_tree->get(nid)->m_val.scalar));
+    _c4dbgpf("append val: id=%zd key='%.*s' val='%.*s'", nid, _c4prsp(m_tree->_pk(nid).scalar), _c4prsp(m_tree->_pv(nid).scalar));
     if( ! m_val_tag.empty())
     {
         _c4dbgpf("append val: set tag to '%.*s'", _c4prsp(m_val_tag));
@@ -3012,9 +4160,9 @@ NodeData* Parser::_append_key_val(csubstr val, bool val_quoted)
 
     csubstr key = _consume_scalar();
     _c4dbgpf("append keyval: '%.*s' '%.*s' to parent id=%zd (level=%zd)%s%s", _c4prsp(key), _c4prsp(val), m_state->node_id, m_state->level, (additional_flags & KEYQUO) ? " KEYQUO!" : "", (additional_flags & VALQUO) ? " VALQUO!" : "");
-    size_t nid = m_tree->append_child(m_state->node_id);
+    id_type nid = _append_child(m_state->node_id);
     m_tree->to_keyval(nid, key, val, additional_flags);
-    _c4dbgpf("append keyval: id=%zd key='%.*s' val='%.*s'", nid, _c4prsp(m_tree->get(nid)->key()), _c4prsp(m_tree->get(nid)->val()));
+    _c4dbgpf("append keyval: id=%zd key='%.*s' val='%.*s'", nid, _c4prsp(m_tree->key(nid)), _c4prsp(m_tree->val(nid)));
     if( ! m_key_tag.empty())
     {
         _c4dbgpf("append keyval: set key tag to '%.*s'", _c4prsp(m_key_tag));
@@ -3190,6 +4338,7 @@ bool Parser::_handle_indentation()
         if(!popto || popto >= m_state || popto->level >= m_state->level)
         {
             _c4err("parse error: incorrect indentation?");
+            return true;
         }
         _c4dbgpf("popping %zd levels: from level %zd to level %zd", m_state->level-popto->level, m_state->level, popto->level);
         while(m_state != popto)
@@ -3350,6 +4499,8 @@ csubstr Parser::_scan_quoted_scalar(const char q)
         {
             _line_progressed(line.len);
             _c4dbgpf("scanning scalar @ line[%zd]: sofar=\"%.*s\"", m_state->pos.line, _c4prsp(s.sub(0, m_state->pos.offset-b)));
+            // the line breaks of quoted scalars are folded
+            needs_filter = true;
         }
         else
         {
@@ -3391,7 +4542,7 @@ csubstr Parser::_scan_quoted_scalar(const char q)
         {
             ret = _filter_dquot_scalar(s);
         }
-        RYML_ASSERT(ret.len <= s.len || s.empty() || s.trim(' ').empty());
+        RYML_ASSERT(ret.len <= s.len || s.empty() || s.trim(' ').empty() || m_tree->in_arena(ret));
         _c4dbgpf("final scalar: \"%.*s\"", _c4prsp(ret));
         return ret;
     }
@@ -3505,329 +4656,483 @@ csubstr Parser::_scan_block()
 //-----------------------------------------------------------------------------
 csubstr Parser::_filter_plain_scalar(substr s, size_t indentation)
 {
+    C4_UNUSED(indentation); // all the leading whitespace of continuation lines is discarded
     _c4dbgpf("filtering plain scalar: indentation=%zu before='%.*s'", indentation, _c4prsp(s));
-
-    // do a first sweep to clean leading whitespace from the indentation
-    substr r = _filter_whitespace(s, indentation);
-
-    // now another sweep for newlines
-    for(size_t i = 0; i < r.len; ++i)
-    {
-        const char curr = r[i];
-        const char next = i+1 < r.len ? r[i+1] : '\0';
-        RYML_ASSERT(curr != '\r' && next != '\r');
-        if(curr == '\n')
+    if(m_validate)
+        return s;
+
+    // a single pass with read and write cursors, jumping between the
+    // line breaks: a single break becomes a space (or is dropped at
+    // the end), and each following one becomes a newline
+    size_t r = 0;
+    size_t w = 0;
+    while(r < s.len)
+    {
+        size_t n = detail::find_newline(s.sub(r));
+        if(n == npos)
+            n = s.len - r;
+        if(w != r)
+            memmove(s.str + w, s.str + r, n);
+        r += n;
+        w += n;
+        if(r == s.len)
+            break;
+        if(s.str[r] == '\r')
         {
-            _c4dbgpf("filtering plain scalar: i=%zu: looked at: '%.*s'", i, _c4prsp(r.first(i)));
-            if(next != '\n')
-            {
-                _c4dbgpf("filtering plain scalar: filter single newline at %zu", i);
-                if(i + 1 < r.len)
-                {
-                    r[i] = ' '; // a single unix newline: turn it into a space
-                }
-                else
-                {
-                    --r.len;
-                }
-            }
-            else
-            {
-                 // multiple new lines
-                RYML_ASSERT(next == '\n');
-                r = r.erase(i, 1);  // erase one
-                RYML_ASSERT(r[i] == '\n');
-                size_t nl = r.sub(i).first_not_of('\n');
-                if(nl == csubstr::npos)
-                {
-                    _c4dbgpf("filtering plain scalar: newlines starting at %zu go up to the end at %zu", i, r.len);
-                    break;
-                }
-                _c4dbgpf("filtering plain scalar: erasing one of %zu newlines found at %zu", nl, i);
-                RYML_ASSERT(nl > 0);
-                i += nl; // and skip the rest
-            }
+            ++r; // https://stackoverflow.com/questions/1885900
+            continue;
+        }
+        size_t num_breaks = 0;
+        for( ; r < s.len; ++r)
+        {
+            const char c = s.str[r];
+            if(c == '\n')
+                ++num_breaks;
+            else if(c != ' ' && c != '\r')
+                break;
         }
-        else if(curr == '\r')
+        _c4dbgpf("filtering plain scalar: %zu newlines before %zu", num_breaks, r);
+        if(num_breaks == 1)
         {
-            _c4dbgpf("filtering plain scalar: i=%zu: removing carriage return \\r", i);
-            r = r.erase(i, 1);
+            if(r < s.len)
+                s.str[w++] = ' ';
+        }
+        else
+        {
+            for(size_t i = 1; i < num_breaks; ++i)
+                s.str[w++] = '\n';
         }
     }
 
-    RYML_ASSERT(s.len >= r.len);
-    _c4dbgpf("filtering plain scalar: num filtered chars=%zd", s.len - r.len);
-    _c4dbgpf("filtering plain scalar: after='%.*s'", _c4prsp(r));
+    RYML_ASSERT(s.len >= w);
+    _c4dbgpf("filtering plain scalar: num filtered chars=%zd", s.len - w);
+    _c4dbgpf("filtering plain scalar: after='%.*s'", _c4prsp(s.first(w)));
 
 #ifdef RYML_DBG
-    for(size_t i = r.len; i < s.len; ++i)
+    for(size_t i = w; i < s.len; ++i)
     {
         s[i] = '~';
     }
 #endif
 
-    return r;
+    return s.first(w);
 }
 
 //-----------------------------------------------------------------------------
 csubstr Parser::_filter_squot_scalar(substr s)
 {
     _c4dbgpf("filtering single-quoted scalar: before=\"%.*s\"", _c4prsp(s));
+    if(m_validate)
+        return s;
 
-    // do a first sweep to clean leading whitespace
-    substr r = _filter_whitespace(s);
-
-    // now another sweep for quotes and newlines
-    for(size_t i = 0; i < r.len; ++i)
+    // a single pass with read and write cursors. Line breaks are
+    // folded as in double-quoted scalars.
+    size_t r = 0;
+    size_t w = 0;
+    while(r < s.len)
     {
-        const char curr = r[i];
-        //const char prev = i   > 0     ? r[i-1] : '\0';
-        const char next = i+1 < r.len ? r[i+1] : '\0';
-        if(curr == '\'' && (curr == next))
+        const char c = s.str[r];
+        if(c == '\'')
         {
-            r = r.erase(i+1, 1); // turn two consecutive single quotes into one
+            s.str[w++] = c;
+            r += (r+1 < s.len && s.str[r+1] == '\'') ? 2 : 1; // two consecutive single quotes are one
         }
-        else if(curr == '\n')
+        else if(c == '\n' || c == '\r')
         {
-            if(next != '\n')
+            while(w > 0 && (s.str[w-1] == ' ' || s.str[w-1] == '\t'))
+                --w;
+            size_t num_breaks = 0;
+            for( ; r < s.len; ++r)
             {
-                r[i] = ' '; // a single unix newline: turn it into a space
-            }
-            else if(curr == '\n' && next == '\n')
-            {
-                r = r.erase(i+1, 1); // keep only one of consecutive newlines
+                const char cc = s.str[r];
+                if(cc == '\n')
+                    ++num_breaks;
+                else if(cc != ' ' && cc != '\t' && cc != '\r')
+                    break;
             }
+            if(num_breaks == 1)
+                s.str[w++] = ' ';
+            for(size_t i = 1; i < num_breaks; ++i)
+                s.str[w++] = '\n';
+        }
+        else
+        {
+            s.str[w++] = c;
+            ++r;
         }
     }
 
-    RYML_ASSERT(s.len >= r.len);
-    _c4dbgpf("filtering single-quoted scalar: num filtered chars=%zd", s.len - r.len);
-    _c4dbgpf("filtering single-quoted scalar: after=\"%.*s\"", _c4prsp(r));
+    RYML_ASSERT(s.len >= w);
+    _c4dbgpf("filtering single-quoted scalar: num filtered chars=%zd", s.len - w);
+    _c4dbgpf("filtering single-quoted scalar: after=\"%.*s\"", _c4prsp(s.first(w)));
 
 #ifdef RYML_DBG
-    for(size_t i = r.len; i < s.len; ++i)
+    for(size_t i = w; i < s.len; ++i)
     {
         s[i] = '~';
     }
 #endif
 
-    return r;
+    return s.first(w);
 }
 
 //-----------------------------------------------------------------------------
+/** read the given number of hex digits at s[*pos], advancing *pos */
+static bool _read_hex_escape(csubstr s, size_t *pos, size_t num_digits, uint32_t *cp)
+{
+    if(*pos + num_digits > s.len)
+        return false;
+    uint32_t val = 0;
+    for(size_t i = *pos, e = *pos + num_digits; i < e; ++i)
+    {
+        const char c = s.str[i];
+        val <<= 4;
+        if(c >= '0' && c <= '9')
+            val |= static_cast<uint32_t>(c - '0');
+        else if(c >= 'a' && c <= 'f')
+            val |= static_cast<uint32_t>(c - 'a' + 10);
+        else if(c >= 'A' && c <= 'F')
+            val |= static_cast<uint32_t>(c - 'A' + 10);
+        else
+            return false;
+    }
+    *pos += num_digits;
+    *cp = val;
+    return true;
+}
+
+/** write the UTF-8 encoding of the code point, returning the number of bytes */
+static size_t _write_utf8(char *dst, uint32_t cp)
+{
+    if(cp < 0x80)
+    {
+        dst[0] = static_cast<char>(cp);
+        return 1;
+    }
+    else if(cp < 0x800)
+    {
+        dst[0] = static_cast<char>(0xc0 | (cp >> 6));
+        dst[1] = static_cast<char>(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    else if(cp < 0x10000)
+    {
+        dst[0] = static_cast<char>(0xe0 | (cp >> 12));
+        dst[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        dst[2] = static_cast<char>(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    dst[0] = static_cast<char>(0xf0 | (cp >> 18));
+    dst[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+    dst[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    dst[3] = static_cast<char>(0x80 | (cp & 0x3f));
+    return 4;
+}
+
 csubstr Parser::_filter_dquot_scalar(substr s)
 {
     _c4dbgpf("filtering double-quoted scalar: before='%.*s'", _c4prsp(s));
+    if(m_validate)
+    {
+        _check_dquot_scalar(s);
+        return s;
+    }
 
-    // do a first sweep to clean leading whitespace
-    substr r = _filter_whitespace(s);
-
-    for(size_t i = 0; i < r.len; ++i)
+    size_t num_read = 0;
+    size_t len = _decode_dquot_scalar(s, s.str, &num_read);
+    if(C4_LIKELY(num_read == s.len))
     {
-        const char curr = r[i];
-        //const char prev = i   > 0     ? r[i-1] : '\0';
-        const char next = i+1 < r.len ? r[i+1] : '\0';
-        if(curr == '\\')
+        RYML_ASSERT(len <= s.len);
+        _c4dbgpf("filtering double-quoted scalar: num filtered chars=%zd", s.len - len);
+        _c4dbgpf("filtering double-quoted scalar: after='%.*s'", _c4prsp(s.first(len)));
+#ifdef RYML_DBG
+        for(size_t i = len; i < s.len; ++i)
         {
-            if(next == curr)
-            {
-                r = r.erase(i+1, 1); // turn two consecutive backslashes into one
-            }
-            else if(next == '\n')
-            {
-                r = r.erase(i, 2);  // newlines are escaped with \ -- delete both
-            }
-            else if(next == '"')
-            {
-                r = r.erase(i, 1);  // fix escaped double quotes
-            }
-            else if(next == 'n')
-            {
-                r = r.erase(i+1, 1);
-                r[i] = '\n';
-            }
+            s[i] = '~';
         }
-        else if(curr == '\n')
+#endif
+        return s.first(len);
+    }
+
+    // The escapes \L and \P are decoded to 3 bytes, one more than
+    // their source, so the decoded text can outgrow the source when
+    // nothing before was shrunk. Finish the decoding in the arena.
+    csubstr done = s.first(len);
+    csubstr rest = s.sub(num_read);
+    const size_t cap = done.len + rest.len + rest.len / 2 + 1; // no escape grows more than 3/2
+    if(cap > m_tree->arena_slack() && m_tree->in_arena(m_buf))
+    {
+        _c4err("no room to decode the \\L or \\P escapes: the source is in the tree's arena, "
+               "which cannot grow while parsing. Reserve arena capacity before parsing.");
+    }
+    csubstr prev_arena = m_tree->arena();
+    substr out = m_tree->alloc_arena(cap);
+    if(m_tree->arena().str != prev_arena.str)
+    {
+        // the arena was relocated: so must be the scalars stored by the parser
+        for(State &st : m_stack)
         {
-            if(next != '\n')
-            {
-                r[i] = ' '; // a single unix newline: turn it into a space
-            }
-            else if(curr == '\n' && next == '\n')
-            {
-                r = r.erase(i+1, 1); // keep only one of consecutive newlines
-            }
+            if(prev_arena.is_super(st.scalar) && ! st.scalar.empty())
+                st.scalar = m_tree->arena().sub(static_cast<size_t>(st.scalar.str - prev_arena.str), st.scalar.len);
         }
     }
+    memcpy(out.str, done.str, done.len);
+    len = _decode_dquot_scalar(rest, out.str + done.len, &num_read);
+    RYML_ASSERT(num_read == rest.len);
+    _c4dbgpf("filtering double-quoted scalar: after='%.*s'", _c4prsp(out.first(done.len + len)));
+    return out.first(done.len + len);
+}
 
-    RYML_ASSERT(s.len >= r.len);
-    _c4dbgpf("filtering double-quoted scalar: num filtered chars=%zd", s.len - r.len);
-    _c4dbgpf("filtering double-quoted scalar: after='%.*s'", _c4prsp(r));
-
-#ifdef RYML_DBG
-    for(size_t i = r.len; i < s.len; ++i)
+/** check the escapes of a double-quoted scalar without decoding it,
+ * raising the same errors as _decode_dquot_scalar() */
+void Parser::_check_dquot_scalar(csubstr s)
+{
+    size_t r = 0;
+    while(r < s.len)
     {
-        s[i] = '~';
+        const char *bs = (const char*) memchr(s.str + r, '\\', s.len - r);
+        if( ! bs)
+            break;
+        r = static_cast<size_t>(bs - s.str) + 2;
+        if(r > s.len)
+            break; // a backslash at the end
+        uint32_t cp = 0;
+        switch(s.str[r - 1])
+        {
+        case 'x':
+            if( ! _read_hex_escape(s, &r, 2, &cp))
+                _c4err("invalid \\x escape in double-quoted scalar");
+            break;
+        case 'u':
+            if( ! _read_hex_escape(s, &r, 4, &cp))
+                _c4err("invalid \\u escape in double-quoted scalar");
+            break;
+        case 'U':
+            if( ! _read_hex_escape(s, &r, 8, &cp) || cp > 0x10ffff)
+                _c4err("invalid \\U escape in double-quoted scalar");
+            break;
+        default:
+            break;
+        }
     }
-#endif
-
-    return r;
 }
 
-//-----------------------------------------------------------------------------
-/** @p leading_whitespace when true, remove every leading spaces from the
- * beginning of each line */
-substr Parser::_filter_whitespace(substr r, size_t indentation, bool leading_whitespace)
+/** decode the double-quoted scalar in src into dst, which can be the
+ * same buffer. The text is copied in spans, jumping from each
+ * backslash or newline to the next. Line breaks are folded: the
+ * whitespace around them is discarded, and a single break becomes a
+ * space while each following one becomes a newline.
+ * @param num_read receives the number of characters consumed from
+ * src; when decoding in place, the decoding stops before an escape
+ * which would overwrite the characters not yet read.
+ * @return the number of characters written to dst */
+size_t Parser::_decode_dquot_scalar(csubstr src, char *dst, size_t *num_read)
 {
-    _c4dbgpf("filtering whitespace: indentation=%zu leading=%d before=\"%.*s\"", indentation, leading_whitespace, _c4prsp(r));
-
-    for(size_t i = 0; i < r.len; ++i)
-    {
-        const char curr = r[i];
-        const char prev = i   > 0     ? r[i-1] : '\0';
-        if(curr == ' ' && prev == '\n')
+    const bool in_place = (dst == src.str);
+    size_t r = 0; // the read cursor
+    size_t w = 0; // the write cursor
+    size_t keep = 0; // the folding does not trim the text written before this
+    while(r < src.len)
+    {
+        size_t n = detail::find_dquot_special(src.sub(r));
+        if(n == npos)
+            n = src.len - r;
+        if(dst + w != src.str + r)
+            memmove(dst + w, src.str + r, n);
+        r += n;
+        w += n;
+        if(r == src.len)
+            break;
+        if(src.str[r] != '\\')
         {
-            _c4dbgpf("filtering whitespace: removing indentation i=%zu len=%zu. curr=~%.*s~", i, r.len, _c4prsp(r.first(i)));
-            csubstr ss = r.sub(i);
-            ss = ss.left_of(ss.first_not_of(' '));
-            RYML_ASSERT(ss.len >= 1);
-            size_t num = ss.len;
-            // RYML_ASSERT(num >= indentation); // empty lines are allowed
-            _c4dbgpf("                    : line has %zu spaces", num);
-            if(leading_whitespace)
-            {
-                num = ss.len;
-            }
-            else if(indentation != csubstr::npos)
+            while(w > keep && (dst[w-1] == ' ' || dst[w-1] == '\t'))
+                --w;
+            size_t num_breaks = 0;
+            for( ; r < src.len; ++r)
             {
-                num = num < indentation ? num : indentation;
+                const char c = src.str[r];
+                if(c == '\n')
+                    ++num_breaks;
+                else if(c != ' ' && c != '\t' && c != '\r')
+                    break;
             }
-            _c4dbgpf("                    : removing %zu spaces", num);
-            r = r.erase(i, num);
-            if(i < r.len && r[i] != ' ') --i; // i is incremented on the next iteration
+            if(num_breaks == 1)
+                dst[w++] = ' ';
+            for(size_t i = 1; i < num_breaks; ++i)
+                dst[w++] = '\n';
+            continue;
         }
-        // erase \r --- https://stackoverflow.com/questions/1885900
-        else if(curr == '\r')
+        if(r + 1 == src.len)
         {
-            _c4dbgpf("filtering whitespace: remove \\r: i=%zu len=%zu. curr=~%.*s~", i, r.len, _c4prsp(r.first(i)));
-            r = r.erase(i, 1);
-            --i; // i is incremented on the next iteration
+            dst[w++] = src.str[r++]; // a backslash at the end
+            keep = w;
+            break;
         }
+        const char e = src.str[r + 1];
+        r += 2;
+        uint32_t cp = 0;
+        switch(e)
+        {
+        case '0' : dst[w++] = '\0'; break;
+        case 'a' : dst[w++] = '\a'; break;
+        case 'b' : dst[w++] = '\b'; break;
+        case 't' :
+        case '\t': dst[w++] = '\t'; break;
+        case 'n' : dst[w++] = '\n'; break;
+        case 'v' : dst[w++] = '\v'; break;
+        case 'f' : dst[w++] = '\f'; break;
+        case 'r' : dst[w++] = '\r'; break;
+        case 'e' : dst[w++] = '\x1b'; break;
+        case ' ' :
+        case '"' :
+        case '/' :
+        case '\\': dst[w++] = e; break;
+        case 'N' : w += _write_utf8(dst + w, 0x85); break; // next line
+        case '_' : w += _write_utf8(dst + w, 0xa0); break; // non-breaking space
+        case 'L' : // line separator
+        case 'P' : // paragraph separator
+            if(in_place && w + 3 > r)
+            {
+                *num_read = r - 2;
+                return w;
+            }
+            w += _write_utf8(dst + w, e == 'L' ? 0x2028 : 0x2029);
+            break;
+        case 'x':
+            if( ! _read_hex_escape(src, &r, 2, &cp))
+                _c4err("invalid \\x escape in double-quoted scalar");
+            w += _write_utf8(dst + w, cp);
+            break;
+        case 'u':
+            if( ! _read_hex_escape(src, &r, 4, &cp))
+                _c4err("invalid \\u escape in double-quoted scalar");
+            // combine a surrogate pair, as used in JSON
+            if(cp >= 0xd800 && cp < 0xdc00 && r + 6 <= src.len && src.str[r] == '\\' && src.str[r+1] == 'u')
+            {
+                size_t r2 = r + 2;
+                uint32_t lo = 0;
+                if(_read_hex_escape(src, &r2, 4, &lo) && lo >= 0xdc00 && lo < 0xe000)
+                {
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                    r = r2;
+                }
+            }
+            w += _write_utf8(dst + w, cp);
+            break;
+        case 'U':
+            if( ! _read_hex_escape(src, &r, 8, &cp) || cp > 0x10ffff)
+                _c4err("invalid \\U escape in double-quoted scalar");
+            w += _write_utf8(dst + w, cp);
+            break;
+        case '\r':
+            if(r < src.len && src.str[r] == '\n')
+                ++r;
+            while(r < src.len && (src.str[r] == ' ' || src.str[r] == '\t'))
+                ++r;
+            break;
+        case '\n': // an escaped line break is discarded, with the leading whitespace of the next line
+            while(r < src.len && (src.str[r] == ' ' || src.str[r] == '\t'))
+                ++r;
+            break;
+        default: // not an escape: keep it
+            dst[w++] = '\\';
+            dst[w++] = e;
+            break;
+        }
+        keep = w;
     }
-
-    _c4dbgpf("filtering whitespace: after=\"%.*s\"", _c4prsp(r));
-
-    return r;
+    *num_read = r;
+    return w;
 }
 
 //-----------------------------------------------------------------------------
 csubstr Parser::_filter_block_scalar(substr s, BlockStyle_e style, BlockChomp_e chomp, size_t indentation)
 {
     _c4dbgpf("filtering block: '%.*s'", _c4prsp(s));
+    if(m_validate)
+        return s;
 
-    substr r = s;
-
-    r = _filter_whitespace(s, indentation, /*leading whitespace*/false);
-    if(r.begins_with(' ', indentation))
-    {
-        r = r.erase(0, indentation);
-    }
-
-    _c4dbgpf("filtering block: after whitespace='%.*s'", _c4prsp(r));
-
-    RYML_ASSERT(r.find('\r') == csubstr::npos); // filter whitespace must remove this
+    if(style != BLOCK_LITERAL && style != BLOCK_FOLD)
+        _c4err("unknown block style");
+    if(chomp != CHOMP_CLIP && chomp != CHOMP_STRIP && chomp != CHOMP_KEEP)
+        _c4err("unknown chomp style");
 
-    switch(chomp)
-    {
-    case CHOMP_KEEP: // nothing to do, keep everything
-        _c4dbgp("filtering block: chomp=KEEP (+)");
-        break;
-    case CHOMP_STRIP: // strip all newlines from the end
-    {
-        _c4dbgp("filtering block: chomp=STRIP (-)");
-        auto pos = r.last_not_of("\n");
-        if(pos != npos)
+    // a single pass with read and write cursors, jumping between the
+    // line breaks. The indentation is removed from each line, the
+    // inner line breaks are folded (when folding) and the trailing
+    // line breaks are chomped as they are found.
+    size_t r = 0;
+    size_t w = 0;
+    bool has_contents = false;
+    if(indentation != npos && s.begins_with(' ', indentation))
+        r = indentation;
+    while(r < s.len)
+    {
+        size_t n = detail::find_newline(s.sub(r));
+        if(n == npos)
+            n = s.len - r;
+        if(n)
+        {
+            if(w != r)
+                memmove(s.str + w, s.str + r, n);
+            r += n;
+            w += n;
+            has_contents = true;
+        }
+        if(r == s.len)
+            break;
+        if(s.str[r] == '\r')
         {
-            r = r.left_of(pos, /*include_pos*/true);
+            ++r; // https://stackoverflow.com/questions/1885900
+            continue;
         }
-        break;
-    }
-    case CHOMP_CLIP: // clip to a single newline
-    {
-        _c4dbgp("filtering block: chomp=CLIP");
-        auto pos = r.last_not_of("\n");
-        if(pos != npos && pos+1 < r.len)
+        // a run of line breaks: skip the indentation of each line.
+        // Spaces beyond the indentation are contents.
+        size_t num_breaks = 0;
+        while(r < s.len && s.str[r] == '\n')
         {
-            ++pos;
-            r = r.left_of(pos, /*include_pos*/true);
+            ++num_breaks;
+            ++r;
+            for(size_t ind = 0; r < s.len; ++r)
+            {
+                const char c = s.str[r];
+                if(c == ' ' && ind < indentation)
+                    ++ind;
+                else if(c != '\r')
+                    break;
+            }
         }
-        break;
-    }
-    default:
-        _c4err("unknown chomp style");
-    }
-
-    _c4dbgpf("filtering block: after chomp='%.*s'", _c4prsp(r));
-
-    switch(style)
-    {
-    case BLOCK_LITERAL:
-        break;
-    case BLOCK_FOLD:
+        if(r == s.len && has_contents)
         {
-            auto pos = r.last_not_of('\n'); // do not fold trailing newlines
-            if((pos != npos) && (pos < r.len))
+            _c4dbgpf("filtering block: chomp %zu trailing newlines", num_breaks);
+            if(chomp == CHOMP_STRIP)
+                num_breaks = 0;
+            else if(chomp == CHOMP_CLIP)
+                num_breaks = 1;
+        }
+        else if(r < s.len && style == BLOCK_FOLD)
+        {
+            _c4dbgpf("filtering block[fold]: fold %zu newlines", num_breaks);
+            if(num_breaks == 1)
             {
-                ++pos; // point pos at the first newline char
-                substr t = r.sub(0, pos);
-                for(size_t i = 0; i < t.len; ++i)
-                {
-                    const char curr = t[i];
-                    if(curr != '\n') continue;
-                    size_t nextl = t.first_not_of('\n', i+1);
-                    if(nextl == i+1)
-                    {
-                        _c4dbgpf("filtering block[fold]: %zu: single newline, replace with space. curr=~%.*s~", i, _c4prsp(r.first(i)));
-                        t[i] = ' ';
-                    }
-                    else if(nextl != csubstr::npos)
-                    {
-                        _c4dbgpf("filtering block[fold]: %zu: %zu newlines, remove first. curr=~%.*s~", i, nextl-1, _c4prsp(r.first(i)));
-                        RYML_ASSERT(nextl >= 1);
-                        t = t.erase(i, 1);
-                        i = nextl-1;
-                        if(i) --i;
-                    }
-                    else
-                    {
-                        _c4err("crl");
-                        break;
-                    }
-                }
-                // copy over the trailing newlines
-                substr nl = r.sub(pos);
-                RYML_ASSERT(t.len + nl.len <= r.len);
-                for(size_t i = 0; i < nl.len; ++i)
-                {
-                    r[t.len + i] = nl[i];
-                }
-                // now trim r
-                r = r.sub(0, t.len + nl.len);
+                s.str[w++] = ' ';
+                continue;
             }
+            --num_breaks;
         }
-        break;
-    default:
-        _c4err("unknown block style");
+        for(size_t i = 0; i < num_breaks; ++i)
+            s.str[w++] = '\n';
     }
 
-    _c4dbgpf("filtering block: final='%.*s'", _c4prsp(r));
+    RYML_ASSERT(w <= s.len);
+    _c4dbgpf("filtering block: final='%.*s'", _c4prsp(s.first(w)));
 
 #ifdef RYML_DBG
-    for(size_t i = r.len; i < s.len; ++i)
+    for(size_t i = w; i < s.len; ++i)
         s[i] = '~';
 #endif
 
-    return r;
+    return s.first(w);
 }
 
 //-----------------------------------------------------------------------------
@@ -3837,12 +5142,6 @@ bool Parser::_read_decimal(csubstr const& str, size_t *decimal)
     return c4::atou(str, decimal);
 }
 
-//-----------------------------------------------------------------------------
-size_t Parser::_count_nlines(csubstr src)
-{
-    return 1 + src.count('\n');
-}
-
 //-----------------------------------------------------------------------------
 void Parser::set_flags(size_t f, State * s)
 {
@@ -3893,6 +5192,18 @@ void Parser::rem_flags(size_t off, State * s)
     s->flags &= ~off;
 }
 
+//-----------------------------------------------------------------------------
+/** raise an error if the feature was disabled with set_features().
+ * This is called only after the feature's syntax was found, so that
+ * the sources not using it do not pay for the check. */
+#ifndef RYML_NO_PARSE_FEATURES
+void Parser::_require_feature(uint32_t feature, const char *what) const
+{
+    if(C4_UNLIKELY( ! (m_features & feature)))
+        _c4err("%s are disabled in this parser: see Parser::set_features()", what);
+}
+#endif
+
 //-----------------------------------------------------------------------------
 void Parser::_err(const char *fmt, ...) const
 {
@@ -3906,7 +5217,18 @@ void Parser::_err(const char *fmt, ...) const
     va_start(args, fmt);
     len = _fmt_msg(errmsg, len, fmt, args);
     va_end(args);
-    c4::yml::error(errmsg, static_cast<size_t>(len), m_state->pos);
+    if(m_validate)
+        _validate_failed(errmsg, static_cast<size_t>(len)); // does not return
+    c4::yml::error(errmsg, static_cast<size_t>(len), _err_location());
+}
+
+/** the current position, relative to the origin of the buffer */
+Location Parser::_err_location() const
+{
+    Location loc = m_state->pos;
+    loc.offset += m_origin_offset;
+    loc.line += m_origin_line;
+    return loc;
 }
 
 //-----------------------------------------------------------------------------
@@ -3942,11 +5264,11 @@ int Parser::_fmt_msg(char *buf, int buflen, const char *fmt, va_list args) const
     // next line: print the yaml src line
     if( ! m_file.empty())
     {
-        del = snprintf(buf + pos, static_cast<size_t>(len), "%.*s:%zd: '", (int)m_file.len, m_file.str, m_state->pos.line);
+        del = snprintf(buf + pos, static_cast<size_t>(len), "%.*s:%zd: '", (int)m_file.len, m_file.str, m_state->pos.line + m_origin_line);
     }
     else
     {
-        del = snprintf(buf + pos, static_cast<size_t>(len), "line %zd: '", m_state->pos.line);
+        del = snprintf(buf + pos, static_cast<size_t>(len), "line %zd: '", m_state->pos.line + m_origin_line);
     }
     int offs = del;
     _wrapbuf();
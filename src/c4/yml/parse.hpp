@@ -13,6 +13,14 @@
 #include "c4/yml/detail/stack.hpp"
 #endif
 
+#ifndef _C4_YML_STRUCTURAL_INDEX_HPP_
+#include "c4/yml/structural_index.hpp"
+#endif
+
+#ifndef _C4_YML_DETAIL_SIMD_HPP_
+#include "c4/yml/detail/simd.hpp"
+#endif
+
 #include <stdarg.h>
 
 #if defined(_MSC_VER)
@@ -24,6 +32,60 @@ namespace c4 {
 namespace yml {
 
 
+/** estimates of the size of the tree resulting from parsing a
+ * source. @see estimate_tree_capacity() */
+struct TreeCapacity
+{
+    size_t nodes; //!< the number of nodes, including the root. This is an estimate, not a bound
+    size_t arena; //!< an upper bound of the arena needed by the parser, excluding any copy of the source
+};
+
+/** estimate the size of the tree resulting from parsing the given
+ * source, with a single vectorized pass counting the characters which
+ * announce nodes: <tt>, : ? [ {</tt> and the dashes followed by a blank.
+ * Nearly every node needs at least one of these (the flow collections
+ * need two, for themselves and their first child), so the node count is
+ * loose mostly when these characters are inside scalars or comments.
+ * But the node count is an estimate, not an upper bound: the documents
+ * separated only by <tt>...</tt> are not counted, so the tree may still
+ * grow while parsing. Unlike counting lines, it is accurate for
+ * single-line flow and minified JSON, and it does not count the blank,
+ * comment or block scalar lines. The parser uses it to reserve the
+ * tree before parsing. */
+RYML_EXPORT TreeCapacity estimate_tree_capacity(csubstr src);
+
+namespace detail {
+/** copy a read-only source to the tree's arena, with room for decoding
+ * its scalars there (see estimate_tree_capacity()): the arena cannot
+ * grow while a source in it is being parsed. This is what the parse()
+ * overloads taking a read-only source do; it is used by the functions
+ * which parse a read-only source in other ways, eg parse_parallel().
+ * @param reserve_nodes whether to reserve also the nodes for the source
+ * @return the copy of the source, which can be parsed in-situ */
+RYML_EXPORT substr copy_to_arena_with_slack(Tree *t, csubstr src, bool reserve_nodes=true);
+} // namespace detail
+
+/** the optional YAML features accepted by the parser, which are all
+ * enabled by default. @see Parser::set_features() */
+typedef enum : uint32_t {
+    PARSE_ANCHORS      = 1u << 0, //!< anchors (&anchor) and references (*anchor)
+    PARSE_TAGS         = 1u << 1, //!< tags (!tag, !!str, !<tag:yaml.org,2002:str>), including !!set
+    PARSE_COMPLEX_KEYS = 1u << 2, //!< complex keys (? key)
+    PARSE_ALL_FEATURES = PARSE_ANCHORS|PARSE_TAGS|PARSE_COMPLEX_KEYS
+} ParseFeatures_e;
+
+/** the result of Parser::validate(). Converts to true when the source
+ * is valid. */
+struct ValidationResult
+{
+    bool     ok;       //!< whether the source is valid
+    Location location; //!< where the first error was found; empty when ok
+    csubstr  message;  //!< the message of the first error; empty when ok. It points into the parser, and is valid until the next call to validate()
+
+    operator bool () const { return ok; }
+};
+
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -38,11 +100,11 @@ public:
     //! create a new YAML tree and parse into its root
     //! @note aliases and anchors are not resolved. You
     //! can resolve by calling Tree::resolve() after parsing.
-    Tree parse(csubstr filename, csubstr src) { Tree t; t.reserve(_estimate_capacity(src)); parse(filename, t.copy_to_arena(src), &t, t.root_id()); return t; }
+    Tree parse(csubstr filename, csubstr src) { Tree t; substr copy = _copy_to_arena(&t, src); parse(filename, copy, &t, t.root_id()); return t; }
     //! create a new YAML tree and parse into its root
     //! @note aliases and anchors are not resolved. You
     //! can resolve by calling Tree::resolve() after parsing.
-    Tree parse(csubstr filename,  substr src) { Tree t; t.reserve(_estimate_capacity(src)); parse(filename, src, &t, t.root_id()); return t; }
+    Tree parse(csubstr filename,  substr src) { Tree t; parse(filename, _reserve(&t, src), &t, t.root_id()); return t; }
 
 
     //! parse with reuse of a YAML tree
@@ -52,17 +114,20 @@ public:
     //! parse with reuse of a YAML tree
     //! @note aliases and anchors are not resolved. You
     //! can resolve by calling Tree::resolve() after parsing.
-    void parse(csubstr filename, csubstr src, Tree *t) { parse(filename, t->copy_to_arena(src), t, t->root_id()); }
+    void parse(csubstr filename, csubstr src, Tree *t) { parse(filename, _copy_to_arena(t, src), t, t->root_id()); }
 
 
     //! parse directly into a node
     //! @note aliases and anchors are not resolved. You
     //! can resolve by calling Tree::resolve() after parsing.
-    void parse(csubstr filename,  substr src, Tree *t, size_t node_id); // this is the workhorse overload; everything else is syntactic candy
+    //! @note when src is in the tree's arena and the arena has no room
+    //! for decoding the scalars (see estimate_tree_capacity()), the
+    //! arena is grown before parsing, which relocates src with it.
+    void parse(csubstr filename,  substr src, Tree *t, id_type node_id); // this is the workhorse overload; everything else is syntactic candy
     //! parse directly into a node
     //! @note aliases and anchors are not resolved. You
     //! can resolve by calling Tree::resolve() after parsing.
-    void parse(csubstr filename, csubstr src, Tree *t, size_t node_id) { parse(filename, t->copy_to_arena(src), t, node_id); }
+    void parse(csubstr filename, csubstr src, Tree *t, id_type node_id) { parse(filename, _copy_to_arena(t, src), t, node_id); }
 
 
     //! parse directly into a node ref
@@ -72,8 +137,179 @@ public:
     //! parse directly into a node ref
     //! @note aliases and anchors are not resolved. You
     //! can resolve by calling Tree::resolve() after parsing.
-    void parse(csubstr filename, csubstr src, NodeRef node) { parse(filename, node.tree()->copy_to_arena(src), node.tree(), node.id()); }
+    void parse(csubstr filename, csubstr src, NodeRef node) { parse(filename, _copy_to_arena(node.tree(), src), node.tree(), node.id()); }
+
+
+    /** @name path-filtered parsing
+     *
+     * Parse only the nodes on or below the given paths, which use the
+     * syntax of Tree::lookup_path() (eg <tt>spec.template.containers[0].image</tt>).
+     * The source is parsed in lazy mode (see set_lazy()), so that the
+     * collections which are not on the way to a path are skipped at
+     * scan speed without being parsed; the nodes at each level which
+     * are not on the way to a path are then removed, and the subtrees
+     * at the paths are fully parsed. In seqs, the entries before the
+     * last one kept are left as null vals, so that the same paths can
+     * be looked up in the resulting tree. Paths which are not found are
+     * ignored. The lazy mode of the parser is restored afterwards,
+     * also when the parse fails.
+     *
+     * @note the scan itself does not know the paths: at each level on
+     * the way to a path, it still creates a node for every sibling,
+     * which is removed afterwards. A skipped collection is a single
+     * node whatever its size, so this extra cost grows with the
+     * number of siblings along the paths, not with the size of the
+     * source; and the removed nodes go back to the free list of the
+     * tree. The removed collections are never expanded, and the
+     * pruning visits each node of the tree once.
+     * @{ */
+
+    /** parse in-situ a modifiable source buffer, keeping only the given paths */
+    void parse(csubstr filename,  substr src, Tree *t, csubstr const* paths, size_t num_paths);
+    /** parse a read-only source buffer, keeping only the given paths */
+    void parse(csubstr filename, csubstr src, Tree *t, csubstr const* paths, size_t num_paths) { parse(filename, _copy_to_arena(t, src), t, paths, num_paths); }
+
+    /** parse in-situ a modifiable source buffer, keeping only the given paths */
+    template<size_t N>
+    void parse(csubstr filename,  substr src, Tree *t, csubstr const (&paths)[N]) { parse(filename, src, t, paths, N); }
+    /** parse a read-only source buffer, keeping only the given paths */
+    template<size_t N>
+    void parse(csubstr filename, csubstr src, Tree *t, csubstr const (&paths)[N]) { parse(filename, _copy_to_arena(t, src), t, paths, N); }
+
+    /** @} */
+
+    /** @name JSON parsing
+     *
+     * Parse a JSON source with a dedicated parser, which skips all the
+     * indentation, anchor, tag and block scalar logic of the YAML
+     * parser, and does not build the structural index. The resulting
+     * tree is the same as the one obtained with parse() on the output
+     * of preprocess_json(): keys and strings are flagged as quoted
+     * (except the keys of seqs, as with the YAML parser), strings are
+     * unescaped in the same way, and numbers, booleans and null are
+     * plain vals. The scanner is lenient: the literals and numbers are
+     * not validated.
+     * @see set_detect_json()
+     * @{ */
+
+    /** create a new tree and parse into its root a read-only JSON source, copying it first to the tree's source arena */
+    Tree parse_json(csubstr filename, csubstr src) { Tree t; substr copy = _copy_to_arena(&t, src); parse_json(filename, copy, &t, t.root_id()); return t; }
+    /** create a new tree and parse in-situ into its root a modifiable JSON source */
+    Tree parse_json(csubstr filename,  substr src) { Tree t; parse_json(filename, _reserve(&t, src), &t, t.root_id()); return t; }
+
+    /** parse in-situ a modifiable JSON source, reusing the tree */
+    void parse_json(csubstr filename,  substr src, Tree *t) { parse_json(filename, src, t, t->root_id()); }
+    /** parse a read-only JSON source, copying it first to the tree's source arena */
+    void parse_json(csubstr filename, csubstr src, Tree *t) { parse_json(filename, _copy_to_arena(t, src), t, t->root_id()); }
+
+    /** parse in-situ a modifiable JSON source directly into a node */
+    void parse_json(csubstr filename,  substr src, Tree *t, id_type node_id);
+    /** parse a read-only JSON source directly into a node, copying it first to the tree's source arena */
+    void parse_json(csubstr filename, csubstr src, Tree *t, id_type node_id) { parse_json(filename, _copy_to_arena(t, src), t, node_id); }
+
+    /** @} */
+
+    /** @name event parsing
+     *
+     * Parse the source and send the parse events to a handler, instead
+     * of returning a tree. This is useful when each value is read only
+     * once: the handler receives the events in document order, and
+     * the memory used by the parser stays bounded by the depth of the
+     * document instead of growing with its size. It is not faster than
+     * parse(): the parser still builds the nodes, in a scratch tree
+     * (see below). The handler must
+     * provide the following methods:
+     *
+     * @code
+     * struct Handler
+     * {
+     *     void begin_doc();
+     *     void end_doc();
+     *     void begin_map();
+     *     void end_map();
+     *     void begin_seq();
+     *     void end_seq();
+     *     void key(csubstr k); // precedes the value of a map member
+     *     void val(csubstr v); // a scalar value; null values have v.str==nullptr
+     * };
+     * @endcode
+     *
+     * The scalars point into the source buffer (or into an internal
+     * copy of it, for the read-only overload), so they remain valid as
+     * long as the buffer (or the parser) is not modified. Tags and
+     * anchors are not reported.
+     *
+     * @note internally, the parser still works on a small scratch tree
+     * which it owns; each node is sent to the handler and released as
+     * soon as its next sibling is started, so the scratch memory is
+     * reused throughout the parse. The state machine of the parser is
+     * not a template on the handler: it reads back the nodes it has
+     * written (eg to turn a val into a key, or a seq into a map), so
+     * it needs the tree anyway, and it stays compiled once in the
+     * library. The handler methods are inlined into a dispatcher
+     * instantiated for the handler type, which the parser calls
+     * through a function pointer. The cost is thus the same as
+     * parse() into a reused tree, plus for each node an indirect call,
+     * the removal of the node from the scratch tree, and a lookup in
+     * the path of open nodes (linear in the depth). This API saves
+     * memory, not time: see the benchmark ryml_rw_reuse_events.
+     * @{ */
+
+    /** parse in-situ a modifiable source buffer, sending the events to the handler */
+    template<class Handler>
+    void parse_events(csubstr filename, substr src, Handler *handler)
+    {
+        _parse_events(filename, src, &_evt_dispatch<Handler>, handler);
+    }
+    /** parse a read-only source buffer, sending the events to the
+     * handler. The buffer is first copied to the parser's scratch arena. */
+    template<class Handler>
+    void parse_events(csubstr filename, csubstr src, Handler *handler)
+    {
+        m_evt_tree.clear_arena();
+        // the scratch tree holds only the current path of nodes
+        substr copy = _copy_to_arena(&m_evt_tree, src, /*reserve_nodes*/false);
+        _parse_events(filename, copy, &_evt_dispatch<Handler>, handler);
+    }
 
+    /** @} */
+
+    /** @name validate
+     * Check the syntax of a source without building a tree, eg to
+     * reject bad inputs before storing them.
+     *
+     * The source goes through the same grammar as in parse(), but the
+     * scalars are neither filtered nor copied (the escapes of
+     * double-quoted scalars are only checked), so the source buffer
+     * is never written and nothing goes to the caller's tree.
+     *
+     * validate() does not build the structural index of the source
+     * (see StructuralIndex), so it does not allocate for the size of
+     * the source; as with parse_events() it works on the scratch
+     * tree of the parser, where each node is released as soon as its
+     * next sibling starts, so that the nodes are bounded by the depth
+     * of the source. Both are kept by the parser, so the next calls
+     * allocate only for larger sources.
+     *
+     * The first error stops the validation, and is returned instead of
+     * being sent to the error callback: the parser records it and
+     * unwinds back to validate(), with a private exception or, when
+     * exceptions are disabled, with longjmp(). Only the syntax errors
+     * found by the parser are returned; the failed assertions and
+     * checks still go to the error callback.
+     *
+     * @code
+     * Parser p;
+     * ValidationResult r = p.validate("request.yml", payload);
+     * if( ! r)
+     *     reject(r.location.line, r.location.col, r.message);
+     * @endcode
+     * @{ */
+
+    ValidationResult validate(csubstr filename, csubstr src);
+    ValidationResult validate(csubstr src) { return validate({}, src); }
+
+    /** @} */
 
     //! reserve a certain capacity for the parsing stack.
     //! This should be at least the expected depth of the parsed YAML tree.
@@ -89,6 +325,99 @@ public:
         m_stack.reserve(capacity);
     }
 
+    //! set the number of threads used to build the structural index
+    //! of the source buffer, which is done before parsing. More than one
+    //! thread is used only for large buffers, and only when ryml is built
+    //! with RYML_WITH_THREADS. The default is 1.
+    //! @see StructuralIndex
+    void set_index_threads(size_t num_threads)
+    {
+        m_index_threads = num_threads > 0 ? num_threads : 1;
+    }
+    size_t index_threads() const { return m_index_threads; }
+
+    //! the default of set_index_min_size()
+    enum : size_t { index_min_size_default = size_t(16) * 1024 };
+    //! set the minimum size of the source buffers for which the
+    //! structural index is built before parsing. Building the index is
+    //! a pass over the whole buffer, which is amortized only when the
+    //! parser looks up many lines in it; smaller buffers are instead
+    //! scanned directly with the same vectorized kernels. Zero indexes
+    //! every buffer. The default is index_min_size_default.
+    //! @see the ryml_rw_index_* benchmarks in bm/bm_parse.cpp
+    void set_index_min_size(size_t num_bytes)
+    {
+        m_index_min_size = num_bytes;
+    }
+    size_t index_min_size() const { return m_index_min_size; }
+
+    //! set the position of the parsed buffers within a larger source:
+    //! the offset and line of the locations given to the error callback
+    //! and printed in the error messages are then relative to that
+    //! source. This is used when the chunks of a source are parsed
+    //! separately. @p offset is the offset of the first byte of the
+    //! buffer, and @p line is the number of lines before it.
+    void set_buffer_origin(size_t offset, size_t line)
+    {
+        m_origin_offset = offset;
+        m_origin_line = line;
+    }
+
+    //! set the lazy mode. In lazy mode, the block or flow collections
+    //! which are values of a map are not parsed, and neither are the
+    //! entries of a block seq which are flow collections or block maps
+    //! starting in the line of the dash (eg <tt>- name: x</tt>): they
+    //! are quickly skipped by balancing their indentation or brackets, and their
+    //! source range is recorded in a LAZY container node. The children
+    //! of a lazy node are parsed only when they are first accessed
+    //! through the non-const overloads of Tree::first_child(),
+    //! Tree::last_child(), Tree::num_children(), Tree::find_child(),
+    //! Tree::child(), through NodeRef, or with Tree::expand_lazy()
+    //! (each expansion is itself lazy). Collections with tags or
+    //! anchors are always parsed. The default is false.
+    //! @note the const API of the tree does not expand: it requires
+    //! the nodes to be expanded, so call Tree::expand_lazy_all()
+    //! before emitting the tree or sharing it between threads.
+    //! @note the source buffer is parsed in-situ when a node is
+    //! expanded, so it must remain valid and unmodified until then;
+    //! and the line numbers in the error messages are relative to the
+    //! expanded range.
+    //! @see parse_lazy()
+    void set_lazy(bool yes) { m_lazy = yes; }
+    bool lazy() const { return m_lazy; }
+
+    //! enable the detection of JSON sources in parse(): when the
+    //! filename ends with <tt>.json</tt>, the source is parsed with
+    //! parse_json(). The default is false.
+    void set_detect_json(bool yes) { m_detect_json = yes; }
+    bool detect_json() const { return m_detect_json; }
+
+    //! set the optional YAML features accepted by the parser, as a
+    //! mask of ParseFeatures_e. When a feature is disabled, the parser
+    //! raises an error when the feature is found in the source. This
+    //! is meant for sources which are known to be plain data, eg
+    //! configuration or messages: the unexpected syntax is rejected
+    //! instead of being silently accepted. The mask is checked only
+    //! where the syntax of a feature was found, so the sources not
+    //! using it are parsed at the same speed.
+    //! The default is PARSE_ALL_FEATURES.
+    //! @note when ryml is built with RYML_NO_PARSE_FEATURES
+    //! (cmake: RYML_WITH_PARSE_FEATURES=OFF), every feature is
+    //! always enabled and the checks are compiled out: then
+    //! features() is a constant and set_features() raises an
+    //! error if any feature is disabled.
+    //! @code
+    //! Parser p;
+    //! p.set_features(0); // no anchors, tags or complex keys
+    //! @endcode
+#ifndef RYML_NO_PARSE_FEATURES
+    void set_features(uint32_t features) { m_features = features & PARSE_ALL_FEATURES; }
+    uint32_t features() const { return m_features; }
+#else
+    void set_features(uint32_t features) { RYML_CHECK_MSG((features & PARSE_ALL_FEATURES) == PARSE_ALL_FEATURES, "the parse features are compiled out: see RYML_NO_PARSE_FEATURES"); }
+    uint32_t features() const { return PARSE_ALL_FEATURES; }
+#endif
+
 private:
 
     typedef enum {
@@ -104,7 +433,85 @@ private:
 
 private:
 
-    static size_t _estimate_capacity(csubstr src) { size_t c = _count_nlines(src); c = c >= 16 ? c : 16; return c; }
+    typedef enum : int {
+        _EVT_BEGIN, //!< send the events opening a node
+        _EVT_END,   //!< send the events closing a node
+        _EVT_WHOLE  //!< send all the events of a node and its children
+    } EventOp_e;
+
+    using pfn_evt = void (*)(void *handler, Tree const* t, id_type node, EventOp_e op);
+
+    void _parse_events(csubstr filename, substr src, pfn_evt fn, void *handler);
+    void _parse(csubstr filename, substr src, Tree *t, id_type node_id);
+    id_type _append_child(id_type parent);
+
+    void _evt_flush_prev_child(id_type parent);
+    void _evt_flush_root();
+    void _evt_open_path(id_type node);
+    void _evt_close(id_type node);
+    bool _evt_is_open(id_type node) const;
+    void _evt_send(id_type node, EventOp_e op) { if(m_evt_fn) m_evt_fn(m_evt_handler, m_tree, node, op); }
+
+    template<class Handler>
+    static void _evt_begin(Handler *h, Tree const* t, id_type node)
+    {
+        if(t->is_stream(node))
+            return;
+        if(t->is_doc(node) || t->is_root(node))
+            h->begin_doc();
+        if(t->has_key(node))
+            h->key(t->key(node));
+        if(t->is_map(node))
+            h->begin_map();
+        else if(t->is_seq(node))
+            h->begin_seq();
+    }
+
+    template<class Handler>
+    static void _evt_end(Handler *h, Tree const* t, id_type node)
+    {
+        if(t->is_stream(node))
+            return;
+        if(t->is_map(node))
+            h->end_map();
+        else if(t->is_seq(node))
+            h->end_seq();
+        if(t->is_doc(node) || t->is_root(node))
+            h->end_doc();
+    }
+
+    template<class Handler>
+    static void _evt_whole(Handler *h, Tree const* t, id_type node)
+    {
+        _evt_begin(h, t, node);
+        if(t->is_container(node))
+        {
+            for(id_type ch = t->first_child(node); ch != NONE; ch = t->next_sibling(ch))
+                _evt_whole(h, t, ch);
+        }
+        else if(t->has_val(node))
+        {
+            h->val(t->val(node));
+        }
+        _evt_end(h, t, node);
+    }
+
+    template<class Handler>
+    static void _evt_dispatch(void *handler, Tree const* t, id_type node, EventOp_e op)
+    {
+        Handler *h = static_cast<Handler*>(handler);
+        switch(op)
+        {
+        case _EVT_BEGIN: _evt_begin(h, t, node); break;
+        case _EVT_END:   _evt_end(h, t, node);   break;
+        case _EVT_WHOLE: _evt_whole(h, t, node); break;
+        }
+    }
+
+private:
+
+    substr _copy_to_arena(Tree *t, csubstr src, bool reserve_nodes=true);
+    substr _reserve(Tree *t, substr buf);
 
     void  _reset();
 
@@ -114,6 +521,8 @@ private:
     csubstr _peek_next_line(size_t pos=npos) const;
     bool    _advance_to_peeked();
     void    _scan_line();
+    size_t  _find_newline(size_t pos) const;
+    size_t  _find_structural(size_t pos, size_t end) const;
 
     csubstr _slurp_doc_scalar();
 
@@ -132,13 +541,28 @@ private:
     substr  _scan_plain_scalar_expl(csubstr currscalar, csubstr peeked_line);
     substr  _scan_complex_key(csubstr currscalar, csubstr peeked_line);
     csubstr _scan_to_next_nonempty_line(size_t indentation);
+    size_t  _find_colon_space(csubstr s) const;
+
+    bool    _handle_lazy_val();
+    static void _expand_lazy(Tree *t, id_type node, substr src);
+    bool    _handle_lazy_entry();
+    bool    _lazy_block_range(size_t *last, size_t *num_lines, bool *is_seq) const;
+    void    _lazy_entry_range(size_t first, size_t dash_col, size_t *last, size_t *num_lines) const;
+    bool    _lazy_flow_range(size_t first, size_t *last, size_t *next, size_t *num_lines) const;
+    size_t  _lazy_skip_quoted(size_t pos) const;
     csubstr _extend_scanned_scalar(csubstr currscalar);
 
+    size_t  _json_skip_ws(size_t pos) const;
+    csubstr _json_scan_string(size_t *pos);
+    csubstr _json_scan_plain(size_t *pos);
+    void    _json_set_pos(size_t pos);
+
     csubstr _filter_squot_scalar(substr s);
     csubstr _filter_dquot_scalar(substr s);
+    void    _check_dquot_scalar(csubstr s);
+    size_t  _decode_dquot_scalar(csubstr src, char *dst, size_t *num_read);
     csubstr _filter_plain_scalar(substr s, size_t indentation);
     csubstr _filter_block_scalar(substr s, BlockStyle_e style, BlockChomp_e chomp, size_t indentation);
-    substr  _filter_whitespace(substr s, size_t indentation=0, bool leading_whitespace=true);
 
     void  _handle_finished_file();
     void  _handle_line();
@@ -152,6 +576,9 @@ private:
     bool  _handle_seq_impl();
     bool  _handle_top();
     bool  _handle_types();
+
+    using pfn_handle_line = bool (Parser::*)();
+    static const pfn_handle_line s_handle_line[16]; //!< the line handler for each combination of the flags RUNK|RMAP|RSEQ|EXPL
     bool  _handle_key_anchors_and_refs();
     bool  _handle_val_anchors_and_refs();
     void  _move_val_tag_to_key_tag();
@@ -193,13 +620,12 @@ private:
     void  _set_indentation(size_t behind);
     void  _save_indentation(size_t behind=0);
 
-    void  _write_key_anchor(size_t node_id);
-    void  _write_val_anchor(size_t node_id);
+    void  _write_key_anchor(id_type node_id);
+    void  _write_val_anchor(id_type node_id);
 
 private:
 
     static bool   _read_decimal(csubstr const& str, size_t *decimal);
-    static size_t _count_nlines(csubstr src);
 
 private:
 
@@ -238,7 +664,9 @@ private:
             stripped = stripped_;
             rem = stripped_;
             // find the first column where the character is not a space
-            indentation = full.first_not_of(' ');
+            indentation = detail::count_leading_spaces(full);
+            if(indentation == full.len)
+                indentation = npos;
         }
 
         size_t current_col() const
@@ -259,7 +687,7 @@ private:
     {
         size_t       flags;
         size_t       level;
-        size_t       node_id; // don't hold a pointer to the node as it will be relocated during tree resizes
+        id_type       node_id; // don't hold a pointer to the node as it will be relocated during tree resizes
         csubstr      scalar;
         size_t       scalar_col; // the column where the scalar (or its quotes) begin
 
@@ -269,7 +697,7 @@ private:
 
         State() : flags(), level(), node_id(), scalar(), scalar_col(), pos(), line_contents(), indref() {}
 
-        void reset(const char *file, size_t node_id_)
+        void reset(const char *file, id_type node_id_)
         {
             flags = RUNK|RTOP;
             level = 0;
@@ -313,7 +741,7 @@ private:
 
     inline NodeData * node(State const* s) const { return m_tree->get(s->node_id); }
     inline NodeData * node(State const& s) const { return m_tree->get(s .node_id); }
-    inline NodeData * node(size_t node_id) const { return m_tree->get(   node_id); }
+    inline NodeData * node(id_type node_id) const { return m_tree->get(   node_id); }
 
     inline bool has_all(size_t f) const { return (m_state->flags & f) == f; }
     inline bool has_any(size_t f) const { return (m_state->flags & f) != 0; }
@@ -339,6 +767,13 @@ private:
     void _dbg(const char *msg, ...) const;
 #endif
     void _err(const char *msg, ...) const;
+    Location _err_location() const;
+    void _validate_failed(const char *msg, size_t len) const;
+#ifndef RYML_NO_PARSE_FEATURES
+    void _require_feature(uint32_t feature, const char *what) const;
+#else
+    void _require_feature(uint32_t, const char *) const {}
+#endif
     int  _fmt_msg(char *buf, int buflen, const char *msg, va_list args) const;
     static int  _prfl(char *buf, int buflen, size_t v);
 
@@ -347,12 +782,36 @@ private:
     csubstr m_file;
      substr m_buf;
 
-    size_t  m_root_id;
+    id_type  m_root_id;
     Tree *  m_tree;
 
     detail::stack<State> m_stack;
     State * m_state;
 
+    StructuralIndex m_index;
+    size_t  m_index_threads;
+    size_t  m_index_min_size;
+    bool    m_indexed; //!< whether m_index was built for m_buf
+    size_t  m_origin_offset; //!< see set_buffer_origin()
+    size_t  m_origin_line;
+    bool    m_lazy;
+    bool    m_detect_json;
+#ifndef RYML_NO_PARSE_FEATURES
+    uint32_t m_features; //!< a mask of ParseFeatures_e
+#endif
+    detail::stack<id_type> m_json_open; //!< the containers open in parse_json()
+    csubstr m_reserved; //!< the source copied by _copy_to_arena(), whose tree was already reserved
+
+    bool    m_evt_mode;
+    pfn_evt m_evt_fn;
+    void *  m_evt_handler;
+    detail::stack<id_type> m_evt_open; //!< the path of nodes whose begin events were sent
+    Tree    m_evt_tree;
+
+    struct _ValidateStatus; //!< the outcome of validate(), set by _err()
+    _ValidateStatus * m_validate; //!< set while validating: where _err() records the error instead of raising it
+    char    m_validate_msg[256]; //!< the message of the last error found by validate()
+
     size_t  m_key_tag_indentation;
     size_t  m_key_tag2_indentation;
     csubstr m_key_tag;
@@ -383,16 +842,67 @@ inline void parse(csubstr filename,  substr buf, Tree *t) { Parser np; np.parse(
 inline void parse(                  csubstr buf, Tree *t) { Parser np; np.parse({}      , buf, t); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena.
 inline void parse(csubstr filename, csubstr buf, Tree *t) { Parser np; np.parse(filename, buf, t); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena, providing a filename for error messages.
 
-inline void parse(                   substr buf, Tree *t, size_t node_id) { Parser np; np.parse({}      , buf, t, node_id); } //!< reusing the YAML tree, parse in-situ a modifiable YAML source buffer
-inline void parse(csubstr filename,  substr buf, Tree *t, size_t node_id) { Parser np; np.parse(filename, buf, t, node_id); } //!< reusing the YAML tree, parse in-situ a modifiable YAML source buffer, providing a filename for error messages.
-inline void parse(                  csubstr buf, Tree *t, size_t node_id) { Parser np; np.parse({}      , buf, t, node_id); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena.
-inline void parse(csubstr filename, csubstr buf, Tree *t, size_t node_id) { Parser np; np.parse(filename, buf, t, node_id); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena, providing a filename for error messages.
+inline void parse(                   substr buf, Tree *t, id_type node_id) { Parser np; np.parse({}      , buf, t, node_id); } //!< reusing the YAML tree, parse in-situ a modifiable YAML source buffer
+inline void parse(csubstr filename,  substr buf, Tree *t, id_type node_id) { Parser np; np.parse(filename, buf, t, node_id); } //!< reusing the YAML tree, parse in-situ a modifiable YAML source buffer, providing a filename for error messages.
+inline void parse(                  csubstr buf, Tree *t, id_type node_id) { Parser np; np.parse({}      , buf, t, node_id); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena.
+inline void parse(csubstr filename, csubstr buf, Tree *t, id_type node_id) { Parser np; np.parse(filename, buf, t, node_id); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena, providing a filename for error messages.
 
 inline void parse(                   substr buf, NodeRef node) { Parser np; np.parse({}      , buf, node); } //!< reusing the YAML tree, parse in-situ a modifiable YAML source buffer
 inline void parse(csubstr filename,  substr buf, NodeRef node) { Parser np; np.parse(filename, buf, node); } //!< reusing the YAML tree, parse in-situ a modifiable YAML source buffer, providing a filename for error messages.
 inline void parse(                  csubstr buf, NodeRef node) { Parser np; np.parse({}      , buf, node); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena.
 inline void parse(csubstr filename, csubstr buf, NodeRef node) { Parser np; np.parse(filename, buf, node); } //!< reusing the YAML tree, parse a read-only YAML source buffer, copying it first to the tree's source arena, providing a filename for error messages.
 
+
+//-----------------------------------------------------------------------------
+
+/** @name parse_lazy
+ *
+ * Parse in lazy mode: the collections which are values of a map are
+ * only parsed when their children are first accessed. This makes
+ * parsing much faster when only a part of a large document is read.
+ * @see Parser::set_lazy()
+ * @note the unparsed ranges of the source are parsed in-situ when
+ * expanded, so the buffer given to the in-situ overloads must be kept
+ * valid and unmodified while the tree has lazy nodes. Such a tree must
+ * not be copied with its copy constructor or assignment before being
+ * fully expanded, as both copies would then parse the same ranges
+ * in-situ; Tree::duplicate() is fine.
+ * @{ */
+
+inline Tree parse_lazy(                   substr buf) { Parser np; np.set_lazy(true); return np.parse({}      , buf); } //!< parse lazily a modifiable YAML source buffer.
+inline Tree parse_lazy(csubstr filename,  substr buf) { Parser np; np.set_lazy(true); return np.parse(filename, buf); } //!< parse lazily a modifiable YAML source buffer, providing a filename for error messages.
+inline Tree parse_lazy(                  csubstr buf) { Parser np; np.set_lazy(true); return np.parse({}      , buf); } //!< parse lazily a read-only YAML source buffer, copying it first to the tree's source arena.
+inline Tree parse_lazy(csubstr filename, csubstr buf) { Parser np; np.set_lazy(true); return np.parse(filename, buf); } //!< parse lazily a read-only YAML source buffer, copying it first to the tree's source arena, providing a filename for error messages.
+
+inline void parse_lazy(                   substr buf, Tree *t) { Parser np; np.set_lazy(true); np.parse({}      , buf, t); } //!< reusing the YAML tree, parse lazily a modifiable YAML source buffer
+inline void parse_lazy(csubstr filename,  substr buf, Tree *t) { Parser np; np.set_lazy(true); np.parse(filename, buf, t); } //!< reusing the YAML tree, parse lazily a modifiable YAML source buffer, providing a filename for error messages.
+inline void parse_lazy(                  csubstr buf, Tree *t) { Parser np; np.set_lazy(true); np.parse({}      , buf, t); } //!< reusing the YAML tree, parse lazily a read-only YAML source buffer, copying it first to the tree's source arena.
+inline void parse_lazy(csubstr filename, csubstr buf, Tree *t) { Parser np; np.set_lazy(true); np.parse(filename, buf, t); } //!< reusing the YAML tree, parse lazily a read-only YAML source buffer, copying it first to the tree's source arena, providing a filename for error messages.
+
+/** @} */
+
+
+//-----------------------------------------------------------------------------
+
+/** @name parse_json
+ *
+ * Parse a JSON source with the dedicated JSON parser, which is much
+ * faster than the YAML parser.
+ * @see Parser::parse_json()
+ * @{ */
+
+inline Tree parse_json(                   substr buf) { Parser np; return np.parse_json({}      , buf); } //!< parse in-situ a modifiable JSON source buffer.
+inline Tree parse_json(csubstr filename,  substr buf) { Parser np; return np.parse_json(filename, buf); } //!< parse in-situ a modifiable JSON source buffer, providing a filename for error messages.
+inline Tree parse_json(                  csubstr buf) { Parser np; return np.parse_json({}      , buf); } //!< parse a read-only JSON source buffer, copying it first to the tree's source arena.
+inline Tree parse_json(csubstr filename, csubstr buf) { Parser np; return np.parse_json(filename, buf); } //!< parse a read-only JSON source buffer, copying it first to the tree's source arena, providing a filename for error messages.
+
+inline void parse_json(                   substr buf, Tree *t) { Parser np; np.parse_json({}      , buf, t); } //!< reusing the tree, parse in-situ a modifiable JSON source buffer
+inline void parse_json(csubstr filename,  substr buf, Tree *t) { Parser np; np.parse_json(filename, buf, t); } //!< reusing the tree, parse in-situ a modifiable JSON source buffer, providing a filename for error messages.
+inline void parse_json(                  csubstr buf, Tree *t) { Parser np; np.parse_json({}      , buf, t); } //!< reusing the tree, parse a read-only JSON source buffer, copying it first to the tree's source arena.
+inline void parse_json(csubstr filename, csubstr buf, Tree *t) { Parser np; np.parse_json(filename, buf, t); } //!< reusing the tree, parse a read-only JSON source buffer, copying it first to the tree's source arena, providing a filename for error messages.
+
+/** @} */
+
 } // namespace yml
 } // namespace c4
 
@@ -0,0 +1,125 @@
+#include "c4/yml/parse_context.hpp"
+#include "c4/yml/parse_file.hpp"
+
+namespace c4 {
+namespace yml {
+
+//-----------------------------------------------------------------------------
+ParseContext::ParseContext(Allocator const& a)
+    : m_parser(a)
+    , m_tree(a)
+    , m_nodes_per_kb(0)
+    , m_arena_per_kb(0)
+    , m_small_nodes(0)
+    , m_small_arena(0)
+{
+}
+
+ParseContext& ParseContext::this_thread()
+{
+    static thread_local ParseContext ctx;
+    return ctx;
+}
+
+void ParseContext::shrink()
+{
+    m_tree = Tree(m_tree.allocator());
+    m_nodes_per_kb = 0;
+    m_arena_per_kb = 0;
+    m_small_nodes = 0;
+    m_small_arena = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+void ParseContext::parse(csubstr filename, substr src, Tree *t)
+{
+    RYML_ASSERT(t != nullptr);
+    _prepare(t, src.len, 0);
+    m_parser.parse(filename, src, t, t->root_id());
+    _update_hints(*t, src.len, 0);
+}
+
+void ParseContext::parse(csubstr filename, csubstr src, Tree *t)
+{
+    RYML_ASSERT(t != nullptr);
+    _prepare(t, src.len, src.len);
+    m_parser.parse(filename, src, t, t->root_id()); // copies with room for decoding
+    _update_hints(*t, src.len, src.len);
+}
+
+bool ParseContext::try_load(const char *path)
+{
+    // do not leave the previous file in the tree if this one fails
+    m_tree.clear();
+    m_tree.clear_arena();
+    detail::FileHandle f;
+    if( ! detail::open_file(path, &f))
+        return false;
+    _prepare(&m_tree, f.size, f.size);
+    substr src = m_tree.alloc_arena(f.size);
+    const bool ok = detail::read_file(path, f, src);
+    detail::close_file(&f);
+    if( ! ok)
+    {
+        m_tree.clear();
+        m_tree.clear_arena();
+        return false;
+    }
+    // when the hints did not make room in the arena for decoding the
+    // scalars, the parser grows it, relocating the source with it
+    m_parser.parse(to_csubstr(path), src, &m_tree, m_tree.root_id());
+    _update_hints(m_tree, f.size, f.size);
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+size_t ParseContext::node_capacity_hint(size_t src_len) const
+{
+    // without history, start small and let the tree grow
+    size_t cap = (src_len * m_nodes_per_kb + 1023) / 1024 + 1;
+    if(cap < m_small_nodes)
+        cap = m_small_nodes;
+    return cap >= 16 ? cap : 16;
+}
+
+size_t ParseContext::arena_capacity_hint(size_t src_len) const
+{
+    size_t cap = (src_len * m_arena_per_kb + 1023) / 1024;
+    return cap >= m_small_arena ? cap : m_small_arena;
+}
+
+/** clear the tree without freeing its memory, and make room for a
+ * source of the given size */
+void ParseContext::_prepare(Tree *t, size_t src_len, size_t src_copy_len)
+{
+    t->clear();
+    t->clear_arena();
+    t->reserve(node_capacity_hint(src_len));
+    t->reserve_arena(src_copy_len + arena_capacity_hint(src_len));
+}
+
+/** raise the high-water marks with the sizes used by the parse */
+void ParseContext::_update_hints(Tree const& t, size_t src_len, size_t src_copy_len)
+{
+    RYML_ASSERT(t.arena_size() >= src_copy_len);
+    if(src_len < hint_min_src_len)
+    {
+        // eg "a: b" is 512 nodes per KiB: do not scale it
+        if(t.size() > m_small_nodes)
+            m_small_nodes = t.size();
+        if(t.arena_size() - src_copy_len > m_small_arena)
+            m_small_arena = t.arena_size() - src_copy_len;
+        return;
+    }
+    const size_t nodes_per_kb = (t.size() * 1024 + src_len - 1) / src_len;
+    const size_t arena_per_kb = ((t.arena_size() - src_copy_len) * 1024 + src_len - 1) / src_len;
+    if(nodes_per_kb > m_nodes_per_kb)
+        m_nodes_per_kb = nodes_per_kb;
+    if(arena_per_kb > m_arena_per_kb)
+        m_arena_per_kb = arena_per_kb;
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,145 @@
+#ifndef _C4_YML_PARSE_CONTEXT_HPP_
+#define _C4_YML_PARSE_CONTEXT_HPP_
+
+#ifndef _C4_YML_PARSE_HPP_
+#include "c4/yml/parse.hpp"
+#endif
+
+#if defined(_MSC_VER)
+#   pragma warning(push)
+#   pragma warning(disable: 4251/*needs to have dll-interface to be used by clients of struct*/)
+#endif
+
+namespace c4 {
+namespace yml {
+
+
+/** A parser and a tree which are reused across parses, for
+ * applications parsing many small sources (eg the payloads of
+ * requests), where creating a Parser and a Tree for each source means
+ * that most of the time is spent allocating.
+ *
+ * Between parses, the tree is cleared without freeing its nodes or its
+ * arena, and the parser keeps its stack and its structural index. The
+ * trees are sized from the high-water marks of the previous parses
+ * (the number of nodes and the arena size per byte of source), instead
+ * of counting the lines of each source. The densities are taken only
+ * from sources of at least hint_min_src_len bytes: a tiny source can
+ * be much denser than a large one, so smaller sources raise only
+ * absolute high-water marks, which are small by construction.
+ *
+ * @code
+ * // one context per thread, created on first use
+ * ParseContext &ctx = ParseContext::this_thread();
+ * Tree const& t = ctx.parse(payload);
+ * handle(t["method"].val(), t["params"]);
+ * @endcode
+ *
+ * A context is not thread safe: use one per thread, eg through
+ * this_thread(). The tree returned by parse() is owned by the context,
+ * and it is valid only until the next call to parse(); to keep it, use
+ * the overloads parsing into a tree given by the caller, which is
+ * reset and sized in the same way.
+ */
+class RYML_EXPORT ParseContext
+{
+public:
+
+    /** the minimum size of the sources whose densities of nodes and
+     * arena are used to size the following parses */
+    enum : size_t { hint_min_src_len = 1024 };
+
+    ParseContext(Allocator const& a={});
+
+    ParseContext(ParseContext const&) = delete;
+    ParseContext(ParseContext &&) = delete;
+    ParseContext& operator= (ParseContext const&) = delete;
+    ParseContext& operator= (ParseContext &&) = delete;
+
+    /** get the context of the calling thread, which is created on the
+     * first call from the thread and destroyed when the thread ends */
+    static ParseContext& this_thread();
+
+public:
+
+    /** @name parse into the context's tree
+     * @return the context's tree, valid until the next parse
+     * @{ */
+
+    /** parse in-situ a modifiable YAML source buffer */
+    Tree& parse(csubstr filename,  substr src) { parse(filename, src, &m_tree); return m_tree; }
+    /** parse a read-only YAML source buffer, copying it first to the tree's arena */
+    Tree& parse(csubstr filename, csubstr src) { parse(filename, src, &m_tree); return m_tree; }
+    /** parse in-situ a modifiable YAML source buffer */
+    Tree& parse( substr src) { parse({}, src, &m_tree); return m_tree; }
+    /** parse a read-only YAML source buffer, copying it first to the tree's arena */
+    Tree& parse(csubstr src) { parse({}, src, &m_tree); return m_tree; }
+
+    /** read a file into the arena of the context's tree, and parse it
+     * there in-situ. The file is read with a single pread() where
+     * available: for small files this is cheaper than mapping them
+     * with parse_file(), and the tree's memory is reused. When the
+     * file cannot be opened or read, the error callback is called;
+     * if it returns, the tree is left empty. @see try_load() */
+    Tree& load(const char *path) { try_load(path); return m_tree; }
+
+    /** as load(), but returning false when the file could not be
+     * opened or read, and the error callback returned. The tree is
+     * then empty. */
+    bool try_load(const char *path);
+
+    /** @} */
+
+    /** @name parse into a tree given by the caller
+     * The tree is cleared, keeping its memory, and sized from the
+     * high-water marks of this context.
+     * @{ */
+
+    /** parse in-situ a modifiable YAML source buffer */
+    void parse(csubstr filename,  substr src, Tree *t);
+    /** parse a read-only YAML source buffer, copying it first to the tree's arena */
+    void parse(csubstr filename, csubstr src, Tree *t);
+
+    /** @} */
+
+public:
+
+    Parser      & parser()       { return m_parser; }
+    Parser const& parser() const { return m_parser; }
+
+    Tree      & tree()       { return m_tree; }
+    Tree const& tree() const { return m_tree; }
+
+    /** the number of nodes which will be reserved for a source of the given size */
+    size_t node_capacity_hint(size_t src_len) const;
+    /** the arena size which will be reserved for a source of the given
+     * size, excluding the copy of the source */
+    size_t arena_capacity_hint(size_t src_len) const;
+
+    /** free the memory of the context's tree, and forget the
+     * high-water marks. The parser keeps its memory. */
+    void shrink();
+
+private:
+
+    void _prepare(Tree *t, size_t src_len, size_t src_copy_len);
+    void _update_hints(Tree const& t, size_t src_len, size_t src_copy_len);
+
+private:
+
+    Parser m_parser;
+    Tree   m_tree;
+    size_t m_nodes_per_kb; //!< high-water mark of the nodes per KiB of source
+    size_t m_arena_per_kb; //!< high-water mark of the arena bytes (excluding the source copy) per KiB of source
+    size_t m_small_nodes;  //!< high-water mark of the nodes of the sources smaller than hint_min_src_len
+    size_t m_small_arena;  //!< high-water mark of the arena bytes of the sources smaller than hint_min_src_len
+};
+
+} // namespace yml
+} // namespace c4
+
+#if defined(_MSC_VER)
+#   pragma warning(pop)
+#endif
+
+#endif /* _C4_YML_PARSE_CONTEXT_HPP_ */
@@ -0,0 +1,339 @@
+#include "c4/yml/parse_file.hpp"
+
+#include <atomic>
+#include <new>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#   define RYML_MAP_FILE_WIN
+#elif defined(__unix__) || defined(__unix) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   define RYML_MAP_FILE_POSIX
+#endif
+
+namespace c4 {
+namespace yml {
+
+namespace detail {
+
+struct SourceBuffer
+{
+    std::atomic<size_t> refs;
+    SourceBuffer *next; //!< the previous source of the tree, to which this one holds a reference
+    Allocator alloc;    //!< the allocator of this object, and of mem when it is not mapped
+    substr mem;
+    bool mapped;
+};
+
+namespace {
+
+void _file_error(const char *path, const char *what)
+{
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg), "%s: %s: %s", path, what, strerror(errno));
+    if(len < 0)
+        len = 0;
+    else if(static_cast<size_t>(len) >= sizeof(msg))
+        len = static_cast<int>(sizeof(msg) - 1);
+    error(msg, static_cast<size_t>(len), Location(path, 0, 0));
+}
+
+/** on success, set *mem (which is empty for an empty file) and *mapped */
+bool _map(const char *path, Allocator alloc, substr *mem, bool *mapped)
+{
+    *mem = {};
+    *mapped = false;
+#if defined(RYML_MAP_FILE_POSIX)
+    C4_UNUSED(alloc);
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        _file_error(path, "could not open the file");
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        _file_error(path, "could not get the size of the file");
+        return false;
+    }
+    size_t len = static_cast<size_t>(st.st_size);
+    if(len > 0)
+    {
+        void *ptr = mmap(nullptr, len, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if(ptr == MAP_FAILED)
+        {
+            close(fd);
+            _file_error(path, "could not map the file");
+            return false;
+        }
+        // the parser goes through the file once, from the start
+        madvise(ptr, len, MADV_SEQUENTIAL);
+        *mem = substr(static_cast<char*>(ptr), len);
+        *mapped = true;
+    }
+    close(fd); // the mapping remains valid
+    return true;
+#elif defined(RYML_MAP_FILE_WIN)
+    C4_UNUSED(alloc);
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        _file_error(path, "could not open the file");
+        return false;
+    }
+    LARGE_INTEGER size;
+    if( ! GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        _file_error(path, "could not get the size of the file");
+        return false;
+    }
+    if(size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        void *ptr = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+        if(mapping)
+            CloseHandle(mapping); // the view keeps the mapping alive
+        if( ! ptr)
+        {
+            CloseHandle(file);
+            _file_error(path, "could not map the file");
+            return false;
+        }
+        *mem = substr(static_cast<char*>(ptr), static_cast<size_t>(size.QuadPart));
+        *mapped = true;
+    }
+    CloseHandle(file);
+    return true;
+#else
+    // no memory mapping: read the file into memory owned by the tree
+    FILE *file = fopen(path, "rb");
+    if( ! file)
+    {
+        _file_error(path, "could not open the file");
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if(len < 0)
+    {
+        fclose(file);
+        _file_error(path, "could not get the size of the file");
+        return false;
+    }
+    if(len > 0)
+    {
+        *mem = substr(static_cast<char*>(alloc.allocate(static_cast<size_t>(len), nullptr)), static_cast<size_t>(len));
+        if(fread(mem->str, 1, mem->len, file) != mem->len)
+        {
+            alloc.free(mem->str, mem->len);
+            *mem = {};
+            fclose(file);
+            _file_error(path, "could not read the file");
+            return false;
+        }
+    }
+    fclose(file);
+    return true;
+#endif
+}
+
+void _unmap(SourceBuffer *s)
+{
+    if( ! s->mem.str)
+        return;
+    if( ! s->mapped)
+    {
+        s->alloc.free(s->mem.str, s->mem.len);
+        return;
+    }
+#if defined(RYML_MAP_FILE_POSIX)
+    munmap(s->mem.str, s->mem.len);
+#elif defined(RYML_MAP_FILE_WIN)
+    UnmapViewOfFile(s->mem.str);
+#endif
+}
+
+} // namespace
+
+
+SourceBuffer* map_file(const char *path, Allocator const& a)
+{
+    Allocator alloc = a;
+    substr mem;
+    bool mapped;
+    if( ! _map(path, alloc, &mem, &mapped))
+        return nullptr;
+    void *ptr = alloc.allocate(sizeof(SourceBuffer), nullptr);
+    SourceBuffer *s = new (ptr) SourceBuffer();
+    s->refs.store(1, std::memory_order_relaxed);
+    s->next = nullptr;
+    s->alloc = alloc;
+    s->mem = mem;
+    s->mapped = mapped;
+    return s;
+}
+
+substr source_memory(SourceBuffer const* s)
+{
+    return s->mem;
+}
+
+void acquire_source(SourceBuffer *s)
+{
+    s->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void release_source(SourceBuffer *s)
+{
+    while(s && s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        SourceBuffer *next = s->next;
+        Allocator alloc = s->alloc;
+        _unmap(s);
+        s->~SourceBuffer();
+        alloc.free(s, sizeof(SourceBuffer));
+        s = next;
+    }
+}
+
+void push_source(SourceBuffer **head, SourceBuffer *s)
+{
+    RYML_ASSERT(s != nullptr && s->next == nullptr);
+    s->next = *head;
+    *head = s;
+}
+
+
+//-----------------------------------------------------------------------------
+bool open_file(const char *path, FileHandle *f)
+{
+    f->handle = -1;
+    f->size = 0;
+#if defined(RYML_MAP_FILE_POSIX)
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        _file_error(path, "could not open the file");
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        _file_error(path, "could not get the size of the file");
+        return false;
+    }
+    f->handle = fd;
+    f->size = static_cast<size_t>(st.st_size);
+    return true;
+#else
+    FILE *file = fopen(path, "rb");
+    if( ! file)
+    {
+        _file_error(path, "could not open the file");
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if(len < 0)
+    {
+        fclose(file);
+        _file_error(path, "could not get the size of the file");
+        return false;
+    }
+    f->handle = reinterpret_cast<intptr_t>(file);
+    f->size = static_cast<size_t>(len);
+    return true;
+#endif
+}
+
+bool read_file(const char *path, FileHandle const& f, substr dst)
+{
+    RYML_ASSERT(dst.len <= f.size);
+#if defined(RYML_MAP_FILE_POSIX)
+    size_t pos = 0;
+    while(pos < dst.len)
+    {
+        ssize_t n = pread(static_cast<int>(f.handle), dst.str + pos, dst.len - pos, static_cast<off_t>(pos));
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+        {
+            _file_error(path, "could not read the file");
+            return false;
+        }
+        pos += static_cast<size_t>(n);
+    }
+    return true;
+#else
+    FILE *file = reinterpret_cast<FILE*>(f.handle);
+    if(fread(dst.str, 1, dst.len, file) != dst.len)
+    {
+        _file_error(path, "could not read the file");
+        return false;
+    }
+    return true;
+#endif
+}
+
+void close_file(FileHandle *f)
+{
+#if defined(RYML_MAP_FILE_POSIX)
+    if(f->handle >= 0)
+        close(static_cast<int>(f->handle));
+#else
+    if(f->handle != -1)
+        fclose(reinterpret_cast<FILE*>(f->handle));
+#endif
+    f->handle = -1;
+}
+
+} // namespace detail
+
+
+//-----------------------------------------------------------------------------
+Tree parse_file(const char *path)
+{
+    Parser parser;
+    Tree t;
+    parse_file(&parser, path, &t, t.root_id());
+    return t;
+}
+
+void parse_file(const char *path, Tree *t)
+{
+    Parser parser;
+    parse_file(&parser, path, t, t->root_id());
+}
+
+void parse_file(Parser *parser, const char *path, Tree *t, id_type node_id)
+{
+    RYML_ASSERT(parser != nullptr && t != nullptr);
+    detail::SourceBuffer *s = detail::map_file(path, t->allocator());
+    if( ! s)
+        return;
+    // the tree owns the mapping before parsing, so that it is
+    // released with the tree even if the parse fails
+    t->add_source(s);
+    parser->parse(to_csubstr(path), detail::source_memory(s), t, node_id);
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,76 @@
+#ifndef _C4_YML_PARSE_FILE_HPP_
+#define _C4_YML_PARSE_FILE_HPP_
+
+#ifndef _C4_YML_PARSE_HPP_
+#include "c4/yml/parse.hpp"
+#endif
+
+namespace c4 {
+namespace yml {
+
+/** @name parse_file
+ *
+ * Parse a file in-situ, without reading it into a buffer and without
+ * copying it to the tree's arena.
+ *
+ * The file is mapped to memory as private copy-on-write pages (with
+ * mmap(MAP_PRIVATE) or with a FILE_MAP_COPY view on windows): the
+ * pages are read from the file as the parser reaches them, and only
+ * the pages written by the filtering of the scalars are copied. The
+ * file itself is never modified. The tree takes the ownership of the
+ * mapping, which holds its scalars, and the mapping is released when
+ * the tree and all its copies are destroyed. On platforms without
+ * memory mapping, the file is read into memory owned by the tree.
+ *
+ * @code
+ * Tree t = parse_file("inventory.yml");
+ * csubstr host = t["hosts"][0]["name"].val(); // points into the mapping
+ * @endcode
+ *
+ * @note the file must not be truncated by another process while it is
+ * mapped; as with any mapping, reading the removed pages would then
+ * raise SIGBUS.
+ * @{ */
+
+/** parse a file into a new tree */
+RYML_EXPORT Tree parse_file(const char *path);
+/** parse a file into the root of an existing tree. The tree keeps the
+ * mappings of its previous files. */
+RYML_EXPORT void parse_file(const char *path, Tree *t);
+/** parse a file into a node of an existing tree with the given parser */
+RYML_EXPORT void parse_file(Parser *parser, const char *path, Tree *t, id_type node_id);
+
+/** @} */
+
+
+namespace detail {
+
+/** map a file to private copy-on-write memory, with a reference count
+ * of one. On failure, an error is raised and nullptr is returned.
+ * @see Tree::add_source() */
+RYML_EXPORT SourceBuffer* map_file(const char *path, Allocator const& a);
+/** the memory of a source buffer */
+RYML_EXPORT substr source_memory(SourceBuffer const* s);
+
+/** a file opened for reading with read_file() */
+struct FileHandle
+{
+    intptr_t handle;
+    size_t   size;
+};
+
+/** open a file for reading, and get its size. On failure, an error
+ * is raised and false is returned. */
+RYML_EXPORT bool open_file(const char *path, FileHandle *f);
+/** read the first dst.len bytes of the file into dst, with pread()
+ * where available. On failure, an error is raised and false is
+ * returned. */
+RYML_EXPORT bool read_file(const char *path, FileHandle const& f, substr dst);
+RYML_EXPORT void close_file(FileHandle *f);
+
+} // namespace detail
+
+} // namespace yml
+} // namespace c4
+
+#endif /* _C4_YML_PARSE_FILE_HPP_ */
@@ -0,0 +1,195 @@
+#include "c4/yml/structural_index.hpp"
+#include "c4/yml/detail/simd.hpp"
+
+#include <string.h>
+
+#ifdef RYML_WITH_THREADS
+#include <thread>
+#include <vector>
+#endif
+
+namespace c4 {
+namespace yml {
+
+StructuralIndex::StructuralIndex(Allocator const& a)
+    : m_newlines(nullptr)
+    , m_structural(nullptr)
+    , m_num_words(0)
+    , m_cap_words(0)
+    , m_len(0)
+    , m_alloc(a)
+{
+}
+
+StructuralIndex::~StructuralIndex()
+{
+    free();
+}
+
+StructuralIndex::StructuralIndex(StructuralIndex const& that)
+    : StructuralIndex(that.m_alloc)
+{
+}
+
+StructuralIndex::StructuralIndex(StructuralIndex && that)
+    : m_newlines(that.m_newlines)
+    , m_structural(that.m_structural)
+    , m_num_words(that.m_num_words)
+    , m_cap_words(that.m_cap_words)
+    , m_len(that.m_len)
+    , m_alloc(that.m_alloc)
+{
+    that.m_newlines = nullptr;
+    that.m_structural = nullptr;
+    that.m_num_words = 0;
+    that.m_cap_words = 0;
+    that.m_len = 0;
+}
+
+StructuralIndex& StructuralIndex::operator= (StructuralIndex const& that)
+{
+    if(&that != this)
+    {
+        free();
+        m_alloc = that.m_alloc;
+    }
+    return *this;
+}
+
+StructuralIndex& StructuralIndex::operator= (StructuralIndex && that)
+{
+    if(&that != this)
+    {
+        free();
+        m_newlines = that.m_newlines;
+        m_structural = that.m_structural;
+        m_num_words = that.m_num_words;
+        m_cap_words = that.m_cap_words;
+        m_len = that.m_len;
+        m_alloc = that.m_alloc;
+        that.m_newlines = nullptr;
+        that.m_structural = nullptr;
+        that.m_num_words = 0;
+        that.m_cap_words = 0;
+        that.m_len = 0;
+    }
+    return *this;
+}
+
+void StructuralIndex::free()
+{
+    if(m_newlines)
+    {
+        // both bitmaps live in the same allocation
+        m_alloc.free(m_newlines, 2u * m_cap_words * sizeof(uint64_t));
+    }
+    m_newlines = nullptr;
+    m_structural = nullptr;
+    m_num_words = 0;
+    m_cap_words = 0;
+    m_len = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+void StructuralIndex::build(csubstr buf, size_t num_threads)
+{
+    const size_t num_words = (buf.len + 63u) / 64u;
+    if(num_words > m_cap_words)
+    {
+        free();
+        m_newlines = (uint64_t*) m_alloc.allocate(2u * num_words * sizeof(uint64_t), nullptr);
+        m_structural = m_newlines + num_words;
+        m_cap_words = num_words;
+    }
+    m_num_words = num_words;
+    m_len = buf.len;
+    if(!num_words)
+        return;
+#ifdef RYML_WITH_THREADS
+    if(num_threads > buf.len / min_bytes_per_thread)
+        num_threads = buf.len / min_bytes_per_thread;
+    if(num_threads > 1)
+    {
+        const size_t words_per_thread = (num_words + num_threads - 1) / num_threads;
+        std::vector<std::thread> workers;
+        workers.reserve(num_threads - 1);
+        for(size_t i = 1; i < num_threads; ++i)
+        {
+            size_t first = i * words_per_thread;
+            size_t last = first + words_per_thread < num_words ? first + words_per_thread : num_words;
+            if(first >= last)
+                break;
+            workers.emplace_back([this, buf, first, last]{
+                _index_words(buf.str, first, last);
+            });
+        }
+        // the calling thread does the first chunk
+        _index_words(buf.str, 0, words_per_thread < num_words ? words_per_thread : num_words);
+        for(std::thread &w : workers)
+            w.join();
+        return;
+    }
+#else
+    C4_UNUSED(num_threads);
+#endif
+    _index_words(buf.str, 0, num_words);
+}
+
+void StructuralIndex::_index_words(const char *buf, size_t first_word, size_t last_word)
+{
+    // only the last word of the buffer can be incomplete
+    size_t last_full = last_word;
+    if(last_word == m_num_words && (m_len % 64u) != 0)
+        --last_full;
+    for(size_t w = first_word; w < last_full; ++w)
+    {
+        const char *b = buf + 64u * w;
+        m_newlines[w] = detail::simd_mask64<detail::match_newline>(b);
+        m_structural[w] = detail::simd_mask64<detail::match_structural>(b);
+    }
+    if(last_full != last_word)
+    {
+        const char *b = buf + 64u * last_full;
+        const char *e = buf + m_len;
+        m_newlines[last_full] = detail::scalar_mask<detail::match_newline>(b, e);
+        m_structural[last_full] = detail::scalar_mask<detail::match_structural>(b, e);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+size_t StructuralIndex::_find(uint64_t const* bitmap, size_t pos, size_t end) const
+{
+    RYML_ASSERT(end <= m_len);
+    if(pos >= end)
+        return npos;
+    size_t w = pos / 64u;
+    // mask out the bits before pos
+    uint64_t word = bitmap[w] & (~uint64_t(0) << (pos % 64u));
+    const size_t last_word = (end - 1u) / 64u;
+    while(true)
+    {
+        if(word)
+        {
+            size_t found = 64u * w + detail::_simd_ctz64(word);
+            return found < end ? found : npos;
+        }
+        if(++w > last_word)
+            return npos;
+        word = bitmap[w];
+    }
+}
+
+size_t StructuralIndex::count_newlines() const
+{
+    size_t count = 0;
+    for(size_t w = 0; w < m_num_words; ++w)
+        count += detail::_simd_popcount64(m_newlines[w]);
+    return count;
+}
+
+} // namespace yml
+} // namespace c4
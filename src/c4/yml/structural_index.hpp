@@ -0,0 +1,106 @@
+#ifndef _C4_YML_STRUCTURAL_INDEX_HPP_
+#define _C4_YML_STRUCTURAL_INDEX_HPP_
+
+#ifndef _C4_YML_COMMON_HPP_
+#include "c4/yml/common.hpp"
+#endif
+
+#include <stdint.h>
+
+namespace c4 {
+namespace yml {
+
+
+/** A stage-1 index of a source buffer, built in a single vectorized
+ * pass before parsing. It records the positions of the newline and
+ * structural characters (<tt>: - # ' " [ ] { } ,</tt>) as bitmaps with
+ * one bit per source byte, so that the parser can jump to the next line
+ * end or the next structural character with a bit scan instead of
+ * rescanning the line contents.
+ *
+ * Building the index is embarrassingly parallel, as every bit depends
+ * only on its own byte; so large buffers can be split in chunks indexed
+ * by several threads.
+ *
+ * @note quote regions are not indexed. Unlike JSON, a quote in YAML is
+ * only meaningful at the beginning of a scalar (eg `it's` is a plain
+ * scalar), so quoted ranges cannot be resolved without the parser
+ * context. */
+class RYML_EXPORT StructuralIndex
+{
+public:
+
+    /** buffers smaller than this are always indexed by the calling
+     * thread, regardless of the requested number of threads */
+    enum : size_t { min_bytes_per_thread = size_t(1) << 20 };
+
+public:
+
+    StructuralIndex(Allocator const& a={});
+    ~StructuralIndex();
+
+    /** the index is transient data: copying gives an empty index */
+    StructuralIndex(StructuralIndex const& that);
+    StructuralIndex(StructuralIndex && that);
+    StructuralIndex& operator= (StructuralIndex const& that);
+    StructuralIndex& operator= (StructuralIndex && that);
+
+public:
+
+    /** index the given buffer, reusing the current memory when it is
+     * large enough.
+     * @param num_threads the number of threads to use. Values larger
+     * than one are effective only when ryml is built with
+     * RYML_WITH_THREADS and the buffer is larger than
+     * min_bytes_per_thread for each thread. */
+    void build(csubstr buf, size_t num_threads=1);
+
+    /** forget the indexed buffer, but keep the memory */
+    void clear() { m_len = 0; m_num_words = 0; }
+
+    /** free the memory */
+    void free();
+
+    size_t size() const { return m_len; }
+    bool   empty() const { return m_len == 0; }
+
+public:
+
+    /** get the position of the first newline character (\n or \r)
+     * at or after pos, or npos if there is none */
+    size_t find_newline(size_t pos) const
+    {
+        return _find(m_newlines, pos, m_len);
+    }
+
+    /** get the position of the first structural character in
+     * [pos,end[, or npos if there is none */
+    size_t find_structural(size_t pos, size_t end) const
+    {
+        RYML_ASSERT(end <= m_len);
+        return _find(m_structural, pos, end);
+    }
+
+    /** get the total number of newline characters in the buffer */
+    size_t count_newlines() const;
+
+private:
+
+    size_t _find(uint64_t const* bitmap, size_t pos, size_t end) const;
+    void _index_words(const char *buf, size_t first_word, size_t last_word);
+
+private:
+
+    uint64_t *m_newlines;
+    uint64_t *m_structural;
+    size_t    m_num_words;
+    size_t    m_cap_words;
+    size_t    m_len;
+    Allocator m_alloc;
+
+};
+
+} // namespace yml
+} // namespace c4
+
+#endif /* _C4_YML_STRUCTURAL_INDEX_HPP_ */
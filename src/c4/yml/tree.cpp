@@ -205,13 +205,24 @@ NodeRef const Tree::operator[] (size_t i) const
 Tree::Tree(Allocator const& cb)
 :
     m_buf(nullptr),
+    m_keys(nullptr),
+    m_vals(nullptr),
     m_cap(0),
     m_size(0),
     m_free_head(NONE),
     m_free_tail(NONE),
     m_arena(),
     m_arena_pos(0),
-    m_alloc(cb)
+    m_alloc(cb),
+    m_source(nullptr),
+    m_props(nullptr),
+    m_props_cap(0),
+    m_props_size(0),
+    m_index(nullptr),
+    m_index_cap(0),
+    m_index_size(0),
+    m_index_threshold(index_threshold_default),
+    m_expand_lazy(nullptr)
 {
 }
 
@@ -256,13 +267,19 @@ void Tree::_free()
     if(m_buf)
     {
         RYML_ASSERT(m_cap > 0);
-        m_alloc.free(m_buf, m_cap * sizeof(NodeData));
+        m_alloc.free(m_buf, m_cap * _node_bytes());
     }
     if(m_arena.str)
     {
         RYML_ASSERT(m_arena.len > 0);
         m_alloc.free(m_arena.str, m_arena.len);
     }
+    if(m_source)
+    {
+        detail::release_source(m_source);
+    }
+    _props_free();
+    _index_free();
     _clear();
 }
 
@@ -275,12 +292,22 @@ C4_SUPPRESS_WARNING_GCC_PUSH
 void Tree::_clear()
 {
     m_buf = nullptr;
+    m_keys = nullptr;
+    m_vals = nullptr;
     m_cap = 0;
     m_size = 0;
     m_free_head = 0;
     m_free_tail = 0;
     m_arena = {};
     m_arena_pos = 0;
+    m_source = nullptr;
+    m_props = nullptr;
+    m_props_cap = 0;
+    m_props_size = 0;
+    m_index = nullptr;
+    m_index_cap = 0;
+    m_index_size = 0;
+    m_expand_lazy = nullptr;
 }
 
 void Tree::_copy(Tree const& that)
@@ -288,14 +315,34 @@ void Tree::_copy(Tree const& that)
     RYML_ASSERT(m_buf == nullptr);
     RYML_ASSERT(m_arena.str == nullptr);
     RYML_ASSERT(m_arena.len == 0);
-    m_buf = (NodeData*) m_alloc.allocate(that.m_cap * sizeof(NodeData), that.m_buf);
-    memcpy(m_buf, that.m_buf, that.m_cap * sizeof(NodeData));
+    if(that.m_buf)
+    {
+        // the three arrays are in a single allocation
+        _set_buf(m_alloc.allocate(that.m_cap * _node_bytes(), that.m_buf), that.m_cap);
+        memcpy(m_buf, that.m_buf, that.m_cap * _node_bytes());
+    }
     m_cap = that.m_cap;
     m_size = that.m_size;
     m_free_head = that.m_free_head;
     m_free_tail = that.m_free_tail;
     m_arena_pos = that.m_arena_pos;
     m_arena = that.m_arena;
+    // the scalars in the sources are shared with that
+    m_source = that.m_source;
+    if(m_source)
+    {
+        detail::acquire_source(m_source);
+    }
+    if(that.m_props)
+    {
+        m_props = (_PropsSlot*) m_alloc.allocate(that.m_props_cap * sizeof(_PropsSlot), that.m_props);
+        memcpy(m_props, that.m_props, that.m_props_cap * sizeof(_PropsSlot));
+        m_props_cap = that.m_props_cap;
+        m_props_size = that.m_props_size;
+    }
+    // the child indices are not copied: they are rebuilt as needed
+    m_index_threshold = that.m_index_threshold;
+    m_expand_lazy = that.m_expand_lazy;
     if(that.m_arena.str)
     {
         RYML_ASSERT(that.m_arena.len > 0);
@@ -305,6 +352,23 @@ void Tree::_copy(Tree const& that)
         _relocate(arena); // does a memcpy of the arena and updates nodes using the old arena
         m_arena = arena;
     }
+    // the lazy nodes are parsed in-situ: those whose source is not
+    // in the arena (and was thus not copied with it) get their own
+    // copy, or both trees would parse the same buffer
+    if(m_expand_lazy)
+    {
+        size_t lazy_len = 0;
+        for(id_type i = 0; i < m_cap; ++i)
+            if((m_buf[i].m_type & LAZY) && ! in_arena(m_vals[i].scalar))
+                lazy_len += m_vals[i].scalar.len;
+        if(lazy_len)
+        {
+            reserve_arena(m_arena_pos + lazy_len);
+            for(id_type i = 0; i < m_cap; ++i)
+                if((m_buf[i].m_type & LAZY) && ! in_arena(m_vals[i].scalar))
+                    m_vals[i].scalar = copy_to_arena(m_vals[i].scalar);
+        }
+    }
 }
 
 void Tree::_move(Tree & that)
@@ -313,12 +377,23 @@ void Tree::_move(Tree & that)
     RYML_ASSERT(m_arena.str == nullptr);
     RYML_ASSERT(m_arena.len == 0);
     m_buf = that.m_buf;
+    m_keys = that.m_keys;
+    m_vals = that.m_vals;
     m_cap = that.m_cap;
     m_size = that.m_size;
     m_free_head = that.m_free_head;
     m_free_tail = that.m_free_tail;
     m_arena = that.m_arena;
     m_arena_pos = that.m_arena_pos;
+    m_source = that.m_source;
+    m_props = that.m_props;
+    m_props_cap = that.m_props_cap;
+    m_props_size = that.m_props_size;
+    m_index = that.m_index;
+    m_index_cap = that.m_index_cap;
+    m_index_size = that.m_index_size;
+    m_index_threshold = that.m_index_threshold;
+    m_expand_lazy = that.m_expand_lazy;
     that._clear();
 }
 
@@ -327,38 +402,83 @@ void Tree::_relocate(substr next_arena)
     RYML_ASSERT(next_arena.not_empty());
     RYML_ASSERT(next_arena.len >= m_arena.len);
     memcpy(next_arena.str, m_arena.str, m_arena_pos);
-    for(NodeData *C4_RESTRICT n = m_buf, *e = m_buf + m_cap; n != e; ++n)
+    for(NodeScalarData *C4_RESTRICT k = m_keys, *e = m_keys + m_cap; k != e; ++k)
+    {
+        if(in_arena(k->scalar))
+            k->scalar = _relocated(k->scalar, next_arena);
+    }
+    for(NodeScalarData *C4_RESTRICT v = m_vals, *e = m_vals + m_cap; v != e; ++v)
+    {
+        if(in_arena(v->scalar))
+            v->scalar = _relocated(v->scalar, next_arena);
+    }
+    for(_PropsSlot *C4_RESTRICT s = m_props, *e = m_props + m_props_cap; s != e; ++s)
     {
-        if(in_arena(n->m_key.scalar))
-            n->m_key.scalar = _relocated(n->m_key.scalar, next_arena);
-        if(in_arena(n->m_key.tag   ))
-            n->m_key.tag    = _relocated(n->m_key.tag   , next_arena);
-        if(in_arena(n->m_key.anchor))
-            n->m_key.anchor = _relocated(n->m_key.anchor, next_arena);
-        if(in_arena(n->m_val.scalar))
-            n->m_val.scalar = _relocated(n->m_val.scalar, next_arena);
-        if(in_arena(n->m_val.tag   ))
-            n->m_val.tag    = _relocated(n->m_val.tag   , next_arena);
-        if(in_arena(n->m_val.anchor))
-            n->m_val.anchor = _relocated(n->m_val.anchor, next_arena);
+        if(s->node == NONE)
+            continue;
+        NodeProps &p = s->props;
+        if(in_arena(p.key_tag   ))
+            p.key_tag    = _relocated(p.key_tag   , next_arena);
+        if(in_arena(p.key_anchor))
+            p.key_anchor = _relocated(p.key_anchor, next_arena);
+        if(in_arena(p.val_tag   ))
+            p.val_tag    = _relocated(p.val_tag   , next_arena);
+        if(in_arena(p.val_anchor))
+            p.val_anchor = _relocated(p.val_anchor, next_arena);
     }
 }
 
 
+//-----------------------------------------------------------------------------
+void Tree::_expand_lazy(id_type node)
+{
+    RYML_ASSERT(is_lazy(node));
+    RYML_ASSERT(_p(node)->m_first_child == NONE);
+    RYML_ASSERT(m_expand_lazy != nullptr);
+    // the source was obtained from a modifiable buffer (or copied to
+    // the arena), and no other node points into it
+    csubstr src = _pv(node).scalar;
+    _rem_flags(node, LAZY);
+    _pv(node).scalar.clear();
+    m_expand_lazy(this, node, substr(const_cast<char*>(src.str), src.len));
+}
+
+void Tree::_copy_lazy_src(id_type dst_, Tree const* that_tree)
+{
+    RYML_ASSERT(is_lazy(dst_));
+    RYML_ASSERT(that_tree != this);
+    RYML_ASSERT(that_tree->m_expand_lazy != nullptr);
+    m_expand_lazy = that_tree->m_expand_lazy;
+    _pv(dst_).scalar = copy_to_arena(_pv(dst_).scalar);
+}
+
+void Tree::expand_lazy_all(id_type node)
+{
+    if(node == NONE)
+        node = root_id();
+    // the children are expanded in the loop: do not keep pointers
+    for(id_type ch = first_child(node); ch != NONE; ch = next_sibling(ch))
+        expand_lazy_all(ch);
+}
+
+
 //-----------------------------------------------------------------------------
 void Tree::reserve(size_t cap)
 {
     if(cap > m_cap)
     {
-        NodeData *buf = (NodeData*) m_alloc.allocate(cap * sizeof(NodeData), m_buf);
-        if(m_buf)
+        NodeData *prev_buf = m_buf;
+        NodeScalarData *prev_keys = m_keys, *prev_vals = m_vals;
+        _set_buf(m_alloc.allocate(cap * _node_bytes(), m_buf), cap);
+        if(prev_buf)
         {
-            memcpy(buf, m_buf, m_cap * sizeof(NodeData));
-            m_alloc.free(m_buf, m_cap * sizeof(NodeData));
+            memcpy(m_buf , prev_buf , m_cap * sizeof(NodeData));
+            memcpy(m_keys, prev_keys, m_cap * sizeof(NodeScalarData));
+            memcpy(m_vals, prev_vals, m_cap * sizeof(NodeScalarData));
+            m_alloc.free(prev_buf, m_cap * _node_bytes());
         }
         size_t first = m_cap, del = cap - m_cap;
         m_cap = cap;
-        m_buf = buf;
         _clear_range(first, del);
 
         if(m_free_head != NONE)
@@ -385,10 +505,25 @@ void Tree::reserve(size_t cap)
 
 
 //-----------------------------------------------------------------------------
+void Tree::_set_buf(void *buf, size_t cap)
+{
+    m_buf = (NodeData*) buf;
+    m_keys = (NodeScalarData*) (m_buf + cap);
+    m_vals = m_keys + cap;
+}
+
 void Tree::clear()
 {
+    _props_clear();
+    _index_clear();
     _clear_range(0, m_cap);
     m_size = 0;
+    // no node refers to the sources anymore
+    if(m_source)
+    {
+        detail::release_source(m_source);
+        m_source = nullptr;
+    }
     if(m_buf)
     {
         RYML_ASSERT(m_cap >= 0);
@@ -405,19 +540,21 @@ void Tree::clear()
 
 void Tree::_claim_root()
 {
-    size_t r = _claim();
+    id_type r = _claim();
     RYML_ASSERT(r == 0);
     _set_hierarchy(r, NONE, NONE);
 }
 
 
 //-----------------------------------------------------------------------------
-void Tree::_clear_range(size_t first, size_t num)
+void Tree::_clear_range(id_type first, size_t num)
 {
     if(num == 0) return; // prevent overflow when subtracting
     RYML_ASSERT(first >= 0 && first + num <= m_cap);
-    memset(m_buf + first, 0, num * sizeof(NodeData));
-    for(size_t i = first, e = first + num; i < e; ++i)
+    memset(m_buf  + first, 0, num * sizeof(NodeData));
+    memset(m_keys + first, 0, num * sizeof(NodeScalarData));
+    memset(m_vals + first, 0, num * sizeof(NodeScalarData));
+    for(id_type i = first, e = first + num; i < e; ++i)
     {
         _clear(i);
         NodeData *n = m_buf + i;
@@ -431,7 +568,567 @@ C4_SUPPRESS_WARNING_GCC_POP
 
 
 //-----------------------------------------------------------------------------
-void Tree::_release(size_t i)
+namespace {
+const NodeProps s_no_props = {};
+} // namespace
+
+NodeScalar Tree::keysc(id_type node) const
+{
+    RYML_ASSERT(has_key(node));
+    NodeData const* n = _p(node);
+    NodeScalar sc(_pk(node).scalar);
+    if(n->m_type & (KEYTAG|KEYANCH|KEYREF))
+    {
+        NodeProps const& props = _props_of(node);
+        if(n->m_type & KEYTAG)
+            sc.tag = props.key_tag;
+        if(n->m_type & (KEYANCH|KEYREF))
+            sc.anchor = props.key_anchor;
+    }
+    return sc;
+}
+
+NodeScalar Tree::valsc(id_type node) const
+{
+    RYML_ASSERT(has_val(node));
+    NodeData const* n = _p(node);
+    NodeScalar sc(_pv(node).scalar);
+    if(n->m_type & (VALTAG|VALANCH|VALREF))
+    {
+        NodeProps const& props = _props_of(node);
+        if(n->m_type & VALTAG)
+            sc.tag = props.val_tag;
+        if(n->m_type & (VALANCH|VALREF))
+            sc.anchor = props.val_anchor;
+    }
+    return sc;
+}
+
+bool Tree::has_anchor(id_type node, csubstr a) const
+{
+    NodeData const* n = _p(node);
+    NodeProps const& props = _props_of(node);
+    csubstr key_anchor = (n->m_type & (KEYANCH|KEYREF)) ? props.key_anchor : csubstr{};
+    csubstr val_anchor = (n->m_type & (VALANCH|VALREF)) ? props.val_anchor : csubstr{};
+    return key_anchor == a || val_anchor == a;
+}
+
+NodeProps const* Tree::_props(id_type node) const
+{
+    if( ! m_props_size)
+        return nullptr;
+    // the table is never more than half full, so the probe always
+    // finds an empty slot
+    for(size_t i = _props_slot(node); ; i = (i + 1) & (m_props_cap - 1))
+    {
+        _PropsSlot const& slot = m_props[i];
+        if(slot.node == node)
+            return &slot.props;
+        if(slot.node == NONE)
+            return nullptr;
+    }
+}
+
+NodeProps const& Tree::_props_of(id_type node) const
+{
+    NodeProps const* props = _props(node);
+    return props ? *props : s_no_props;
+}
+
+NodeProps& Tree::_props_get(id_type node)
+{
+    if(NodeProps *props = _props(node))
+        return *props;
+    if(2 * (m_props_size + 1) > m_props_cap)
+        _props_rehash(m_props_cap ? 2 * m_props_cap : 16);
+    size_t i = _props_slot(node);
+    while(m_props[i].node != NONE)
+        i = (i + 1) & (m_props_cap - 1);
+    m_props[i].node = node;
+    m_props[i].props = {};
+    ++m_props_size;
+    return m_props[i].props;
+}
+
+void Tree::_props_rem(id_type node)
+{
+    if( ! m_props_size)
+        return;
+    const size_t mask = m_props_cap - 1;
+    size_t i = _props_slot(node);
+    while(m_props[i].node != node)
+    {
+        if(m_props[i].node == NONE)
+            return;
+        i = (i + 1) & mask;
+    }
+    // instead of leaving a tombstone, shift back the following
+    // entries whose probe sequence crosses the freed slot
+    for(size_t j = (i + 1) & mask; m_props[j].node != NONE; j = (j + 1) & mask)
+    {
+        const size_t home = _props_slot(m_props[j].node);
+        if(((j - home) & mask) >= ((j - i) & mask))
+        {
+            m_props[i] = m_props[j];
+            i = j;
+        }
+    }
+    m_props[i].node = NONE;
+    --m_props_size;
+}
+
+void Tree::_props_rehash(size_t cap)
+{
+    RYML_ASSERT(cap > 0 && (cap & (cap - 1)) == 0);
+    RYML_ASSERT(2 * m_props_size <= cap);
+    _PropsSlot *prev = m_props;
+    const size_t prev_cap = m_props_cap;
+    m_props = (_PropsSlot*) m_alloc.allocate(cap * sizeof(_PropsSlot), prev);
+    m_props_cap = cap;
+    for(size_t i = 0; i < cap; ++i)
+        m_props[i].node = NONE;
+    for(_PropsSlot const* C4_RESTRICT s = prev, *e = prev + prev_cap; s != e; ++s)
+    {
+        if(s->node == NONE)
+            continue;
+        size_t i = _props_slot(s->node);
+        while(m_props[i].node != NONE)
+            i = (i + 1) & (cap - 1);
+        m_props[i] = *s;
+    }
+    if(prev)
+        m_alloc.free(prev, prev_cap * sizeof(_PropsSlot));
+}
+
+void Tree::_props_clear()
+{
+    if( ! m_props_size)
+        return;
+    for(size_t i = 0; i < m_props_cap; ++i)
+        m_props[i].node = NONE;
+    m_props_size = 0;
+}
+
+void Tree::_props_free()
+{
+    if(m_props)
+    {
+        RYML_ASSERT(m_props_cap > 0);
+        m_alloc.free(m_props, m_props_cap * sizeof(_PropsSlot));
+    }
+}
+
+void Tree::_copy_node_props(id_type dst, Tree const* that_tree, id_type src, bool with_key)
+{
+    NodeProps const* src_props = (that_tree->_p(src)->m_type & _PROPMASK) ? that_tree->_props(src) : nullptr;
+    if( ! src_props)
+    {
+        if(with_key)
+            _props_rem(dst);
+        return;
+    }
+    // copy first: adding dst to the table may rehash it
+    const NodeProps props = *src_props;
+    NodeProps &dst_props = _props_get(dst);
+    if(with_key)
+    {
+        dst_props = props;
+    }
+    else
+    {
+        dst_props.val_tag = props.val_tag;
+        dst_props.val_anchor = props.val_anchor;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+/** FNV-1a */
+size_t _hash_key(csubstr key)
+{
+    uint64_t h = UINT64_C(14695981039346656037);
+    for(char c : key)
+    {
+        h ^= static_cast<uint8_t>(c);
+        h *= UINT64_C(1099511628211);
+    }
+    return static_cast<size_t>(h);
+}
+
+size_t _index_pos(size_t hash, size_t cap)
+{
+    return (size_t)((uint64_t(hash) * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & (cap - 1);
+}
+
+} // namespace
+
+Tree::_IndexSlot const* Tree::_index_find(id_type node) const
+{
+    if( ! m_index_size)
+        return nullptr;
+    for(size_t i = _index_slot(node); ; i = (i + 1) & (m_index_cap - 1))
+    {
+        _IndexSlot const& slot = m_index[i];
+        if(slot.node == node)
+            return &slot;
+        if(slot.node == NONE)
+            return nullptr;
+    }
+}
+
+Tree::_IndexSlot& Tree::_index_get(id_type node)
+{
+    if(_IndexSlot *slot = _index_find(node))
+        return *slot;
+    if(2 * (m_index_size + 1) > m_index_cap)
+        _index_rehash(m_index_cap ? 2 * m_index_cap : 16);
+    size_t i = _index_slot(node);
+    while(m_index[i].node != NONE)
+        i = (i + 1) & (m_index_cap - 1);
+    m_index[i].node = node;
+    m_index[i].size = 0;
+    m_index[i].cap = 0;
+    m_index[i].entries = nullptr;
+    m_index[i].ids_cap = 0;
+    m_index[i].ids = nullptr;
+    ++m_index_size;
+    return m_index[i];
+}
+
+void Tree::_index_rem(id_type node)
+{
+    if( ! m_index_size)
+        return;
+    const size_t mask = m_index_cap - 1;
+    size_t i = _index_slot(node);
+    while(m_index[i].node != node)
+    {
+        if(m_index[i].node == NONE)
+            return;
+        i = (i + 1) & mask;
+    }
+    if(m_index[i].entries)
+        m_alloc.free(m_index[i].entries, m_index[i].cap * sizeof(_IndexEntry));
+    if(m_index[i].ids)
+        m_alloc.free(m_index[i].ids, m_index[i].ids_cap * sizeof(id_type));
+    // shift back the following slots, as in _props_rem()
+    for(size_t j = (i + 1) & mask; m_index[j].node != NONE; j = (j + 1) & mask)
+    {
+        const size_t home = _index_slot(m_index[j].node);
+        if(((j - home) & mask) >= ((j - i) & mask))
+        {
+            m_index[i] = m_index[j];
+            i = j;
+        }
+    }
+    m_index[i].node = NONE;
+    --m_index_size;
+}
+
+void Tree::_index_rehash(size_t cap)
+{
+    RYML_ASSERT(cap > 0 && (cap & (cap - 1)) == 0);
+    RYML_ASSERT(2 * m_index_size <= cap);
+    _IndexSlot *prev = m_index;
+    const size_t prev_cap = m_index_cap;
+    m_index = (_IndexSlot*) m_alloc.allocate(cap * sizeof(_IndexSlot), prev);
+    m_index_cap = cap;
+    for(size_t i = 0; i < cap; ++i)
+        m_index[i].node = NONE;
+    for(_IndexSlot const* C4_RESTRICT s = prev, *e = prev + prev_cap; s != e; ++s)
+    {
+        if(s->node == NONE)
+            continue;
+        size_t i = _index_slot(s->node);
+        while(m_index[i].node != NONE)
+            i = (i + 1) & (cap - 1);
+        m_index[i] = *s;
+    }
+    if(prev)
+        m_alloc.free(prev, prev_cap * sizeof(_IndexSlot));
+}
+
+void Tree::_index_clear()
+{
+    if( ! m_index_size)
+        return;
+    for(size_t i = 0; i < m_index_cap; ++i)
+    {
+        _IndexSlot &slot = m_index[i];
+        if(slot.node == NONE)
+            continue;
+        if(slot.entries)
+            m_alloc.free(slot.entries, slot.cap * sizeof(_IndexEntry));
+        if(slot.ids)
+            m_alloc.free(slot.ids, slot.ids_cap * sizeof(id_type));
+        slot.node = NONE;
+    }
+    m_index_size = 0;
+}
+
+void Tree::_index_free()
+{
+    _index_clear();
+    if(m_index)
+    {
+        RYML_ASSERT(m_index_cap > 0);
+        m_alloc.free(m_index, m_index_cap * sizeof(_IndexSlot));
+    }
+}
+
+void Tree::_index_resize(_IndexSlot &slot, size_t cap)
+{
+    RYML_ASSERT(cap > 0 && (cap & (cap - 1)) == 0);
+    RYML_ASSERT(2 * slot.size <= cap);
+    _IndexEntry *prev = slot.entries;
+    const size_t prev_cap = slot.cap;
+    slot.entries = (_IndexEntry*) m_alloc.allocate(cap * sizeof(_IndexEntry), prev);
+    slot.cap = cap;
+    for(size_t i = 0; i < cap; ++i)
+        slot.entries[i].child = NONE;
+    // the entries keep the hash, so the keys are not read again
+    for(_IndexEntry const* C4_RESTRICT e = prev, *end = prev + prev_cap; e != end; ++e)
+    {
+        if(e->child == NONE)
+            continue;
+        size_t i = _index_pos(e->hash, cap);
+        while(slot.entries[i].child != NONE)
+            i = (i + 1) & (cap - 1);
+        slot.entries[i] = *e;
+    }
+    if(prev)
+        m_alloc.free(prev, prev_cap * sizeof(_IndexEntry));
+}
+
+void Tree::_index_drop_keys(_IndexSlot *slot)
+{
+    RYML_ASSERT(slot->entries);
+    if( ! slot->ids)
+    {
+        _index_rem(slot->node);
+        return;
+    }
+    m_alloc.free(slot->entries, slot->cap * sizeof(_IndexEntry));
+    slot->entries = nullptr;
+    slot->size = 0;
+    slot->cap = 0;
+}
+
+void Tree::_index_drop_ids(_IndexSlot *slot)
+{
+    RYML_ASSERT(slot->ids);
+    if( ! slot->entries)
+    {
+        _index_rem(slot->node);
+        return;
+    }
+    m_alloc.free(slot->ids, slot->ids_cap * sizeof(id_type));
+    slot->ids = nullptr;
+    slot->ids_cap = 0;
+}
+
+void Tree::_index_reserve_ids(_IndexSlot &slot, size_t cap)
+{
+    if(cap <= slot.ids_cap)
+        return;
+    id_type *prev = slot.ids;
+    slot.ids = (id_type*) m_alloc.allocate(cap * sizeof(id_type), prev);
+    if(prev)
+    {
+        memcpy(slot.ids, prev, slot.ids_cap * sizeof(id_type));
+        m_alloc.free(prev, slot.ids_cap * sizeof(id_type));
+    }
+    slot.ids_cap = cap;
+}
+
+void Tree::_index_insert(_IndexSlot &slot, id_type child, size_t hash)
+{
+    if(2 * (slot.size + 1) > slot.cap)
+        _index_resize(slot, slot.cap ? 2 * slot.cap : 8);
+    const size_t mask = slot.cap - 1;
+    size_t i = _index_pos(hash, slot.cap);
+    while(slot.entries[i].child != NONE)
+        i = (i + 1) & mask;
+    slot.entries[i].child = child;
+    slot.entries[i].hash = hash;
+    ++slot.size;
+}
+
+void Tree::_index_erase(_IndexSlot &slot, id_type child, size_t hash)
+{
+    if( ! slot.size)
+        return;
+    const size_t mask = slot.cap - 1;
+    size_t i = _index_pos(hash, slot.cap);
+    while(slot.entries[i].child != child)
+    {
+        if(slot.entries[i].child == NONE)
+            return;
+        i = (i + 1) & mask;
+    }
+    for(size_t j = (i + 1) & mask; slot.entries[j].child != NONE; j = (j + 1) & mask)
+    {
+        const size_t home = _index_pos(slot.entries[j].hash, slot.cap);
+        if(((j - home) & mask) >= ((j - i) & mask))
+        {
+            slot.entries[i] = slot.entries[j];
+            i = j;
+        }
+    }
+    slot.entries[i].child = NONE;
+    --slot.size;
+}
+
+id_type Tree::_index_lookup(_IndexSlot const& slot, id_type node, csubstr key) const
+{
+    if( ! slot.size)
+        return NONE;
+    const size_t hash = _hash_key(key);
+    const size_t mask = slot.cap - 1;
+    id_type found = NONE;
+    for(size_t i = _index_pos(hash, slot.cap); slot.entries[i].child != NONE; i = (i + 1) & mask)
+    {
+        _IndexEntry const& e = slot.entries[i];
+        if(e.hash != hash || _pk(e.child).scalar != key)
+            continue;
+        if(found != NONE)
+        {
+            // duplicate keys: find_child() returns the first of them
+            // in the order of the children, which the index does not
+            // know, so walk the children
+            for(id_type ch = first_child(node); ch != NONE; ch = next_sibling(ch))
+                if(_pk(ch).scalar == key)
+                    return ch;
+        }
+        found = e.child;
+    }
+    return found;
+}
+
+/** called after linking the child to its parent */
+void Tree::_index_add_child(id_type child)
+{
+    const id_type parent = _p(child)->m_parent;
+    _IndexSlot *slot = _index_find(parent);
+    if( ! slot)
+        return;
+    if(slot->entries)
+        _index_insert(*slot, child, _hash_key(_pk(child).scalar));
+    if(slot->ids)
+    {
+        // appending keeps the array valid
+        const size_t num_children = _p(parent)->m_num_children;
+        if(_p(child)->m_next_sibling == NONE)
+        {
+            if(num_children > slot->ids_cap)
+                _index_reserve_ids(*slot, 2 * num_children);
+            slot->ids[num_children - 1] = child;
+        }
+        else
+        {
+            _index_drop_ids(slot);
+        }
+    }
+}
+
+/** called before unlinking the child from its parent */
+void Tree::_index_rem_child(id_type child)
+{
+    const id_type parent = _p(child)->m_parent;
+    _IndexSlot *slot = _index_find(parent);
+    if( ! slot)
+        return;
+    if(slot->entries)
+        _index_erase(*slot, child, _hash_key(_pk(child).scalar));
+    // removing the last child keeps the array valid
+    if(slot->ids && _p(child)->m_next_sibling != NONE)
+        _index_drop_ids(slot);
+}
+
+void Tree::_index_set_key(id_type child, csubstr key)
+{
+    const id_type parent = _p(child)->m_parent;
+    _IndexSlot *slot = parent != NONE ? _index_find(parent) : nullptr;
+    if(slot && ! slot->entries)
+        slot = nullptr;
+    if(slot)
+        _index_erase(*slot, child, _hash_key(_pk(child).scalar));
+    _pk(child).scalar = key;
+    if(slot)
+        _index_insert(*slot, child, _hash_key(key));
+}
+
+void Tree::build_index(id_type node)
+{
+    RYML_ASSERT(is_map(node));
+    _expand_if_lazy(node);
+    size_t num_children = 0;
+    for(id_type ch = first_child(node); ch != NONE; ch = next_sibling(ch))
+        ++num_children;
+    size_t cap = 8;
+    while(cap < 2 * num_children)
+        cap *= 2;
+    _IndexSlot &slot = _index_get(node);
+    if(slot.cap != cap)
+    {
+        _IndexEntry *prev = slot.entries;
+        slot.entries = (_IndexEntry*) m_alloc.allocate(cap * sizeof(_IndexEntry), prev);
+        if(prev)
+            m_alloc.free(prev, slot.cap * sizeof(_IndexEntry));
+        slot.cap = cap;
+    }
+    for(size_t i = 0; i < cap; ++i)
+        slot.entries[i].child = NONE;
+    slot.size = 0;
+    for(id_type ch = first_child(node); ch != NONE; ch = next_sibling(ch))
+        _index_insert(slot, ch, _hash_key(_pk(ch).scalar));
+}
+
+void Tree::rem_index(id_type node)
+{
+    _IndexSlot *slot = _index_find(node);
+    if(slot && slot->entries)
+        _index_drop_keys(slot);
+}
+
+bool Tree::has_index(id_type node) const
+{
+    _IndexSlot const* slot = _index_find(node);
+    return slot && slot->entries;
+}
+
+void Tree::build_child_ids(id_type node)
+{
+    RYML_ASSERT(is_container(node));
+    _expand_if_lazy(node);
+    const size_t num_children = _p(node)->m_num_children;
+    _IndexSlot &slot = _index_get(node);
+    _index_reserve_ids(slot, num_children > 8 ? num_children : 8);
+    size_t pos = 0;
+    for(id_type ch = first_child(node); ch != NONE; ch = next_sibling(ch))
+        slot.ids[pos++] = ch;
+    RYML_ASSERT(pos == num_children);
+}
+
+void Tree::rem_child_ids(id_type node)
+{
+    _IndexSlot *slot = _index_find(node);
+    if(slot && slot->ids)
+        _index_drop_ids(slot);
+}
+
+bool Tree::has_child_ids(id_type node) const
+{
+    _IndexSlot const* slot = _index_find(node);
+    return slot && slot->ids;
+}
+
+
+//-----------------------------------------------------------------------------
+void Tree::_release(id_type i)
 {
     RYML_ASSERT(i >= 0 && i < m_cap);
 
@@ -444,7 +1141,7 @@ void Tree::_release(size_t i)
 
 //-----------------------------------------------------------------------------
 // add to the front of the free list
-void Tree::_free_list_add(size_t i)
+void Tree::_free_list_add(id_type i)
 {
     RYML_ASSERT(i >= 0 && i < m_cap);
     NodeData &C4_RESTRICT w = m_buf[i];
@@ -459,7 +1156,7 @@ void Tree::_free_list_add(size_t i)
         m_free_tail = m_free_head;
 }
 
-void Tree::_free_list_rem(size_t i)
+void Tree::_free_list_rem(id_type i)
 {
     if(m_free_head == i)
         m_free_head = _p(i)->m_next_sibling;
@@ -467,7 +1164,7 @@ void Tree::_free_list_rem(size_t i)
 }
 
 //-----------------------------------------------------------------------------
-size_t Tree::_claim()
+id_type Tree::_claim()
 {
     if(m_free_head == NONE || m_buf == nullptr)
     {
@@ -480,7 +1177,7 @@ size_t Tree::_claim()
     RYML_ASSERT(m_size < m_cap);
     RYML_ASSERT(m_free_head >= 0 && m_free_head < m_cap);
 
-    size_t ichild = m_free_head;
+    id_type ichild = m_free_head;
     NodeData *child = m_buf + ichild;
 
     ++m_size;
@@ -505,7 +1202,7 @@ C4_SUPPRESS_WARNING_CLANG("-Wnull-dereference")
 C4_SUPPRESS_WARNING_GCC("-Wnull-dereference")
 #endif
 
-void Tree::_set_hierarchy(size_t ichild, size_t iparent, size_t iprev_sibling)
+void Tree::_set_hierarchy(id_type ichild, id_type iparent, id_type iprev_sibling)
 {
     RYML_ASSERT(iparent == NONE || (iparent >= 0 && iparent < m_cap));
     RYML_ASSERT(iprev_sibling == NONE || (iprev_sibling >= 0 && iprev_sibling < m_cap));
@@ -525,11 +1222,13 @@ void Tree::_set_hierarchy(size_t ichild, size_t iparent, size_t iprev_sibling)
     if(iparent == NONE)
         return;
 
-    size_t inext_sibling = iprev_sibling != NONE ? next_sibling(iprev_sibling) : first_child(iparent);
+    id_type inext_sibling = iprev_sibling != NONE ? next_sibling(iprev_sibling) : first_child(iparent);
     NodeData *C4_RESTRICT parent = get(iparent);
     NodeData *C4_RESTRICT psib   = get(iprev_sibling);
     NodeData *C4_RESTRICT nsib   = get(inext_sibling);
 
+    ++parent->m_num_children;
+
     if(psib)
     {
         RYML_ASSERT(next_sibling(iprev_sibling) == id(nsib));
@@ -560,6 +1259,9 @@ void Tree::_set_hierarchy(size_t ichild, size_t iparent, size_t iprev_sibling)
         if(child->m_prev_sibling == parent->m_last_child)
             parent->m_last_child = id(child);
     }
+
+    if(m_index_size)
+        _index_add_child(ichild);
 }
 
 C4_SUPPRESS_WARNING_GCC_POP
@@ -567,7 +1269,7 @@ C4_SUPPRESS_WARNING_CLANG_POP
 
 
 //-----------------------------------------------------------------------------
-void Tree::_rem_hierarchy(size_t i)
+void Tree::_rem_hierarchy(id_type i)
 {
     RYML_ASSERT(i >= 0 && i < m_cap);
 
@@ -576,7 +1278,11 @@ void Tree::_rem_hierarchy(size_t i)
     // remove from the parent
     if(w.m_parent != NONE)
     {
+        if(m_index_size)
+            _index_rem_child(i);
         NodeData &C4_RESTRICT p = m_buf[w.m_parent];
+        RYML_ASSERT(p.m_num_children > 0);
+        --p.m_num_children;
         if(p.m_first_child == i)
         {
             p.m_first_child = w.m_next_sibling;
@@ -603,12 +1309,14 @@ void Tree::_rem_hierarchy(size_t i)
 //-----------------------------------------------------------------------------
 void Tree::reorder()
 {
-    size_t r = root_id();
+    // the node ids change, so the indices would have to be rebuilt anyway
+    _index_clear();
+    id_type r = root_id();
     _do_reorder(&r, 0);
 }
 
 //-----------------------------------------------------------------------------
-size_t Tree::_do_reorder(size_t *node, size_t count)
+size_t Tree::_do_reorder(id_type *node, size_t count)
 {
     // swap this node if it's not in place
     if(*node != count)
@@ -619,7 +1327,7 @@ size_t Tree::_do_reorder(size_t *node, size_t count)
     ++count; // bump the count from this node
 
     // now descend in the hierarchy
-    for(size_t i = first_child(*node); i != NONE; i = next_sibling(i))
+    for(id_type i = first_child(*node); i != NONE; i = next_sibling(i))
     {
         // this child may have been relocated to a different index,
         // so get an updated version
@@ -629,7 +1337,7 @@ size_t Tree::_do_reorder(size_t *node, size_t count)
 }
 
 //-----------------------------------------------------------------------------
-void Tree::_swap(size_t n_, size_t m_)
+void Tree::_swap(id_type n_, id_type m_)
 {
     RYML_ASSERT((parent(n_) != NONE) || type(n_) == NOTYPE);
     RYML_ASSERT((parent(m_) != NONE) || type(m_) == NOTYPE);
@@ -663,17 +1371,17 @@ void Tree::_swap(size_t n_, size_t m_)
 }
 
 //-----------------------------------------------------------------------------
-void Tree::_swap_hierarchy(size_t ia, size_t ib)
+void Tree::_swap_hierarchy(id_type ia, id_type ib)
 {
     if(ia == ib) return;
 
-    for(size_t i = first_child(ia); i != NONE; i = next_sibling(i))
+    for(id_type i = first_child(ia); i != NONE; i = next_sibling(i))
     {
         if(i == ib || i == ia) continue;
         _p(i)->m_parent = ib;
     }
 
-    for(size_t i = first_child(ib); i != NONE; i = next_sibling(i))
+    for(id_type i = first_child(ib); i != NONE; i = next_sibling(i))
     {
         if(i == ib || i == ia) continue;
         _p(i)->m_parent = ia;
@@ -710,6 +1418,7 @@ void Tree::_swap_hierarchy(size_t ia, size_t ib)
     }
     std::swap(a.m_first_child , b.m_first_child);
     std::swap(a.m_last_child  , b.m_last_child);
+    std::swap(a.m_num_children, b.m_num_children);
 
     if(a.m_prev_sibling != ib && b.m_prev_sibling != ia &&
        a.m_next_sibling != ib && b.m_next_sibling != ia)
@@ -748,7 +1457,7 @@ void Tree::_swap_hierarchy(size_t ia, size_t ib)
                 RYML_ASSERT(b.m_next_sibling != ia);
                 _p(b.m_next_sibling)->m_prev_sibling = ia;
             }
-            size_t ns = b.m_next_sibling;
+            id_type ns = b.m_next_sibling;
             b.m_prev_sibling = a.m_prev_sibling;
             b.m_next_sibling = ia;
             a.m_prev_sibling = ib;
@@ -767,7 +1476,7 @@ void Tree::_swap_hierarchy(size_t ia, size_t ib)
                 RYML_ASSERT(a.m_next_sibling != ib);
                 _p(a.m_next_sibling)->m_prev_sibling = ib;
             }
-            size_t ns = b.m_prev_sibling;
+            id_type ns = b.m_prev_sibling;
             a.m_prev_sibling = b.m_prev_sibling;
             a.m_next_sibling = ib;
             b.m_prev_sibling = ia;
@@ -807,12 +1516,12 @@ void Tree::_swap_hierarchy(size_t ia, size_t ib)
 }
 
 //-----------------------------------------------------------------------------
-void Tree::_copy_hierarchy(size_t dst_, size_t src_)
+void Tree::_copy_hierarchy(id_type dst_, id_type src_)
 {
     auto const& C4_RESTRICT src = *_p(src_);
     auto      & C4_RESTRICT dst = *_p(dst_);
     auto      & C4_RESTRICT prt = *_p(src.m_parent);
-    for(size_t i = src.m_first_child; i != NONE; i = next_sibling(i))
+    for(id_type i = src.m_first_child; i != NONE; i = next_sibling(i))
     {
         _p(i)->m_parent = dst_;
     }
@@ -837,20 +1546,35 @@ void Tree::_copy_hierarchy(size_t dst_, size_t src_)
     dst.m_last_child   = src.m_last_child;
     dst.m_prev_sibling = src.m_prev_sibling;
     dst.m_next_sibling = src.m_next_sibling;
+    dst.m_num_children = src.m_num_children;
 }
 
 //-----------------------------------------------------------------------------
-void Tree::_swap_props(size_t n_, size_t m_)
+void Tree::_swap_props(id_type n_, id_type m_)
 {
     NodeData &C4_RESTRICT n = *_p(n_);
     NodeData &C4_RESTRICT m = *_p(m_);
+    const bool n_has_props = (n.m_type & _PROPMASK) != 0;
+    const bool m_has_props = (m.m_type & _PROPMASK) != 0;
     std::swap(n.m_type, m.m_type);
-    std::swap(n.m_key, m.m_key);
-    std::swap(n.m_val, m.m_val);
+    std::swap(_pk(n_), _pk(m_));
+    std::swap(_pv(n_), _pv(m_));
+    if(n_has_props || m_has_props)
+    {
+        // the table is keyed by node id, so the entries are swapped too
+        const NodeProps props_n = _props_of(n_);
+        const NodeProps props_m = _props_of(m_);
+        _props_rem(n_);
+        _props_rem(m_);
+        if(m_has_props)
+            _props_get(n_) = props_m;
+        if(n_has_props)
+            _props_get(m_) = props_n;
+    }
 }
 
 //-----------------------------------------------------------------------------
-void Tree::move(size_t node, size_t after)
+void Tree::move(id_type node, id_type after)
 {
     RYML_ASSERT(node != NONE);
     RYML_ASSERT( ! is_root(node));
@@ -862,7 +1586,7 @@ void Tree::move(size_t node, size_t after)
 
 //-----------------------------------------------------------------------------
 
-void Tree::move(size_t node, size_t new_parent, size_t after)
+void Tree::move(id_type node, id_type new_parent, id_type after)
 {
     RYML_ASSERT(node != NONE);
     RYML_ASSERT(new_parent != NONE);
@@ -872,19 +1596,19 @@ void Tree::move(size_t node, size_t new_parent, size_t after)
     _set_hierarchy(node, new_parent, after);
 }
 
-size_t Tree::move(Tree *src, size_t node, size_t new_parent, size_t after)
+id_type Tree::move(Tree *src, id_type node, id_type new_parent, id_type after)
 {
     RYML_ASSERT(node != NONE);
     RYML_ASSERT(new_parent != NONE);
 
-    size_t dup = duplicate(src, node, new_parent, after);
+    id_type dup = duplicate(src, node, new_parent, after);
     src->remove(node);
     return dup;
 }
 
 void Tree::set_root_as_stream()
 {
-    size_t root = root_id();
+    id_type root = root_id();
     if(is_stream(root))
         return;
     // don't use _add_flags() because it's checked and will fail
@@ -893,7 +1617,7 @@ void Tree::set_root_as_stream()
         if(is_val(root))
         {
             _p(root)->m_type.add(SEQ);
-            size_t next_doc = append_child(root);
+            id_type next_doc = append_child(root);
             _copy_props_wo_key(next_doc, root);
             _p(next_doc)->m_type.add(DOC);
             _p(next_doc)->m_type.rem(SEQ);
@@ -902,10 +1626,10 @@ void Tree::set_root_as_stream()
         return;
     }
     RYML_ASSERT(!has_key(root));
-    size_t next_doc = append_child(root);
+    id_type next_doc = append_child(root);
     _copy_props_wo_key(next_doc, root);
     _add_flags(next_doc, DOC);
-    for(size_t prev = NONE, ch = first_child(root), next = next_sibling(ch); ch != NONE; )
+    for(id_type prev = NONE, ch = first_child(root), next = next_sibling(ch); ch != NONE; )
     {
         if(ch == next_doc)
             break;
@@ -919,42 +1643,48 @@ void Tree::set_root_as_stream()
 
 
 //-----------------------------------------------------------------------------
-size_t Tree::duplicate(size_t node, size_t parent, size_t after)
+id_type Tree::duplicate(id_type node, id_type parent, id_type after)
 {
     return duplicate(this, node, parent, after);
 }
 
-size_t Tree::duplicate(Tree const* src, size_t node, size_t parent, size_t after)
+id_type Tree::duplicate(Tree const* src, id_type node, id_type parent, id_type after)
 {
     RYML_ASSERT(src != nullptr);
     RYML_ASSERT(node != NONE);
     RYML_ASSERT(parent != NONE);
     RYML_ASSERT( ! src->is_root(node));
 
-    size_t copy = _claim();
+    id_type copy = _claim();
 
     _copy_props(copy, src, node);
     _set_hierarchy(copy, parent, after);
-    duplicate_children(src, node, copy, NONE);
+    // a lazy node from another tree is copied with its source
+    if( ! is_lazy(copy))
+        duplicate_children(src, node, copy, NONE);
 
     return copy;
 }
 
 //-----------------------------------------------------------------------------
-size_t Tree::duplicate_children(size_t node, size_t parent, size_t after)
+id_type Tree::duplicate_children(id_type node, id_type parent, id_type after)
 {
     return duplicate_children(this, node, parent, after);
 }
 
-size_t Tree::duplicate_children(Tree const* src, size_t node, size_t parent, size_t after)
+id_type Tree::duplicate_children(Tree const* src, id_type node, id_type parent, id_type after)
 {
     RYML_ASSERT(src != nullptr);
     RYML_ASSERT(node != NONE);
     RYML_ASSERT(parent != NONE);
     RYML_ASSERT(after == NONE || has_child(parent, after));
+    if(src == this)
+        _expand_if_lazy(node);
+    else
+        RYML_CHECK( ! src->is_lazy(node)); // expand it first with expand_lazy()
 
-    size_t prev = after;
-    for(size_t i = src->first_child(node); i != NONE; i = src->next_sibling(i))
+    id_type prev = after;
+    for(id_type i = src->first_child(node); i != NONE; i = src->next_sibling(i))
     {
         prev = duplicate(src, i, parent, prev);
     }
@@ -963,27 +1693,33 @@ size_t Tree::duplicate_children(Tree const* src, size_t node, size_t parent, siz
 }
 
 //-----------------------------------------------------------------------------
-void Tree::duplicate_contents(size_t node, size_t where)
+void Tree::duplicate_contents(id_type node, id_type where)
 {
     duplicate_contents(this, node, where);
 }
 
-void Tree::duplicate_contents(Tree const *src, size_t node, size_t where)
+void Tree::duplicate_contents(Tree const *src, id_type node, id_type where)
 {
     RYML_ASSERT(src != nullptr);
     RYML_ASSERT(node != NONE);
     RYML_ASSERT(where != NONE);
+    if(src != this && src->is_lazy(node))
+    {
+        RYML_CHECK( ! has_children(where)); // or expand the source first with expand_lazy()
+        _copy_props_wo_key(where, src, node); // copies the lazy source
+        return;
+    }
     _copy_props_wo_key(where, src, node);
     duplicate_children(src, node, where, last_child(where));
 }
 
 //-----------------------------------------------------------------------------
-size_t Tree::duplicate_children_no_rep(size_t node, size_t parent, size_t after)
+id_type Tree::duplicate_children_no_rep(id_type node, id_type parent, id_type after)
 {
     return duplicate_children_no_rep(this, node, parent, after);
 }
 
-size_t Tree::duplicate_children_no_rep(Tree const *src, size_t node, size_t parent, size_t after)
+id_type Tree::duplicate_children_no_rep(Tree const *src, id_type node, id_type parent, id_type after)
 {
     RYML_ASSERT(node != NONE);
     RYML_ASSERT(parent != NONE);
@@ -995,7 +1731,7 @@ size_t Tree::duplicate_children_no_rep(Tree const *src, size_t node, size_t pare
     size_t after_pos = NONE;
     if(after != NONE)
     {
-        for(size_t i = first_child(parent), icount = 0; i != NONE; ++icount, i = next_sibling(i))
+        for(id_type i = first_child(parent), icount = 0; i != NONE; ++icount, i = next_sibling(i))
         {
             if(i == after)
             {
@@ -1006,9 +1742,14 @@ size_t Tree::duplicate_children_no_rep(Tree const *src, size_t node, size_t pare
         RYML_ASSERT(after_pos != NONE);
     }
 
+    if(src == this)
+        _expand_if_lazy(node);
+    else
+        RYML_CHECK( ! src->is_lazy(node)); // expand it first with expand_lazy()
+
     // for each child to be duplicated...
-    size_t prev = after;
-    for(size_t i = src->first_child(node), icount = 0; i != NONE; ++icount, i = src->next_sibling(i))
+    id_type prev = after;
+    for(id_type i = src->first_child(node), icount = 0; i != NONE; ++icount, i = src->next_sibling(i))
     {
         if(is_seq(parent))
         {
@@ -1018,8 +1759,9 @@ size_t Tree::duplicate_children_no_rep(Tree const *src, size_t node, size_t pare
         {
             RYML_ASSERT(is_map(parent));
             // does the parent already have a node with key equal to that of the current duplicate?
-            size_t rep = NONE, rep_pos = NONE;
-            for(size_t j = first_child(parent), jcount = 0; j != NONE; ++jcount, j = next_sibling(j))
+            id_type rep = NONE;
+            size_t rep_pos = NONE;
+            for(id_type j = first_child(parent), jcount = 0; j != NONE; ++jcount, j = next_sibling(j))
             {
                 if(key(j) == key(i))
                 {
@@ -1061,7 +1803,28 @@ size_t Tree::duplicate_children_no_rep(Tree const *src, size_t node, size_t pare
 
 //-----------------------------------------------------------------------------
 
-void Tree::merge_with(Tree const *src, size_t src_node, size_t dst_node)
+namespace {
+/** merging a map with more children than this indexes the destination */
+constexpr const size_t s_merge_index_min = 16;
+} // namespace
+
+/** merging a lazy container from another tree: it can be copied
+ * with its source only into an empty container */
+bool Tree::_merge_lazy(Tree const *src, id_type src_node, id_type dst_node)
+{
+    if(src == this)
+    {
+        _expand_if_lazy(src_node);
+        return false;
+    }
+    if( ! src->is_lazy(src_node))
+        return false;
+    RYML_CHECK( ! has_children(dst_node)); // or expand the source first with expand_lazy()
+    set_lazy(dst_node, copy_to_arena(src->_pv(src_node).scalar), src->m_expand_lazy);
+    return true;
+}
+
+void Tree::merge_with(Tree const *src, id_type src_node, id_type dst_node)
 {
     RYML_ASSERT(src != nullptr);
     if(src_node == NONE)
@@ -1096,11 +1859,14 @@ void Tree::merge_with(Tree const *src, size_t src_node, size_t dst_node)
             else
                 to_seq(dst_node);
         }
-        for(size_t sch = src->first_child(src_node); sch != NONE; sch = src->next_sibling(sch))
+        if(_merge_lazy(src, src_node, dst_node))
+            return;
+        for(id_type sch = src->first_child(src_node); sch != NONE; sch = src->next_sibling(sch))
         {
-            size_t dch = append_child(dst_node);
+            id_type dch = append_child(dst_node);
             _copy_props_wo_key(dch, src, sch);
-            merge_with(src, sch, dch);
+            if( ! is_lazy(dch)) // otherwise it was copied with its source
+                merge_with(src, sch, dch);
         }
     }
     else if(src->is_map(src_node))
@@ -1115,16 +1881,30 @@ void Tree::merge_with(Tree const *src, size_t src_node, size_t dst_node)
             else
                 to_map(dst_node);
         }
-        for(size_t sch = src->first_child(src_node); sch != NONE; sch = src->next_sibling(sch))
+        if(_merge_lazy(src, src_node, dst_node))
+            return;
+        // with many children, looking up each of them would be
+        // quadratic: use an index of the destination while merging
+        bool temp_index = false;
+        if( ! has_index(dst_node) && src->num_children(src_node) > s_merge_index_min)
+        {
+            build_index(dst_node);
+            temp_index = true;
+        }
+        for(id_type sch = src->first_child(src_node); sch != NONE; sch = src->next_sibling(sch))
         {
-            size_t dch = find_child(dst_node, src->key(sch));
+            id_type dch = find_child(dst_node, src->key(sch));
             if(dch == NONE)
             {
                 dch = append_child(dst_node);
                 _copy_props(dch, src, sch);
+                if(is_lazy(dch)) // it was copied with its source
+                    continue;
             }
             merge_with(src, sch, dch);
         }
+        if(temp_index)
+            rem_index(dst_node);
     }
     else
     {
@@ -1144,11 +1924,11 @@ struct ReferenceResolver
     struct refdata
     {
         NodeType type;
-        size_t node;
+        id_type node;
         size_t prev_anchor;
-        size_t target;
-        size_t parent_ref;
-        size_t parent_ref_sibling;
+        id_type target;
+        id_type parent_ref;
+        id_type parent_ref_sibling;
     };
 
     Tree *t;
@@ -1187,19 +1967,19 @@ struct ReferenceResolver
         }
     }
 
-    size_t count_anchors_and_refs(size_t n)
+    size_t count_anchors_and_refs(id_type n)
     {
         size_t c = 0;
         c += t->has_key_anchor(n);
         c += t->has_val_anchor(n);
         c += t->is_key_ref(n);
         c += t->is_val_ref(n);
-        for(size_t ch = t->first_child(n); ch != NONE; ch = t->next_sibling(ch))
+        for(id_type ch = t->first_child(n); ch != NONE; ch = t->next_sibling(ch))
             c += count_anchors_and_refs(ch);
         return c;
     }
 
-    void _store_anchors_and_refs(size_t n)
+    void _store_anchors_and_refs(id_type n)
     {
         if(t->is_key_ref(n) || t->is_val_ref(n) || (t->has_key(n) && t->key(n) == "<<"))
         {
@@ -1207,41 +1987,41 @@ struct ReferenceResolver
             {
                 // for merging multiple:
                 //   << : [ *CENTER, *BIG ]
-                for(size_t ich = t->first_child(n); ich != NONE; ich = t->next_sibling(ich))
+                for(id_type ich = t->first_child(n); ich != NONE; ich = t->next_sibling(ich))
                 {
                     RYML_ASSERT(t->num_children(ich) == 0);
-                    refs.push({VALREF, ich, npos, npos, n, t->next_sibling(n)});
+                    refs.push({VALREF, ich, npos, NONE, n, t->next_sibling(n)});
                 }
                 return;
             }
             if(t->is_key_ref(n)) // insert key refs BEFORE inserting val refs
             {
                 RYML_CHECK(t->has_key(n));
-                refs.push({KEYREF, n, npos, npos, NONE, NONE});
+                refs.push({KEYREF, n, npos, NONE, NONE, NONE});
             }
             if(t->is_val_ref(n))
             {
                 RYML_CHECK(t->has_val(n));
-                refs.push({VALREF, n, npos, npos, NONE, NONE});
+                refs.push({VALREF, n, npos, NONE, NONE, NONE});
             }
         }
         if(t->has_key_anchor(n))
         {
             RYML_CHECK(t->has_key(n));
-            refs.push({KEYANCH, n, npos, npos, NONE, NONE});
+            refs.push({KEYANCH, n, npos, NONE, NONE, NONE});
         }
         if(t->has_val_anchor(n))
         {
             RYML_CHECK(t->has_val(n) || t->is_container(n));
-            refs.push({VALANCH, n, npos, npos, NONE, NONE});
+            refs.push({VALANCH, n, npos, NONE, NONE, NONE});
         }
-        for(size_t ch = t->first_child(n); ch != NONE; ch = t->next_sibling(ch))
+        for(id_type ch = t->first_child(n); ch != NONE; ch = t->next_sibling(ch))
         {
             _store_anchors_and_refs(ch);
         }
     }
 
-    size_t lookup_(refdata *C4_RESTRICT ra)
+    id_type lookup_(refdata *C4_RESTRICT ra)
     {
         RYML_ASSERT(ra->type.is_key_ref() || ra->type.is_val_ref());
         RYML_ASSERT(ra->type.is_key_ref() != ra->type.is_val_ref());
@@ -1306,8 +2086,8 @@ void Tree::resolve()
     detail::ReferenceResolver rr(this);
 
     // insert the resolved references
-    size_t prev_parent_ref = NONE;
-    size_t prev_parent_ref_after = NONE;
+    id_type prev_parent_ref = NONE;
+    id_type prev_parent_ref_after = NONE;
     for(auto const& C4_RESTRICT rd : rr.refs)
     {
         if( ! rd.type.is_ref())
@@ -1315,7 +2095,7 @@ void Tree::resolve()
         if(rd.parent_ref != NONE)
         {
             RYML_ASSERT(is_seq(rd.parent_ref));
-            size_t after, p = parent(rd.parent_ref);
+            id_type after, p = parent(rd.parent_ref);
             if(prev_parent_ref != rd.parent_ref)
             {
                 after = rd.parent_ref;//prev_sibling(rd.parent_ref_sibling);
@@ -1334,8 +2114,8 @@ void Tree::resolve()
             if(has_key(rd.node) && key(rd.node) == "<<")
             {
                 RYML_ASSERT(is_keyval(rd.node));
-                size_t p = parent(rd.node);
-                size_t after = prev_sibling(rd.node);
+                id_type p = parent(rd.node);
+                id_type after = prev_sibling(rd.node);
                 duplicate_children_no_rep(rd.target, p, after);
                 remove(rd.node);
             }
@@ -1347,12 +2127,12 @@ void Tree::resolve()
                 {
                     RYML_CHECK(!is_container(rd.target));
                     RYML_CHECK(has_val(rd.target));
-                    _p(rd.node)->m_key.scalar = val(rd.target);
+                    _set_key_scalar(rd.node, val(rd.target));
                 }
                 else
                 {
                     RYML_CHECK(key_anchor(rd.target) == key_ref(rd.node));
-                    _p(rd.node)->m_key.scalar = key(rd.target);
+                    _set_key_scalar(rd.node, key(rd.target));
                 }
             }
             else
@@ -1362,7 +2142,7 @@ void Tree::resolve()
                 {
                     RYML_CHECK(!is_container(rd.target));
                     RYML_CHECK(has_val(rd.target));
-                    _p(rd.node)->m_val.scalar = key(rd.target);
+                    _pv(rd.node).scalar = key(rd.target);
                 }
                 else
                 {
@@ -1385,34 +2165,70 @@ void Tree::resolve()
 
 //-----------------------------------------------------------------------------
 
-size_t Tree::num_children(size_t node) const
+size_t Tree::num_children(id_type node) const
 {
     if(_p(node)->is_val()) return 0;
-    size_t count = 0;
-    for(size_t i = first_child(node); i != NONE; i = next_sibling(i))
-    {
-        ++count;
-    }
-    return count;
+    _check_not_lazy(node);
+    return _p(node)->m_num_children;
 }
 
-size_t Tree::child(size_t node, size_t pos) const
+id_type Tree::child(id_type node, size_t pos) const
 {
     RYML_ASSERT(node != NONE);
     if(_p(node)->is_val()) return NONE;
-    size_t count = 0;
-    for(size_t i = first_child(node); i != NONE; i = next_sibling(i))
+    _check_not_lazy(node);
+    const size_t num = _p(node)->m_num_children;
+    if(pos >= num)
+        return NONE;
+    if(m_index_size)
     {
-        if(count++ == pos)
-            return i;
+        _IndexSlot const* slot = _index_find(node);
+        if(slot && slot->ids)
+            return slot->ids[pos];
     }
-    return NONE;
+    // walk from the closest end
+    id_type i;
+    if(pos <= num / 2)
+    {
+        i = _p(node)->m_first_child;
+        for(size_t count = 0; count < pos; ++count)
+            i = _p(i)->m_next_sibling;
+    }
+    else
+    {
+        i = _p(node)->m_last_child;
+        for(size_t count = num - 1; count > pos; --count)
+            i = _p(i)->m_prev_sibling;
+    }
+    return i;
+}
+
+id_type Tree::child(id_type node, size_t pos)
+{
+    _expand_if_lazy(node);
+    if(m_index_threshold && pos > m_index_threshold && pos < _p(node)->m_num_children && ! has_child_ids(node))
+        build_child_ids(node);
+    return ((Tree const*)this)->child(node, pos);
 }
 
-size_t Tree::child_pos(size_t node, size_t ch) const
+size_t Tree::child_pos(id_type node, id_type ch) const
 {
+    if(ch == NONE || _p(ch)->m_parent != node)
+        return npos;
+    if(m_index_size)
+    {
+        _IndexSlot const* slot = _index_find(node);
+        if(slot && slot->ids)
+        {
+            // the ids are contiguous, so this is much faster than the walk
+            for(size_t i = 0, num = _p(node)->m_num_children; i < num; ++i)
+                if(slot->ids[i] == ch)
+                    return i;
+            return npos;
+        }
+    }
     size_t count = 0;
-    for(size_t i = first_child(node); i != NONE; i = next_sibling(i))
+    for(id_type i = first_child(node); i != NONE; i = next_sibling(i))
     {
         if(i == ch)
             return count;
@@ -1431,11 +2247,29 @@ size_t Tree::child_pos(size_t node, size_t ch) const
 #   endif
 #endif
 
-size_t Tree::find_child(size_t node, csubstr const& name) const
+id_type Tree::find_child(id_type node, csubstr const& name) const
+{
+    return _find_child(node, name, nullptr);
+}
+
+id_type Tree::find_child(id_type node, csubstr const& name)
+{
+    _expand_if_lazy(node);
+    size_t num_walked = 0;
+    id_type found = _find_child(node, name, &num_walked);
+    if(m_index_threshold && num_walked > m_index_threshold)
+        build_index(node);
+    return found;
+}
+
+/** find the child with the given key, walking the children unless the
+ * map has an index; the number of children walked goes to num_walked */
+id_type Tree::_find_child(id_type node, csubstr const& name, size_t *num_walked) const
 {
     RYML_ASSERT(node != NONE);
     if(_p(node)->is_val()) return NONE;
     RYML_ASSERT(_p(node)->is_map());
+    _check_not_lazy(node);
     if(get(node)->m_first_child == NONE)
     {
         RYML_ASSERT(_p(node)->m_last_child == NONE);
@@ -1445,14 +2279,26 @@ size_t Tree::find_child(size_t node, csubstr const& name) const
     {
         RYML_ASSERT(_p(node)->m_last_child != NONE);
     }
-    for(size_t i = first_child(node); i != NONE; i = next_sibling(i))
+    if(m_index_size)
     {
-        if(_p(i)->m_key.scalar == name)
+        _IndexSlot const* slot = _index_find(node);
+        if(slot && slot->entries)
+            return _index_lookup(*slot, node, name);
+    }
+    size_t count = 0;
+    id_type found = NONE;
+    for(id_type i = first_child(node); i != NONE; i = next_sibling(i))
+    {
+        ++count;
+        if(_pk(i).scalar == name)
         {
-            return i;
+            found = i;
+            break;
         }
     }
-    return NONE;
+    if(num_walked)
+        *num_walked = count;
+    return found;
 }
 
 #if defined(__clang__)
@@ -1464,74 +2310,82 @@ size_t Tree::find_child(size_t node, csubstr const& name) const
 
 //-----------------------------------------------------------------------------
 
-void Tree::to_val(size_t node, csubstr const& val, type_bits more_flags)
+void Tree::to_val(id_type node, csubstr const& val, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
     RYML_ASSERT(parent(node) == NONE || ! parent_is_map(node));
+    _props_rem_if_set(node);
     _set_flags(node, VAL|more_flags);
-    _p(node)->m_key.clear();
-    _p(node)->m_val = val;
+    _set_key_scalar(node, {});
+    _pv(node) = val;
 }
 
-void Tree::to_keyval(size_t node, csubstr const& key, csubstr const& val, type_bits more_flags)
+void Tree::to_keyval(id_type node, csubstr const& key, csubstr const& val, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
     RYML_ASSERT(parent(node) == NONE || parent_is_map(node));
+    _props_rem_if_set(node);
     _set_flags(node, KEYVAL|more_flags);
-    _p(node)->m_key = key;
-    _p(node)->m_val = val;
+    _set_key_scalar(node, key);
+    _pv(node) = val;
 }
 
-void Tree::to_map(size_t node, type_bits more_flags)
+void Tree::to_map(id_type node, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
     RYML_ASSERT(parent(node) == NONE || ! parent_is_map(node)); // parent must not have children with keys
+    _props_rem_if_set(node);
     _set_flags(node, MAP|more_flags);
-    _p(node)->m_key.clear();
-    _p(node)->m_val.clear();
+    _set_key_scalar(node, {});
+    _pv(node).clear();
 }
 
-void Tree::to_map(size_t node, csubstr const& key, type_bits more_flags)
+void Tree::to_map(id_type node, csubstr const& key, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
     RYML_ASSERT(parent(node) == NONE || parent_is_map(node));
+    _props_rem_if_set(node);
     _set_flags(node, KEY|MAP|more_flags);
-    _p(node)->m_key = key;
-    _p(node)->m_val.clear();
+    _set_key_scalar(node, key);
+    _pv(node).clear();
 }
 
-void Tree::to_seq(size_t node, type_bits more_flags)
+void Tree::to_seq(id_type node, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
     RYML_ASSERT(parent(node) == NONE || parent_is_seq(node));
+    _props_rem_if_set(node);
     _set_flags(node, SEQ|more_flags);
-    _p(node)->m_key.clear();
-    _p(node)->m_val.clear();
+    _set_key_scalar(node, {});
+    _pv(node).clear();
 }
 
-void Tree::to_seq(size_t node, csubstr const& key, type_bits more_flags)
+void Tree::to_seq(id_type node, csubstr const& key, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
     RYML_ASSERT(parent(node) == NONE || parent_is_map(node));
+    _props_rem_if_set(node);
     _set_flags(node, KEY|SEQ|more_flags);
-    _p(node)->m_key = key;
-    _p(node)->m_val.clear();
+    _set_key_scalar(node, key);
+    _pv(node).clear();
 }
 
-void Tree::to_doc(size_t node, type_bits more_flags)
+void Tree::to_doc(id_type node, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
+    _props_rem_if_set(node);
     _set_flags(node, DOC|more_flags);
-    _p(node)->m_key.clear();
-    _p(node)->m_val.clear();
+    _set_key_scalar(node, {});
+    _pv(node).clear();
 }
 
-void Tree::to_stream(size_t node, type_bits more_flags)
+void Tree::to_stream(id_type node, type_bits more_flags)
 {
     RYML_ASSERT( ! has_children(node));
+    _props_rem_if_set(node);
     _set_flags(node, STREAM|more_flags);
-    _p(node)->m_key.clear();
-    _p(node)->m_val.clear();
+    _set_key_scalar(node, {});
+    _pv(node).clear();
 }
 
 
@@ -1557,7 +2411,7 @@ void Tree::_advance(lookup_result *r, size_t more) const
         ++r->path_pos;
 }
 
-Tree::lookup_result Tree::lookup_path(csubstr path, size_t start) const
+Tree::lookup_result Tree::lookup_path(csubstr path, id_type start) const
 {
     if(start == NONE)
         start = root_id();
@@ -1570,9 +2424,22 @@ Tree::lookup_result Tree::lookup_path(csubstr path, size_t start) const
     return r;
 }
 
-size_t Tree::lookup_path_or_modify(csubstr default_value, csubstr path, size_t start)
+Tree::lookup_result Tree::lookup_path(csubstr path, id_type start)
+{
+    if(start == NONE)
+        start = root_id();
+    lookup_result r(path, start);
+    if(path.empty())
+        return r;
+    _lookup_path(&r); // the non-const overload expands on the way
+    if(r.target == NONE && r.closest == start)
+        r.closest = NONE;
+    return r;
+}
+
+id_type Tree::lookup_path_or_modify(csubstr default_value, csubstr path, id_type start)
 {
-    size_t target = _lookup_path_or_create(path, start);
+    id_type target = _lookup_path_or_create(path, start);
     if(parent_is_map(target))
         to_keyval(target, key(target), default_value);
     else
@@ -1580,14 +2447,14 @@ size_t Tree::lookup_path_or_modify(csubstr default_value, csubstr path, size_t s
     return target;
 }
 
-size_t Tree::lookup_path_or_modify(Tree const *src, size_t src_node, csubstr path, size_t start)
+id_type Tree::lookup_path_or_modify(Tree const *src, id_type src_node, csubstr path, id_type start)
 {
-    size_t target = _lookup_path_or_create(path, start);
+    id_type target = _lookup_path_or_create(path, start);
     merge_with(src, src_node, target);
     return target;
 }
 
-size_t Tree::_lookup_path_or_create(csubstr path, size_t start)
+id_type Tree::_lookup_path_or_create(csubstr path, id_type start)
 {
     if(start == NONE)
         start = root_id();
@@ -1606,9 +2473,28 @@ void Tree::_lookup_path(lookup_result *r) const
 {
     C4_ASSERT( ! r->unresolved().empty());
     _lookup_path_token parent{"", type(r->closest)};
-    size_t node;
+    id_type node;
+    do
+    {
+        node = _next_node(r, &parent);
+        if(node != NONE)
+            r->closest = node;
+        if(r->unresolved().empty())
+        {
+            r->target = node;
+            return;
+        }
+    } while(node != NONE);
+}
+
+void Tree::_lookup_path(lookup_result *r)
+{
+    C4_ASSERT( ! r->unresolved().empty());
+    _lookup_path_token parent{"", type(r->closest)};
+    id_type node;
     do
     {
+        _expand_if_lazy(r->closest); // _next_node() looks into its children
         node = _next_node(r, &parent);
         if(node != NONE)
             r->closest = node;
@@ -1624,7 +2510,7 @@ void Tree::_lookup_path_modify(lookup_result *r)
 {
     C4_ASSERT( ! r->unresolved().empty());
     _lookup_path_token parent{"", type(r->closest)};
-    size_t node;
+    id_type node;
     do
     {
         node = _next_node_modify(r, &parent);
@@ -1638,13 +2524,13 @@ void Tree::_lookup_path_modify(lookup_result *r)
     } while(node != NONE);
 }
 
-size_t Tree::_next_node(lookup_result * r, _lookup_path_token *parent) const
+id_type Tree::_next_node(lookup_result * r, _lookup_path_token *parent) const
 {
     _lookup_path_token token = _next_token(r, *parent);
     if( ! token)
         return NONE;
 
-    size_t node = NONE;
+    id_type node = NONE;
     csubstr prev = token.value;
     if(token.type == MAP || token.type == SEQ)
     {
@@ -1687,13 +2573,13 @@ size_t Tree::_next_node(lookup_result * r, _lookup_path_token *parent) const
     return node;
 }
 
-size_t Tree::_next_node_modify(lookup_result * r, _lookup_path_token *parent)
+id_type Tree::_next_node_modify(lookup_result * r, _lookup_path_token *parent)
 {
     _lookup_path_token token = _next_token(r, *parent);
     if( ! token)
         return NONE;
 
-    size_t node = NONE;
+    id_type node = NONE;
     if(token.type == MAP || token.type == SEQ)
     {
         RYML_ASSERT(!token.value.begins_with('['));
@@ -1721,9 +2607,8 @@ size_t Tree::_next_node_modify(lookup_result * r, _lookup_path_token *parent)
         {
             RYML_ASSERT(is_map(r->closest));
             node = append_child(r->closest);
-            NodeData *n = _p(node);
-            n->m_key.scalar = token.value;
-            n->m_type.add(KEY);
+            _set_key_scalar(node, token.value);
+            _p(node)->m_type.add(KEY);
         }
     }
     else if(token.type == KEYVAL)
@@ -1741,10 +2626,9 @@ size_t Tree::_next_node_modify(lookup_result * r, _lookup_path_token *parent)
             _add_flags(r->closest, MAP);
             node = append_child(r->closest);
         }
-        NodeData *n = _p(node);
-        n->m_key.scalar = token.value;
-        n->m_val.scalar = "";
-        n->m_type.add(KEYVAL);
+        _set_key_scalar(node, token.value);
+        _pv(node).scalar = "";
+        _p(node)->m_type.add(KEYVAL);
     }
     else if(token.type == KEY)
     {
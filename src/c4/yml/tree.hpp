@@ -31,6 +31,18 @@ struct NodeData;
 class NodeRef;
 class Tree;
 
+namespace detail {
+/** a source buffer owned by trees, eg the file mapping created by
+ * parse_file(). It is reference counted, so that it is shared by the
+ * copies of a tree. @see parse_file.hpp */
+struct SourceBuffer;
+RYML_EXPORT void acquire_source(SourceBuffer *s);
+RYML_EXPORT void release_source(SourceBuffer *s);
+/** push s to the front of the list of sources at *head, taking over
+ * the reference held by *head */
+RYML_EXPORT void push_source(SourceBuffer **head, SourceBuffer *s);
+} // namespace detail
+
 
 /** the integral type necessary to cover all the bits marking node types */
 using tag_bits = uint16_t;
@@ -141,12 +153,14 @@ typedef enum : type_bits {
     VALTAG  = c4bit(11),    ///< the val has an explicit tag/type
     VALQUO  = c4bit(12),    ///< the val is quoted by '', "", > or |
     KEYQUO  = c4bit(13),    ///< the key is quoted by '', "", > or |
+    LAZY    = c4bit(14),    ///< a container whose children were not parsed yet; the val holds their source. @see parse_lazy()
     KEYVAL  = KEY|VAL,
     KEYSEQ  = KEY|SEQ,
     KEYMAP  = KEY|MAP,
     DOCMAP  = DOC|MAP,
     DOCSEQ  = DOC|SEQ,
     DOCVAL  = DOC|VAL,
+    _PROPMASK = KEYREF|VALREF|KEYANCH|VALANCH|KEYTAG|VALTAG, ///< the bits of the properties kept apart from the node. @see NodeProps
 
 #ifdef C4_WORK_IN_PROGRESS_
     // https://yaml.org/type/
@@ -385,20 +399,61 @@ public:
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
-/** contains the data for each YAML node. */
+/** the tags and the anchors (or references) of a node. Few nodes
+ * have any of these, so they are not kept in the node but in a sparse
+ * table of the tree, where they are found by node id. Whether a node
+ * has each of them is still given by its KEYTAG, VALTAG, KEYANCH,
+ * VALANCH, KEYREF and VALREF bits. */
+struct NodeProps
+{
+    csubstr key_tag;
+    csubstr key_anchor; ///< the anchor of the key, or its reference with KEYREF
+    csubstr val_tag;
+    csubstr val_anchor; ///< the anchor of the val, or its reference with VALREF
+};
+C4_MUST_BE_TRIVIAL_COPY(NodeProps);
+
+
+/** the scalar of a key or val as stored in the node: its tag and
+ * anchor are in the node properties. @see NodeProps */
+struct NodeScalarData
+{
+    csubstr scalar;
+
+public:
+
+    NodeScalarData& operator= (csubstr s) noexcept { scalar = s; return *this; }
+
+    bool empty() const noexcept { return scalar.empty(); }
+
+    void clear() noexcept { scalar.clear(); }
+
+};
+C4_MUST_BE_TRIVIAL_COPY(NodeScalarData);
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+/** contains the type and the links of each YAML node, which are what
+ * the type queries and the walks over the tree read, and the number
+ * of children. The key and val scalars of the nodes are in separate
+ * arrays of the tree, so that they are not brought to the cache with
+ * the links.
+ * @see Tree::m_keys, Tree::m_vals */
 struct NodeData
 {
 
     NodeType   m_type;
 
-    NodeScalar m_key;
-    NodeScalar m_val;
+    id_type    m_parent;
+    id_type    m_first_child;
+    id_type    m_last_child;
+    id_type    m_next_sibling;
+    id_type    m_prev_sibling;
 
-    size_t     m_parent;
-    size_t     m_first_child;
-    size_t     m_last_child;
-    size_t     m_next_sibling;
-    size_t     m_prev_sibling;
+    id_type    m_num_children;
 
 public:
 
@@ -406,16 +461,6 @@ public:
     const char* type_str() const { return type_str(m_type); }
     RYML_EXPORT static const char* type_str(NodeType_e ty);
 
-    csubstr const& key() const { RYML_ASSERT(has_key()); return m_key.scalar; }
-    csubstr const& key_tag() const { RYML_ASSERT(has_key_tag()); return m_key.tag; }
-    csubstr const& key_anchor() const { return m_key.anchor; }
-    NodeScalar const& keysc() const { RYML_ASSERT(has_key()); return m_key; }
-
-    csubstr const& val() const { RYML_ASSERT(has_val()); return m_val.scalar; }
-    csubstr const& val_tag() const { RYML_ASSERT(has_val_tag()); return m_val.tag; }
-    csubstr const& val_anchor() const { RYML_ASSERT(has_val_tag()); return m_val.anchor; }
-    NodeScalar const& valsc() const { RYML_ASSERT(has_val()); return m_val; }
-
 public:
 
 #if defined(__clang__)
@@ -460,6 +505,12 @@ C4_MUST_BE_TRIVIAL_COPY(NodeData);
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
+/** the function which parses the source of a lazy container into its
+ * children. It is provided by the parser which created the lazy
+ * node, so that the tree does not depend on the parser.
+ * @see Tree::set_lazy() */
+using pfn_expand_lazy = void (*)(Tree *t, id_type node, substr src);
+
 class Tree
 {
 public:
@@ -506,6 +557,15 @@ public:
 
     Allocator const& allocator() const { return m_alloc; }
 
+    /** make the tree an owner of a source buffer, eg the file mapping
+     * created by parse_file(). The tree takes over the reference to
+     * it; the buffer is released when the tree and all its copies
+     * are destroyed or cleared with clear(). So a tree reused for
+     * parse_file() must be cleared between files, otherwise it keeps
+     * every mapping. */
+    void add_source(detail::SourceBuffer *s) { detail::push_source(&m_source, s); }
+    bool owns_source() const { return m_source != nullptr; }
+
     /** @} */
 
 public:
@@ -515,7 +575,7 @@ public:
 
     //! get the index of a node belonging to this tree.
     //! @p n can be nullptr, in which case a
-    size_t id(NodeData const* n) const
+    id_type id(NodeData const* n) const
     {
         if( ! n)
         {
@@ -527,7 +587,7 @@ public:
 
     //! get a pointer to a node's NodeData.
     //! i can be NONE, in which case a nullptr is returned
-    inline NodeData *get(size_t i)
+    inline NodeData *get(id_type i)
     {
         if(i == NONE)
         {
@@ -538,7 +598,7 @@ public:
     }
     //! get a pointer to a node's NodeData.
     //! i can be NONE, in which case a nullptr is returned.
-    inline NodeData const *get(size_t i) const
+    inline NodeData const *get(id_type i) const
     {
         if(i == NONE)
         {
@@ -550,15 +610,31 @@ public:
 
     // An if-less form of get() that demands a valid node index.
     // This function is implementation only; use at your own risk.
-    inline NodeData       * _p(size_t i)       { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_buf + i; }
+    inline NodeData       * _p(id_type i)       { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_buf + i; }
     // An if-less form of get() that demands a valid node index.
     // This function is implementation only; use at your own risk.
-    inline NodeData const * _p(size_t i) const { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_buf + i; }
+    inline NodeData const * _p(id_type i) const { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_buf + i; }
+
+    // The bytes taken by each node: its NodeData, key and val.
+    static constexpr size_t _node_bytes() { return sizeof(NodeData) + 2 * sizeof(NodeScalarData); }
+
+    // As _p(), for the key scalar of a node.
+    // This function is implementation only; use at your own risk.
+    inline NodeScalarData       & _pk(id_type i)       { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_keys[i]; }
+    // As _p(), for the key scalar of a node.
+    // This function is implementation only; use at your own risk.
+    inline NodeScalarData const & _pk(id_type i) const { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_keys[i]; }
+    // As _p(), for the val scalar of a node.
+    // This function is implementation only; use at your own risk.
+    inline NodeScalarData       & _pv(id_type i)       { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_vals[i]; }
+    // As _p(), for the val scalar of a node.
+    // This function is implementation only; use at your own risk.
+    inline NodeScalarData const & _pv(id_type i) const { RYML_ASSERT(i != NONE && i >= 0 && i < m_cap); return m_vals[i]; }
 
     //! Get the id of the root node
-    size_t root_id()       { if(m_cap == 0) { reserve(16); } RYML_ASSERT(m_cap > 0 && m_size > 0); return 0; }
+    id_type root_id()       { if(m_cap == 0) { reserve(16); } RYML_ASSERT(m_cap > 0 && m_size > 0); return 0; }
     //! Get the id of the root node
-    size_t root_id() const {                                 RYML_ASSERT(m_cap > 0 && m_size > 0); return 0; }
+    id_type root_id() const {                                 RYML_ASSERT(m_cap > 0 && m_size > 0); return 0; }
 
     //! Get the root as a NodeRef
     NodeRef       rootref();
@@ -586,20 +662,20 @@ public:
     /** @name node property getters */
     /** @{ */
 
-    NodeType_e  type(size_t node) const { return (NodeType_e)(_p(node)->m_type & _TYMASK); }
-    const char* type_str(size_t node) const { return NodeType::type_str(_p(node)->m_type); }
+    NodeType_e  type(id_type node) const { return (NodeType_e)(_p(node)->m_type & _TYMASK); }
+    const char* type_str(id_type node) const { return NodeType::type_str(_p(node)->m_type); }
 
-    csubstr    const& key       (size_t node) const { RYML_ASSERT(has_key(node)); return _p(node)->m_key.scalar; }
-    csubstr    const& key_tag   (size_t node) const { RYML_ASSERT(has_key_tag(node)); return _p(node)->m_key.tag; }
-    csubstr    const& key_ref   (size_t node) const { RYML_ASSERT(is_key_ref(node) && ! has_key_anchor(node)); return _p(node)->m_key.anchor; }
-    csubstr    const& key_anchor(size_t node) const { RYML_ASSERT( ! is_key_ref(node) && has_key_anchor(node)); return _p(node)->m_key.anchor; }
-    NodeScalar const& keysc     (size_t node) const { RYML_ASSERT(has_key(node)); return _p(node)->m_key; }
+    csubstr    const& key       (id_type node) const { RYML_ASSERT(has_key(node)); return _pk(node).scalar; }
+    csubstr    const& key_tag   (id_type node) const { RYML_ASSERT(has_key_tag(node)); return _props_of(node).key_tag; }
+    csubstr    const& key_ref   (id_type node) const { RYML_ASSERT(is_key_ref(node) && ! has_key_anchor(node)); return _props_of(node).key_anchor; }
+    csubstr    const& key_anchor(id_type node) const { RYML_ASSERT( ! is_key_ref(node) && has_key_anchor(node)); return _props_of(node).key_anchor; }
+    NodeScalar        keysc     (id_type node) const;
 
-    csubstr    const& val       (size_t node) const { RYML_ASSERT(has_val(node)); return _p(node)->m_val.scalar; }
-    csubstr    const& val_tag   (size_t node) const { RYML_ASSERT(has_val_tag(node)); return _p(node)->m_val.tag; }
-    csubstr    const& val_ref   (size_t node) const { RYML_ASSERT(is_val_ref(node) && ! has_val_anchor(node)); return _p(node)->m_val.anchor; }
-    csubstr    const& val_anchor(size_t node) const { RYML_ASSERT( ! is_val_ref(node) && has_val_anchor(node)); return _p(node)->m_val.anchor; }
-    NodeScalar const& valsc     (size_t node) const { RYML_ASSERT(has_val(node)); return _p(node)->m_val; }
+    csubstr    const& val       (id_type node) const { RYML_ASSERT(has_val(node)); return _pv(node).scalar; }
+    csubstr    const& val_tag   (id_type node) const { RYML_ASSERT(has_val_tag(node)); return _props_of(node).val_tag; }
+    csubstr    const& val_ref   (id_type node) const { RYML_ASSERT(is_val_ref(node) && ! has_val_anchor(node)); return _props_of(node).val_anchor; }
+    csubstr    const& val_anchor(id_type node) const { RYML_ASSERT( ! is_val_ref(node) && has_val_anchor(node)); return _props_of(node).val_anchor; }
+    NodeScalar        valsc     (id_type node) const;
 
     /** @} */
 
@@ -608,35 +684,36 @@ public:
     /** @name node predicates */
     /** @{ */
 
-    bool is_root(size_t node) const { RYML_ASSERT(_p(node)->m_parent != NONE || node == 0); return _p(node)->m_parent == NONE; }
-    bool is_stream(size_t node) const { return (_p(node)->m_type & STREAM) == STREAM; }
-    bool is_doc(size_t node) const { return (_p(node)->m_type & DOC) != 0; }
-    bool is_container(size_t node) const { return (_p(node)->m_type & (MAP|SEQ|STREAM|DOC)) != 0; }
-    bool is_map(size_t node) const { return (_p(node)->m_type & MAP) != 0; }
-    bool is_seq(size_t node) const { return (_p(node)->m_type & SEQ) != 0; }
-    bool has_val(size_t node) const { return (_p(node)->m_type & VAL) != 0; }
-    bool has_key(size_t node) const { return (_p(node)->m_type & KEY) != 0; }
-    bool is_val(size_t node) const { return (_p(node)->m_type & KEYVAL) == VAL; }
-    bool is_keyval(size_t node) const { return (_p(node)->m_type & KEYVAL) == KEYVAL; }
-    bool has_key_tag(size_t node) const { return (_p(node)->m_type & (KEY|KEYTAG)) == (KEY|KEYTAG); }
-    bool has_val_tag(size_t node) const { return ((_p(node)->m_type & (VALTAG)) && (_p(node)->m_type & (VAL|MAP|SEQ))); }
-    bool has_key_anchor(size_t node) const { return (_p(node)->m_type & KEYANCH) != 0; }
-    bool has_val_anchor(size_t node) const { return (_p(node)->m_type & VALANCH) != 0; }
-    bool is_key_ref(size_t node) const { return (_p(node)->m_type & KEYREF) != 0; }
-    bool is_val_ref(size_t node) const { return (_p(node)->m_type & VALREF) != 0; }
-    bool is_ref(size_t node) const { return (_p(node)->m_type & (KEYREF|VALREF)) != 0; }
-    bool is_anchor(size_t node) const { return (_p(node)->m_type & (KEYANCH|VALANCH)) != 0; }
-    bool is_anchor_or_ref(size_t node) const { return (_p(node)->m_type & (KEYANCH|VALANCH|KEYREF|VALREF)) != 0; }
-    bool is_key_quoted(size_t node) const { return (_p(node)->m_type & (KEYQUO)) != 0; }
-    bool is_val_quoted(size_t node) const { return (_p(node)->m_type & (VALQUO)) != 0; }
-
-    bool parent_is_seq(size_t node) const { RYML_ASSERT(has_parent(node)); return is_seq(_p(node)->m_parent); }
-    bool parent_is_map(size_t node) const { RYML_ASSERT(has_parent(node)); return is_map(_p(node)->m_parent); }
+    bool is_root(id_type node) const { RYML_ASSERT(_p(node)->m_parent != NONE || node == 0); return _p(node)->m_parent == NONE; }
+    bool is_stream(id_type node) const { return (_p(node)->m_type & STREAM) == STREAM; }
+    bool is_doc(id_type node) const { return (_p(node)->m_type & DOC) != 0; }
+    bool is_container(id_type node) const { return (_p(node)->m_type & (MAP|SEQ|STREAM|DOC)) != 0; }
+    bool is_map(id_type node) const { return (_p(node)->m_type & MAP) != 0; }
+    bool is_seq(id_type node) const { return (_p(node)->m_type & SEQ) != 0; }
+    bool has_val(id_type node) const { return (_p(node)->m_type & VAL) != 0; }
+    bool has_key(id_type node) const { return (_p(node)->m_type & KEY) != 0; }
+    bool is_val(id_type node) const { return (_p(node)->m_type & KEYVAL) == VAL; }
+    bool is_keyval(id_type node) const { return (_p(node)->m_type & KEYVAL) == KEYVAL; }
+    bool has_key_tag(id_type node) const { return (_p(node)->m_type & (KEY|KEYTAG)) == (KEY|KEYTAG); }
+    bool has_val_tag(id_type node) const { return ((_p(node)->m_type & (VALTAG)) && (_p(node)->m_type & (VAL|MAP|SEQ))); }
+    bool has_key_anchor(id_type node) const { return (_p(node)->m_type & KEYANCH) != 0; }
+    bool has_val_anchor(id_type node) const { return (_p(node)->m_type & VALANCH) != 0; }
+    bool is_key_ref(id_type node) const { return (_p(node)->m_type & KEYREF) != 0; }
+    bool is_val_ref(id_type node) const { return (_p(node)->m_type & VALREF) != 0; }
+    bool is_ref(id_type node) const { return (_p(node)->m_type & (KEYREF|VALREF)) != 0; }
+    bool is_anchor(id_type node) const { return (_p(node)->m_type & (KEYANCH|VALANCH)) != 0; }
+    bool is_anchor_or_ref(id_type node) const { return (_p(node)->m_type & (KEYANCH|VALANCH|KEYREF|VALREF)) != 0; }
+    bool is_key_quoted(id_type node) const { return (_p(node)->m_type & (KEYQUO)) != 0; }
+    bool is_val_quoted(id_type node) const { return (_p(node)->m_type & (VALQUO)) != 0; }
+    bool is_lazy(id_type node) const { return (_p(node)->m_type & LAZY) != 0; }
+
+    bool parent_is_seq(id_type node) const { RYML_ASSERT(has_parent(node)); return is_seq(_p(node)->m_parent); }
+    bool parent_is_map(id_type node) const { RYML_ASSERT(has_parent(node)); return is_map(_p(node)->m_parent); }
 
     /** true when name and value are empty, and has no children */
-    bool empty(size_t node) const { return ! has_children(node) && _p(node)->m_key.empty() && (( ! (_p(node)->m_type & VAL)) || _p(node)->m_val.empty()); }
+    bool empty(id_type node) const { return ! has_children(node) && _pk(node).empty() && (( ! (_p(node)->m_type & VAL)) || _pv(node).empty()); }
     /** true when the node has an anchor named a */
-    bool has_anchor(size_t node, csubstr a) const { return _p(node)->m_key.anchor == a || _p(node)->m_val.anchor == a; }
+    bool has_anchor(id_type node, csubstr a) const;
 
     /** @} */
 
@@ -645,18 +722,19 @@ public:
     /** @name hierarchy predicates */
     /** @{ */
 
-    bool has_parent(size_t node) const { return _p(node)->m_parent != NONE; }
+    bool has_parent(id_type node) const { return _p(node)->m_parent != NONE; }
 
-    bool has_child(size_t node, csubstr key) const { return find_child(node, key) != npos; }
-    bool has_child(size_t node, size_t ch) const { return child_pos(node, ch) != npos; }
-    bool has_children(size_t node) const { return _p(node)->m_first_child != NONE; }
+    bool has_child(id_type node, csubstr key) const { return find_child(node, key) != NONE; }
+    bool has_child(id_type node, id_type ch) const { return child_pos(node, ch) != npos; }
+    /** lazy containers always have children, so they are not expanded here */
+    bool has_children(id_type node) const { return _p(node)->m_first_child != NONE || (_p(node)->m_type & LAZY) != 0; }
 
-    bool has_sibling(size_t node, size_t sib) const { return is_root(node) ? sib==node : child_pos(_p(node)->m_parent, sib) != npos; }
-    bool has_sibling(size_t node, csubstr key) const { return find_sibling(node, key) != npos; }
+    bool has_sibling(id_type node, id_type sib) const { return is_root(node) ? sib==node : child_pos(_p(node)->m_parent, sib) != npos; }
+    bool has_sibling(id_type node, csubstr key) const { return find_sibling(node, key) != NONE; }
     /** counts with *this */
     bool has_siblings(size_t /*node*/) const { return true; }
     /** does not count with *this */
-    bool has_other_siblings(size_t node) const { return is_root(node) ? false : (_p(_p(node)->m_parent)->m_first_child != _p(_p(node)->m_parent)->m_last_child); }
+    bool has_other_siblings(id_type node) const { return is_root(node) ? false : (_p(_p(node)->m_parent)->m_first_child != _p(_p(node)->m_parent)->m_last_child); }
 
     /** @} */
 
@@ -665,29 +743,49 @@ public:
     /** @name hierarchy getters */
     /** @{ */
 
-    size_t parent(size_t node) const { return _p(node)->m_parent; }
+    id_type parent(id_type node) const { return _p(node)->m_parent; }
 
-    size_t prev_sibling(size_t node) const { return _p(node)->m_prev_sibling; }
-    size_t next_sibling(size_t node) const { return _p(node)->m_next_sibling; }
+    id_type prev_sibling(id_type node) const { return _p(node)->m_prev_sibling; }
+    id_type next_sibling(id_type node) const { return _p(node)->m_next_sibling; }
 
+    /** O(1): the number of children is kept in the node */
+    size_t num_children(id_type node) const;
     /** O(#num_children) */
-    size_t num_children(size_t node) const;
-    size_t child_pos(size_t node, size_t ch) const;
-    size_t first_child(size_t node) const { return _p(node)->m_first_child; }
-    size_t last_child(size_t node) const { return _p(node)->m_last_child; }
-    size_t child(size_t node, size_t pos) const;
-    size_t find_child(size_t node, csubstr const& key) const;
+    size_t child_pos(id_type node, id_type ch) const;
+    id_type first_child(id_type node) const { _check_not_lazy(node); return _p(node)->m_first_child; }
+    id_type last_child(id_type node) const { _check_not_lazy(node); return _p(node)->m_last_child; }
+    /** O(1) when the node has an array of its children, otherwise
+     * O(#num_children). @see build_child_ids() */
+    id_type child(id_type node, size_t pos) const;
+    /** O(1) when the node has an index, otherwise O(#num_children).
+     * @see build_index() */
+    id_type find_child(id_type node, csubstr const& key) const;
+
+    /** @name non-const hierarchy getters
+     * The const getters above require the node to be expanded, and
+     * report an error through the error callback when it is not, while
+     * these expand a lazy node before accessing its children. Likewise,
+     * only these build the indices lazily (see set_index_threshold()):
+     * the const getters never modify the tree.
+     * @see expand_lazy() */
+    /** @{ */
+    size_t num_children(id_type node) { _expand_if_lazy(node); return ((Tree const*)this)->num_children(node); }
+    id_type first_child(id_type node) { _expand_if_lazy(node); return _p(node)->m_first_child; }
+    id_type last_child(id_type node) { _expand_if_lazy(node); return _p(node)->m_last_child; }
+    id_type child(id_type node, size_t pos);
+    id_type find_child(id_type node, csubstr const& key);
+    /** @} */
 
     /** O(#num_siblings) */
     /** counts with this */
-    size_t num_siblings(size_t node) const { return is_root(node) ? 1 : num_children(_p(node)->m_parent); }
+    size_t num_siblings(id_type node) const { return is_root(node) ? 1 : num_children(_p(node)->m_parent); }
     /** does not count with this */
-    size_t num_other_siblings(size_t node) const { size_t ns = num_siblings(node); RYML_ASSERT(ns > 0); return ns-1; }
-    size_t sibling_pos(size_t node, size_t sib) const { RYML_ASSERT( ! is_root(node) || node == root_id()); return child_pos(_p(node)->m_parent, sib); }
-    size_t first_sibling(size_t node) const { return is_root(node) ? node : _p(_p(node)->m_parent)->m_first_child; }
-    size_t last_sibling(size_t node) const { return is_root(node) ? node : _p(_p(node)->m_parent)->m_last_child; }
-    size_t sibling(size_t node, size_t pos) const { return child(_p(node)->m_parent, pos); }
-    size_t find_sibling(size_t node, csubstr const& key) const { return find_child(_p(node)->m_parent, key); }
+    size_t num_other_siblings(id_type node) const { size_t ns = num_siblings(node); RYML_ASSERT(ns > 0); return ns-1; }
+    size_t sibling_pos(id_type node, id_type sib) const { RYML_ASSERT( ! is_root(node) || node == root_id()); return child_pos(_p(node)->m_parent, sib); }
+    id_type first_sibling(id_type node) const { return is_root(node) ? node : _p(_p(node)->m_parent)->m_first_child; }
+    id_type last_sibling(id_type node) const { return is_root(node) ? node : _p(_p(node)->m_parent)->m_last_child; }
+    id_type sibling(id_type node, size_t pos) const { return child(_p(node)->m_parent, pos); }
+    id_type find_sibling(id_type node, csubstr const& key) const { return find_child(_p(node)->m_parent, key); }
 
     /** @} */
 
@@ -696,31 +794,55 @@ public:
     /** @name node modifiers */
     /** @{ */
 
-    void to_keyval(size_t node, csubstr const& key, csubstr const& val, type_bits more_flags=0);
-    void to_map(size_t node, csubstr const& key, type_bits more_flags=0);
-    void to_seq(size_t node, csubstr const& key, type_bits more_flags=0);
-    void to_val(size_t node, csubstr const& val, type_bits more_flags=0);
-    void to_map(size_t node, type_bits more_flags=0);
-    void to_seq(size_t node, type_bits more_flags=0);
-    void to_doc(size_t node, type_bits more_flags=0);
-    void to_stream(size_t node, type_bits more_flags=0);
-
-    void set_key(size_t node, csubstr key) { RYML_ASSERT(has_key(node)); _p(node)->m_key.scalar = key; }
-    void set_val(size_t node, csubstr val) { RYML_ASSERT(has_val(node)); _p(node)->m_val.scalar = val; }
-
-    void set_key_tag(size_t node, csubstr tag) { RYML_ASSERT(has_key(node)); _p(node)->m_key.tag = tag; _add_flags(node, KEYTAG); }
-    void set_val_tag(size_t node, csubstr tag) { RYML_ASSERT(has_val(node) || is_container(node)); _p(node)->m_val.tag = tag; _add_flags(node, VALTAG); }
-
-    void set_key_anchor(size_t node, csubstr anchor) { RYML_ASSERT( ! is_key_ref(node)); _p(node)->m_key.anchor = anchor; _add_flags(node, KEYANCH); }
-    void set_val_anchor(size_t node, csubstr anchor) { RYML_ASSERT( ! is_val_ref(node)); _p(node)->m_val.anchor = anchor; _add_flags(node, VALANCH); }
-    void set_key_ref   (size_t node, csubstr ref   ) { RYML_ASSERT( ! has_key_anchor(node)); _p(node)->m_key.anchor = ref; _add_flags(node, KEYREF); }
-    void set_val_ref   (size_t node, csubstr ref   ) { RYML_ASSERT( ! has_val_anchor(node)); _p(node)->m_val.anchor = ref; _add_flags(node, VALREF); }
+    void to_keyval(id_type node, csubstr const& key, csubstr const& val, type_bits more_flags=0);
+    void to_map(id_type node, csubstr const& key, type_bits more_flags=0);
+    void to_seq(id_type node, csubstr const& key, type_bits more_flags=0);
+    void to_val(id_type node, csubstr const& val, type_bits more_flags=0);
+    void to_map(id_type node, type_bits more_flags=0);
+    void to_seq(id_type node, type_bits more_flags=0);
+    void to_doc(id_type node, type_bits more_flags=0);
+    void to_stream(id_type node, type_bits more_flags=0);
+
+    void set_key(id_type node, csubstr key) { RYML_ASSERT(has_key(node)); _set_key_scalar(node, key); }
+    void set_val(id_type node, csubstr val) { RYML_ASSERT(has_val(node)); _pv(node).scalar = val; }
+
+    /** make an empty container lazy: its children will be parsed from
+     * the given source by the expand function when they are first
+     * accessed through the non-const getters, or by expand_lazy().
+     * The source is parsed in-situ, so it must remain valid until
+     * then; copying the tree or the node copies the source as well.
+     * @see parse_lazy() */
+    void set_lazy(id_type node, csubstr src, pfn_expand_lazy expand)
+    {
+        RYML_ASSERT(is_container(node) && ! has_children(node));
+        RYML_ASSERT(expand != nullptr);
+        _pv(node).scalar = src;
+        _add_flags(node, LAZY);
+        m_expand_lazy = expand;
+    }
 
-    void rem_key_anchor(size_t node) { _p(node)->m_key.anchor.clear(); _rem_flags(node, KEYANCH); }
-    void rem_val_anchor(size_t node) { _p(node)->m_val.anchor.clear(); _rem_flags(node, VALANCH); }
-    void rem_key_ref   (size_t node) { _p(node)->m_key.anchor.clear(); _rem_flags(node, KEYREF); }
-    void rem_val_ref   (size_t node) { _p(node)->m_val.anchor.clear(); _rem_flags(node, VALREF); }
-    void rem_anchor_ref(size_t node) { _p(node)->m_key.anchor.clear(); _p(node)->m_val.anchor.clear(); _rem_flags(node, KEYANCH|VALANCH|KEYREF|VALREF); }
+    /** parse the children of a lazy container. Its own nested
+     * containers may be left lazy. Does nothing when the node is not
+     * lazy. */
+    void expand_lazy(id_type node) { _expand_if_lazy(node); }
+    /** expand all the lazy containers in the branch of the node (by
+     * default the root), so that it can be read through the const
+     * API, eg to emit it or to read it from several threads. */
+    void expand_lazy_all(id_type node=NONE);
+
+    void set_key_tag(id_type node, csubstr tag) { RYML_ASSERT(has_key(node)); _props_get(node).key_tag = tag; _add_flags(node, KEYTAG); }
+    void set_val_tag(id_type node, csubstr tag) { RYML_ASSERT(has_val(node) || is_container(node)); _props_get(node).val_tag = tag; _add_flags(node, VALTAG); }
+
+    void set_key_anchor(id_type node, csubstr anchor) { RYML_ASSERT( ! is_key_ref(node)); _props_get(node).key_anchor = anchor; _add_flags(node, KEYANCH); }
+    void set_val_anchor(id_type node, csubstr anchor) { RYML_ASSERT( ! is_val_ref(node)); _props_get(node).val_anchor = anchor; _add_flags(node, VALANCH); }
+    void set_key_ref   (id_type node, csubstr ref   ) { RYML_ASSERT( ! has_key_anchor(node)); _props_get(node).key_anchor = ref; _add_flags(node, KEYREF); }
+    void set_val_ref   (id_type node, csubstr ref   ) { RYML_ASSERT( ! has_val_anchor(node)); _props_get(node).val_anchor = ref; _add_flags(node, VALREF); }
+
+    void rem_key_anchor(id_type node) { _rem_flags(node, KEYANCH); _props_rem_if_unused(node); }
+    void rem_val_anchor(id_type node) { _rem_flags(node, VALANCH); _props_rem_if_unused(node); }
+    void rem_key_ref   (id_type node) { _rem_flags(node, KEYREF); _props_rem_if_unused(node); }
+    void rem_val_ref   (id_type node) { _rem_flags(node, VALREF); _props_rem_if_unused(node); }
+    void rem_anchor_ref(id_type node) { _rem_flags(node, KEYANCH|VALANCH|KEYREF|VALREF); _props_rem_if_unused(node); }
 
     /** @} */
 
@@ -765,17 +887,18 @@ public:
     /** create and insert a new child of "parent". insert after the (to-be)
      * sibling "after", which must be a child of "parent". To insert as the
      * first child, set after to NONE */
-    inline size_t insert_child(size_t parent, size_t after)
+    inline id_type insert_child(id_type parent, id_type after)
     {
         RYML_ASSERT(parent != NONE);
         RYML_ASSERT(is_container(parent) || is_root(parent));
         RYML_ASSERT(after == NONE || has_child(parent, after));
-        size_t child = _claim();
+        _expand_if_lazy(parent);
+        id_type child = _claim();
         _set_hierarchy(child, parent, after);
         return child;
     }
-    inline size_t prepend_child(size_t parent) { return insert_child(parent, NONE); }
-    inline size_t  append_child(size_t parent) { return insert_child(parent, last_child(parent)); }
+    inline id_type prepend_child(id_type parent) { return insert_child(parent, NONE); }
+    inline id_type  append_child(id_type parent) { return insert_child(parent, last_child(parent)); }
 
 public:
 
@@ -790,7 +913,7 @@ public:
     #endif
 
     //! create and insert a new sibling of n. insert after "after"
-    inline size_t insert_sibling(size_t node, size_t after)
+    inline id_type insert_sibling(id_type node, id_type after)
     {
         RYML_ASSERT(node != NONE);
         RYML_ASSERT( ! is_root(node));
@@ -799,28 +922,36 @@ public:
         RYML_ASSERT(get(node) != nullptr);
         return insert_child(get(node)->m_parent, after);
     }
-    inline size_t prepend_sibling(size_t node) { return insert_sibling(node, NONE); }
-    inline size_t  append_sibling(size_t node) { return insert_sibling(node, last_sibling(node)); }
+    inline id_type prepend_sibling(id_type node) { return insert_sibling(node, NONE); }
+    inline id_type  append_sibling(id_type node) { return insert_sibling(node, last_sibling(node)); }
 
 public:
 
     //! remove an entire branch at once: ie remove the children and the node itself
-    inline void remove(size_t node)
+    inline void remove(id_type node)
     {
         remove_children(node);
         _release(node);
     }
 
     //! remove all the node's children, but keep the node itself
-    void remove_children(size_t node)
+    void remove_children(id_type node)
     {
         RYML_ASSERT(get(node) != nullptr);
-        size_t ich = get(node)->m_first_child;
+        if(m_index_size)
+            _index_rem(node); // cheaper than removing each child from it
+        if(_p(node)->m_type & LAZY)
+        {
+            // the children were not parsed yet: just drop their source
+            _rem_flags(node, LAZY);
+            _pv(node).scalar.clear();
+        }
+        id_type ich = get(node)->m_first_child;
         while(ich != NONE)
         {
             remove_children(ich);
             RYML_ASSERT(get(ich) != nullptr);
-            size_t next = get(ich)->m_next_sibling;
+            id_type next = get(ich)->m_next_sibling;
             _release(ich);
             if(ich == get(node)->m_last_child) break;
             ich = next;
@@ -836,14 +967,14 @@ public:
 public:
 
     /** change the node's position in the parent */
-    void move(size_t node, size_t after);
+    void move(id_type node, id_type after);
 
     /** change the node's parent and position */
-    void move(size_t node, size_t new_parent, size_t after);
+    void move(id_type node, id_type new_parent, id_type after);
 
     /** change the node's parent and position to a different tree
      * @return the index of the new node in the destination tree */
-    size_t move(Tree * src, size_t node, size_t new_parent, size_t after);
+    id_type move(Tree * src, id_type node, id_type new_parent, id_type after);
 
     /** ensure the first node is a stream. Eg, change this tree
      *
@@ -873,34 +1004,34 @@ public:
     /** recursively duplicate a node from this tree into a new parent,
      * placing it after one of its children
      * @return the index of the copy */
-    size_t duplicate(size_t node, size_t new_parent, size_t after);
+    id_type duplicate(id_type node, id_type new_parent, id_type after);
     /** recursively duplicate a node from a different tree into a new parent,
      * placing it after one of its children
      * @return the index of the copy */
-    size_t duplicate(Tree const* src, size_t node, size_t new_parent, size_t after);
+    id_type duplicate(Tree const* src, id_type node, id_type new_parent, id_type after);
 
     /** recursively duplicate the node's children (but not the node)
      * @return the index of the last duplicated child */
-    size_t duplicate_children(size_t node, size_t parent, size_t after);
+    id_type duplicate_children(id_type node, id_type parent, id_type after);
     /** recursively duplicate the node's children (but not the node), where
      * the node is from a different tree
      * @return the index of the last duplicated child */
-    size_t duplicate_children(Tree const* src, size_t node, size_t parent, size_t after);
+    id_type duplicate_children(Tree const* src, id_type node, id_type parent, id_type after);
 
-    void duplicate_contents(size_t node, size_t where);
-    void duplicate_contents(Tree const* src, size_t node, size_t where);
+    void duplicate_contents(id_type node, id_type where);
+    void duplicate_contents(Tree const* src, id_type node, id_type where);
 
     /** duplicate the node's children (but not the node) in a new parent, but
      * omit repetitions where a duplicated node has the same key (in maps) or
      * value (in seqs). If one of the duplicated children has the same key
      * (in maps) or value (in seqs) as one of the parent's children, the one
      * that is placed closest to the end will prevail. */
-    size_t duplicate_children_no_rep(size_t node, size_t parent, size_t after);
-    size_t duplicate_children_no_rep(Tree const* src, size_t node, size_t parent, size_t after);
+    id_type duplicate_children_no_rep(id_type node, id_type parent, id_type after);
+    id_type duplicate_children_no_rep(Tree const* src, id_type node, id_type parent, id_type after);
 
 public:
 
-    void merge_with(Tree const* src, size_t src_node=NONE, size_t dst_root=NONE);
+    void merge_with(Tree const* src, id_type src_node=NONE, id_type dst_root=NONE);
 
     /** @} */
 
@@ -1055,15 +1186,15 @@ public:
 
     struct lookup_result
     {
-        size_t  target;
-        size_t  closest;
+        id_type  target;
+        id_type  closest;
         size_t  path_pos;
         csubstr path;
 
         inline operator bool() const { return target != NONE; }
 
         lookup_result() : target(NONE), closest(NONE), path_pos(0), path() {}
-        lookup_result(csubstr path_, size_t start) : target(NONE), closest(start), path_pos(0), path(path_) {}
+        lookup_result(csubstr path_, id_type start) : target(NONE), closest(start), path_pos(0), path(path_) {}
 
         /** get the part ot the input path that was resolved */
         csubstr resolved() const;
@@ -1072,19 +1203,22 @@ public:
     };
 
     /** for example foo.bar[0].baz */
-    lookup_result lookup_path(csubstr path, size_t start=NONE) const;
+    lookup_result lookup_path(csubstr path, id_type start=NONE) const;
+    /** as the const overload, but the lazy containers on the way to
+     * the target are expanded */
+    lookup_result lookup_path(csubstr path, id_type start=NONE);
 
     /** defaulted lookup: lookup @p path; if the lookup fails, recursively modify
      * the tree so that the corresponding lookup_path() would return the
      * default value.
      * @see lookup_path() */
-    size_t lookup_path_or_modify(csubstr default_value, csubstr path, size_t start=NONE);
+    id_type lookup_path_or_modify(csubstr default_value, csubstr path, id_type start=NONE);
 
     /** defaulted lookup: lookup @p path; if the lookup fails, recursively modify
      * the tree so that the corresponding lookup_path() would return the
      * branch @p src_node (from the tree @p src).
      * @see lookup_path() */
-    size_t lookup_path_or_modify(Tree const *src, size_t src_node, csubstr path, size_t start=NONE);
+    id_type lookup_path_or_modify(Tree const *src, id_type src_node, csubstr path, id_type start=NONE);
 
     /** @} */
 
@@ -1100,13 +1234,14 @@ private:
         bool is_index() const { return value.begins_with('[') && value.ends_with(']'); }
     };
 
-    size_t _lookup_path_or_create(csubstr path, size_t start);
+    id_type _lookup_path_or_create(csubstr path, id_type start);
 
     void   _lookup_path       (lookup_result *r) const;
+    void   _lookup_path       (lookup_result *r);
     void   _lookup_path_modify(lookup_result *r);
 
-    size_t _next_node       (lookup_result *r, _lookup_path_token *parent) const;
-    size_t _next_node_modify(lookup_result *r, _lookup_path_token *parent);
+    id_type _next_node       (lookup_result *r, _lookup_path_token *parent) const;
+    id_type _next_node_modify(lookup_result *r, _lookup_path_token *parent);
 
     void   _advance(lookup_result *r, size_t more) const;
 
@@ -1121,12 +1256,35 @@ private:
 
     void _relocate(substr next_arena);
 
+    /** point m_buf, m_keys and m_vals into a buffer of @p cap nodes */
+    void _set_buf(void *buf, size_t cap);
+
+    /** parse the source of a lazy container into its children,
+     * through the function given to set_lazy() */
+    void _expand_lazy(id_type node);
+    inline void _expand_if_lazy(id_type node)
+    {
+        if(C4_UNLIKELY(_p(node)->m_type & LAZY))
+            _expand_lazy(node);
+    }
+    /** the const hierarchy getters cannot expand a lazy node, so
+     * they fail also in release builds instead of returning an empty
+     * container */
+    inline void _check_not_lazy(id_type node) const
+    {
+        RYML_CHECK_MSG( ! (_p(node)->m_type & LAZY), "lazy node: use the non-const getters or expand_lazy() first");
+    }
+    /** copy to the arena the source of a lazy node copied from
+     * another tree, so that the trees do not parse it both in-situ */
+    void _copy_lazy_src(id_type dst_, Tree const* that_tree);
+    bool _merge_lazy(Tree const *src, id_type src_node, id_type dst_node);
+
 public:
 
     #if ! RYML_USE_ASSERT
     #define _check_next_flags(node, f)
     #else
-    inline void _check_next_flags(size_t node, type_bits f)
+    inline void _check_next_flags(id_type node, type_bits f)
     {
         auto n = _p(node);
         type_bits o = n->m_type; // old
@@ -1159,69 +1317,83 @@ public:
     }
     #endif
 
-    inline void _set_flags(size_t node, NodeType_e f) { _check_next_flags(node, f); _p(node)->m_type = f; }
-    inline void _set_flags(size_t node, type_bits  f) { _check_next_flags(node, f); _p(node)->m_type = f; }
+    inline void _set_flags(id_type node, NodeType_e f) { _check_next_flags(node, f); _p(node)->m_type = f; }
+    inline void _set_flags(id_type node, type_bits  f) { _check_next_flags(node, f); _p(node)->m_type = f; }
 
-    inline void _add_flags(size_t node, NodeType_e f) { NodeData *d = _p(node); type_bits fb = f |  d->m_type; _check_next_flags(node, fb); d->m_type = (NodeType_e) fb; }
-    inline void _add_flags(size_t node, type_bits  f) { NodeData *d = _p(node);                f |= d->m_type; _check_next_flags(node,  f); d->m_type = f; }
+    inline void _add_flags(id_type node, NodeType_e f) { NodeData *d = _p(node); type_bits fb = f |  d->m_type; _check_next_flags(node, fb); d->m_type = (NodeType_e) fb; }
+    inline void _add_flags(id_type node, type_bits  f) { NodeData *d = _p(node);                f |= d->m_type; _check_next_flags(node,  f); d->m_type = f; }
 
-    inline void _rem_flags(size_t node, NodeType_e f) { NodeData *d = _p(node); type_bits fb = d->m_type & ~f; _check_next_flags(node, fb); d->m_type = (NodeType_e) fb; }
-    inline void _rem_flags(size_t node, type_bits  f) { NodeData *d = _p(node);            f = d->m_type & ~f; _check_next_flags(node,  f); d->m_type = f; }
+    inline void _rem_flags(id_type node, NodeType_e f) { NodeData *d = _p(node); type_bits fb = d->m_type & ~f; _check_next_flags(node, fb); d->m_type = (NodeType_e) fb; }
+    inline void _rem_flags(id_type node, type_bits  f) { NodeData *d = _p(node);            f = d->m_type & ~f; _check_next_flags(node,  f); d->m_type = f; }
 
-    void _set_key(size_t node, csubstr const& key, type_bits more_flags=0)
+    void _set_key(id_type node, csubstr const& key, type_bits more_flags=0)
     {
-        _p(node)->m_key.scalar = key;
+        _set_key_scalar(node, key);
         _add_flags(node, KEY|more_flags);
     }
-    void _set_key(size_t node, NodeScalar const& key, type_bits more_flags=0)
+    void _set_key(id_type node, NodeScalar const& key, type_bits more_flags=0)
     {
-        _p(node)->m_key = key;
+        _set_key_scalar(node, key.scalar);
         _add_flags(node, KEY|more_flags);
+        if( ! key.tag.empty())
+            set_key_tag(node, key.tag);
+        if( ! key.anchor.empty())
+            set_key_anchor(node, key.anchor);
     }
 
-    void _set_val(size_t node, csubstr const& val, type_bits more_flags=0)
+    void _set_val(id_type node, csubstr const& val, type_bits more_flags=0)
     {
         RYML_ASSERT(num_children(node) == 0);
         RYML_ASSERT(!is_seq(node) && !is_map(node));
-        _p(node)->m_val.scalar = val;
+        _pv(node).scalar = val;
         _add_flags(node, VAL|more_flags);
     }
-    void _set_val(size_t node, NodeScalar const& val, type_bits more_flags=0)
+    void _set_val(id_type node, NodeScalar const& val, type_bits more_flags=0)
     {
         RYML_ASSERT(num_children(node) == 0);
         RYML_ASSERT( ! is_container(node));
-        _p(node)->m_val = val;
+        _pv(node) = val.scalar;
         _add_flags(node, VAL|more_flags);
+        if( ! val.tag.empty())
+            set_val_tag(node, val.tag);
+        if( ! val.anchor.empty())
+            set_val_anchor(node, val.anchor);
     }
 
-    void _set(size_t node, NodeInit const& i)
+    void _set(id_type node, NodeInit const& i)
     {
         RYML_ASSERT(i._check());
-        NodeData *n = _p(node);
-        RYML_ASSERT(n->m_key.scalar.empty() || i.key.scalar.empty() || i.key.scalar == n->m_key.scalar);
+        NodeScalarData &k = _pk(node);
+        RYML_ASSERT(k.scalar.empty() || i.key.scalar.empty() || i.key.scalar == k.scalar);
         _add_flags(node, i.type);
-        if(n->m_key.scalar.empty())
+        if(k.scalar.empty())
         {
             if( ! i.key.scalar.empty())
             {
                 _set_key(node, i.key.scalar);
             }
         }
-        n->m_key.tag = i.key.tag;
-        n->m_val = i.val;
+        _pv(node) = i.val.scalar;
+        if(i.type & (KEYTAG|VALTAG|VALANCH))
+        {
+            NodeProps &props = _props_get(node);
+            props.key_tag = i.key.tag;
+            props.val_tag = i.val.tag;
+            props.val_anchor = i.val.anchor;
+        }
     }
 
-    void _set_parent_as_container_if_needed(size_t in)
+    void _set_parent_as_container_if_needed(id_type in)
     {
         NodeData const* n = _p(in);
-        size_t ip = parent(in);
+        id_type ip = parent(in);
         if(ip != NONE)
         {
             if( ! (is_seq(ip) || is_map(ip)))
             {
                 if((in == first_child(ip)) && (in == last_child(ip)))
                 {
-                    if( ! n->m_key.empty() || n->has_key())
+                    if( ! _pk(in).empty() || n->has_key())
                     {
                         _add_flags(ip, MAP);
                     }
@@ -1234,120 +1406,299 @@ public:
         }
     }
 
-    void _seq2map(size_t node)
+    void _seq2map(id_type node)
     {
         RYML_ASSERT(is_seq(node));
-        for(size_t i = first_child(node); i != NONE; i = next_sibling(i))
+        for(id_type i = first_child(node); i != NONE; i = next_sibling(i))
         {
             NodeData *C4_RESTRICT ch = _p(i);
             if(ch->m_type.is_keyval()) continue;
             ch->m_type.add(KEY);
-            ch->m_key = ch->m_val;
+            _set_key_scalar(i, _pv(i).scalar);
+            if(ch->m_type & VALTAG)
+            {
+                NodeProps &props = _props_get(i);
+                props.key_tag = props.val_tag;
+                ch->m_type.add(KEYTAG);
+            }
         }
         auto *C4_RESTRICT n = _p(node);
         n->m_type.rem(SEQ);
         n->m_type.add(MAP);
     }
 
-    size_t _do_reorder(size_t *node, size_t count);
+    size_t _do_reorder(id_type *node, size_t count);
 
-    void _swap(size_t n_, size_t m_);
-    void _swap_props(size_t n_, size_t m_);
-    void _swap_hierarchy(size_t n_, size_t m_);
-    void _copy_hierarchy(size_t dst_, size_t src_);
+    void _swap(id_type n_, id_type m_);
+    void _swap_props(id_type n_, id_type m_);
+    void _swap_hierarchy(id_type n_, id_type m_);
+    void _copy_hierarchy(id_type dst_, id_type src_);
 
-    void _copy_props(size_t dst_, size_t src_)
+    void _copy_props(id_type dst_, id_type src_)
     {
+        _expand_if_lazy(src_); // lazy nodes are expanded, not shared
         auto      & C4_RESTRICT dst = *_p(dst_);
         auto const& C4_RESTRICT src = *_p(src_);
         dst.m_type = src.m_type;
-        dst.m_key  = src.m_key;
-        dst.m_val  = src.m_val;
+        _set_key_scalar(dst_, _pk(src_).scalar);
+        _pv(dst_)  = _pv(src_);
+        _copy_node_props(dst_, this, src_, /*with_key*/true);
     }
 
-    void _copy_props_wo_key(size_t dst_, size_t src_)
+    void _copy_props_wo_key(id_type dst_, id_type src_)
     {
+        _expand_if_lazy(src_);
         auto      & C4_RESTRICT dst = *_p(dst_);
         auto const& C4_RESTRICT src = *_p(src_);
         dst.m_type = src.m_type;
-        dst.m_val  = src.m_val;
+        _pv(dst_)  = _pv(src_);
+        _copy_node_props(dst_, this, src_, /*with_key*/false);
     }
 
-    void _copy_props(size_t dst_, Tree const* that_tree, size_t src_)
+    void _copy_props(id_type dst_, Tree const* that_tree, id_type src_)
     {
+        if(that_tree == this)
+            _expand_if_lazy(src_); // lazy nodes are expanded, not shared
         auto      & C4_RESTRICT dst = *_p(dst_);
         auto const& C4_RESTRICT src = *that_tree->_p(src_);
         dst.m_type = src.m_type;
-        dst.m_key  = src.m_key;
-        dst.m_val  = src.m_val;
+        _set_key_scalar(dst_, that_tree->_pk(src_).scalar);
+        _pv(dst_)  = that_tree->_pv(src_);
+        if(src.m_type & LAZY)
+            _copy_lazy_src(dst_, that_tree);
+        _copy_node_props(dst_, that_tree, src_, /*with_key*/true);
     }
 
-    void _copy_props_wo_key(size_t dst_, Tree const* that_tree, size_t src_)
+    void _copy_props_wo_key(id_type dst_, Tree const* that_tree, id_type src_)
     {
+        if(that_tree == this)
+            _expand_if_lazy(src_);
         auto      & C4_RESTRICT dst = *_p(dst_);
         auto const& C4_RESTRICT src = *that_tree->_p(src_);
         dst.m_type = src.m_type;
-        dst.m_val  = src.m_val;
+        _pv(dst_)  = that_tree->_pv(src_);
+        if(src.m_type & LAZY)
+            _copy_lazy_src(dst_, that_tree);
+        _copy_node_props(dst_, that_tree, src_, /*with_key*/false);
     }
 
-    inline void _clear_type(size_t node)
+    void _copy_node_props(id_type dst, Tree const* that_tree, id_type src, bool with_key);
+
+    inline void _clear_type(id_type node)
     {
         _p(node)->m_type = NOTYPE;
     }
 
-    inline void _clear(size_t node)
+    inline void _clear(id_type node)
     {
+        _props_rem_if_set(node);
+        if(m_index_size)
+            _index_rem(node);
         auto *C4_RESTRICT n = _p(node);
         n->m_type = NOTYPE;
-        n->m_key.clear();
-        n->m_val.clear();
+        m_keys[node].clear();
+        m_vals[node].clear();
         n->m_parent = NONE;
         n->m_first_child = NONE;
         n->m_last_child = NONE;
+        n->m_num_children = 0;
     }
 
-    inline void _clear_key(size_t node)
+    inline void _clear_key(id_type node)
     {
-        _p(node)->m_key.clear();
+        _set_key_scalar(node, {});
         _rem_flags(node, KEY);
     }
 
-    inline void _clear_val(size_t node)
+    inline void _clear_val(id_type node)
     {
-        _p(node)->m_key.clear();
+        _set_key_scalar(node, {});
         _rem_flags(node, VAL);
     }
 
+public:
+
+    /** @name node properties
+     *
+     * The tags and anchors of the nodes are in an open-addressing
+     * hash table keyed by node id, so that the nodes which have none
+     * (ie almost all of them) do not pay for them. @see NodeProps
+     *
+     * @{ */
+
+    /** the properties of the node, or nullptr if it has none */
+    NodeProps const* _props(id_type node) const;
+    /** the properties of the node, or nullptr if it has none */
+    NodeProps      * _props(id_type node) { return const_cast<NodeProps*>(static_cast<Tree const*>(this)->_props(node)); }
+    /** the properties of the node, or empty properties if it has none */
+    NodeProps const& _props_of(id_type node) const;
+    /** the properties of the node, adding them if it has none */
+    NodeProps & _props_get(id_type node);
+    /** remove the properties of the node, if it has any */
+    void _props_rem(id_type node);
+    /** remove the properties of the node when any of its property bits is set */
+    void _props_rem_if_set(id_type node) { if(m_props_size && (_p(node)->m_type & _PROPMASK)) _props_rem(node); }
+    /** remove the properties of the node when none of its property bits is set */
+    void _props_rem_if_unused(id_type node) { if(m_props_size && ! (_p(node)->m_type & _PROPMASK)) _props_rem(node); }
+    /** the number of nodes with properties */
+    size_t _props_size() const { return m_props_size; }
+
+    /** @} */
+
+private:
+
+    struct _PropsSlot
+    {
+        id_type   node; ///< NONE for an empty slot
+        NodeProps props;
+    };
+
+    size_t _props_slot(id_type node) const { return (size_t)((uint64_t(node) * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & (m_props_cap - 1); }
+    void   _props_rehash(size_t cap);
+    void   _props_clear();
+    void   _props_free();
+
+public:
+
+    /** @name child index
+     *
+     * A map can have an open-addressing hash index of the keys of
+     * its children, so that find_child() -- and through it
+     * NodeRef::operator[], lookup_path() and merge_with() -- does not
+     * walk the sibling list. Likewise, a container can have an array
+     * with the ids of its children, so that child() -- and through it
+     * NodeRef::operator[](size_t) -- does not walk the sibling list.
+     *
+     * These are in a table of the tree keyed by container id. The
+     * index is kept valid when the children of the map are added,
+     * removed, moved or re-keyed. The array is kept valid when
+     * children are appended or removed from the back, and dropped
+     * by any other change of the children. Neither is copied with
+     * the tree, and both are dropped by clear() and reorder().
+     *
+     * @{ */
+
+    /** build (or rebuild) the index of the children of a map */
+    void build_index(id_type node);
+    /** drop the index of a node, if it has one */
+    void rem_index(id_type node);
+    /** whether the node has an index of its children */
+    bool has_index(id_type node) const;
+
+    /** build (or rebuild) the array of the children of a container */
+    void build_child_ids(id_type node);
+    /** drop the array of the children of a node, if it has one */
+    void rem_child_ids(id_type node);
+    /** whether the node has an array of its children */
+    bool has_child_ids(id_type node) const;
+
+    /** the default of set_index_threshold() */
+    enum : size_t { index_threshold_default = 32 };
+    /** build the index of a map or the array of a container lazily,
+     * when the non-const find_child() or child() walk more than this
+     * number of its children. Zero disables the lazy indices. The
+     * default is index_threshold_default.
+     * @warning so by default the non-const lookups may modify the
+     * tree. The const find_child() and child() never build the
+     * indices: a tree looked up from several threads must be accessed
+     * through a const reference, or have a zero threshold; use
+     * build_index() or build_child_ids() beforehand to index it. */
+    void set_index_threshold(size_t num_children) { m_index_threshold = num_children; }
+    size_t index_threshold() const { return m_index_threshold; }
+
+    /** the number of containers with an index or an array of children */
+    size_t _index_size() const { return m_index_size; }
+
+    /** @} */
+
 private:
 
-    void _clear_range(size_t first, size_t num);
+    struct _IndexEntry
+    {
+        id_type child; ///< NONE for an empty entry
+        size_t  hash;  ///< the hash of the child's key
+    };
 
-    size_t _claim();
+    struct _IndexSlot
+    {
+        id_type      node;    ///< the container; NONE for an empty slot
+        size_t       size;    ///< the number of entries
+        size_t       cap;     ///< a power of two
+        _IndexEntry *entries; ///< the index of the keys; nullptr if not built
+        size_t       ids_cap;
+        id_type     *ids;     ///< the ids of the children, in order; nullptr if not built
+    };
+
+    size_t _index_slot(id_type node) const { return (size_t)((uint64_t(node) * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & (m_index_cap - 1); }
+    _IndexSlot const* _index_find(id_type node) const;
+    _IndexSlot      * _index_find(id_type node) { return const_cast<_IndexSlot*>(static_cast<Tree const*>(this)->_index_find(node)); }
+    _IndexSlot      & _index_get(id_type node);
+    void    _index_rem(id_type node);
+    void    _index_rehash(size_t cap);
+    void    _index_clear();
+    void    _index_free();
+
+    void    _index_insert(_IndexSlot &slot, id_type child, size_t hash);
+    void    _index_erase(_IndexSlot &slot, id_type child, size_t hash);
+    void    _index_resize(_IndexSlot &slot, size_t cap);
+    void    _index_drop_keys(_IndexSlot *slot);
+    void    _index_drop_ids(_IndexSlot *slot);
+    void    _index_reserve_ids(_IndexSlot &slot, size_t cap);
+    id_type _index_lookup(_IndexSlot const& slot, id_type node, csubstr key) const;
+    id_type _find_child(id_type node, csubstr const& key, size_t *num_walked) const;
+
+    void    _index_add_child(id_type child);
+    void    _index_rem_child(id_type child);
+    void    _index_set_key(id_type child, csubstr key);
+
+    /** set the key scalar of a node, keeping the index of its parent */
+    void _set_key_scalar(id_type node, csubstr key) { if(m_index_size) _index_set_key(node, key); else _pk(node).scalar = key; }
+
+private:
+
+    void _clear_range(id_type first, size_t num);
+
+    id_type _claim();
     void   _claim_root();
-    void   _release(size_t node);
-    void   _free_list_add(size_t node);
-    void   _free_list_rem(size_t node);
+    void   _release(id_type node);
+    void   _free_list_add(id_type node);
+    void   _free_list_rem(id_type node);
 
-    void _set_hierarchy(size_t node, size_t parent, size_t after_sibling);
-    void _rem_hierarchy(size_t node);
+    void _set_hierarchy(id_type node, id_type parent, id_type after_sibling);
+    void _rem_hierarchy(id_type node);
 
 public:
 
     // members are exposed, but you should NOT access them directly
 
-    NodeData * m_buf;
+    NodeData * m_buf;  //!< the type and links of the nodes
+    NodeScalarData * m_keys; //!< the key scalars of the nodes, in the same allocation as m_buf
+    NodeScalarData * m_vals; //!< the val scalars of the nodes, in the same allocation as m_buf
     size_t m_cap;
 
     size_t m_size;
 
-    size_t m_free_head;
-    size_t m_free_tail;
+    id_type m_free_head;
+    id_type m_free_tail;
 
     substr m_arena;
     size_t m_arena_pos;
 
     Allocator m_alloc;
 
+    detail::SourceBuffer *m_source; //!< the source buffers owned by the tree, if any
+
+    _PropsSlot *m_props;      //!< the table of node properties. @see NodeProps
+    size_t      m_props_cap;  //!< a power of two, or zero
+    size_t      m_props_size;
+
+    _IndexSlot *m_index;      //!< the table of child indices, keyed by map id. @see build_index()
+    size_t      m_index_cap;  //!< a power of two, or zero
+    size_t      m_index_size;
+    size_t      m_index_threshold; //!< @see set_index_threshold()
+
+    pfn_expand_lazy m_expand_lazy; //!< @see set_lazy()
+
 };
 
 } // namespace yml
@@ -0,0 +1,93 @@
+#include "c4/yml/tree_batch.hpp"
+
+namespace c4 {
+namespace yml {
+
+namespace {
+
+/** grow geometrically, so that appending many small documents does
+ * not reallocate for each one */
+size_t _grown_capacity(size_t cap, size_t needed)
+{
+    cap *= 2;
+    return cap > needed ? cap : needed;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+TreeBatch::TreeBatch(Allocator const& a)
+    : m_parser(a)
+    , m_tree(a)
+    , m_doc_ids(a)
+{
+    _reset_root();
+}
+
+void TreeBatch::clear()
+{
+    m_tree.clear();
+    m_tree.clear_arena();
+    m_doc_ids.clear();
+    _reset_root();
+}
+
+void TreeBatch::reserve(size_t num_docs, size_t num_nodes, size_t arena_size)
+{
+    // the root of the batch takes one node
+    m_tree.reserve(num_nodes + 1);
+    m_tree.reserve_arena(arena_size);
+    if(num_docs > m_doc_ids.capacity())
+        m_doc_ids.reserve(num_docs);
+}
+
+void TreeBatch::shrink()
+{
+    m_tree = Tree(m_tree.allocator());
+    m_doc_ids = detail::stack<id_type>(m_tree.allocator());
+    _reset_root();
+}
+
+void TreeBatch::_reset_root()
+{
+    m_tree.to_seq(m_tree.root_id());
+}
+
+
+//-----------------------------------------------------------------------------
+size_t TreeBatch::parse(csubstr filename, substr src)
+{
+    id_type id = _append_doc(src, 0);
+    m_parser.parse(filename, src, &m_tree, id);
+    return m_doc_ids.size() - 1;
+}
+
+size_t TreeBatch::parse(csubstr filename, csubstr src)
+{
+    id_type id = _append_doc(src, src.len);
+    m_parser.parse(filename, m_tree.copy_to_arena(src), &m_tree, id);
+    return m_doc_ids.size() - 1;
+}
+
+/** make room for the document before appending its node, so that the
+ * parser finds the tree already reserved; otherwise it would reserve
+ * the exact size of each document, reallocating every time */
+id_type TreeBatch::_append_doc(csubstr src, size_t src_copy_len)
+{
+    TreeCapacity cap = estimate_tree_capacity(src);
+    // the node of the document is appended before the parser reserves
+    // the nodes of the source
+    const size_t num_nodes = m_tree.size() + 1 + cap.nodes;
+    const size_t arena_size = m_tree.arena_size() + src_copy_len + cap.arena;
+    if(num_nodes > m_tree.capacity())
+        m_tree.reserve(_grown_capacity(m_tree.capacity(), num_nodes));
+    if(arena_size > m_tree.arena_capacity())
+        m_tree.reserve_arena(_grown_capacity(m_tree.arena_capacity(), arena_size));
+    id_type id = m_tree.append_child(m_tree.root_id());
+    m_doc_ids.push(id);
+    return id;
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,140 @@
+#ifndef _C4_YML_TREE_BATCH_HPP_
+#define _C4_YML_TREE_BATCH_HPP_
+
+#ifndef _C4_YML_PARSE_HPP_
+#include "c4/yml/parse.hpp"
+#endif
+
+#ifndef _C4_YML_NODE_HPP_
+#include "c4/yml/node.hpp"
+#endif
+
+#if defined(_MSC_VER)
+#   pragma warning(push)
+#   pragma warning(disable: 4251/*needs to have dll-interface to be used by clients of struct*/)
+#endif
+
+namespace c4 {
+namespace yml {
+
+
+/** Many small documents parsed into a single tree, for applications
+ * receiving lots of tiny sources (eg the messages of a queue), where
+ * a tree for each source means a node buffer and an arena for each,
+ * and most of the time is spent allocating.
+ *
+ * The documents are the children of the batch tree's root, which is
+ * a sequence, so that all their nodes are in the same node buffer
+ * and all their scalars are in the same arena. Both grow
+ * geometrically, and clear() keeps their memory: once a batch has
+ * seen its largest workload, parsing into it does not allocate.
+ *
+ * @code
+ * TreeBatch batch;
+ * while(queue.receive(&messages))
+ * {
+ *     batch.clear(); // keeps the memory
+ *     for(csubstr msg : messages)
+ *         batch.parse(msg);
+ *     for(NodeRef doc : batch.docs())
+ *         handle(doc["method"].val(), doc["params"]);
+ * }
+ * @endcode
+ *
+ * Each source must have a single implicit document, ie without
+ * document markers. The documents are valid until the batch is
+ * cleared; a batch is not thread safe.
+ */
+class RYML_EXPORT TreeBatch
+{
+public:
+
+    TreeBatch(Allocator const& a={});
+
+    TreeBatch(TreeBatch const&) = delete;
+    TreeBatch(TreeBatch &&) = delete;
+    TreeBatch& operator= (TreeBatch const&) = delete;
+    TreeBatch& operator= (TreeBatch &&) = delete;
+
+public:
+
+    /** @name parse a source into a new document of the batch
+     * @return the index of the new document
+     * @{ */
+
+    /** parse in-situ a modifiable YAML source buffer, which must
+     * outlive the document */
+    size_t parse(csubstr filename,  substr src);
+    /** parse a read-only YAML source buffer, copying it first to the batch's arena */
+    size_t parse(csubstr filename, csubstr src);
+    /** parse in-situ a modifiable YAML source buffer, which must
+     * outlive the document */
+    size_t parse( substr src) { return parse({}, src); }
+    /** parse a read-only YAML source buffer, copying it first to the batch's arena */
+    size_t parse(csubstr src) { return parse({}, src); }
+
+    /** @} */
+
+public:
+
+    /** remove all the documents, keeping the memory of the nodes,
+     * of the arena and of the document ids */
+    void clear();
+
+    /** make room for the given number of documents, nodes and arena
+     * bytes (including the copies of the read-only sources) */
+    void reserve(size_t num_docs, size_t num_nodes, size_t arena_size);
+
+    /** free all the memory of the batch, except the parser's */
+    void shrink();
+
+public:
+
+    /** the number of documents in the batch */
+    size_t size() const { return m_doc_ids.size(); }
+    bool empty() const { return m_doc_ids.empty(); }
+
+    /** the node id of the i-th document */
+    id_type doc_id(size_t i) const { RYML_ASSERT(i < m_doc_ids.size()); return m_doc_ids[i]; }
+
+    /** the i-th document */
+    NodeRef       doc(size_t i)       { return NodeRef(&m_tree, doc_id(i)); }
+    /** the i-th document */
+    NodeRef const doc(size_t i) const { return NodeRef(const_cast<Tree*>(&m_tree), doc_id(i)); }
+
+    NodeRef       operator[] (size_t i)       { return doc(i); }
+    NodeRef const operator[] (size_t i) const { return doc(i); }
+
+    /** iterate over the documents, in the order they were parsed */
+    NodeRef::children_view       docs()       { return m_tree.rootref().children(); }
+    /** iterate over the documents, in the order they were parsed */
+    NodeRef::const_children_view docs() const { return m_tree.rootref().children(); }
+
+    Parser      & parser()       { return m_parser; }
+    Parser const& parser() const { return m_parser; }
+
+    /** the tree with all the documents, as children of its root */
+    Tree      & tree()       { return m_tree; }
+    /** the tree with all the documents, as children of its root */
+    Tree const& tree() const { return m_tree; }
+
+private:
+
+    id_type _append_doc(csubstr src, size_t src_copy_len);
+    void _reset_root();
+
+private:
+
+    Parser m_parser;
+    Tree   m_tree;
+    detail::stack<id_type> m_doc_ids;
+};
+
+} // namespace yml
+} // namespace c4
+
+#if defined(_MSC_VER)
+#   pragma warning(pop)
+#endif
+
+#endif /* _C4_YML_TREE_BATCH_HPP_ */
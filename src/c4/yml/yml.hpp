@@ -5,6 +5,11 @@
 #include "./node.hpp"
 #include "./emit.hpp"
 #include "./parse.hpp"
+#include "./parse_context.hpp"
+#include "./parse_file.hpp"
+#include "./tree_batch.hpp"
+#include "./incremental_parser.hpp"
+#include "./parallel.hpp"
 #include "./preprocess.hpp"
 
 #endif // _C4_YML_YML_HPP_
@@ -407,6 +407,133 @@ far: a long long way to run
 )");
 }
 
+TEST(tree, id_type)
+{
+    static_assert(sizeof(NodeData::m_parent) == sizeof(id_type), "the links must be stored as id_type");
+    static_assert(sizeof(NodeData::m_next_sibling) == sizeof(id_type), "the links must be stored as id_type");
+    EXPECT_EQ(static_cast<id_type>(NONE), static_cast<id_type>(-1));
+    Tree t = parse("{a: [b, c], d: {e: f}}");
+    const id_type root = t.root_id();
+    EXPECT_EQ(t.parent(root), (id_type)NONE);
+    EXPECT_EQ(t.prev_sibling(root), (id_type)NONE);
+    EXPECT_EQ(t.next_sibling(root), (id_type)NONE);
+    const id_type c = t.last_child(t.first_child(root));
+    EXPECT_EQ(t.val(c), "c");
+    EXPECT_EQ(t.first_child(c), (id_type)NONE);
+    EXPECT_EQ(t.next_sibling(c), (id_type)NONE);
+    EXPECT_EQ(t.find_child(root, "x"), (id_type)NONE);
+    EXPECT_FALSE(t.has_child(root, "x"));
+    EXPECT_TRUE(t.has_child(root, "d"));
+    c4::yml::check_invariants(t);
+}
+
+TEST(tree, node_scalars)
+{
+    // the nodes keep only their type, links and number of children;
+    // the scalars are in their own arrays, after the nodes in the
+    // same buffer
+    static_assert(sizeof(NodeData) <= sizeof(NodeType) + 6 * sizeof(id_type), "the node must be only its type, links and number of children");
+    Tree t = parse("{a: b, c: [d, e]}");
+    ASSERT_NE(t.m_keys, nullptr);
+    EXPECT_EQ((void*)t.m_keys, (void*)(t.m_buf + t.m_cap));
+    EXPECT_EQ(t.m_vals, t.m_keys + t.m_cap);
+    const id_type a = t.find_child(t.root_id(), "a");
+    EXPECT_EQ(t._pk(a).scalar, "a");
+    EXPECT_EQ(t._pv(a).scalar, "b");
+    // the scalars follow the nodes when the buffer grows
+    t.reserve(4 * t.capacity());
+    EXPECT_EQ((void*)t.m_keys, (void*)(t.m_buf + t.m_cap));
+    EXPECT_EQ(t.m_vals, t.m_keys + t.m_cap);
+    EXPECT_EQ(t.key(a), "a");
+    EXPECT_EQ(t.val(a), "b");
+    EXPECT_EQ(t.val(t.last_child(t.last_child(t.root_id()))), "e");
+    for(id_type i = t.size(); i < t.capacity(); ++i)
+    {
+        EXPECT_TRUE(t._pk(i).empty());
+        EXPECT_TRUE(t._pv(i).empty());
+    }
+    // and are copied with them
+    Tree cp = t;
+    EXPECT_NE(cp.m_keys, t.m_keys);
+    EXPECT_EQ(cp.key(a), "a");
+    EXPECT_EQ(cp.val(a), "b");
+    EXPECT_EQ(emitrs<std::string>(cp), emitrs<std::string>(t));
+    c4::yml::check_invariants(cp);
+}
+
+TEST(tree, node_props)
+{
+    // the tags and anchors are not stored in the nodes
+    static_assert(sizeof(NodeScalarData) == sizeof(csubstr), "the key and val must be only their scalar");
+    Tree t = parse("a: &x !!str b\nc: *x\nd: !!seq [e, f]\ng: h\n");
+    const std::string expected = emitrs<std::string>(t);
+    EXPECT_EQ(t._props_size(), 3u);
+    EXPECT_EQ(t["a"].val_tag(), "!!str");
+    EXPECT_EQ(t["a"].val_anchor(), "x");
+    EXPECT_EQ(t["a"].valsc().tag, "!!str");
+    EXPECT_EQ(t["a"].valsc().anchor, "x");
+    EXPECT_EQ(t["c"].val_ref(), "x");
+    EXPECT_EQ(t["d"].val_tag(), "!!seq");
+    EXPECT_EQ(t._props(t["g"].id()), nullptr);
+    EXPECT_TRUE(t["g"].valsc().tag.empty());
+    EXPECT_TRUE(t.has_anchor(t["a"].id(), "x"));
+    EXPECT_FALSE(t.has_anchor(t["a"].id(), "y"));
+    // copies and moves take the table
+    {
+        Tree cp = t;
+        EXPECT_EQ(emitrs<std::string>(cp), expected);
+        Tree mv = std::move(cp);
+        EXPECT_EQ(emitrs<std::string>(mv), expected);
+        EXPECT_EQ(mv._props_size(), 3u);
+    }
+    // a removed node takes its properties away from a reused id
+    const id_type d = t["d"].id();
+    t.remove(d);
+    EXPECT_EQ(t._props_size(), 2u);
+    NodeRef z = t.rootref().append_child();
+    ASSERT_EQ(z.id(), d);
+    z << key("z") << "w";
+    EXPECT_FALSE(z.has_val_tag());
+    EXPECT_EQ(t._props(d), nullptr);
+    // the properties in the arena are relocated with it
+    const id_type g = t["g"].id();
+    t.set_val_tag(g, t.copy_to_arena("!!foo"));
+    t.reserve_arena(2 * t.arena_capacity() + 64);
+    EXPECT_TRUE(t.in_arena(t.val_tag(g)));
+    EXPECT_EQ(t.val_tag(g), "!!foo");
+    t.rem_anchor_ref(t["c"].id());
+    EXPECT_EQ(t._props_size(), 2u);
+    t.clear();
+    EXPECT_EQ(t._props_size(), 0u);
+}
+
+TEST(tree, node_props_many)
+{
+    Tree t;
+    NodeRef r = t.rootref();
+    r |= SEQ;
+    std::vector<std::string> tags;
+    for(size_t i = 0; i < 1000; ++i)
+        tags.push_back("!tag" + std::to_string(i));
+    for(std::string const& tag : tags)
+    {
+        NodeRef ch = r.append_child();
+        ch = NodeScalar(to_csubstr(tag), "v");
+    }
+    EXPECT_EQ(t._props_size(), tags.size());
+    // remove every other node, shifting back the entries of the table
+    for(size_t pos = 0; pos < tags.size() / 2; ++pos)
+        t.remove(t.child(r.id(), pos));
+    EXPECT_EQ(t._props_size(), tags.size() / 2);
+    size_t i = 1;
+    for(NodeRef ch : r.children())
+    {
+        EXPECT_EQ(ch.val_tag(), to_csubstr(tags[i]));
+        i += 2;
+    }
+    EXPECT_EQ(i, tags.size() + 1);
+}
+
 
 //-------------------------------------------
 template<class Container, class... Args>
@@ -1555,6 +1682,43 @@ TEST(general, parsing)
     EXPECT_EQ(cmp.first(ret), "foo");
 }
 
+TEST(general, estimate_tree_capacity)
+{
+    csubstr srcs[] = {
+        "",
+        "a",
+        "{foo: 1}",
+        R"({"a":[1,2,3,{"b":[],"c":{}}],"d":"e"})",
+        "[[[[1]]], {a: [b, c]}, {}]",
+        "a: 1\nb:\n  - c\n  -\n    - d\n  - e: f\n    g: h\n",
+        "--- a\n---\nb: c\n--- [d]\n",
+        "? a\n? b\n: c\n",
+        "a: |\n  text\n\n  more text\n# a comment\n\n\n\nb: 'x'\n",
+        "- \"\\L\\P\" \n- \"a\\Lb\"\n",
+    };
+    for(csubstr src : srcs)
+    {
+        SCOPED_TRACE(src);
+        TreeCapacity cap = estimate_tree_capacity(src);
+        // the estimate is reserved up front; for these sources it is
+        // an upper bound, so the tree is never reallocated
+        Tree t = parse(src);
+        EXPECT_LE(t.size(), cap.nodes);
+        EXPECT_EQ(t.capacity(), cap.nodes);
+        std::string buf(src.str, src.len);
+        Tree u = parse(to_substr(buf));
+        EXPECT_LE(u.size(), cap.nodes);
+        EXPECT_EQ(u.capacity(), cap.nodes);
+    }
+    // flow and minified sources are estimated from their tokens, not
+    // from their lines
+    EXPECT_EQ(estimate_tree_capacity(R"({"a":[1,2,3],"b":{"c":4}})").nodes, 2u + 6u + 2u*3u);
+    // and the lines without tokens are not counted
+    EXPECT_EQ(estimate_tree_capacity("a: |\n  1\n  2\n  3\n\n\n# x\n").nodes, 3u);
+    EXPECT_EQ(estimate_tree_capacity("a: b").arena, 0u);
+    EXPECT_GT(estimate_tree_capacity("a: \"\\L\"").arena, 0u);
+}
+
 TEST(general, emitting)
 {
     std::string cmpbuf;
@@ -3,6 +3,26 @@
 namespace c4 {
 namespace yml {
 
+TEST(block_folded, large)
+{
+    // the filtering is linear in the size of the scalar
+    std::string src = "a: >\n";
+    std::string expected;
+    for(size_t i = 0; i < 50000; ++i)
+    {
+        src += "  some\r\n  words\n\n";
+        expected += "some words\n";
+    }
+    src += "b: c\n";
+    Tree t = parse(to_substr(src));
+    EXPECT_EQ(t["a"].val(), to_csubstr(expected));
+    EXPECT_EQ(t["b"].val(), "c");
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
 #define BLOCK_FOLDED_CASES \
     "block folded as seq val, implicit indentation 2", \
     "block folded as map val, implicit indentation 2",\
@@ -3,6 +3,54 @@
 namespace c4 {
 namespace yml {
 
+TEST(block_literal, large)
+{
+    // the filtering is linear in the size of the scalar
+    std::string src = "a: |+\n";
+    std::string expected;
+    for(size_t i = 0; i < 50000; ++i)
+    {
+        src += "  line\r\n    more\n\n";
+        expected += "line\n  more\n\n";
+    }
+    src += "b: c\n";
+    Tree t = parse(to_substr(src));
+    EXPECT_EQ(t["a"].val(), to_csubstr(expected));
+    EXPECT_EQ(t["b"].val(), "c");
+}
+
+TEST(block_literal, chomping)
+{
+    Tree t = parse(R"(- |
+  a
+
+  b
+
+
+- |-
+  a
+
+  b
+
+
+- |+
+  a
+
+  b
+
+
+- end
+)");
+    EXPECT_EQ(t[0].val(), "a\n\nb\n");
+    EXPECT_EQ(t[1].val(), "a\n\nb");
+    EXPECT_EQ(t[2].val(), "a\n\nb\n\n\n");
+    EXPECT_EQ(t[3].val(), "end");
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
 #define BLOCK_LITERAL_CASES \
     "block literal as seq val, implicit indentation 2",\
     "block literal as seq val, implicit indentation 2, chomp=keep",\
@@ -98,23 +98,29 @@ void test_compare(Tree const& a, size_t node_a,
 
 void test_arena_not_shared(Tree const& a, Tree const& b)
 {
-    for(NodeData *n = a.m_buf, *e = a.m_buf + a.m_cap; n != e; ++n)
+    for(id_type i = 0; i < a.m_cap; ++i)
     {
-        EXPECT_FALSE(b.in_arena(n->m_key.scalar)) << n - a.m_buf;
-        EXPECT_FALSE(b.in_arena(n->m_key.tag   )) << n - a.m_buf;
-        EXPECT_FALSE(b.in_arena(n->m_key.anchor)) << n - a.m_buf;
-        EXPECT_FALSE(b.in_arena(n->m_val.scalar)) << n - a.m_buf;
-        EXPECT_FALSE(b.in_arena(n->m_val.tag   )) << n - a.m_buf;
-        EXPECT_FALSE(b.in_arena(n->m_val.anchor)) << n - a.m_buf;
+        EXPECT_FALSE(b.in_arena(a.m_keys[i].scalar)) << i;
+        EXPECT_FALSE(b.in_arena(a.m_vals[i].scalar)) << i;
+        if(NodeProps const* props = a._props(i))
+        {
+            EXPECT_FALSE(b.in_arena(props->key_tag   )) << i;
+            EXPECT_FALSE(b.in_arena(props->key_anchor)) << i;
+            EXPECT_FALSE(b.in_arena(props->val_tag   )) << i;
+            EXPECT_FALSE(b.in_arena(props->val_anchor)) << i;
+        }
     }
-    for(NodeData *n = b.m_buf, *e = b.m_buf + b.m_cap; n != e; ++n)
+    for(id_type i = 0; i < b.m_cap; ++i)
     {
-        EXPECT_FALSE(a.in_arena(n->m_key.scalar)) << n - b.m_buf;
-        EXPECT_FALSE(a.in_arena(n->m_key.tag   )) << n - b.m_buf;
-        EXPECT_FALSE(a.in_arena(n->m_key.anchor)) << n - b.m_buf;
-        EXPECT_FALSE(a.in_arena(n->m_val.scalar)) << n - b.m_buf;
-        EXPECT_FALSE(a.in_arena(n->m_val.tag   )) << n - b.m_buf;
-        EXPECT_FALSE(a.in_arena(n->m_val.anchor)) << n - b.m_buf;
+        EXPECT_FALSE(a.in_arena(b.m_keys[i].scalar)) << i;
+        EXPECT_FALSE(a.in_arena(b.m_vals[i].scalar)) << i;
+        if(NodeProps const* props = b._props(i))
+        {
+            EXPECT_FALSE(a.in_arena(props->key_tag   )) << i;
+            EXPECT_FALSE(a.in_arena(props->key_anchor)) << i;
+            EXPECT_FALSE(a.in_arena(props->val_tag   )) << i;
+            EXPECT_FALSE(a.in_arena(props->val_anchor)) << i;
+        }
     }
 }
 
@@ -327,7 +333,7 @@ void CaseNode::compare_child(yml::NodeRef const& n, size_t pos) const
     if(type & SEQ)
     {
         EXPECT_FALSE(n[pos].has_key());
-        EXPECT_EQ(n[pos].get()->m_key.scalar, children[pos].key);
+        EXPECT_EQ(n.tree()->_pk(n[pos].id()).scalar, children[pos].key);
         auto fch = n.child(pos);
         EXPECT_EQ(fch.get(), n[pos].get());
     }
@@ -439,14 +445,18 @@ void CaseNode::recreate(yml::NodeRef *n) const
     C4_ASSERT( ! n->has_children());
     auto *nd = n->get();
     nd->m_type = type|key_anchor.type|val_anchor.type;
-    nd->m_key.scalar = key;
-    nd->m_key.tag = (key_tag);
-    nd->m_key.anchor = key_anchor.str;
-    nd->m_val.scalar = val;
-    nd->m_val.tag = (val_tag);
-    nd->m_val.anchor = val_anchor.str;
     auto &tree = *n->tree();
     size_t nid = n->id(); // don't use node from now on
+    tree._pk(nid).scalar = key;
+    tree._pv(nid).scalar = val;
+    if( ! key_tag.empty() || ! key_anchor.str.empty() || ! val_tag.empty() || ! val_anchor.str.empty())
+    {
+        NodeProps &props = tree._props_get(nid);
+        props.key_tag = key_tag;
+        props.key_anchor = key_anchor.str;
+        props.val_tag = val_tag;
+        props.val_anchor = val_anchor.str;
+    }
     for(auto const& ch : children)
     {
         size_t id = tree.append_child(nid);
@@ -3,6 +3,113 @@
 namespace c4 {
 namespace yml {
 
+TEST(double_quoted, escapes)
+{
+    Tree t = parse(R"(- "a\tb\0c\a\b\v\f\r\ed"
+- "\x41é\U0001F600😀"
+- "\/\ \"\\\	x"
+- "\q\w"
+)");
+    EXPECT_EQ(t[0].val(), csubstr("a\tb\0c\a\b\v\f\r\x1b" "d", 12));
+    EXPECT_EQ(t[1].val(), "A\xc3\xa9\xf0\x9f\x98\x80\xf0\x9f\x98\x80");
+    EXPECT_EQ(t[2].val(), "/ \"\\\tx");
+    EXPECT_EQ(t[3].val(), "\\q\\w"); // not escapes: kept as they are
+}
+
+TEST(double_quoted, unicode_separators)
+{
+    // \L and \P are longer than their escape, so they may not fit in
+    // the source buffer
+    const char src[] = R"(- "\L\P\N\_"
+- "a\Lb"
+- "\\\\\L\P"
+)";
+    const char *expected[] = {
+        "\xe2\x80\xa8\xe2\x80\xa9\xc2\x85\xc2\xa0",
+        "a\xe2\x80\xa8" "b",
+        "\\\\\xe2\x80\xa8\xe2\x80\xa9",
+    };
+    {
+        Tree t = parse(csubstr(src));
+        for(size_t i = 0; i < 3; ++i)
+            EXPECT_EQ(t[i].val(), to_csubstr(expected[i]));
+    }
+    {
+        std::string buf(src);
+        Tree t = parse(to_substr(buf));
+        for(size_t i = 0; i < 3; ++i)
+            EXPECT_EQ(t[i].val(), to_csubstr(expected[i]));
+    }
+}
+
+TEST(double_quoted, unicode_separators_in_arena)
+{
+    // a source already in the arena of the tree is moved with the
+    // arena when the arena grows to make room for decoding
+    std::string src = "- \"";
+    std::string expected;
+    for(size_t i = 0; i < 100; ++i)
+    {
+        src += "\\L\\P";
+        expected += "\xe2\x80\xa8\xe2\x80\xa9";
+    }
+    src += "\"\n";
+    Tree t;
+    t.reserve_arena(src.size());
+    substr buf = t.copy_to_arena(to_csubstr(src));
+    ASSERT_EQ(t.arena_slack(), 0u);
+    parse(buf, &t);
+    EXPECT_EQ(t[0].val(), to_csubstr(expected));
+    EXPECT_TRUE(t.in_arena(t[0].val()));
+}
+
+TEST(double_quoted, folding)
+{
+    Tree t = parse(R"(- "a  
+   b
+
+   c
+
+
+   d"
+- "e \
+     f\
+  g"
+- "h\t
+  i"
+)");
+    EXPECT_EQ(t[0].val(), "a b\nc\n\nd");
+    EXPECT_EQ(t[1].val(), "e fg");
+    EXPECT_EQ(t[2].val(), "h\t i"); // escaped whitespace is not trimmed
+}
+
+TEST(double_quoted, large)
+{
+    // the decoding is linear in the size of the scalar
+    std::string src = "\"";
+    std::string expected;
+    for(size_t i = 0; i < 50000; ++i)
+    {
+        src += "a\\\"b\\\\c\\n\\u00e9 ";
+        expected += "a\"b\\c\n\xc3\xa9 ";
+    }
+    src += "\"";
+    Tree t = parse(to_substr(src));
+    EXPECT_EQ(t.rootref().val(), to_csubstr(expected));
+}
+
+TEST(double_quoted, invalid_escapes)
+{
+    ExpectError::do_check([]{ parse(csubstr(R"("\xZZ")")); });
+    ExpectError::do_check([]{ parse(csubstr(R"("\u12")")); });
+    ExpectError::do_check([]{ parse(csubstr(R"("\UFFFFFFFF")")); });
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
 #define DOUBLE_QUOTED_CASES                             \
             "dquoted, only text",                       \
             "dquoted, with single quotes",              \
@@ -0,0 +1,210 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/incremental_parser.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace c4 {
+namespace yml {
+
+/** a textual representation of the contents of a node, ignoring the
+ * stream and doc structure */
+void canon(Tree const& t, size_t node, std::string *out)
+{
+    if(t.has_key(node))
+    {
+        out->append(t.key(node).str, t.key(node).len);
+        *out += ": ";
+    }
+    if(t.is_map(node) || t.is_seq(node))
+    {
+        *out += t.is_seq(node) ? "[" : "{";
+        for(size_t ch = t.first_child(node); ch != NONE; ch = t.next_sibling(ch))
+        {
+            canon(t, ch, out);
+            *out += ", ";
+        }
+        *out += t.is_seq(node) ? "]" : "}";
+    }
+    else if(t.has_val(node))
+    {
+        out->append(t.val(node).str, t.val(node).len);
+    }
+}
+
+/** get the docs of a tree parsed from a full stream */
+std::vector<std::string> stream_docs(Tree const& t)
+{
+    std::vector<std::string> docs;
+    size_t root = t.root_id();
+    if(t.is_stream(root))
+    {
+        for(size_t ch = t.first_child(root); ch != NONE; ch = t.next_sibling(ch))
+        {
+            docs.emplace_back();
+            canon(t, ch, &docs.back());
+        }
+    }
+    else if(t.type(root) != NOTYPE)
+    {
+        docs.emplace_back();
+        canon(t, root, &docs.back());
+    }
+    return docs;
+}
+
+/** get the single doc of a tree parsed from a doc */
+std::string single_doc(Tree const& t)
+{
+    std::vector<std::string> docs = stream_docs(t);
+    EXPECT_EQ(docs.size(), 1u);
+    return docs.empty() ? std::string() : docs[0];
+}
+
+std::vector<std::string> parse_in_chunks(csubstr src, size_t chunk_size)
+{
+    std::vector<std::string> docs;
+    IncrementalParser ip;
+    Tree t;
+    for(size_t pos = 0; pos < src.len; pos += chunk_size)
+    {
+        ip.feed(src.sub(pos, pos + chunk_size < src.len ? chunk_size : src.len - pos));
+        while(ip.next_doc(&t))
+            docs.emplace_back(single_doc(t));
+    }
+    ip.finish();
+    while(ip.next_doc(&t))
+        docs.emplace_back(single_doc(t));
+    EXPECT_EQ(ip.buffered_size(), 0u);
+    return docs;
+}
+
+void test_chunks(csubstr src)
+{
+    SCOPED_TRACE(src);
+    Tree t = parse(src);
+    std::vector<std::string> expected = stream_docs(t);
+    for(size_t chunk_size : {(size_t)1, (size_t)2, (size_t)3, (size_t)7, (size_t)16, src.len ? src.len : (size_t)1})
+    {
+        SCOPED_TRACE(chunk_size);
+        std::vector<std::string> actual = parse_in_chunks(src, chunk_size);
+        EXPECT_EQ(actual, expected);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(IncrementalParser, empty)
+{
+    IncrementalParser ip;
+    Tree t;
+    ip.feed("");
+    EXPECT_FALSE(ip.next_doc(&t));
+    ip.finish();
+    EXPECT_TRUE(ip.finished());
+    EXPECT_FALSE(ip.next_doc(&t));
+}
+
+TEST(IncrementalParser, single_doc)
+{
+    test_chunks("a: 1\nb: [2, 3]\nc:\n  - d\n  - e\n");
+    test_chunks("a: 1\nb: 2"); // no newline at the end
+    test_chunks("- a\n- b\n");
+}
+
+TEST(IncrementalParser, multiple_docs)
+{
+    test_chunks("a: 1\n---\nb: 2\n---\n- c\n- d\n");
+    test_chunks("---\na: 1\n---\nb: 2\n");
+    test_chunks("--- a\n--- b\n--- [c, d]\n");
+    test_chunks("a: 1\n...\n---\nb: 2\n...\n");
+}
+
+TEST(IncrementalParser, comments_are_not_docs)
+{
+    test_chunks("# a comment\n---\na: 1\n# another\n---\nb: 2\n# the end\n");
+}
+
+TEST(IncrementalParser, block_scalars)
+{
+    test_chunks(R"(a: |
+  line one
+  --- not a marker
+  line three
+b: >
+  folded
+  text
+---
+c: "multi
+  line ... quoted"
+)");
+}
+
+TEST(IncrementalParser, docs_are_available_early)
+{
+    IncrementalParser ip;
+    Tree t;
+    ip.feed("a: 1\n-");
+    EXPECT_EQ(ip.num_pending_docs(), 0u);
+    ip.feed("--\nb: ");
+    ASSERT_EQ(ip.num_pending_docs(), 1u);
+    ASSERT_TRUE(ip.next_doc(&t));
+    EXPECT_EQ(t["a"].val(), "1");
+    EXPECT_FALSE(ip.next_doc(&t));
+    ip.feed("2\n");
+    EXPECT_FALSE(ip.next_doc(&t));
+    ip.finish();
+    ASSERT_TRUE(ip.next_doc(&t));
+    EXPECT_EQ(single_doc(t), "{b: 2, }");
+}
+
+TEST(IncrementalParser, trees_own_their_text)
+{
+    IncrementalParser ip;
+    Tree t;
+    ip.feed("a: 1\n---\n");
+    ASSERT_TRUE(ip.next_doc(&t));
+    ip.feed("b: 2\n---\nc: 3\n");
+    // feeding more moved the buffered text, but the tree is still valid
+    EXPECT_EQ(single_doc(t), "{a: 1, }");
+}
+
+TEST(IncrementalParser, memory_is_bounded_by_doc_size)
+{
+    IncrementalParser ip;
+    Tree t;
+    std::string doc = "---\nkey: [a, b, c]\nother: value\n";
+    size_t max_buffered = 0;
+    for(size_t i = 0; i < 1000; ++i)
+    {
+        ip.feed(to_csubstr(doc));
+        if(ip.buffered_size() > max_buffered)
+            max_buffered = ip.buffered_size();
+        while(ip.next_doc(&t))
+            EXPECT_EQ(single_doc(t), "{key: [a, b, c, ], other: value, }");
+    }
+    ip.finish();
+    EXPECT_TRUE(ip.next_doc(&t));
+    EXPECT_FALSE(ip.next_doc(&t));
+    EXPECT_LE(max_buffered, 2 * doc.size());
+}
+
+TEST(IncrementalParser, reset)
+{
+    IncrementalParser ip;
+    Tree t;
+    ip.feed("a: 1\n---\nb: 2\n");
+    ip.finish();
+    ip.reset();
+    EXPECT_FALSE(ip.finished());
+    EXPECT_FALSE(ip.next_doc(&t));
+    ip.feed("c: 3\n");
+    ip.finish();
+    ASSERT_TRUE(ip.next_doc(&t));
+    EXPECT_EQ(single_doc(t), "{c: 3, }");
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,387 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/std/vector.hpp"
+#include "c4/yml/tree.hpp"
+#include "c4/yml/node.hpp"
+#include "c4/yml/parse.hpp"
+#include "c4/yml/emit.hpp"
+#include "c4/yml/detail/checks.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace c4 {
+namespace yml {
+
+namespace {
+
+/** find_child() without the index */
+id_type _find_linear(Tree const& t, id_type node, csubstr key)
+{
+    for(id_type ch = t.first_child(node); ch != NONE; ch = t.next_sibling(ch))
+        if(t.key(ch) == key)
+            return ch;
+    return NONE;
+}
+
+void _check_lookups(Tree const& t, id_type node)
+{
+    for(id_type ch = t.first_child(node); ch != NONE; ch = t.next_sibling(ch))
+    {
+        EXPECT_EQ(t.find_child(node, t.key(ch)), _find_linear(t, node, t.key(ch))) << t.key(ch);
+    }
+    EXPECT_EQ(t.find_child(node, "nope"), (id_type)NONE);
+    EXPECT_EQ(t.find_child(node, ""), _find_linear(t, node, ""));
+}
+
+std::string _big_map(size_t num_keys)
+{
+    std::string src;
+    for(size_t i = 0; i < num_keys; ++i)
+        src += "key" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+    return src;
+}
+
+} // namespace
+
+TEST(index, build)
+{
+    std::string src = _big_map(1000);
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    EXPECT_FALSE(t.has_index(root));
+    t.build_index(root);
+    EXPECT_TRUE(t.has_index(root));
+    EXPECT_EQ(t._index_size(), 1u);
+    _check_lookups(t, root);
+    EXPECT_EQ(t.val(t.find_child(root, "key777")), "777");
+    EXPECT_EQ(t["key999"].val(), "999");
+    // rebuilding is fine
+    t.build_index(root);
+    EXPECT_EQ(t._index_size(), 1u);
+    _check_lookups(t, root);
+    t.rem_index(root);
+    EXPECT_FALSE(t.has_index(root));
+    EXPECT_EQ(t._index_size(), 0u);
+    _check_lookups(t, root);
+}
+
+TEST(index, empty_map)
+{
+    Tree t = parse("{a: {}, b: c}");
+    const id_type a = t.find_child(t.root_id(), "a");
+    t.build_index(a);
+    EXPECT_TRUE(t.has_index(a));
+    EXPECT_EQ(t.find_child(a, "x"), (id_type)NONE);
+    t[0]["x"] = "y";
+    EXPECT_EQ(t.find_child(a, "x"), t.first_child(a));
+}
+
+TEST(index, mutations)
+{
+    std::string src = _big_map(200);
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    t.build_index(root);
+    // append_child + set key
+    NodeRef r = t.rootref();
+    for(size_t i = 200; i < 400; ++i)
+        r[t.copy_to_arena(to_csubstr("key" + std::to_string(i)))] << i;
+    EXPECT_EQ(t.num_children(root), 400u);
+    EXPECT_TRUE(t.has_index(root));
+    _check_lookups(t, root);
+    EXPECT_EQ(t["key399"].val(), "399");
+    // remove
+    t.remove(t.find_child(root, "key0"));
+    t.remove(t.find_child(root, "key150"));
+    t.remove(t.last_child(root));
+    EXPECT_EQ(t.find_child(root, "key0"), (id_type)NONE);
+    EXPECT_EQ(t.find_child(root, "key150"), (id_type)NONE);
+    EXPECT_EQ(t.find_child(root, "key399"), (id_type)NONE);
+    _check_lookups(t, root);
+    // set_key
+    id_type ch = t.find_child(root, "key10");
+    t.set_key(ch, "renamed");
+    EXPECT_EQ(t.find_child(root, "key10"), (id_type)NONE);
+    EXPECT_EQ(t.find_child(root, "renamed"), ch);
+    _check_lookups(t, root);
+    // move within the map
+    ch = t.find_child(root, "key20");
+    t.move(ch, root, NONE);
+    EXPECT_EQ(t.first_child(root), ch);
+    EXPECT_EQ(t.find_child(root, "key20"), ch);
+    _check_lookups(t, root);
+    // move to another map
+    id_type other = t.append_child(root);
+    t.to_map(other, "other");
+    t.build_index(other);
+    t.move(ch, other, NONE);
+    EXPECT_EQ(t.find_child(root, "key20"), (id_type)NONE);
+    EXPECT_EQ(t.find_child(other, "key20"), ch);
+    _check_lookups(t, root);
+    _check_lookups(t, other);
+    // the index of a removed map is dropped
+    EXPECT_EQ(t._index_size(), 2u);
+    t.remove(other);
+    EXPECT_EQ(t._index_size(), 1u);
+    // and so is the index of a map whose children are removed
+    t.remove_children(root);
+    EXPECT_FALSE(t.has_index(root));
+    EXPECT_EQ(t.find_child(root, "key20"), (id_type)NONE);
+    c4::yml::check_invariants(t);
+}
+
+TEST(index, duplicate_keys)
+{
+    Tree t = parse("{a: 0, b: 1, a: 2, c: 3, b: 4}");
+    const id_type root = t.root_id();
+    t.build_index(root);
+    // the first in the order of the children, as without the index
+    EXPECT_EQ(t.val(t.find_child(root, "a")), "0");
+    EXPECT_EQ(t.val(t.find_child(root, "b")), "1");
+    t.remove(t.first_child(root));
+    EXPECT_EQ(t.val(t.find_child(root, "a")), "2");
+    t.move(t.last_child(root), root, NONE);
+    EXPECT_EQ(t.val(t.find_child(root, "b")), "4");
+    _check_lookups(t, root);
+}
+
+TEST(index, threshold)
+{
+    std::string src = _big_map(100);
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    EXPECT_EQ(t.index_threshold(), (size_t)Tree::index_threshold_default);
+    // by default, a long walk builds the index
+    EXPECT_NE(t.find_child(root, "key99"), (id_type)NONE);
+    EXPECT_TRUE(t.has_index(root));
+    _check_lookups(t, root);
+    t.rem_index(root);
+    // unless the lazy indices are disabled
+    t.set_index_threshold(0);
+    EXPECT_NE(t.find_child(root, "key99"), (id_type)NONE);
+    EXPECT_FALSE(t.has_index(root));
+    t.set_index_threshold(50);
+    // a short walk does not build the index
+    EXPECT_NE(t.find_child(root, "key10"), (id_type)NONE);
+    EXPECT_FALSE(t.has_index(root));
+    // nor does a long walk through the const tree
+    Tree const& ct = t;
+    EXPECT_NE(ct.find_child(root, "key60"), (id_type)NONE);
+    EXPECT_EQ(ct.find_child(root, "nope"), (id_type)NONE);
+    EXPECT_FALSE(t.has_index(root));
+    // a long walk does
+    EXPECT_NE(t.find_child(root, "key60"), (id_type)NONE);
+    EXPECT_TRUE(t.has_index(root));
+    _check_lookups(t, root);
+    // the threshold is copied, but not the indices
+    Tree cp = t;
+    EXPECT_EQ(cp.index_threshold(), 50u);
+    EXPECT_FALSE(cp.has_index(root));
+    EXPECT_EQ(cp["key42"].val(), "42");
+}
+
+TEST(index, clear_and_reorder)
+{
+    std::string src = "{first: 0, m: {" + std::string("x: 0, y: 1, z: 2") + "}, last: 1}";
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    const id_type m = t.find_child(root, "m");
+    t.build_index(root);
+    t.build_index(m);
+    EXPECT_EQ(t._index_size(), 2u);
+    // make the ids out of order
+    t.move(t.find_child(root, "first"), root, t.last_child(root));
+    t.reorder();
+    EXPECT_EQ(t._index_size(), 0u);
+    EXPECT_EQ(t["m"]["z"].val(), "2");
+    EXPECT_EQ(t["first"].val(), "0");
+    t.build_index(root);
+    t.clear();
+    EXPECT_EQ(t._index_size(), 0u);
+    // moving the tree keeps the indices
+    Tree u = parse(to_csubstr(src));
+    u.build_index(u.root_id());
+    Tree v = std::move(u);
+    EXPECT_TRUE(v.has_index(v.root_id()));
+    EXPECT_EQ(v["last"].val(), "1");
+}
+
+TEST(index, merge)
+{
+    std::string src1 = _big_map(300);
+    std::string src2;
+    for(size_t i = 150; i < 450; ++i)
+        src2 += "key" + std::to_string(i) + ": v" + std::to_string(i) + "\n";
+    Tree dst = parse(to_csubstr(src1));
+    Tree src = parse(to_csubstr(src2));
+    dst.merge_with(&src);
+    // the index used for the merge is dropped
+    EXPECT_EQ(dst._index_size(), 0u);
+    EXPECT_EQ(dst.rootref().num_children(), 450u);
+    EXPECT_EQ(dst["key0"].val(), "0");
+    EXPECT_EQ(dst["key149"].val(), "149");
+    EXPECT_EQ(dst["key150"].val(), "v150");
+    EXPECT_EQ(dst["key449"].val(), "v449");
+    // the same as merging without the index
+    std::string expected_src;
+    for(size_t i = 0; i < 150; ++i)
+        expected_src += "key" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+    expected_src += src2;
+    Tree expected = parse(to_csubstr(expected_src));
+    EXPECT_EQ(emitrs<std::string>(dst), emitrs<std::string>(expected));
+}
+
+void _check_positions(Tree const& t, id_type node)
+{
+    size_t pos = 0;
+    for(id_type ch = t.first_child(node); ch != NONE; ch = t.next_sibling(ch), ++pos)
+    {
+        EXPECT_EQ(t.child(node, pos), ch) << pos;
+        EXPECT_EQ(t.child_pos(node, ch), pos);
+    }
+    EXPECT_EQ(t.num_children(node), pos);
+    EXPECT_EQ(t.child(node, pos), (id_type)NONE);
+    EXPECT_EQ(t.child_pos(node, node), npos);
+}
+
+TEST(child_ids, num_children)
+{
+    Tree t = parse("{a: [0, 1, 2], b: {c: d}, e: f}");
+    const id_type root = t.root_id();
+    const id_type a = t.first_child(root);
+    EXPECT_EQ(t.num_children(root), 3u);
+    EXPECT_EQ(t.num_children(a), 3u);
+    EXPECT_EQ(t.num_children(t.last_child(root)), 0u);
+    t[0].append_child() << 3;
+    EXPECT_EQ(t.num_children(a), 4u);
+    t.remove(t.first_child(a));
+    t.remove(t.first_child(root));
+    EXPECT_EQ(t.num_children(root), 2u);
+    const id_type b = t.first_child(root);
+    t.move(t.first_child(b), root, NONE);
+    EXPECT_EQ(t.num_children(root), 3u);
+    EXPECT_EQ(t.num_children(b), 0u);
+    t.reorder();
+    EXPECT_EQ(t.num_children(t.root_id()), 3u);
+    c4::yml::check_invariants(t);
+    t.remove_children(t.root_id());
+    EXPECT_EQ(t.num_children(t.root_id()), 0u);
+    c4::yml::check_invariants(t);
+}
+
+TEST(child_ids, build)
+{
+    std::string src;
+    for(size_t i = 0; i < 500; ++i)
+        src += "- " + std::to_string(i) + "\n";
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    _check_positions(t, root);
+    t.build_child_ids(root);
+    EXPECT_TRUE(t.has_child_ids(root));
+    EXPECT_FALSE(t.has_index(root));
+    _check_positions(t, root);
+    EXPECT_EQ(t.rootref()[321].val(), "321");
+    std::vector<int> vec;
+    t.rootref() >> vec;
+    ASSERT_EQ(vec.size(), 500u);
+    EXPECT_EQ(vec[499], 499);
+    t.rem_child_ids(root);
+    EXPECT_FALSE(t.has_child_ids(root));
+    EXPECT_EQ(t._index_size(), 0u);
+    _check_positions(t, root);
+}
+
+TEST(child_ids, mutations)
+{
+    std::string src;
+    for(size_t i = 0; i < 100; ++i)
+        src += "- " + std::to_string(i) + "\n";
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    t.build_child_ids(root);
+    // appending and removing the last child keep the array
+    for(size_t i = 100; i < 300; ++i)
+        t.rootref().append_child() << i;
+    EXPECT_TRUE(t.has_child_ids(root));
+    _check_positions(t, root);
+    EXPECT_EQ(t.val(t.child(root, 299)), "299");
+    t.remove(t.last_child(root));
+    EXPECT_TRUE(t.has_child_ids(root));
+    EXPECT_EQ(t.child(root, 299), (id_type)NONE);
+    _check_positions(t, root);
+    // other changes drop it
+    t.remove(t.first_child(root));
+    EXPECT_FALSE(t.has_child_ids(root));
+    EXPECT_EQ(t.val(t.child(root, 0)), "1");
+    _check_positions(t, root);
+    t.build_child_ids(root);
+    t.rootref().prepend_child() << "first";
+    EXPECT_FALSE(t.has_child_ids(root));
+    EXPECT_EQ(t.val(t.child(root, 0)), "first");
+    _check_positions(t, root);
+    t.build_child_ids(root);
+    t.move(t.child(root, 5), root, t.child(root, 10));
+    EXPECT_FALSE(t.has_child_ids(root));
+    _check_positions(t, root);
+    EXPECT_EQ(t._index_size(), 0u);
+}
+
+TEST(child_ids, with_index)
+{
+    std::string src = _big_map(100);
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    t.set_index_threshold(0); // only the explicit indices
+    t.build_index(root);
+    t.build_child_ids(root);
+    EXPECT_EQ(t._index_size(), 1u);
+    t["key100"] << 100;
+    EXPECT_TRUE(t.has_index(root));
+    EXPECT_TRUE(t.has_child_ids(root));
+    _check_lookups(t, root);
+    _check_positions(t, root);
+    // dropping the array keeps the index
+    t.remove(t.first_child(root));
+    EXPECT_TRUE(t.has_index(root));
+    EXPECT_FALSE(t.has_child_ids(root));
+    _check_lookups(t, root);
+    // and the other way around
+    t.build_child_ids(root);
+    t.rem_index(root);
+    EXPECT_FALSE(t.has_index(root));
+    EXPECT_TRUE(t.has_child_ids(root));
+    EXPECT_EQ(t.find_child(root, "key50"), t.child(root, 49));
+    t.rem_child_ids(root);
+    EXPECT_EQ(t._index_size(), 0u);
+}
+
+TEST(child_ids, threshold)
+{
+    std::string src;
+    for(size_t i = 0; i < 100; ++i)
+        src += "- " + std::to_string(i) + "\n";
+    Tree t = parse(to_csubstr(src));
+    const id_type root = t.root_id();
+    // by default, a long walk builds the array
+    EXPECT_EQ(t.val(t.child(root, 90)), "90");
+    EXPECT_TRUE(t.has_child_ids(root));
+    _check_positions(t, root);
+    t.rem_child_ids(root);
+    // unless the lazy indices are disabled
+    t.set_index_threshold(0);
+    EXPECT_EQ(t.val(t.child(root, 90)), "90");
+    EXPECT_FALSE(t.has_child_ids(root));
+    t.set_index_threshold(50);
+    EXPECT_EQ(t.val(t.child(root, 10)), "10");
+    EXPECT_FALSE(t.has_child_ids(root));
+    Tree const& ct = t;
+    EXPECT_EQ(ct.val(ct.child(root, 60)), "60");
+    EXPECT_FALSE(t.has_child_ids(root));
+    EXPECT_EQ(t.val(t.child(root, 60)), "60");
+    EXPECT_TRUE(t.has_child_ids(root));
+    _check_positions(t, root);
+}
+
+} // namespace yml
+} // namespace c4
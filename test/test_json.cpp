@@ -0,0 +1,176 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parse.hpp"
+#include "c4/yml/emit.hpp"
+#include "c4/yml/preprocess.hpp"
+#include <gtest/gtest.h>
+
+#include "./test_case.hpp"
+
+namespace c4 {
+namespace yml {
+
+void compare_nodes(Tree const& a, size_t na, Tree const& b, size_t nb)
+{
+    EXPECT_EQ(a.type(na), b.type(nb));
+    if(a.has_key(na) && b.has_key(nb))
+        EXPECT_EQ(a.key(na), b.key(nb));
+    if(a.has_val(na) && b.has_val(nb))
+        EXPECT_EQ(a.val(na), b.val(nb));
+    ASSERT_EQ(a.num_children(na), b.num_children(nb));
+    for(size_t cha = a.first_child(na), chb = b.first_child(nb);
+        cha != NONE && chb != NONE;
+        cha = a.next_sibling(cha), chb = b.next_sibling(chb))
+    {
+        compare_nodes(a, cha, b, chb);
+    }
+}
+
+/** the JSON parser must give the same tree as the YAML parser on the
+ * preprocessed JSON */
+void test_json(csubstr json)
+{
+    SCOPED_TRACE(json);
+    std::string yaml = preprocess_json<std::string>(json);
+    Tree expected = parse(to_csubstr(yaml));
+    {
+        Tree actual = parse_json(json);
+        compare_nodes(expected, expected.root_id(), actual, actual.root_id());
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+    {
+        std::string buf(json.str, json.len);
+        Tree actual = parse_json(to_substr(buf));
+        compare_nodes(expected, expected.root_id(), actual, actual.root_id());
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(parse_json, same_as_parse)
+{
+    test_json(R"({})");
+    test_json(R"([])");
+    test_json(R"({"a": 1, "b": "2", "c": true, "d": null})");
+    test_json(R"({"a":1,"b":"2","c":false})");
+    test_json(R"([1, "2", 3.5, -4e10, true, null])");
+    test_json(R"({"a": {"b": {"c": [1, {"d": []}, {}]}}, "e": [[1, 2], [3]]})");
+    test_json(R"([{"a": 1}, {"b": [2, 3]}, [], {}])");
+    test_json(R"({
+    "a": [
+        1,
+        2
+    ],
+    "b": {
+        "c": "d"
+    }
+}
+)");
+    test_json(R"({"a": "", "b": [""]})");
+}
+
+TEST(parse_json, strings)
+{
+    test_json(R"({"a": "b}", "c": "{d", "e": "[f]", "g": "h,i", "j": "k: l"})");
+    test_json(R"({"a": "with \"quotes\"", "b": "back\\slash", "c": "new\nline"})");
+    test_json(R"({"a\"b": "c\\d"})");
+    test_json(R"(["#not a comment", "&not_an_anchor", "*not_a_ref", "!not_a_tag", "- x", "| y"])");
+}
+
+TEST(parse_json, escapes_are_filtered)
+{
+    Tree t = parse_json(R"({"a": "x\"y", "b": "1\\2", "c": "p\nq"})");
+    EXPECT_EQ(t["a"].val(), "x\"y");
+    EXPECT_EQ(t["b"].val(), "1\\2");
+    EXPECT_EQ(t["c"].val(), "p\nq");
+    size_t a = t.find_child(t.root_id(), "a");
+    EXPECT_TRUE(t.is_key_quoted(a));
+    EXPECT_TRUE(t.is_val_quoted(a));
+}
+
+TEST(parse_json, into_node)
+{
+    Tree t = parse("a: 1\nb: {}\n");
+    size_t b = t.find_child(t.root_id(), "b");
+    ASSERT_NE(b, NONE);
+    Parser p;
+    p.parse_json({}, csubstr(R"({"c": [3, 4]})"), &t, b);
+    EXPECT_EQ(t["a"].val(), "1");
+    EXPECT_EQ(t["b"].key(), "b");
+    EXPECT_EQ(t["b"]["c"][1].val(), "4");
+}
+
+TEST(parse_json, into_keyed_node)
+{
+    // the node was not a container: it must keep its key
+    Tree t = parse("a: 1\nb: 2\n\"c\": 3\n");
+    Parser p;
+    size_t a = t.find_child(t.root_id(), "a");
+    size_t b = t.find_child(t.root_id(), "b");
+    size_t c = t.find_child(t.root_id(), "c");
+    p.parse_json({}, csubstr(R"({"d": 4})"), &t, a);
+    p.parse_json({}, csubstr(R"([5, 6])"), &t, b);
+    p.parse_json({}, csubstr(R"("seven")"), &t, c);
+    ASSERT_TRUE(t.is_map(a));
+    EXPECT_EQ(t.key(a), "a");
+    EXPECT_EQ(t["a"]["d"].val(), "4");
+    ASSERT_TRUE(t.is_seq(b));
+    EXPECT_EQ(t.key(b), "b");
+    EXPECT_EQ(t["b"][1].val(), "6");
+    ASSERT_TRUE(t.is_keyval(c));
+    EXPECT_EQ(t.key(c), "c");
+    EXPECT_TRUE(t.is_key_quoted(c));
+    EXPECT_EQ(t.val(c), "seven");
+    EXPECT_TRUE(t.is_val_quoted(c));
+}
+
+TEST(parse_json, root_scalars)
+{
+    test_json(R"("a string")");
+    test_json(R"("")");
+    test_json(R"(123)");
+    test_json(R"(true)");
+    Tree t = parse_json(R"("a string")");
+    EXPECT_TRUE(t.is_doc(t.root_id()));
+    EXPECT_TRUE(t.is_val_quoted(t.root_id()));
+    EXPECT_EQ(t.val(t.root_id()), "a string");
+    t = parse_json(R"(123)");
+    EXPECT_FALSE(t.is_val_quoted(t.root_id()));
+}
+
+TEST(parse_json, detect_json)
+{
+    csubstr json = R"({"a": [1, 2]})";
+    Parser p;
+    EXPECT_FALSE(p.detect_json());
+    p.set_detect_json(true);
+    Tree t = p.parse("file.json", json);
+    EXPECT_EQ(t["a"][1].val(), "2");
+    Tree expected = parse(json);
+    compare_nodes(expected, expected.root_id(), t, t.root_id());
+}
+
+TEST(parse_json, terminating_null)
+{
+    std::string buf = R"({"a": 1})";
+    buf.push_back('\0');
+    Tree t = parse_json(to_substr(buf));
+    EXPECT_EQ(t["a"].val(), "1");
+}
+
+TEST(parse_json, errors)
+{
+    ExpectError::do_check([]{ parse_json(csubstr(R"({"a": 1)")); });
+    ExpectError::do_check([]{ parse_json(csubstr(R"({"a": 1,})")); });
+    ExpectError::do_check([]{ parse_json(csubstr(R"([1, 2,])")); });
+    ExpectError::do_check([]{ parse_json(csubstr(R"({"a" 1})")); });
+    ExpectError::do_check([]{ parse_json(csubstr(R"({a: 1})")); });
+    ExpectError::do_check([]{ parse_json(csubstr(R"([1 2])")); });
+    ExpectError::do_check([]{ parse_json(csubstr(R"(["a)")); });
+    ExpectError::do_check([]{ parse_json(csubstr(R"({"a": 1}})")); });
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,421 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parse.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+#include "./test_case.hpp"
+
+namespace c4 {
+namespace yml {
+
+/** b is not const, so that its lazy nodes are expanded on access */
+void compare_nodes(Tree const& a, size_t na, Tree & b, size_t nb)
+{
+    EXPECT_EQ(a.type(na), b.type(nb));
+    if(a.has_key(na) && b.has_key(nb))
+    {
+        EXPECT_EQ(a.key(na), b.key(nb));
+        EXPECT_EQ(a.is_key_quoted(na), b.is_key_quoted(nb));
+    }
+    if(a.has_val(na) && b.has_val(nb))
+        EXPECT_EQ(a.val(na), b.val(nb));
+    ASSERT_EQ(a.num_children(na), b.num_children(nb));
+    for(size_t cha = a.first_child(na), chb = b.first_child(nb);
+        cha != NONE && chb != NONE;
+        cha = a.next_sibling(cha), chb = b.next_sibling(chb))
+    {
+        compare_nodes(a, cha, b, chb);
+    }
+}
+
+void test_lazy(csubstr src)
+{
+    SCOPED_TRACE(src);
+    Tree expected = parse(src);
+    {
+        Tree actual = parse_lazy(src);
+        compare_nodes(expected, expected.root_id(), actual, actual.root_id());
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+    {
+        std::string buf(src.str, src.len);
+        Tree actual = parse_lazy(to_substr(buf));
+        actual.expand_lazy_all();
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(parse_lazy, containers_are_not_parsed)
+{
+    Tree t = parse_lazy(R"(a:
+  b: 1
+  c: [2, 3]
+d: {e: f}
+g: h
+i:
+- j
+- k
+)");
+    size_t root = t.root_id();
+    EXPECT_FALSE(t.is_lazy(root));
+    size_t a = t.find_child(root, "a");
+    size_t d = t.find_child(root, "d");
+    size_t g = t.find_child(root, "g");
+    size_t i = t.find_child(root, "i");
+    ASSERT_NE(a, NONE);
+    ASSERT_NE(d, NONE);
+    ASSERT_NE(g, NONE);
+    ASSERT_NE(i, NONE);
+    EXPECT_TRUE(t.is_lazy(a));
+    EXPECT_TRUE(t.is_lazy(d));
+    EXPECT_FALSE(t.is_lazy(g));
+    EXPECT_TRUE(t.is_lazy(i));
+    EXPECT_TRUE(t.is_map(a));
+    EXPECT_TRUE(t.is_map(d));
+    EXPECT_TRUE(t.is_seq(i));
+    EXPECT_TRUE(t.has_children(a));
+    EXPECT_EQ(t.size(), 5u);
+
+    // expand a, but not its nested containers
+    EXPECT_EQ(t.num_children(a), 2u);
+    EXPECT_FALSE(t.is_lazy(a));
+    size_t c = t.find_child(a, "c");
+    ASSERT_NE(c, NONE);
+    EXPECT_TRUE(t.is_lazy(c));
+    EXPECT_TRUE(t.is_lazy(d));
+    EXPECT_EQ(t.val(t.find_child(a, "b")), "1");
+
+    NodeRef r = t.rootref();
+    EXPECT_EQ(r["a"]["c"][1].val(), "3");
+    EXPECT_EQ(r["d"]["e"].val(), "f");
+    EXPECT_EQ(r["i"][0].val(), "j");
+    EXPECT_FALSE(t.is_lazy(c));
+    EXPECT_FALSE(t.is_lazy(d));
+    EXPECT_FALSE(t.is_lazy(i));
+}
+
+TEST(parse_lazy, same_as_parse)
+{
+    test_lazy("a: 1\nb: 2\n");
+    test_lazy("a:\n  b: 1\n  c:\n    d: 2\n    e: [3, 4]\nf: 5\n");
+    test_lazy("a:\n- 1\n- 2\nb:\n  - 3\n  - 4\nc: 5\n");
+    test_lazy("- a:\n    b: 1\n  c: 2\n- d:\n  - 3\n  - 4\n");
+    test_lazy("a:\n  b: 1\n\n  # a comment\n  c: 2\n\n# another comment\nd: 3\n");
+    test_lazy("a:\n  b: 1\n  c: 2"); // no newline at the end
+    test_lazy("a: [1, 2]");
+    test_lazy("a: {b: 1, c: [2, 3]}\nd: [{e: 4}, [5, 6]] # a comment\ng: 7\n");
+    test_lazy("a: [1,\n  2,\n  3]\nb: {c: 4,\n  d: 5}\ne: 6\n");
+    test_lazy("a: [\"x]\", 'it''s', \"y\\\"}\", it's, {c: d}]\nb: 1\n");
+    test_lazy("a: [1, 2] # ] not a bracket\nb: 3\n");
+    test_lazy("a:\n  b: |\n    text\n\n    more text\n  c: 2\nd: 3\n");
+    test_lazy("\"a\":\n  b: 1\n'c': [2]\n");
+}
+
+TEST(parse_lazy, seq_entries)
+{
+    Tree t = parse_lazy("- name: a\n  val: 1\n- [x, y]\n- {p: q}\n- scalar\n- - nested\n");
+    Tree const& ct = t;
+    ASSERT_EQ(t.num_children(t.root_id()), 5u);
+    EXPECT_TRUE(ct.is_lazy(ct.child(ct.root_id(), 0)));
+    EXPECT_TRUE(ct.is_lazy(ct.child(ct.root_id(), 1)));
+    EXPECT_TRUE(ct.is_lazy(ct.child(ct.root_id(), 2)));
+    EXPECT_FALSE(ct.is_lazy(ct.child(ct.root_id(), 3)));
+    EXPECT_FALSE(ct.is_lazy(ct.child(ct.root_id(), 4)));
+    EXPECT_TRUE(ct.is_map(ct.child(ct.root_id(), 0)));
+    EXPECT_TRUE(ct.is_seq(ct.child(ct.root_id(), 1)));
+    NodeRef r = t.rootref();
+    EXPECT_EQ(r[0]["val"].val(), "1");
+    EXPECT_EQ(r[1][1].val(), "y");
+    EXPECT_EQ(r[2]["p"].val(), "q");
+    test_lazy("- a: 1\n  b: 2\n- c: 3\n");
+    test_lazy("- a: 1\n\n  # a comment\n  b: [2, 3]\n\n# another comment\n- c: 3\n");
+    test_lazy("a:\n  - b: 1\n    c:\n    - d: 2\n      e: 3\n  - f: 4\nd: 5\n");
+    test_lazy("a:\n- b: |\n    text\n\n    more text\n  c: 2\n- d\n");
+    test_lazy("-   a: 1\n    b: 2\n-   [c, d]   # comment\n-   {e: f}\n");
+    test_lazy("- a # not: a key\n- b: 1"); // no newline at the end
+    test_lazy("- 'a': 1\n- \"b\": 2\n");
+    test_lazy("---\n- a: 1\n---\n- b: 2\n");
+}
+
+TEST(parse_lazy, values_which_are_parsed_eagerly)
+{
+    test_lazy("a:\nb: 1\n"); // null
+    test_lazy("a:\n  plain\n  scalar\nb: 1\n");
+    test_lazy("a: &anchor\n  b: 1\nc: *anchor\n");
+    test_lazy("a:\n  \"b\": 1\n");
+    test_lazy("a: |\n  text\nb: 1\n");
+}
+
+TEST(parse_lazy, nested_expansion)
+{
+    csubstr src = "a:\n  b:\n    c:\n      d: 1\n";
+    Tree t = parse_lazy(src);
+    NodeRef r = t.rootref();
+    EXPECT_EQ(t.size(), 2u);
+    EXPECT_EQ(r["a"]["b"]["c"]["d"].val(), "1");
+    EXPECT_EQ(t.size(), 5u);
+}
+
+TEST(parse_lazy, remove_children_drops_the_source)
+{
+    Tree t = parse_lazy("a:\n  b: 1\nc: 2\n");
+    size_t a = t.find_child(t.root_id(), "a");
+    ASSERT_TRUE(t.is_lazy(a));
+    t.remove_children(a);
+    EXPECT_FALSE(t.is_lazy(a));
+    EXPECT_FALSE(t.has_children(a));
+    EXPECT_EQ(t.num_children(a), 0u);
+}
+
+TEST(parse_lazy, const_access_does_not_expand)
+{
+    Tree t = parse_lazy("a:\n  b: 1\nc: 2\n");
+    Tree const& ct = t;
+    size_t a = ct.find_child(ct.root_id(), "a");
+    ASSERT_NE(a, NONE);
+    EXPECT_TRUE(ct.is_lazy(a));
+    EXPECT_TRUE(ct.has_children(a));
+    EXPECT_EQ(t.size(), 3u);
+    t.expand_lazy(a);
+    EXPECT_FALSE(ct.is_lazy(a));
+    EXPECT_EQ(ct.num_children(a), 1u);
+    EXPECT_EQ(ct.val(ct.first_child(a)), "1");
+    t.expand_lazy(a); // not lazy: does nothing
+    EXPECT_EQ(ct.num_children(a), 1u);
+}
+
+TEST(parse_lazy, const_access_to_the_children_is_an_error)
+{
+    // this is checked also in release builds
+    Tree t = parse_lazy("a:\n  b: 1\nc: 2\n");
+    Tree const& ct = t;
+    const size_t a = ct.find_child(ct.root_id(), "a");
+    ASSERT_NE(a, NONE);
+    ASSERT_TRUE(ct.is_lazy(a));
+    ExpectError::do_check([&]{ (void)ct.num_children(a); });
+    ExpectError::do_check([&]{ (void)ct.first_child(a); });
+    ExpectError::do_check([&]{ (void)ct.last_child(a); });
+    ExpectError::do_check([&]{ (void)ct.child(a, 0); });
+    ExpectError::do_check([&]{ (void)ct.find_child(a, "b"); });
+    EXPECT_TRUE(ct.is_lazy(a));
+    // the non-const getters expand the node
+    EXPECT_EQ(t.num_children(a), 1u);
+    EXPECT_EQ(ct.val(ct.find_child(a, "b")), "1");
+}
+
+TEST(parse_lazy, expand_all)
+{
+    csubstr src = "a:\n  b:\n    c: [1, {d: 2}]\ne: {f: [3]}\n";
+    Tree expected = parse(src);
+    Tree t = parse_lazy(src);
+    t.expand_lazy_all();
+    for(size_t i = 0; i < t.capacity(); ++i)
+        EXPECT_FALSE(t.is_lazy(i));
+    EXPECT_EQ(t.size(), expected.size());
+    EXPECT_EQ(emitrs<std::string>(t), emitrs<std::string>(expected));
+}
+
+TEST(parse_lazy, duplicate)
+{
+    csubstr src = "a:\n  b: 1\n  c: [2, \"x\\ty\"]\n";
+    Tree expected = parse(src);
+    Tree dup;
+    {
+        // the lazy source is copied to the arena of dup, so dup
+        // outlives the source buffer
+        std::string buf(src.str, src.len);
+        Tree t = parse_lazy(to_substr(buf));
+        dup.to_map(dup.root_id());
+        dup.duplicate_children(&t, t.root_id(), dup.root_id(), NONE);
+        t.expand_lazy_all(); // this writes into buf
+        buf.assign(buf.size(), '?');
+    }
+    size_t a = dup.find_child(dup.root_id(), "a");
+    ASSERT_NE(a, NONE);
+    dup.expand_lazy_all();
+    EXPECT_EQ(emitrs<std::string>(dup), emitrs<std::string>(expected));
+}
+
+TEST(parse_lazy, copy_does_not_share_the_source)
+{
+    // the expansion writes to the source (filtering the escapes in
+    // place), so the copies must have their own
+    csubstr src = "a:\n  b: \"x\\ty\"\n  c: [\"z\\tw\"]\nd: 1\n";
+    Tree expected = parse(src);
+    std::string buf(src.str, src.len);
+    Tree t = parse_lazy(to_substr(buf));
+    Tree copy = t;
+    Tree assigned;
+    assigned = t;
+    t.expand_lazy_all();
+    EXPECT_EQ(emitrs<std::string>(t), emitrs<std::string>(expected));
+    buf.assign(buf.size(), '?');
+    copy.expand_lazy_all();
+    EXPECT_EQ(emitrs<std::string>(copy), emitrs<std::string>(expected));
+    assigned.expand_lazy_all();
+    EXPECT_EQ(emitrs<std::string>(assigned), emitrs<std::string>(expected));
+}
+
+TEST(parse_lazy, wide_escapes)
+{
+    // \L and \P are decoded to more bytes than they take in the
+    // source, so expanding a source in the arena needs room there
+    std::string src = "a:\n  b: \"";
+    for(size_t i = 0; i < 100; ++i)
+        src += "\\L\\P";
+    src += "\"\n  c: [1, 2]\n";
+    Tree expected = parse(to_csubstr(src));
+    {
+        Tree t = parse_lazy(to_csubstr(src));
+        t.expand_lazy_all();
+        EXPECT_EQ(emitrs<std::string>(t), emitrs<std::string>(expected));
+    }
+    {
+        // the copy takes the source to its arena, exactly sized
+        std::string buf = src;
+        Tree t = parse_lazy(to_substr(buf));
+        Tree copy = t;
+        buf.assign(buf.size(), '?');
+        copy.expand_lazy_all();
+        EXPECT_EQ(emitrs<std::string>(copy), emitrs<std::string>(expected));
+    }
+}
+
+TEST(parse_lazy, merge)
+{
+    csubstr src = "a:\n  b: 1\n  c: [2, 3]\n";
+    Tree expected = parse(src);
+    Tree dst;
+    {
+        std::string buf(src.str, src.len);
+        Tree t = parse_lazy(to_substr(buf));
+        dst.merge_with(&t);
+        buf.assign(buf.size(), '?');
+    }
+    dst.expand_lazy_all();
+    EXPECT_EQ(emitrs<std::string>(dst), emitrs<std::string>(expected));
+}
+
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+csubstr manifest = R"(apiVersion: v1
+kind: Pod
+metadata:
+  name: web
+  labels: {app: web, tier: frontend}
+spec:
+  template:
+    containers:
+    - name: sidecar
+      image: proxy:1.0
+      ports: [80, 443]
+    - name: app
+      image: app:2.3
+      env:
+      - name: MODE
+        value: prod
+  volumes:
+  - name: data
+    emptyDir: {}
+)";
+
+TEST(parse_paths, keeps_only_the_paths)
+{
+    csubstr paths[] = {"kind", "spec.template.containers[1].image", "metadata.labels"};
+    Parser p;
+    Tree t;
+    p.parse({}, manifest, &t, paths);
+    EXPECT_FALSE(p.lazy());
+    NodeRef r = t.rootref();
+    ASSERT_EQ(r.num_children(), 3u);
+    EXPECT_EQ(r["kind"].val(), "Pod");
+    ASSERT_EQ(r["metadata"].num_children(), 1u);
+    ASSERT_EQ(r["metadata"]["labels"].num_children(), 2u);
+    EXPECT_EQ(r["metadata"]["labels"]["tier"].val(), "frontend");
+    ASSERT_EQ(r["spec"].num_children(), 1u);
+    ASSERT_EQ(r["spec"]["template"].num_children(), 1u);
+    NodeRef containers = r["spec"]["template"]["containers"];
+    ASSERT_EQ(containers.num_children(), 2u);
+    // the previous entries are kept as null placeholders
+    EXPECT_TRUE(containers[0].is_val());
+    EXPECT_EQ(containers[0].val().str, nullptr);
+    ASSERT_EQ(containers[1].num_children(), 1u);
+    EXPECT_EQ(containers[1]["image"].val(), "app:2.3");
+    // so the same paths can be looked up in the result
+    for(csubstr path : paths)
+    {
+        SCOPED_TRACE(path);
+        EXPECT_NE(t.lookup_path(path).target, NONE);
+    }
+}
+
+TEST(parse_paths, subtrees_are_fully_parsed)
+{
+    csubstr paths[] = {"spec.template.containers[1]"};
+    Tree t;
+    Parser p;
+    p.parse({}, manifest, &t, paths);
+    size_t app = t.lookup_path("spec.template.containers[1]").target;
+    ASSERT_NE(app, NONE);
+    size_t env = t.find_child(app, "env");
+    ASSERT_NE(env, NONE);
+    EXPECT_FALSE(t.is_lazy(env));
+    EXPECT_FALSE(t.is_lazy(t.first_child(env)));
+    EXPECT_EQ(t.num_children(app), 3u);
+    EXPECT_EQ(t.find_child(t.root_id(), "metadata"), NONE);
+    EXPECT_EQ(t.find_child(t.lookup_path("spec").target, "volumes"), NONE);
+}
+
+TEST(parse_paths, skipped_entries_are_not_expanded)
+{
+    std::string src = "list:\n";
+    for(size_t i = 0; i < 100; ++i)
+        src += "- name: entry" + std::to_string(i) + "\n  data: {a: 1, b: [2, 3]}\n";
+    csubstr paths[] = {"list[50].name"};
+    Tree t;
+    Parser p;
+    p.parse({}, to_csubstr(src), &t, paths);
+    ASSERT_EQ(t.rootref()["list"].num_children(), 51u);
+    EXPECT_EQ(t.rootref()["list"][50]["name"].val(), "entry50");
+    // the root, the list, the 50 blanked entries, the target entry
+    // and its name
+    EXPECT_EQ(t.size(), 54u);
+}
+
+TEST(parse_paths, lazy_mode_is_restored_on_error)
+{
+    csubstr paths[] = {"a"};
+    Parser p;
+    ExpectError::do_check([&]{
+        Tree t;
+        p.parse({}, csubstr("a: 'unclosed\n"), &t, paths);
+    });
+    EXPECT_FALSE(p.lazy());
+    p.set_lazy(true);
+    ExpectError::do_check([&]{
+        Tree t;
+        p.parse({}, csubstr("a: 'unclosed\n"), &t, paths);
+    });
+    EXPECT_TRUE(p.lazy());
+}
+
+TEST(parse_paths, missing_paths_are_ignored)
+{
+    csubstr paths[] = {"spec.nope", "kind", "spec.template.containers[7]"};
+    Tree t;
+    Parser p;
+    p.parse({}, manifest, &t, paths, 3);
+    ASSERT_EQ(t.rootref().num_children(), 1u);
+    EXPECT_EQ(t.rootref()["kind"].val(), "Pod");
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,361 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parallel.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <stdio.h>
+#include <vector>
+
+namespace c4 {
+namespace yml {
+
+void compare_nodes(Tree const& a, size_t na, Tree const& b, size_t nb)
+{
+    EXPECT_EQ(a.type(na), b.type(nb));
+    if(a.has_key(na) && b.has_key(nb))
+        EXPECT_EQ(a.key(na), b.key(nb));
+    if(a.has_val(na) && b.has_val(nb))
+        EXPECT_EQ(a.val(na), b.val(nb));
+    ASSERT_EQ(a.num_children(na), b.num_children(nb));
+    for(size_t cha = a.first_child(na), chb = b.first_child(nb);
+        cha != NONE && chb != NONE;
+        cha = a.next_sibling(cha), chb = b.next_sibling(chb))
+    {
+        compare_nodes(a, cha, b, chb);
+    }
+}
+
+void test_parallel(csubstr src)
+{
+    SCOPED_TRACE(src);
+    Tree expected = parse(src);
+    for(size_t num_threads : {(size_t)0, (size_t)1, (size_t)2, (size_t)3, (size_t)8})
+    {
+        SCOPED_TRACE(num_threads);
+        Tree actual;
+        parse_stream_parallel(src, &actual, num_threads);
+        compare_nodes(expected, expected.root_id(), actual, actual.root_id());
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(parse_stream_parallel, single_doc)
+{
+    test_parallel("a: 1\nb: [2, 3]\n");
+    test_parallel("- a\n- b\n");
+    test_parallel("---\na: 1\n");
+    test_parallel("just a scalar");
+}
+
+TEST(parse_stream_parallel, multiple_docs)
+{
+    test_parallel("a: 1\n---\nb: 2\n---\n- c\n- d\n");
+    test_parallel("---\na: 1\n---\nb: 2\n");
+    test_parallel("--- a\n--- b\n--- [c, d]\n--- {e: f}\n");
+    test_parallel("a: 1\n...\n---\nb: 2\n...\n");
+    test_parallel("foo\n---\nbar\n");
+}
+
+TEST(parse_stream_parallel, block_scalars_with_markers)
+{
+    test_parallel(R"(a: |
+  --- not a marker
+  ... nor this
+---
+b: >
+  folded
+  text
+---
+c: "multi
+  line"
+)");
+}
+
+TEST(parse_stream_parallel, many_docs)
+{
+    std::string src;
+    for(size_t i = 0; i < 500; ++i)
+    {
+        src += "---\nname: doc";
+        src += std::to_string(i);
+        src += "\nitems:\n  - a\n  - b: &anchor";
+        src += std::to_string(i);
+        src += " c\n  - *anchor";
+        src += std::to_string(i);
+        src += "\n";
+    }
+    test_parallel(to_csubstr(src));
+}
+
+TEST(parse_stream_parallel, in_situ)
+{
+    std::string src = "a: 1\n---\nb: 2\n---\nc: 3\n";
+    Tree expected = parse(to_csubstr(src));
+    Tree actual;
+    parse_stream_parallel(to_substr(src), &actual, 2);
+    compare_nodes(expected, expected.root_id(), actual, actual.root_id());
+    // the scalars point at the source buffer
+    EXPECT_EQ(actual[1]["b"].val().str, src.data() + 12);
+}
+
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+void test_parallel_entries(csubstr src)
+{
+    SCOPED_TRACE(src);
+    Tree expected = parse(src);
+    for(size_t num_threads : {(size_t)0, (size_t)1, (size_t)2, (size_t)3, (size_t)8})
+    {
+        SCOPED_TRACE(num_threads);
+        Tree actual;
+        parse_parallel(src, &actual, num_threads, /*min_chunk_size*/1);
+        compare_nodes(expected, expected.root_id(), actual, actual.root_id());
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+}
+
+TEST(parse_parallel, block_map)
+{
+    test_parallel_entries("a: 1\nb: 2\nc: 3\nd: 4\ne: 5\n");
+    test_parallel_entries(R"(a:
+- x
+- y
+b: |
+  it's [
+  z
+c: 'q'
+d: {e: f, g: [h, i]}
+"j k": l # it's [
+m:
+  n: o
+  p: [q,
+    r]
+)");
+}
+
+TEST(parse_parallel, properties)
+{
+    // the flow collections and quoted scalars after an anchor or a
+    // tag must be tracked, or their column-0 lines would be taken
+    // for new entries
+    test_parallel_entries("a: &x [1,\nb: 2]\nc: 3\n");
+    test_parallel_entries("a: !!str \"x\nb: y\"\nc: 3\n");
+    test_parallel_entries("a: &x !!str 'x\nb: y'\nc: 3\n");
+    test_parallel_entries("a: !!map {b: c,\nd: e}\nf: g\n");
+}
+
+TEST(parse_parallel, wide_escapes)
+{
+    // \L and \P are decoded to more bytes than they take in the
+    // source, so the chunks decode them into the arenas of their own
+    // trees, which are gone once the chunks are spliced
+    std::string src;
+    std::string stream;
+    for(size_t i = 0; i < 20; ++i)
+    {
+        std::string entry = "k" + std::to_string(i) + ": [\"\\L\\P\\L\", \"x\\Py\"]\n";
+        src += entry;
+        stream += "---\n" + entry;
+    }
+    test_parallel_entries(to_csubstr(src));
+    test_parallel(to_csubstr(stream));
+    Tree t;
+    parse_parallel(to_csubstr(src), &t, 4, /*min_chunk_size*/1);
+    EXPECT_EQ(t["k19"][0].val(), "\xe2\x80\xa8\xe2\x80\xa9\xe2\x80\xa8");
+    EXPECT_EQ(t["k19"][1].val(), "x\xe2\x80\xa9y");
+}
+
+TEST(parse_parallel, block_seq)
+{
+    test_parallel_entries("- a\n- b\n- c\n- d\n");
+    test_parallel_entries(R"(- a
+- b: c
+  d: e
+- [f, g]
+- - h
+  - i
+- >
+  folded
+  text
+- "quoted # [ {"
+)");
+}
+
+TEST(parse_parallel, fallback)
+{
+    // not a top-level block collection
+    test_parallel_entries("a scalar\nin two lines\n");
+    test_parallel_entries("{a: b,\nc: d}\n");
+    test_parallel_entries("a: 1\n---\nb: 2\n---\nc: 3\n");
+    test_parallel_entries("");
+}
+
+TEST(parse_parallel, large_map)
+{
+    std::string src;
+    for(size_t i = 0; i < 2000; ++i)
+    {
+        src += "key";
+        src += std::to_string(i);
+        src += ":\n  name: value";
+        src += std::to_string(i);
+        src += "\n  list: [a, b, c]\n  text: |\n    block\n    text\n";
+    }
+    test_parallel_entries(to_csubstr(src));
+}
+
+
+/** parse the source sequentially and in parallel, and compare the
+ * locations of the errors */
+template<class ParseFn>
+void test_parallel_error_location(csubstr src, ParseFn &&parse_fn)
+{
+    SCOPED_TRACE(src);
+    struct ErrorLocation
+    {
+        Location loc;
+        static void error(const char* msg, size_t len, Location loc, void *user_data)
+        {
+            ((ErrorLocation*)user_data)->loc = loc;
+            throw std::runtime_error(std::string(msg, len));
+        }
+    };
+    Callbacks prev = get_callbacks();
+    ErrorLocation expected, actual;
+    set_callbacks(Callbacks(&expected, prev.m_allocate, prev.m_free, &ErrorLocation::error));
+    {
+        std::string buf(src.str, src.len);
+        Tree t;
+        EXPECT_THROW(parse(to_substr(buf), &t), std::runtime_error);
+    }
+    for(size_t num_threads : {(size_t)1, (size_t)2, (size_t)3})
+    {
+        SCOPED_TRACE(num_threads);
+        set_callbacks(Callbacks(&actual, prev.m_allocate, prev.m_free, &ErrorLocation::error));
+        std::string buf(src.str, src.len);
+        Tree t;
+        EXPECT_THROW(parse_fn(to_substr(buf), &t, num_threads), std::runtime_error);
+        EXPECT_EQ(actual.loc.line, expected.loc.line);
+        EXPECT_EQ(actual.loc.col, expected.loc.col);
+        EXPECT_EQ(actual.loc.offset, expected.loc.offset);
+    }
+    set_callbacks(prev);
+    EXPECT_GT(expected.loc.line, 4u);
+}
+
+TEST(parse_stream_parallel, error_location)
+{
+    test_parallel_error_location("a: 1\n---\nb: 2\n---\nc: 3\nd: 'unclosed\n", [](substr src, Tree *t, size_t num_threads){
+        parse_stream_parallel(src, t, num_threads);
+    });
+}
+
+TEST(parse_parallel, error_location)
+{
+    test_parallel_error_location("a: 1\nb: 2\nc: 3\nd: 4\ne: 'unclosed\n", [](substr src, Tree *t, size_t num_threads){
+        parse_parallel(src, t, num_threads, /*min_chunk_size*/1);
+    });
+}
+
+
+//-----------------------------------------------------------------------------
+
+TEST(load_files, same_as_parse)
+{
+    std::vector<std::string> srcs, names;
+    for(size_t i = 0; i < 50; ++i)
+    {
+        srcs.push_back("name: file" + std::to_string(i) + "\nlist: [a, \"b\\tc\", " + std::to_string(i) + "]\n");
+        names.push_back("ryml_test_load_files_" + std::to_string(i) + ".yml");
+        FILE *f = fopen(names.back().c_str(), "wb");
+        ASSERT_NE(f, nullptr);
+        fwrite(srcs.back().data(), 1, srcs.back().size(), f);
+        fclose(f);
+    }
+    std::vector<const char*> paths;
+    for(std::string const& name : names)
+        paths.push_back(name.c_str());
+    for(size_t num_threads : {1u, 4u, 0u})
+    {
+        SCOPED_TRACE(num_threads);
+        std::vector<Tree> trees(paths.size());
+        std::vector<int> calls(paths.size(), 0);
+        load_files(paths.data(), paths.size(), [&](size_t i, Tree &t){
+            ++calls[i];
+            trees[i] = std::move(t);
+        }, num_threads);
+        for(size_t i = 0; i < paths.size(); ++i)
+        {
+            EXPECT_EQ(calls[i], 1);
+            Tree expected = parse(to_csubstr(srcs[i]));
+            EXPECT_EQ(emitrs<std::string>(trees[i]), emitrs<std::string>(expected));
+        }
+    }
+    for(std::string const& name : names)
+        remove(name.c_str());
+}
+
+/** an error callback which returns, counting the errors */
+void count_file_errors(const char* /*msg*/, size_t /*len*/, Location /*loc*/, void *user_data)
+{
+    ++*static_cast<std::atomic<int>*>(user_data);
+}
+
+TEST(load_files, missing_files_are_skipped)
+{
+    std::vector<std::string> names;
+    for(size_t i = 0; i < 8; ++i)
+    {
+        names.push_back("ryml_test_load_files_missing_" + std::to_string(i) + ".yml");
+        if(i % 2)
+            continue; // the odd files do not exist
+        FILE *f = fopen(names.back().c_str(), "wb");
+        ASSERT_NE(f, nullptr);
+        fputs("a: 1\n", f);
+        fclose(f);
+    }
+    std::vector<const char*> paths;
+    for(std::string const& name : names)
+        paths.push_back(name.c_str());
+    std::atomic<int> num_errors(0);
+    Callbacks prev = get_callbacks();
+    set_callbacks(Callbacks(&num_errors, nullptr, nullptr, &count_file_errors));
+    for(size_t num_threads : {1u, 4u})
+    {
+        SCOPED_TRACE(num_threads);
+        num_errors = 0;
+        std::vector<std::atomic<int>> calls(paths.size());
+        for(std::atomic<int> &c : calls)
+            c = 0;
+        load_files(paths.data(), paths.size(), [&](size_t i, Tree &t){
+            ++calls[i];
+            EXPECT_EQ(t["a"].val(), "1");
+        }, num_threads);
+        EXPECT_EQ(num_errors.load(), 4);
+        for(size_t i = 0; i < paths.size(); ++i)
+            EXPECT_EQ(calls[i].load(), (i % 2) ? 0 : 1) << i;
+    }
+    set_callbacks(prev);
+    for(std::string const& name : names)
+        remove(name.c_str());
+}
+
+TEST(load_files, no_files)
+{
+    size_t calls = 0;
+    load_files(nullptr, 0, [&](size_t, Tree &){ ++calls; });
+    EXPECT_EQ(calls, 0u);
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,194 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parse_context.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+#ifdef RYML_WITH_THREADS
+#include <thread>
+#endif
+#include <stdio.h>
+
+namespace c4 {
+namespace yml {
+
+TEST(ParseContext, same_as_parse)
+{
+    csubstr srcs[] = {
+        "a: 1\nb: [2, 3]\nc: {d: e}\n",
+        "- a\n- b: c\n  d: |\n    text\n- \"x\\ty\"\n",
+        "{}",
+        "",
+        "--- a\n--- b\n",
+    };
+    ParseContext ctx;
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        for(csubstr src : srcs)
+        {
+            SCOPED_TRACE(src);
+            Tree expected = parse(src);
+            Tree const& actual = ctx.parse(src);
+            EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+            std::string buf(src.str, src.len);
+            Tree const& actual_rw = ctx.parse(to_substr(buf));
+            EXPECT_EQ(emitrs<std::string>(actual_rw), emitrs<std::string>(expected));
+        }
+    }
+}
+
+TEST(ParseContext, memory_is_kept)
+{
+    std::string src;
+    for(size_t i = 0; i < 100; ++i)
+        src += "key" + std::to_string(i) + ": [a, \"b\\tc\", d]\n";
+    ParseContext ctx;
+    ctx.parse(to_csubstr(src));
+    // the second parse is sized from the first
+    Tree const& t = ctx.parse(to_csubstr(src));
+    const size_t size = t.size();
+    const size_t cap = t.capacity();
+    const size_t arena_cap = t.arena_capacity();
+    EXPECT_GE(ctx.node_capacity_hint(src.size()), size);
+    EXPECT_GE(cap, ctx.node_capacity_hint(src.size()));
+    // a smaller source does not shrink the tree
+    Tree const& t2 = ctx.parse(csubstr("a: b"));
+    EXPECT_EQ(&t2, &t);
+    EXPECT_EQ(t2.size(), 2u);
+    EXPECT_EQ(t2.capacity(), cap);
+    EXPECT_EQ(t2.arena_capacity(), arena_cap);
+    // and the same source fits in the memory of the previous parses
+    ctx.parse(to_csubstr(src));
+    EXPECT_EQ(t.size(), size);
+    EXPECT_EQ(t.capacity(), cap);
+    EXPECT_EQ(t.arena_capacity(), arena_cap);
+    ctx.shrink();
+    EXPECT_EQ(ctx.tree().capacity(), 0u);
+    EXPECT_EQ(ctx.node_capacity_hint(src.size()), 16u);
+}
+
+TEST(ParseContext, small_source_does_not_oversize_large_ones)
+{
+    std::string src;
+    for(size_t i = 0; i < 1000; ++i)
+        src += "key" + std::to_string(i) + ": a value which is not so short\n";
+    ParseContext ctx;
+    // a tiny source is much denser than a large one
+    ctx.parse(csubstr("a: b"));
+    EXPECT_EQ(ctx.node_capacity_hint(src.size()), 16u);
+    Tree const& t = ctx.parse(to_csubstr(src));
+    const size_t size = t.size();
+    EXPECT_EQ(size, 1001u);
+    // the large source sets the density; it is not raised by the
+    // tiny one, which is instead sized from its own count
+    const size_t hint = ctx.node_capacity_hint(src.size());
+    EXPECT_GE(hint, size);
+    EXPECT_LT(hint, 2 * size);
+    ctx.parse(csubstr("a: b"));
+    EXPECT_EQ(ctx.node_capacity_hint(src.size()), hint);
+    EXPECT_GE(ctx.node_capacity_hint(4), 2u);
+}
+
+TEST(ParseContext, external_tree)
+{
+    ParseContext ctx;
+    ctx.parse(csubstr("a: [1, 2, 3, 4, 5, 6, 7, 8]"));
+    Tree t;
+    t.rootref() |= MAP;
+    t["x"] = "y";
+    ctx.parse({}, csubstr("[1, 2]"), &t);
+    EXPECT_TRUE(t.rootref().is_seq());
+    EXPECT_EQ(t.rootref().num_children(), 2u);
+    EXPECT_GE(t.capacity(), ctx.node_capacity_hint(6));
+    EXPECT_EQ(t[1].val(), "2");
+}
+
+#ifdef RYML_WITH_THREADS
+TEST(ParseContext, this_thread)
+{
+    ParseContext *main_ctx = &ParseContext::this_thread();
+    EXPECT_EQ(main_ctx, &ParseContext::this_thread());
+    ParseContext *other_ctx = nullptr;
+    std::string other_val;
+    std::thread th([&]{
+        other_ctx = &ParseContext::this_thread();
+        csubstr val = other_ctx->parse(csubstr("a: b"))["a"].val();
+        other_val.assign(val.str, val.len);
+    });
+    th.join();
+    EXPECT_NE(main_ctx, other_ctx);
+    EXPECT_EQ(other_val, "b");
+}
+#endif // RYML_WITH_THREADS
+
+TEST(ParseContext, load)
+{
+    csubstr srcs[] = {
+        "a: 1\nb: [2, 3]\nc: {d: e}\n",
+        "a: \"\\L\\P\\L\\P\\L\\P\"\n", // decoded to more bytes than the source
+        "",
+    };
+    const char *path = "ryml_test_parse_context_load.yml";
+    ParseContext ctx;
+    for(csubstr src : srcs)
+    {
+        SCOPED_TRACE(src);
+        FILE *f = fopen(path, "wb");
+        ASSERT_NE(f, nullptr);
+        fwrite(src.str, 1, src.len, f);
+        fclose(f);
+        Tree expected = parse(src);
+        Tree const& actual = ctx.load(path);
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+    remove(path);
+}
+
+/** an error callback which returns, counting the errors */
+void count_errors(const char* /*msg*/, size_t /*len*/, Location /*loc*/, void *user_data)
+{
+    ++*static_cast<int*>(user_data);
+}
+
+TEST(ParseContext, load_failure_leaves_the_tree_empty)
+{
+    const char *path = "ryml_test_parse_context_load_failure.yml";
+    FILE *f = fopen(path, "wb");
+    ASSERT_NE(f, nullptr);
+    fputs("a: 1\nb: 2\n", f);
+    fclose(f);
+    ParseContext ctx;
+    EXPECT_TRUE(ctx.try_load(path));
+    EXPECT_EQ(ctx.tree()["b"].val(), "2");
+    remove(path);
+    int num_errors = 0;
+    Callbacks prev = get_callbacks();
+    set_callbacks(Callbacks(&num_errors, nullptr, nullptr, &count_errors));
+    EXPECT_FALSE(ctx.try_load(path));
+    EXPECT_EQ(num_errors, 1);
+    EXPECT_FALSE(ctx.tree().rootref().has_children()); // not the previous file
+    Tree const& t = ctx.load(path);
+    EXPECT_EQ(num_errors, 2);
+    EXPECT_FALSE(t.rootref().has_children());
+    set_callbacks(prev);
+}
+
+TEST(ParseContext, wide_escapes)
+{
+    // \L and \P are decoded to more bytes than they take in the source,
+    // so the copy of the read-only source needs room in the arena
+    std::string src = "a: \"";
+    for(size_t i = 0; i < 100; ++i)
+        src += "\\L\\P";
+    src += "\"\n";
+    std::string expected;
+    for(size_t i = 0; i < 100; ++i)
+        expected += "\xe2\x80\xa8\xe2\x80\xa9";
+    ParseContext ctx;
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        Tree const& t = ctx.parse(to_csubstr(src));
+        EXPECT_EQ(t["a"].val(), to_csubstr(expected));
+    }
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,239 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parse.hpp"
+#include <gtest/gtest.h>
+
+namespace c4 {
+namespace yml {
+
+/** records the events as text, one per line */
+struct EventRecorder
+{
+    std::string out;
+    size_t max_depth = 0;
+    size_t depth = 0;
+
+    void _push() { ++depth; if(depth > max_depth) max_depth = depth; }
+    void _pop() { --depth; }
+    void _scalar(const char *what, csubstr s)
+    {
+        out += what;
+        if(s.str == nullptr)
+            out += "~";
+        else
+            out.append(s.str, s.len);
+        out += '\n';
+    }
+
+    void begin_doc() { out += "+DOC\n"; _push(); }
+    void end_doc()   { out += "-DOC\n"; _pop(); }
+    void begin_map() { out += "+MAP\n"; _push(); }
+    void end_map()   { out += "-MAP\n"; _pop(); }
+    void begin_seq() { out += "+SEQ\n"; _push(); }
+    void end_seq()   { out += "-SEQ\n"; _pop(); }
+    void key(csubstr k) { _scalar("=KEY ", k); }
+    void val(csubstr v) { _scalar("=VAL ", v); }
+};
+
+/** walk a parsed tree to get the events expected from it */
+void tree_events(Tree const& t, size_t node, EventRecorder *r)
+{
+    if(t.is_stream(node))
+    {
+        for(size_t ch = t.first_child(node); ch != NONE; ch = t.next_sibling(ch))
+            tree_events(t, ch, r);
+        return;
+    }
+    if(t.is_doc(node) || t.is_root(node))
+        r->begin_doc();
+    if(t.has_key(node))
+        r->key(t.key(node));
+    if(t.is_map(node))
+        r->begin_map();
+    else if(t.is_seq(node))
+        r->begin_seq();
+    if(t.is_container(node))
+    {
+        for(size_t ch = t.first_child(node); ch != NONE; ch = t.next_sibling(ch))
+            tree_events(t, ch, r);
+    }
+    else if(t.has_val(node))
+    {
+        r->val(t.val(node));
+    }
+    if(t.is_map(node))
+        r->end_map();
+    else if(t.is_seq(node))
+        r->end_seq();
+    if(t.is_doc(node) || t.is_root(node))
+        r->end_doc();
+}
+
+void test_events(csubstr yaml)
+{
+    SCOPED_TRACE(yaml);
+    Tree t = parse(yaml);
+    EventRecorder expected;
+    if(t.type(t.root_id()) != NOTYPE)
+        tree_events(t, t.root_id(), &expected);
+
+    Parser p;
+    EventRecorder actual;
+    p.parse_events({}, yaml, &actual);
+    EXPECT_EQ(actual.out, expected.out);
+    EXPECT_EQ(actual.depth, 0u);
+
+    // the in-situ overload must give the same result
+    std::string copy(yaml.str, yaml.len);
+    EventRecorder insitu;
+    p.parse_events({}, to_substr(copy), &insitu);
+    EXPECT_EQ(insitu.out, expected.out);
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(parse_events, empty)
+{
+    Parser p;
+    EventRecorder r;
+    p.parse_events({}, csubstr(""), &r);
+    EXPECT_EQ(r.out, "");
+}
+
+TEST(parse_events, simple_map)
+{
+    Parser p;
+    EventRecorder r;
+    p.parse_events({}, csubstr("a: 1\nb: 2\n"), &r);
+    EXPECT_EQ(r.out, "+DOC\n+MAP\n=KEY a\n=VAL 1\n=KEY b\n=VAL 2\n-MAP\n-DOC\n");
+    test_events("a: 1\nb: 2\n");
+}
+
+TEST(parse_events, simple_seq)
+{
+    Parser p;
+    EventRecorder r;
+    p.parse_events({}, csubstr("- a\n- b\n"), &r);
+    EXPECT_EQ(r.out, "+DOC\n+SEQ\n=VAL a\n=VAL b\n-SEQ\n-DOC\n");
+    test_events("- a\n- b\n");
+}
+
+TEST(parse_events, docval)
+{
+    test_events("foo");
+    test_events("foo\n---\nbar\n");
+}
+
+TEST(parse_events, nested)
+{
+    test_events(R"(a: 1
+b:
+  - x
+  - y:
+      z: 2
+      w: [3, 4, {k: v}]
+  - - 5
+    - 6
+c: {d: e, f: [g, h]}
+i: 'quoted'
+j: "dquoted"
+k: |
+  literal
+  text
+l:
+)");
+}
+
+TEST(parse_events, seqimap)
+{
+    test_events("[a: b, c, d: e]");
+}
+
+TEST(parse_events, stream)
+{
+    test_events("a: b\n---\nc: d\n---\n- e\n- f\n");
+    test_events("---\na: b\n---\nc: d\n...\n");
+    test_events("--- scalar\n--- [a, b]\n--- {c: d}\n");
+}
+
+TEST(parse_events, anchors_and_refs)
+{
+    test_events(R"(base: &base
+  a: 1
+derived:
+  <<: *base
+  b: 2
+)");
+}
+
+TEST(parse_events, wide_escapes)
+{
+    // \L and \P are decoded to more bytes than they take in the source,
+    // so the copy of the read-only source needs room in the arena
+    std::string yaml = "- \"";
+    std::string expected = "+DOC\n+SEQ\n=VAL ";
+    for(size_t i = 0; i < 100; ++i)
+    {
+        yaml += "\\L\\P";
+        expected += "\xe2\x80\xa8\xe2\x80\xa9";
+    }
+    yaml += "\"\n";
+    expected += "\n-SEQ\n-DOC\n";
+    Parser p;
+    EventRecorder r;
+    p.parse_events({}, to_csubstr(yaml), &r);
+    EXPECT_EQ(r.out, expected);
+    test_events(to_csubstr(yaml));
+}
+
+struct CountingResource : public MemoryResource
+{
+    size_t max_bytes = 0;
+    size_t curr_bytes = 0;
+    void *allocate(size_t num_bytes, void *hint) override
+    {
+        curr_bytes += num_bytes;
+        if(curr_bytes > max_bytes)
+            max_bytes = curr_bytes;
+        return get_memory_resource()->allocate(num_bytes, hint);
+    }
+    void free(void *mem, size_t num_bytes) override
+    {
+        curr_bytes -= num_bytes;
+        get_memory_resource()->free(mem, num_bytes);
+    }
+};
+
+TEST(parse_events, memory_is_bounded)
+{
+    std::string yaml;
+    for(size_t i = 0; i < 1000; ++i)
+    {
+        yaml += "- key";
+        yaml += std::to_string(i);
+        yaml += ": [1, 2, 3]\n";
+    }
+    Tree t = parse(to_csubstr(yaml));
+    EventRecorder expected;
+    tree_events(t, t.root_id(), &expected);
+
+    CountingResource mr;
+    {
+        Parser p(Allocator{&mr});
+        EventRecorder r;
+        std::string copy = yaml;
+        p.parse_events({}, to_substr(copy), &r);
+        EXPECT_EQ(r.out, expected.out);
+        EXPECT_EQ(r.max_depth, 4u);
+    }
+    EXPECT_EQ(mr.curr_bytes, 0u);
+    // the scratch tree reuses its nodes, so the parser memory does
+    // not grow with the number of nodes
+    EXPECT_GT(mr.max_bytes, 0u);
+    EXPECT_LT(mr.max_bytes, t.size() * Tree::_node_bytes());
+}
+
+} // namespace yml
+} // namespace c4
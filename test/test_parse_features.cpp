@@ -0,0 +1,78 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parse.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+
+#include "./test_case.hpp"
+
+namespace c4 {
+namespace yml {
+
+TEST(parse_features, default_is_all)
+{
+    Parser p;
+    EXPECT_EQ(p.features(), (uint32_t)PARSE_ALL_FEATURES);
+    p.set_features(PARSE_TAGS|0x100u);
+    EXPECT_EQ(p.features(), (uint32_t)PARSE_TAGS);
+}
+
+TEST(parse_features, plain_data_gives_the_same_tree)
+{
+    csubstr srcs[] = {
+        "a: 1\nb: [2, 3]\nc: {d: e}\n",
+        "- a\n- b: c\n  d: |\n    text\n- \"x\\ty\"\n",
+        "a: 'it''s'\nb: \"*not a ref\"\nc: '&not an anchor'\nd: '!not a tag'\n",
+        "a: b*c\nd: e&f\ng: h!i\n",
+        "--- a\n--- b\n",
+    };
+    for(csubstr src : srcs)
+    {
+        SCOPED_TRACE(src);
+        Tree expected = parse(src);
+        Parser p;
+        p.set_features(0);
+        Tree actual = p.parse({}, src);
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+}
+
+TEST(parse_features, disabled_features_are_errors)
+{
+    struct Case { uint32_t feature; csubstr src; };
+    Case cases[] = {
+        {PARSE_ANCHORS, "a: &anchor 1\n"},
+        {PARSE_ANCHORS, "a: &anchor\n  b: 1\n"},
+        {PARSE_ANCHORS, "- &anchor 1\n"},
+        {PARSE_ANCHORS, "a: 1\nb: *a\n"},
+        {PARSE_ANCHORS, "[*a]"},
+        {PARSE_TAGS, "a: !!str 1\n"},
+        {PARSE_TAGS, "- !foo bar\n"},
+        {PARSE_TAGS, "--- !!map\na: b\n"},
+        {PARSE_TAGS, "a: !<tag:yaml.org,2002:str> b\n"},
+        {PARSE_COMPLEX_KEYS, "? a\n: b\n"},
+        {PARSE_COMPLEX_KEYS, "a:\n  ? b\n  : c\n"},
+        {PARSE_COMPLEX_KEYS, "{? a: b}"},
+    };
+    for(Case const& c : cases)
+    {
+        SCOPED_TRACE(c.src);
+        Parser all;
+        EXPECT_TRUE(all.validate(c.src));
+        Parser p;
+        p.set_features(PARSE_ALL_FEATURES & ~c.feature);
+        ValidationResult r = p.validate(c.src);
+        EXPECT_FALSE(r);
+        EXPECT_NE(r.message.find("disabled"), npos);
+        // the other features do not matter
+        p.set_features(c.feature);
+        EXPECT_TRUE(p.validate(c.src));
+    }
+    ExpectError::do_check([]{
+        Parser p;
+        p.set_features(0);
+        Tree t = p.parse({}, csubstr("a: &anchor 1\n"));
+    });
+}
+
+} // namespace yml
+} // namespace c4
@@ -0,0 +1,145 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parse_file.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include "./test_case.hpp"
+
+namespace c4 {
+namespace yml {
+
+/** a file which is removed at the end of the scope */
+struct ScopedFile
+{
+    std::string path;
+    ScopedFile(const char *name, csubstr contents) : path(name)
+    {
+        FILE *f = fopen(path.c_str(), "wb");
+        EXPECT_NE(f, nullptr);
+        if(f)
+        {
+            fwrite(contents.str, 1, contents.len, f);
+            fclose(f);
+        }
+    }
+    ~ScopedFile() { remove(path.c_str()); }
+    std::string contents() const
+    {
+        std::string s;
+        FILE *f = fopen(path.c_str(), "rb");
+        if( ! f)
+            return s;
+        char buf[256];
+        size_t n;
+        while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            s.append(buf, n);
+        fclose(f);
+        return s;
+    }
+};
+
+csubstr src = R"(a: 1
+b: [2, 3]
+c: "x\ty\n"
+d: 'it''s'
+e:
+  plain
+  folded
+)";
+
+TEST(parse_file, same_as_parse)
+{
+    ScopedFile f("ryml_test_parse_file.yml", src);
+    Tree expected = parse(src);
+    Tree t = parse_file(f.path.c_str());
+    EXPECT_TRUE(t.owns_source());
+    EXPECT_EQ(emitrs<std::string>(t), emitrs<std::string>(expected));
+    // the scalars are filtered in the mapping, not in the arena
+    EXPECT_EQ(t.arena_size(), 0u);
+    EXPECT_EQ(t["c"].val(), "x\ty\n");
+    EXPECT_FALSE(t.in_arena(t["c"].val()));
+    // and the file is not modified
+    EXPECT_EQ(f.contents(), std::string(src.str, src.len));
+}
+
+TEST(parse_file, copies_share_the_mapping)
+{
+    ScopedFile f("ryml_test_parse_file_copies.yml", src);
+    Tree copy, moved;
+    {
+        Tree t = parse_file(f.path.c_str());
+        copy = t;
+        moved = std::move(t);
+        EXPECT_FALSE(t.owns_source());
+    }
+    EXPECT_TRUE(copy.owns_source());
+    EXPECT_TRUE(moved.owns_source());
+    EXPECT_EQ(copy["d"].val(), "it's");
+    moved.clear();
+    EXPECT_FALSE(moved.owns_source()); // released by clear()
+    EXPECT_EQ(copy["e"].val(), "plain folded"); // but kept by the copy
+    moved = Tree();
+    EXPECT_EQ(copy["e"].val(), "plain folded");
+}
+
+TEST(parse_file, reused_tree_releases_the_mappings)
+{
+    ScopedFile f1("ryml_test_parse_file_reuse_1.yml", "a: 1\n");
+    ScopedFile f2("ryml_test_parse_file_reuse_2.yml", "b: [c, d]\n");
+    Tree t;
+    Parser p;
+    for(int i = 0; i < 10; ++i)
+    {
+        t.clear();
+        EXPECT_FALSE(t.owns_source());
+        parse_file(&p, f1.path.c_str(), &t, t.root_id());
+        EXPECT_TRUE(t.owns_source());
+        EXPECT_EQ(t["a"].val(), "1");
+        t.clear();
+        EXPECT_FALSE(t.owns_source());
+        parse_file(&p, f2.path.c_str(), &t, t.root_id());
+        EXPECT_TRUE(t.owns_source());
+        EXPECT_EQ(t["b"][1].val(), "d");
+    }
+    t.clear();
+    EXPECT_FALSE(t.owns_source());
+}
+
+TEST(parse_file, several_files_in_a_tree)
+{
+    ScopedFile f1("ryml_test_parse_file_1.yml", "a: 1\n");
+    ScopedFile f2("ryml_test_parse_file_2.yml", "b: [c, d]\n");
+    Tree t;
+    t.rootref() |= MAP;
+    size_t x = t.append_child(t.root_id());
+    size_t y = t.append_child(t.root_id());
+    t.to_map(x, "x");
+    t.to_map(y, "y");
+    Parser p;
+    parse_file(&p, f1.path.c_str(), &t, x);
+    parse_file(&p, f2.path.c_str(), &t, y);
+    EXPECT_EQ(t["x"]["a"].val(), "1");
+    EXPECT_EQ(t["y"]["b"][1].val(), "d");
+    Tree copy = t;
+    t = Tree();
+    EXPECT_EQ(copy["x"]["a"].val(), "1");
+    EXPECT_EQ(copy["y"]["b"][0].val(), "c");
+}
+
+TEST(parse_file, empty_file)
+{
+    ScopedFile f("ryml_test_parse_file_empty.yml", "");
+    Tree t = parse_file(f.path.c_str());
+    EXPECT_TRUE(t.empty() || ! t.rootref().has_children());
+}
+
+TEST(parse_file, missing_file)
+{
+    ExpectError::do_check([]{
+        Tree t = parse_file("ryml_test_parse_file_does_not_exist.yml");
+    });
+}
+
+} // namespace yml
+} // namespace c4
@@ -2,6 +2,44 @@
 
 namespace c4 {
 namespace yml {
+
+TEST(plain_scalar, large)
+{
+    // the filtering is linear in the size of the scalar
+    std::string src = "a:\n  first";
+    std::string expected = "first";
+    for(size_t i = 0; i < 50000; ++i)
+    {
+        src += "\n\n  word\r\n  other";
+        expected += "\nword other";
+    }
+    src += "\nb: c\n";
+    Tree t = parse(to_substr(src));
+    EXPECT_EQ(t["a"].val(), to_csubstr(expected));
+    EXPECT_EQ(t["b"].val(), "c");
+}
+
+TEST(plain_scalar, continuation_lines)
+{
+    Tree t = parse(R"(a: first
+  second
+
+  third
+b: c
+d: e
+   f
+)");
+    EXPECT_EQ(t["a"].val(), "first second\nthird");
+    EXPECT_EQ(t["b"].val(), "c");
+    EXPECT_EQ(t["d"].val(), "e f");
+    ExpectError::do_check([]{ parse(csubstr("a: b\n  c: d\n")); });
+    ExpectError::do_check([]{ parse(csubstr("a: b\n  c:\n")); });
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
 #define PLAIN_SCALAR_CASES                                          \
     "plain scalar, 1 word only",                                    \
     "plain scalar, 1 line with spaces",                             \
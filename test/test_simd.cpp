@@ -0,0 +1,155 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/detail/simd.hpp"
+#include <gtest/gtest.h>
+
+namespace c4 {
+namespace yml {
+namespace detail {
+
+// exercise every position relative to the register widths,
+// including the scalar tail
+const size_t sizes[] = {0, 1, 2, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100};
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(simd, find_newline)
+{
+    for(size_t sz : sizes)
+    {
+        std::string s(sz, 'a');
+        EXPECT_EQ(find_newline(to_csubstr(s)), npos) << "sz=" << sz;
+        EXPECT_EQ(find_newline_scalar(to_csubstr(s)), npos) << "sz=" << sz;
+        for(size_t pos = 0; pos < sz; ++pos)
+        {
+            for(char nl : {'\n', '\r'})
+            {
+                std::string t = s;
+                t[pos] = nl;
+                if(pos + 1 < sz)
+                    t[sz - 1] = '\n'; // the first one must be found
+                EXPECT_EQ(find_newline(to_csubstr(t)), pos) << "sz=" << sz;
+                EXPECT_EQ(find_newline_scalar(to_csubstr(t)), pos) << "sz=" << sz;
+            }
+        }
+    }
+}
+
+TEST(simd, count_leading_spaces)
+{
+    for(size_t sz : sizes)
+    {
+        std::string s(sz, ' ');
+        EXPECT_EQ(count_leading_spaces(to_csubstr(s)), sz);
+        EXPECT_EQ(count_leading_spaces_scalar(to_csubstr(s)), sz);
+        for(size_t pos = 0; pos < sz; ++pos)
+        {
+            std::string t = s;
+            t[pos] = 'x';
+            EXPECT_EQ(count_leading_spaces(to_csubstr(t)), pos) << "sz=" << sz;
+            EXPECT_EQ(count_leading_spaces_scalar(to_csubstr(t)), pos) << "sz=" << sz;
+            t[pos] = '\t'; // tabs are not indentation
+            EXPECT_EQ(count_leading_spaces(to_csubstr(t)), pos) << "sz=" << sz;
+        }
+    }
+}
+
+TEST(simd, find_structural)
+{
+    const char structural[] = ":-#'\"[]{},";
+    const char others[] = "abc \t\n\r!&*|>?%@`09_";
+    for(size_t sz : sizes)
+    {
+        std::string s(sz, 'a');
+        for(size_t i = 0; i < sz; ++i)
+            s[i] = others[i % (sizeof(others) - 1)];
+        EXPECT_EQ(find_structural(to_csubstr(s)), npos) << "sz=" << sz;
+        EXPECT_EQ(find_structural_scalar(to_csubstr(s)), npos) << "sz=" << sz;
+        for(size_t pos = 0; pos < sz; ++pos)
+        {
+            for(char c : csubstr(structural))
+            {
+                std::string t = s;
+                t[pos] = c;
+                EXPECT_EQ(find_structural(to_csubstr(t)), pos) << "sz=" << sz << " c=" << c;
+                EXPECT_EQ(find_structural_scalar(to_csubstr(t)), pos) << "sz=" << sz << " c=" << c;
+            }
+        }
+    }
+}
+
+TEST(simd, find_dquot_special)
+{
+    for(size_t sz : sizes)
+    {
+        std::string s(sz, 'a');
+        for(size_t i = 0; i < sz; ++i)
+            s[i] = "ab \"'\t"[i % 6];
+        EXPECT_EQ(find_dquot_special(to_csubstr(s)), npos) << "sz=" << sz;
+        EXPECT_EQ(find_dquot_special_scalar(to_csubstr(s)), npos) << "sz=" << sz;
+        for(size_t pos = 0; pos < sz; ++pos)
+        {
+            for(char c : {'\\', '\n', '\r'})
+            {
+                std::string t = s;
+                t[pos] = c;
+                EXPECT_EQ(find_dquot_special(to_csubstr(t)), pos) << "sz=" << sz << " c=" << c;
+                EXPECT_EQ(find_dquot_special_scalar(to_csubstr(t)), pos) << "sz=" << sz << " c=" << c;
+            }
+        }
+    }
+}
+
+TEST(simd, count_tree_tokens)
+{
+    // place each pair at every position, so that it straddles the
+    // register and block boundaries
+    struct { const char *pair; size_t separators, openers, dashes, wide_escapes; } cases[] = {
+        {",:", 2, 0, 0, 0},
+        {"?[", 1, 1, 0, 0},
+        {"{-", 0, 1, 0, 0}, // the dash is followed by x
+        {"- ", 0, 0, 1, 0},
+        {"-\t", 0, 0, 1, 0},
+        {"-\n", 0, 0, 1, 0},
+        {"-\r", 0, 0, 1, 0},
+        {"--", 0, 0, 0, 0},
+        {"\\L", 0, 0, 0, 1},
+        {"\\P", 0, 0, 0, 1},
+        {"\\N", 0, 0, 0, 0},
+    };
+    for(size_t sz : sizes)
+    {
+        std::string s(sz, 'x');
+        tree_token_counts c = count_tree_tokens(to_csubstr(s));
+        EXPECT_EQ(c.separators + c.openers + c.dashes + c.wide_escapes, 0u) << "sz=" << sz;
+        for(auto const& tc : cases)
+        {
+            for(size_t pos = 0; pos + 2 < sz; ++pos) // leave an x at the end
+            {
+                std::string t = s;
+                t[pos] = tc.pair[0];
+                t[pos + 1] = tc.pair[1];
+                for(tree_token_counts r : {count_tree_tokens(to_csubstr(t)), count_tree_tokens_scalar(to_csubstr(t))})
+                {
+                    EXPECT_EQ(r.separators, tc.separators) << "sz=" << sz << " pos=" << pos << " pair=" << tc.pair;
+                    EXPECT_EQ(r.openers, tc.openers) << "sz=" << sz << " pos=" << pos << " pair=" << tc.pair;
+                    EXPECT_EQ(r.dashes, tc.dashes) << "sz=" << sz << " pos=" << pos << " pair=" << tc.pair;
+                    EXPECT_EQ(r.wide_escapes, tc.wide_escapes) << "sz=" << sz << " pos=" << pos << " pair=" << tc.pair;
+                }
+            }
+        }
+        if(sz)
+        {
+            // a dash at the end is followed by the end
+            s.back() = '-';
+            EXPECT_EQ(count_tree_tokens(to_csubstr(s)).dashes, 1u) << "sz=" << sz;
+            EXPECT_EQ(count_tree_tokens_scalar(to_csubstr(s)).dashes, 1u) << "sz=" << sz;
+        }
+    }
+}
+
+} // namespace detail
+} // namespace yml
+} // namespace c4
@@ -3,6 +3,55 @@
 namespace c4 {
 namespace yml {
 
+TEST(single_quoted, folding)
+{
+    Tree t = parse(R"(- 'a  
+   b
+
+   c
+
+
+   d'
+- 'e''
+  ''f'
+)");
+    EXPECT_EQ(t[0].val(), "a b\nc\n\nd");
+    EXPECT_EQ(t[1].val(), "e' 'f");
+}
+
+TEST(single_quoted, folding_without_indentation)
+{
+    // the line break is folded even when nothing else needs filtering
+    Tree t = parse(R"('a
+b')");
+    EXPECT_EQ(t.rootref().val(), "a b");
+    t = parse(R"(k: 'a
+  b'
+)");
+    EXPECT_EQ(t["k"].val(), "a b");
+}
+
+TEST(single_quoted, large)
+{
+    // the filtering is linear in the size of the scalar
+    std::string src = "'";
+    std::string expected;
+    for(size_t i = 0; i < 50000; ++i)
+    {
+        src += "it''s a\n  line\n\n";
+        expected += "it's a line\n";
+    }
+    // the closing quote comes after an empty line, which is folded
+    // to a line break like the others
+    src += "'";
+    Tree t = parse(to_substr(src));
+    EXPECT_EQ(t.rootref().val(), to_csubstr(expected));
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
 #define SINGLE_QUOTED_CASES                             \
             "squoted, only text",                       \
             "squoted, with double quotes",              \
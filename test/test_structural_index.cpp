@@ -0,0 +1,128 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/structural_index.hpp"
+#include "c4/yml/parse.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+
+namespace c4 {
+namespace yml {
+
+size_t naive_find(csubstr s, size_t pos, size_t end, csubstr chars)
+{
+    for(size_t i = pos; i < end; ++i)
+        if(chars.first_of(s[i]) != npos)
+            return i;
+    return npos;
+}
+
+void test_index(csubstr src, size_t num_threads)
+{
+    StructuralIndex idx;
+    idx.build(src, num_threads);
+    ASSERT_EQ(idx.size(), src.len);
+    size_t num_newlines = 0;
+    for(char c : src)
+        num_newlines += (c == '\n' || c == '\r');
+    EXPECT_EQ(idx.count_newlines(), num_newlines);
+    for(size_t pos = 0; pos <= src.len; ++pos)
+    {
+        EXPECT_EQ(idx.find_newline(pos), naive_find(src, pos, src.len, "\n\r")) << "pos=" << pos;
+        EXPECT_EQ(idx.find_structural(pos, src.len), naive_find(src, pos, src.len, ":-#'\"[]{},")) << "pos=" << pos;
+        size_t end = pos + 5 < src.len ? pos + 5 : src.len;
+        EXPECT_EQ(idx.find_structural(pos, end), naive_find(src, pos, end, ":-#'\"[]{},")) << "pos=" << pos;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(StructuralIndex, empty)
+{
+    StructuralIndex idx;
+    idx.build({});
+    EXPECT_TRUE(idx.empty());
+    EXPECT_EQ(idx.find_newline(0), npos);
+    EXPECT_EQ(idx.find_structural(0, 0), npos);
+    EXPECT_EQ(idx.count_newlines(), 0u);
+}
+
+TEST(StructuralIndex, small)
+{
+    test_index("a", 1);
+    test_index("\n", 1);
+    test_index("a: b\nc: d\r\n- [e, f]\n", 1);
+    test_index("{\"a\": 'b', c: d} # comment", 1);
+}
+
+TEST(StructuralIndex, word_boundaries)
+{
+    // put the characters at every position around the 64-bit words
+    for(size_t sz : {63u, 64u, 65u, 127u, 128u, 129u, 200u})
+    {
+        std::string s(sz, 'x');
+        for(size_t i = 0; i < sz; i += 7)
+            s[i] = ':';
+        for(size_t i = 3; i < sz; i += 11)
+            s[i] = '\n';
+        test_index(to_csubstr(s), 1);
+    }
+}
+
+TEST(StructuralIndex, reuse)
+{
+    StructuralIndex idx;
+    idx.build("a: b\nc: d\n");
+    EXPECT_EQ(idx.find_newline(5), 9u);
+    idx.build("ab");
+    EXPECT_EQ(idx.size(), 2u);
+    EXPECT_EQ(idx.find_newline(0), npos);
+    EXPECT_EQ(idx.find_structural(0, 2), npos);
+}
+
+TEST(StructuralIndex, multiple_threads)
+{
+    // large enough to be split among the threads
+    std::string s;
+    const size_t sz = 4u * StructuralIndex::min_bytes_per_thread + 37u;
+    s.reserve(sz);
+    while(s.size() < sz)
+        s += "key: [val0, val1] # and a comment\n";
+    s.resize(sz);
+    StructuralIndex serial, parallel;
+    serial.build(to_csubstr(s), 1);
+    parallel.build(to_csubstr(s), 4);
+    EXPECT_EQ(serial.count_newlines(), parallel.count_newlines());
+    for(size_t pos = 0; pos < sz; pos += 97u)
+    {
+        EXPECT_EQ(serial.find_newline(pos), parallel.find_newline(pos));
+        EXPECT_EQ(serial.find_structural(pos, sz), parallel.find_structural(pos, sz));
+    }
+    EXPECT_EQ(parallel.find_newline(sz - 5u), npos);
+}
+
+TEST(StructuralIndex, parse_with_and_without_index)
+{
+    csubstr srcs[] = {
+        "a: 1\nb: [2, 3]\nc: {d: e}\n",
+        "a:\n  plain\n  multi line\n\n  scalar\nb: 'x\n  y'\n",
+        "- a\n- b: c\n  d: |\n    text\n- \"x\\ty\"\n",
+        "k: {a: b,\n  c: [d,\n  e]}\n",
+        "--- a\n--- b\n",
+    };
+    for(csubstr src : srcs)
+    {
+        SCOPED_TRACE(src);
+        Parser indexed, scanned;
+        indexed.set_index_min_size(0);
+        scanned.set_index_min_size(~size_t(0));
+        Tree expected = indexed.parse({}, src);
+        Tree actual = scanned.parse({}, src);
+        EXPECT_EQ(emitrs<std::string>(actual), emitrs<std::string>(expected));
+    }
+    EXPECT_EQ(Parser().index_min_size(), (size_t)Parser::index_min_size_default);
+}
+
+} // namespace yml
+} // namespace c4
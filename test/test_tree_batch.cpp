@@ -0,0 +1,142 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/tree_batch.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace c4 {
+namespace yml {
+
+namespace {
+
+struct AllocationCounter : public MemoryResource
+{
+    size_t num_allocations = 0;
+    void *allocate(size_t num_bytes, void *hint) override
+    {
+        ++num_allocations;
+        return get_memory_resource()->allocate(num_bytes, hint);
+    }
+    void free(void *mem, size_t num_bytes) override
+    {
+        get_memory_resource()->free(mem, num_bytes);
+    }
+};
+
+std::string _message(size_t i)
+{
+    return "id: " + std::to_string(i) + "\n"
+        "method: \"set\\tvalue\"\n"
+        "params: [" + std::to_string(i * 3) + ", {key: k" + std::to_string(i) + "}]\n";
+}
+
+} // namespace
+
+TEST(TreeBatch, same_as_parse)
+{
+    csubstr srcs[] = {
+        "a: 1\nb: [2, 3]\nc: {d: e}\n",
+        "- a\n- b: c\n  d: |\n    text\n- \"x\\ty\"\n",
+        "{}",
+        "[]",
+        "a: \"\\L\\P\\L\\P\\L\\P\"\n",
+    };
+    TreeBatch batch;
+    for(size_t i = 0; i < C4_COUNTOF(srcs); ++i)
+        EXPECT_EQ(batch.parse(srcs[i]), i);
+    ASSERT_EQ(batch.size(), C4_COUNTOF(srcs));
+    EXPECT_EQ(batch.tree().rootref().num_children(), C4_COUNTOF(srcs));
+    for(size_t i = 0; i < C4_COUNTOF(srcs); ++i)
+    {
+        SCOPED_TRACE(srcs[i]);
+        Tree expected = parse(srcs[i]);
+        EXPECT_EQ(emitrs<std::string>(batch[i]), emitrs<std::string>(expected.rootref()));
+        EXPECT_EQ(batch[i].id(), batch.doc_id(i));
+        EXPECT_EQ(batch.tree().parent(batch.doc_id(i)), batch.tree().root_id());
+    }
+}
+
+TEST(TreeBatch, in_situ)
+{
+    std::string buf = "a: b\nc: [d, e]\n";
+    TreeBatch batch;
+    batch.parse(to_substr(buf));
+    batch.parse(csubstr("f: g"));
+    EXPECT_EQ(batch[0]["a"].val(), "b");
+    EXPECT_EQ(batch[0]["c"][1].val(), "e");
+    EXPECT_EQ(batch[1]["f"].val(), "g");
+    // the in-situ source is not copied to the arena
+    EXPECT_FALSE(batch.tree().in_arena(batch[0]["a"].val()));
+    EXPECT_TRUE(batch.tree().in_arena(batch[1]["f"].val()));
+}
+
+TEST(TreeBatch, docs)
+{
+    TreeBatch batch;
+    EXPECT_TRUE(batch.empty());
+    EXPECT_EQ(batch.tree().rootref().num_children(), 0u);
+    for(size_t i = 0; i < 100; ++i)
+        batch.parse(to_csubstr(_message(i)));
+    size_t i = 0;
+    for(NodeRef doc : batch.docs())
+    {
+        EXPECT_EQ(doc.id(), batch.doc_id(i));
+        EXPECT_EQ(doc["id"].val(), to_csubstr(std::to_string(i)));
+        EXPECT_EQ(doc["method"].val(), "set\tvalue");
+        EXPECT_EQ(doc["params"][1]["key"].val(), to_csubstr("k" + std::to_string(i)));
+        ++i;
+    }
+    EXPECT_EQ(i, 100u);
+}
+
+TEST(TreeBatch, clear_keeps_memory)
+{
+    AllocationCounter mr;
+    TreeBatch batch(Allocator{&mr});
+    std::vector<std::string> msgs;
+    for(size_t i = 0; i < 1000; ++i)
+        msgs.push_back(_message(i));
+    for(std::string const& msg : msgs)
+        batch.parse(to_csubstr(msg));
+    const size_t cap = batch.tree().capacity();
+    const size_t arena_cap = batch.tree().arena_capacity();
+    // the memory grows geometrically, not once per document
+    EXPECT_LT(mr.num_allocations, 100u);
+    for(int pass = 0; pass < 3; ++pass)
+    {
+        batch.clear();
+        EXPECT_TRUE(batch.empty());
+        EXPECT_EQ(batch.tree().rootref().num_children(), 0u);
+        const size_t num_allocations = mr.num_allocations;
+        for(std::string const& msg : msgs)
+            batch.parse(to_csubstr(msg));
+        EXPECT_EQ(mr.num_allocations, num_allocations);
+        EXPECT_EQ(batch.size(), msgs.size());
+        EXPECT_EQ(batch.tree().capacity(), cap);
+        EXPECT_EQ(batch.tree().arena_capacity(), arena_cap);
+        EXPECT_EQ(batch[999]["params"][1]["key"].val(), "k999");
+    }
+}
+
+TEST(TreeBatch, reserve)
+{
+    AllocationCounter mr;
+    TreeBatch batch(Allocator{&mr});
+    std::string msg = _message(0);
+    batch.parse(to_csubstr(msg)); // let the parser allocate its memory
+    batch.clear();
+    TreeCapacity cap = estimate_tree_capacity(to_csubstr(msg));
+    batch.reserve(50, 50 * (cap.nodes + 1), 50 * (msg.size() + cap.arena));
+    const size_t num_allocations = mr.num_allocations;
+    for(size_t i = 0; i < 50; ++i)
+        batch.parse(to_csubstr(msg));
+    EXPECT_EQ(mr.num_allocations, num_allocations);
+    batch.shrink();
+    EXPECT_TRUE(batch.empty());
+    EXPECT_EQ(batch.tree().arena_capacity(), 0u);
+    batch.parse(to_csubstr(msg));
+    EXPECT_EQ(batch[0]["method"].val(), "set\tvalue");
+}
+
+} // namespace yml
+} // namespace c4
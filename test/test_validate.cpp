@@ -0,0 +1,141 @@
+#include "c4/yml/std/string.hpp"
+#include "c4/yml/parse.hpp"
+#include "c4/yml/emit.hpp"
+#include <gtest/gtest.h>
+
+namespace c4 {
+namespace yml {
+
+TEST(validate, valid_sources)
+{
+    csubstr srcs[] = {
+        "",
+        "a: 1\nb: [2, 3]\nc: {d: e}\n",
+        "- a\n- b: c\n  d: |\n    text\n- \"x\\ty\"\n",
+        "a:\n  plain\n  scalar\nb: 'single ''quoted''\n  folded'\n",
+        "a: >-\n  folded\n  text\n\nb: \"\\u00e9\\L\\P\\x41\"\n",
+        "--- a\n--- b\n",
+        "a: &anchor\n  b: 1\nc: *anchor\n",
+        "{\"a\": [1, 2, {\"b\": null}]}",
+    };
+    Parser p;
+    for(csubstr src : srcs)
+    {
+        SCOPED_TRACE(src);
+        ValidationResult r = p.validate(src);
+        EXPECT_TRUE(r);
+        EXPECT_TRUE(r.ok);
+        EXPECT_TRUE(r.message.empty());
+        EXPECT_FALSE(r.location);
+    }
+}
+
+TEST(validate, source_is_not_modified)
+{
+    const std::string src = "a: \"x\\ty\\n\\L\\\"z\"\nb: 'it''s\n  folded'\nc:\n  plain\n\n  scalar\nd: |\n    keep\n\n";
+    std::string buf = src;
+    Parser p;
+    EXPECT_TRUE(p.validate(to_csubstr(buf)));
+    EXPECT_EQ(buf, src);
+    // the same parser still builds the tree as before
+    Tree t = p.parse(to_csubstr(buf));
+    EXPECT_EQ(t["a"].val(), "x\ty\n\xe2\x80\xa8\"z");
+    EXPECT_EQ(t["b"].val(), "it's folded");
+    EXPECT_EQ(t["c"].val(), "plain\nscalar");
+    EXPECT_EQ(t["d"].val(), "keep\n");
+}
+
+TEST(validate, errors)
+{
+    csubstr srcs[] = {
+        "a: b\n  c: d\n",
+        "a: b\n  c:\n",
+        "\"\\xZZ\"",
+        "\"\\u12\"",
+        "\"\\UFFFFFFFF\"",
+        "a: \"unclosed\n",
+        "a: 'unclosed\nb: c\n",
+        "}\n",
+        "- a\n}\n",
+    };
+    Parser p;
+    for(csubstr src : srcs)
+    {
+        SCOPED_TRACE(src);
+        // the default error callback aborts, so this also checks that
+        // the errors are not sent to it
+        ValidationResult r = p.validate("file.yml", src);
+        EXPECT_FALSE(r);
+        EXPECT_FALSE(r.message.empty());
+        EXPECT_EQ(r.location.name, "file.yml");
+        EXPECT_GE(r.location.line, 1u);
+        EXPECT_LE(r.location.offset, src.len);
+    }
+}
+
+TEST(validate, first_error_is_kept)
+{
+    // the parser unwinds at the first error, so the following ones are
+    // not reached
+    Parser p;
+    ValidationResult r = p.validate("a: \"\\xZZ\"\nb: c\n  d: e\n  f: [g\n");
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.location.line, 1u);
+    EXPECT_NE(r.message.find("escape"), npos);
+}
+
+TEST(validate, error_location)
+{
+    Parser p;
+    ValidationResult r = p.validate("a: 1\nb: 2\nc: \"\\xZZ\"\n");
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.location.line, 3u);
+    EXPECT_NE(r.message.find("escape"), npos);
+}
+
+TEST(validate, parser_is_reusable_after_an_error)
+{
+    Parser p;
+    EXPECT_FALSE(p.validate("a: b\n  c: d\n"));
+    EXPECT_TRUE(p.validate("a: [1, 2]\n"));
+    Tree t = p.parse(csubstr("a: [1, 2]\n"));
+    EXPECT_EQ(t["a"][1].val(), "2");
+    EXPECT_FALSE(p.validate("\"\\xZZ\""));
+    EXPECT_TRUE(p.validate("- x\n- y\n"));
+}
+
+TEST(validate, large_invalid_source)
+{
+    // larger than the size from which parse() builds the structural
+    // index, which validate() does not build
+    std::string src;
+    while(src.size() < 2 * Parser::index_min_size_default)
+        src += "key" + std::to_string(src.size()) + ": [a, b, {c: d}]\n";
+    src += "bad: \"\\xZZ\"\n";
+    Parser p;
+    ValidationResult r = p.validate(to_csubstr(src));
+    ASSERT_FALSE(r);
+    EXPECT_NE(r.message.find("escape"), npos);
+    src.resize(src.size() - 12);
+    EXPECT_TRUE(p.validate(to_csubstr(src)));
+}
+
+TEST(validate, same_verdict_as_parse)
+{
+    // a large valid source, to go through the release of the scratch nodes
+    std::string src;
+    for(size_t i = 0; i < 200; ++i)
+    {
+        src += "key" + std::to_string(i) + ":\n";
+        src += "  seq: [a, 'b', \"c\\td\"]\n";
+        src += "  map: {e: f}\n";
+        src += "  block: |\n    text\n";
+    }
+    Parser p;
+    EXPECT_TRUE(p.validate(to_csubstr(src)));
+    Tree t = p.parse(to_csubstr(src));
+    EXPECT_EQ(t.rootref().num_children(), 200u);
+}
+
+} // namespace yml
+} // namespace c4